@@ -163,6 +163,8 @@ bool noOverwriteTexture_ = false;
 bool noOverwriteNewerTexture_ = false;
 bool checkUniqueModel_ = true;
 bool moveToBindPose_ = false;
+bool compressAnimations_ = false;
+float animationSampleRate_ = 30.0f;
 unsigned maxBones_ = 64;
 Vector<String> nonSkinningBoneIncludes_;
 Vector<String> nonSkinningBoneExcludes_;
@@ -303,6 +305,8 @@ void Run(const Vector<String>& arguments)
             "-ctn        Check and do not overwrite if texture has newer timestamp\n"
             "-am         Export all meshes even if identical (scene mode only)\n"
             "-bp         Move bones to bind pose before saving model\n"
+            "-ac <rate>  Save animations in the compressed format, uniformly sampled at the\n"
+            "            given rate per second. Default 30\n"
             "-split <start> <end> (animation model only)\n"
             "            Split animation, will only import from start frame to end frame\n"
             "-np         Do not suppress $fbx pivot nodes (FBX files only)\n"
@@ -456,6 +460,17 @@ void Run(const Vector<String>& arguments)
                 checkUniqueModel_ = false;
             else if (argument == "bp")
                 moveToBindPose_ = true;
+            else if (argument == "ac")
+            {
+                compressAnimations_ = true;
+                if (value.Length() && value[0] != '-')
+                {
+                    animationSampleRate_ = ToFloat(value);
+                    if (animationSampleRate_ <= 0.0f)
+                        animationSampleRate_ = 30.0f;
+                    ++i;
+                }
+            }
             else if (argument == "split")
             {
                 String value2 = i + 2 < arguments.Size() ? arguments[i + 2] : String::EMPTY;
@@ -1482,6 +1497,8 @@ void BuildAndSaveAnimations(OutModel* model)
         File outFile(context_);
         if (!outFile.Open(animOutName, FILE_WRITE))
             ErrorExit("Could not open output file " + animOutName);
+        if (compressAnimations_)
+            outAnim->Compress(animationSampleRate_);
         outAnim->Save(outFile);
     }
 }
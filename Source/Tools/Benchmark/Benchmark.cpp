@@ -0,0 +1,573 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Graphics/AnimationState.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Resource/Image.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+#ifdef URHO3D_NETWORK
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkPriority.h>
+#endif
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <cstdio>
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+SharedPtr<Context> context_(new Context());
+String prefixPath_;
+unsigned numThreads_ = GetNumLogicalCPUs() - 1;
+unsigned count_ = 0;
+unsigned numClients_ = 100;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+void BenchmarkWorkQueue();
+void BenchmarkAnimation();
+void BenchmarkCulling();
+void BenchmarkSpatialIndex();
+void BenchmarkNetwork();
+void BenchmarkLoading();
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Empty())
+        ErrorExit(
+            "Usage: Benchmark <benchmark> [options]\n"
+            "\n"
+            "Benchmarks:\n"
+            "workqueue  Work item, dependency chain and ParallelFor throughput compared to a serial run\n"
+            "animation  Threaded animation and skinning of AnimatedModels, reported as models per millisecond\n"
+            "culling    Frustum queries over a 20_HugeObjectCount style grid, packed bounds test compared to per-drawable test\n"
+            "spatial    Update and query cost of moving drawables with the octree and the BVH spatial index\n"
+            "network    Server update of a replicated scene to loopback clients (requires network support)\n"
+            "loading    Background loading of the textures and models in the Data resource directory\n"
+            "\n"
+            "Options:\n"
+            "-t      Number of worker threads without a space, default is the number of logical CPUs minus one\n"
+            "-n      Number of items, models, drawables or nodes without a space, default depends on the benchmark\n"
+            "-c      Number of network clients without a space, default 100\n"
+            "-p      Resource prefix path containing the Data and CoreData directories, default is the program directory's parent\n"
+        );
+
+    context_->RegisterSubsystem(new FileSystem(context_));
+    prefixPath_ = GetParentPath(context_->GetSubsystem<FileSystem>()->GetProgramDir());
+
+    for (unsigned i = 1; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String arg = arguments[i].Substring(1, 1).ToLower();
+            String value = arguments[i].Substring(2);
+            if (arg == "t")
+                numThreads_ = ToUInt(value);
+            else if (arg == "n")
+                count_ = ToUInt(value);
+            else if (arg == "c")
+                numClients_ = Max(ToUInt(value), 1U);
+            else if (arg == "p" && !value.Empty())
+                prefixPath_ = AddTrailingSlash(GetInternalPath(value));
+        }
+    }
+
+    context_->RegisterSubsystem(new Time(context_));
+    context_->RegisterSubsystem(new Log(context_));
+    context_->GetSubsystem<Log>()->SetLevel(LOG_WARNING);
+    context_->RegisterSubsystem(new ResourceCache(context_));
+    auto* queue = new WorkQueue(context_);
+    context_->RegisterSubsystem(queue);
+    if (numThreads_)
+        queue->CreateThreads(numThreads_);
+    RegisterSceneLibrary(context_);
+    RegisterGraphicsLibrary(context_);
+
+    auto* cache = context_->GetSubsystem<ResourceCache>();
+    cache->AddResourceDir(prefixPath_ + "Data");
+    cache->AddResourceDir(prefixPath_ + "CoreData");
+
+    String benchmark = arguments[0].ToLower();
+    if (benchmark == "workqueue")
+        BenchmarkWorkQueue();
+    else if (benchmark == "animation")
+        BenchmarkAnimation();
+    else if (benchmark == "culling")
+        BenchmarkCulling();
+    else if (benchmark == "spatial")
+        BenchmarkSpatialIndex();
+    else if (benchmark == "network")
+        BenchmarkNetwork();
+    else if (benchmark == "loading")
+        BenchmarkLoading();
+    else
+        ErrorExit("Unknown benchmark " + arguments[0]);
+}
+
+/// Fixed amount of arithmetic standing in for the payload of a small work item.
+static float Spin(unsigned seed)
+{
+    float value = (float)seed;
+    for (unsigned i = 0; i < 2000; ++i)
+        value = value * 0.999f + 1.0f;
+    return value;
+}
+
+static void SpinWork(const WorkItem* item, unsigned /*threadIndex*/)
+{
+    *reinterpret_cast<float*>(item->start_) = Spin((unsigned)(size_t)item->aux_);
+}
+
+void BenchmarkWorkQueue()
+{
+    auto* queue = context_->GetSubsystem<WorkQueue>();
+    unsigned numItems = count_ ? count_ : 20000;
+    PODVector<float> results(numItems);
+    HiresTimer timer;
+
+    for (unsigned i = 0; i < numItems; ++i)
+        results[i] = Spin(i);
+    long long serialUs = timer.GetUSec(true);
+
+    // Independent items waited on through a group
+    WorkItemGroup group;
+    for (unsigned i = 0; i < numItems; ++i)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->workFunction_ = SpinWork;
+        item->start_ = &results[i];
+        item->aux_ = (void*)(size_t)i;
+        item->group_ = &group;
+        queue->AddWorkItem(item);
+    }
+    queue->Complete(group);
+    long long itemsUs = timer.GetUSec(true);
+
+    // Chains of eight dependent items
+    WorkItemGroup chainGroup;
+    for (unsigned i = 0; i < numItems; i += 8)
+    {
+        Vector<SharedPtr<WorkItem> > chain;
+        for (unsigned j = i; j < Min(i + 8, numItems); ++j)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->workFunction_ = SpinWork;
+            item->start_ = &results[j];
+            item->aux_ = (void*)(size_t)j;
+            item->group_ = &chainGroup;
+            if (!chain.Empty())
+                queue->AddDependency(item, chain.Back());
+            chain.Push(item);
+        }
+        for (unsigned j = 0; j < chain.Size(); ++j)
+            queue->AddWorkItem(chain[j]);
+    }
+    queue->Complete(chainGroup);
+    long long chainsUs = timer.GetUSec(true);
+
+    queue->ParallelFor(numItems, 16, [&results](unsigned start, unsigned end, unsigned /*threadIndex*/)
+    {
+        for (unsigned i = start; i < end; ++i)
+            results[i] = Spin(i);
+    });
+    long long parallelForUs = timer.GetUSec(true);
+
+    printf("%u items, %u worker threads\n", numItems, queue->GetNumThreads());
+    printf("serial      %8.3f ms\n", serialUs / 1000.0);
+    printf("work items  %8.3f ms\n", itemsUs / 1000.0);
+    printf("chains of 8 %8.3f ms\n", chainsUs / 1000.0);
+    printf("ParallelFor %8.3f ms\n", parallelForUs / 1000.0);
+}
+
+void BenchmarkAnimation()
+{
+    auto* cache = context_->GetSubsystem<ResourceCache>();
+    auto* model = cache->GetResource<Model>("Models/Mutant/Mutant.mdl");
+    auto* animation = cache->GetResource<Animation>("Models/Mutant/Mutant_Run.ani");
+    if (!model || !animation)
+        ErrorExit("Could not load the Mutant model and animation");
+
+    unsigned numModels = count_ ? count_ : 1000;
+    SharedPtr<Scene> scene(new Scene(context_));
+    auto* octree = scene->CreateComponent<Octree>();
+    auto* camera = scene->CreateChild("Camera")->CreateComponent<Camera>();
+
+    PODVector<AnimatedModel*> models;
+    unsigned side = (unsigned)ceilf(sqrtf((float)numModels));
+    for (unsigned i = 0; i < numModels; ++i)
+    {
+        Node* node = scene->CreateChild("Mutant");
+        node->SetPosition(Vector3((float)(i % side) * 2.0f, 0.0f, (float)(i / side) * 2.0f));
+        auto* animatedModel = node->CreateComponent<AnimatedModel>();
+        animatedModel->SetModel(model);
+        AnimationState* state = animatedModel->AddAnimationState(animation);
+        state->SetWeight(1.0f);
+        state->SetLooped(true);
+        state->SetTime(Random(animation->GetLength()));
+        models.Push(animatedModel);
+    }
+
+    FrameInfo frame;
+    frame.camera_ = camera;
+    frame.timeStep_ = 1.0f / 60.0f;
+    const unsigned numFrames = 100;
+    long long totalUs = 0;
+    HiresTimer timer;
+
+    for (unsigned i = 0; i < numFrames + 1; ++i)
+    {
+        frame.frameNumber_ = i + 1;
+        // Mark the models viewed on the previous frame, so that their skin matrices are also calculated during the update
+        for (unsigned j = 0; j < models.Size(); ++j)
+        {
+            models[j]->MarkInView(i);
+            models[j]->GetAnimationStates()[0]->AddTime(frame.timeStep_);
+        }
+
+        timer.Reset();
+        octree->Update(frame);
+        // Skip the first frame, which also creates the skinning data
+        if (i)
+            totalUs += timer.GetUSec(false);
+    }
+
+    double frameMs = totalUs / 1000.0 / numFrames;
+    printf("%u models, %u worker threads: %.3f ms per frame, %.1f models per ms\n", numModels,
+        context_->GetSubsystem<WorkQueue>()->GetNumThreads(), frameMs, numModels / frameMs);
+}
+
+/// Frustum query which tests drawables one at a time also where the octree provides packed bounds.
+class PerDrawableFrustumOctreeQuery : public FrustumOctreeQuery
+{
+public:
+    using FrustumOctreeQuery::FrustumOctreeQuery;
+
+    /// Intersection test for drawables with packed bounds.
+    void TestPackedDrawables(Drawable** start, Drawable** end, const DrawableBoundsBlock* /*bounds*/, bool inside) override
+    {
+        TestDrawables(start, end, inside);
+    }
+};
+
+/// Create a grid of boxes in the style of the 20_HugeObjectCount sample.
+static void CreateBoxGrid(Scene* scene, unsigned numBoxes, PODVector<Node*>& nodes)
+{
+    auto* box = context_->GetSubsystem<ResourceCache>()->GetResource<Model>("Models/Box.mdl");
+    if (!box)
+        ErrorExit("Could not load the box model");
+
+    int side = (int)ceilf(sqrtf((float)numBoxes));
+    for (unsigned i = 0; i < numBoxes; ++i)
+    {
+        Node* node = scene->CreateChild("Box");
+        node->SetPosition(Vector3((float)((int)(i % side) - side / 2) * 1.2f, 0.0f, (float)((int)(i / side) - side / 2) * 1.2f));
+        node->SetScale(0.25f);
+        node->CreateComponent<StaticModel>()->SetModel(box);
+        nodes.Push(node);
+    }
+}
+
+void BenchmarkCulling()
+{
+    unsigned numBoxes = count_ ? count_ : 250000;
+    SharedPtr<Scene> scene(new Scene(context_));
+    auto* octree = scene->CreateComponent<Octree>();
+    octree->SetSize(BoundingBox(-1000.0f, 1000.0f), 8);
+    auto* camera = scene->CreateChild("Camera")->CreateComponent<Camera>();
+    camera->SetFarClip(1000.0f);
+    PODVector<Node*> nodes;
+    CreateBoxGrid(scene, numBoxes, nodes);
+
+    FrameInfo frame;
+    frame.frameNumber_ = 1;
+    octree->Update(frame);
+
+    const unsigned numViews = 72;
+    PODVector<Drawable*> result;
+    result.Reserve(numBoxes);
+    long long packedUs = 0;
+    long long perDrawableUs = 0;
+    unsigned numVisible = 0;
+    bool equal = true;
+    HiresTimer timer;
+
+    for (unsigned i = 0; i < numViews; ++i)
+    {
+        camera->GetNode()->SetPosition(Vector3(0.0f, 40.0f, 0.0f));
+        camera->GetNode()->SetRotation(Quaternion(30.0f, i * 360.0f / numViews, 0.0f));
+
+        timer.Reset();
+        FrustumOctreeQuery packedQuery(result, camera->GetFrustum(), DRAWABLE_GEOMETRY);
+        octree->GetDrawables(packedQuery);
+        packedUs += timer.GetUSec(true);
+        unsigned numPacked = result.Size();
+        numVisible += numPacked;
+
+        result.Clear();
+        timer.Reset();
+        PerDrawableFrustumOctreeQuery perDrawableQuery(result, camera->GetFrustum(), DRAWABLE_GEOMETRY);
+        octree->GetDrawables(perDrawableQuery);
+        perDrawableUs += timer.GetUSec(true);
+        equal &= result.Size() == numPacked;
+        result.Clear();
+    }
+
+    printf("%u drawables, %u visible on average\n", numBoxes, numVisible / numViews);
+    printf("per-drawable test %8.3f ms per query\n", perDrawableUs / 1000.0 / numViews);
+    printf("packed test       %8.3f ms per query\n", packedUs / 1000.0 / numViews);
+    if (!equal)
+        printf("Warning: the queries returned different results\n");
+}
+
+void BenchmarkSpatialIndex()
+{
+    unsigned numBoxes = count_ ? count_ : 50000;
+    const char* names[] = { "octree", "BVH" };
+
+    for (unsigned type = 0; type < 2; ++type)
+    {
+        SetRandomSeed(1);
+        SharedPtr<Scene> scene(new Scene(context_));
+        auto* octree = scene->CreateComponent<Octree>();
+        octree->SetSize(BoundingBox(-1000.0f, 1000.0f), 8);
+        octree->SetSpatialIndex(type ? SPATIAL_INDEX_BVH : SPATIAL_INDEX_OCTREE);
+        auto* camera = scene->CreateChild("Camera")->CreateComponent<Camera>();
+        camera->SetFarClip(300.0f);
+        PODVector<Node*> nodes;
+        CreateBoxGrid(scene, numBoxes, nodes);
+
+        FrameInfo frame;
+        frame.frameNumber_ = 1;
+        octree->Update(frame);
+
+        // Move a quarter of the boxes every frame, then run a frustum query and a batch of raycasts
+        const unsigned numFrames = 50;
+        const unsigned numRays = 100;
+        PODVector<Drawable*> drawables;
+        PODVector<RayQueryResult> hits;
+        long long updateUs = 0;
+        long long frustumUs = 0;
+        long long raycastUs = 0;
+        HiresTimer timer;
+
+        for (unsigned i = 0; i < numFrames; ++i)
+        {
+            for (unsigned j = i % 4; j < nodes.Size(); j += 4)
+                nodes[j]->Translate(Vector3(Random(-1.0f, 1.0f), 0.0f, Random(-1.0f, 1.0f)));
+
+            frame.frameNumber_ = i + 2;
+            timer.Reset();
+            octree->Update(frame);
+            updateUs += timer.GetUSec(true);
+
+            camera->GetNode()->SetPosition(Vector3(0.0f, 40.0f, 0.0f));
+            camera->GetNode()->SetRotation(Quaternion(30.0f, i * 360.0f / numFrames, 0.0f));
+            timer.Reset();
+            FrustumOctreeQuery query(drawables, camera->GetFrustum(), DRAWABLE_GEOMETRY);
+            octree->GetDrawables(query);
+            frustumUs += timer.GetUSec(true);
+            drawables.Clear();
+
+            timer.Reset();
+            for (unsigned j = 0; j < numRays; ++j)
+            {
+                Ray ray(Vector3(Random(-100.0f, 100.0f), 10.0f, Random(-100.0f, 100.0f)), Vector3(Random(-0.5f, 0.5f), -1.0f,
+                    Random(-0.5f, 0.5f)).Normalized());
+                RayOctreeQuery rayQuery(hits, ray, RAY_AABB, 100.0f, DRAWABLE_GEOMETRY);
+                octree->RaycastSingle(rayQuery);
+                hits.Clear();
+            }
+            raycastUs += timer.GetUSec(true);
+        }
+
+        printf("%-6s %u drawables: update %.3f ms, frustum query %.3f ms, %u raycasts %.3f ms per frame\n", names[type],
+            numBoxes, updateUs / 1000.0 / numFrames, frustumUs / 1000.0 / numFrames, numRays, raycastUs / 1000.0 / numFrames);
+    }
+}
+
+void BenchmarkNetwork()
+{
+#ifdef URHO3D_NETWORK
+    const unsigned short port = 34567;
+    const float timeStep = 1.0f / 30.0f;
+    unsigned numNodes = count_ ? count_ : 2000;
+
+    RegisterNetworkLibrary(context_);
+    auto* server = new Network(context_);
+    context_->RegisterSubsystem(server);
+    server->SetUpdateFps(30);
+    if (!server->StartServer(port))
+        ErrorExit("Could not start the server");
+
+    // Half of the nodes use distance based update frequency
+    SharedPtr<Scene> serverScene(new Scene(context_));
+    PODVector<Node*> nodes;
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        Node* node = serverScene->CreateChild("Node");
+        node->SetPosition(Vector3(Random(200.0f), 0.0f, Random(200.0f)));
+        if (i & 1)
+            node->CreateComponent<NetworkPriority>();
+        nodes.Push(node);
+    }
+
+    Vector<SharedPtr<Network> > clients;
+    Vector<SharedPtr<Scene> > clientScenes;
+    for (unsigned i = 0; i < numClients_; ++i)
+    {
+        SharedPtr<Network> client(new Network(context_));
+        SharedPtr<Scene> clientScene(new Scene(context_));
+        client->Connect("127.0.0.1", port, clientScene);
+        clients.Push(client);
+        clientScenes.Push(clientScene);
+    }
+
+    // Let the clients connect and load the scene before measuring
+    const unsigned numWarmupFrames = 200;
+    const unsigned numFrames = 200;
+    long long totalUs = 0;
+    HiresTimer timer;
+
+    for (unsigned i = 0; i < numWarmupFrames + numFrames; ++i)
+    {
+        using namespace BeginFrame;
+
+        VariantMap& eventData = context_->GetEventDataMap();
+        eventData[P_FRAMENUMBER] = i + 1;
+        eventData[P_TIMESTEP] = timeStep;
+        server->SendEvent(E_BEGINFRAME, eventData);
+        Time::Sleep(2);
+
+        const Vector<SharedPtr<Connection> >& connections = server->GetClientConnections();
+        for (unsigned j = 0; j < connections.Size(); ++j)
+        {
+            if (!connections[j]->GetScene())
+                connections[j]->SetScene(serverScene);
+        }
+
+        for (unsigned j = 0; j < nodes.Size(); ++j)
+            nodes[j]->Translate(Vector3(0.01f, 0.0f, 0.0f));
+
+        timer.Reset();
+        server->PostUpdate(timeStep);
+        if (i >= numWarmupFrames)
+            totalUs += timer.GetUSec(false);
+    }
+
+    unsigned numLoaded = 0;
+    const Vector<SharedPtr<Connection> >& connections = server->GetClientConnections();
+    for (unsigned i = 0; i < connections.Size(); ++i)
+    {
+        if (connections[i]->IsSceneLoaded())
+            ++numLoaded;
+    }
+
+    printf("%u nodes, %u clients of which %u loaded the scene, %u worker threads: %.3f ms per server update\n", numNodes,
+        connections.Size(), numLoaded, context_->GetSubsystem<WorkQueue>()->GetNumThreads(), totalUs / 1000.0 / numFrames);
+
+    for (unsigned i = 0; i < clients.Size(); ++i)
+        clients[i]->Disconnect();
+    server->StopServer();
+#else
+    ErrorExit("Network support is disabled in this build");
+#endif
+}
+
+void BenchmarkLoading()
+{
+    auto* fileSystem = context_->GetSubsystem<FileSystem>();
+    auto* cache = context_->GetSubsystem<ResourceCache>();
+    cache->SetNumBackgroundLoadThreads(Max(numThreads_, 1U));
+    cache->SetFinishBackgroundResourcesMs(1000);
+
+    String dataPath = prefixPath_ + "Data/";
+    Vector<String> textures;
+    Vector<String> models;
+    fileSystem->ScanDir(textures, dataPath + "Textures", "*.*", SCAN_FILES, true);
+    fileSystem->ScanDir(models, dataPath + "Models", "*.mdl", SCAN_FILES, true);
+
+    HiresTimer timer;
+    unsigned numQueued = 0;
+    for (unsigned i = 0; i < textures.Size(); ++i)
+    {
+        String extension = GetExtension(textures[i]);
+        if (extension == ".png" || extension == ".dds" || extension == ".jpg" || extension == ".tga")
+            numQueued += cache->BackgroundLoadResource<Image>("Textures/" + textures[i]) ? 1 : 0;
+    }
+    for (unsigned i = 0; i < models.Size(); ++i)
+        numQueued += cache->BackgroundLoadResource<Model>("Models/" + models[i]) ? 1 : 0;
+
+    unsigned frameNumber = 0;
+    while (cache->GetNumBackgroundLoadResources())
+    {
+        using namespace BeginFrame;
+
+        VariantMap& eventData = context_->GetEventDataMap();
+        eventData[P_FRAMENUMBER] = ++frameNumber;
+        eventData[P_TIMESTEP] = 1.0f / 60.0f;
+        context_->GetSubsystem<Time>()->SendEvent(E_BEGINFRAME, eventData);
+        Time::Sleep(1);
+    }
+    long long totalUs = timer.GetUSec(false);
+
+    PODVector<Resource*> images;
+    PODVector<Resource*> loadedModels;
+    cache->GetResources(images, Image::GetTypeStatic());
+    cache->GetResources(loadedModels, Model::GetTypeStatic());
+    printf("%u loader threads: %u resources queued, %u images and %u models loaded in %.1f ms\n",
+        cache->GetNumBackgroundLoadThreads(), numQueued, images.Size(), loadedModels.Size(), totalUs / 1000.0);
+}
@@ -23,6 +23,8 @@
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Container/ArrayPtr.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Thread.h>
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/PackageFile.h>
@@ -38,7 +40,10 @@
 
 using namespace Urho3D;
 
-static const unsigned COMPRESSED_BLOCK_SIZE = 32768;
+static const unsigned COMPRESSED_BLOCK_SIZE = 65536;
+/// Largest block size PackageFile accepts.
+static const unsigned MAX_COMPRESSED_BLOCK_SIZE = 16 * 1024 * 1024;
+static const unsigned COMPRESS_BATCH_SIZE = 64 * 1024 * 1024;
 
 struct FileEntry
 {
@@ -48,6 +53,35 @@ struct FileEntry
     unsigned checksum_{};
 };
 
+struct CompressBlock
+{
+    /// Uncompressed data.
+    const unsigned char* data_{};
+    /// Uncompressed size.
+    unsigned size_{};
+    /// Compressed data, or uncompressed if the block did not compress.
+    PODVector<unsigned char> packedData_;
+};
+
+/// Thread compressing every Nth block of a batch.
+class CompressThread : public Thread
+{
+public:
+    CompressThread(Vector<CompressBlock>& blocks, unsigned start, unsigned step) :
+        blocks_(blocks),
+        start_(start),
+        step_(step)
+    {
+    }
+
+    void ThreadFunction() override;
+
+private:
+    Vector<CompressBlock>& blocks_;
+    unsigned start_;
+    unsigned step_;
+};
+
 SharedPtr<Context> context_(new Context());
 SharedPtr<FileSystem> fileSystem_(new FileSystem(context_));
 String basePath_;
@@ -56,6 +90,8 @@ unsigned checksum_ = 0;
 bool compress_ = false;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
+int compressionLevel_ = LZ4HC_CLEVEL_DEFAULT;
+unsigned numThreads_ = GetNumLogicalCPUs();
 
 String ignoreExtensions_[] = {
     ".bak",
@@ -68,6 +104,7 @@ void Run(const Vector<String>& arguments);
 void ProcessFile(const String& fileName, const String& rootDir);
 void WritePackageFile(const String& fileName, const String& rootDir);
 void WriteHeader(File& dest);
+void CompressBlocks(Vector<CompressBlock>& blocks);
 
 int main(int argc, char** argv)
 {
@@ -90,7 +127,10 @@ void Run(const Vector<String>& arguments)
             "Usage: PackageTool <directory to process> <package name> [basepath] [options]\n"
             "\n"
             "Options:\n"
-            "-c      Enable package file LZ4 compression\n"
+            "-c      Enable package file LZ4 compression. Optionally followed by compression level 1-12 without a space, default 9.\n"
+            "        Levels below 3 use fast LZ4 compression, higher levels LZ4-HC\n"
+            "-b      Compression block size in kilobytes 1-16384 without a space, default 64\n"
+            "-j      Number of compression threads without a space, default number of logical CPUs\n"
             "-q      Enable quiet mode\n"
             "\n"
             "Basepath is an optional prefix that will be added to the file entries.\n\n"
@@ -118,6 +158,20 @@ void Run(const Vector<String>& arguments)
                     {
                     case 'c':
                         compress_ = true;
+                        if (arguments[i].Length() > 2)
+                            compressionLevel_ = Clamp(ToInt(arguments[i].Substring(2)), 1, LZ4HC_CLEVEL_MAX);
+                        break;
+                    case 'b':
+                        {
+                            // Validate before scaling, so that large values can not wrap around
+                            unsigned blockSizeKB = ToUInt(arguments[i].Substring(2));
+                            if (!blockSizeKB || blockSizeKB > MAX_COMPRESSED_BLOCK_SIZE / 1024)
+                                ErrorExit("Invalid block size: must be 1-" + String(MAX_COMPRESSED_BLOCK_SIZE / 1024) + " kilobytes");
+                            blockSize_ = blockSizeKB * 1024;
+                        }
+                        break;
+                    case 'j':
+                        numThreads_ = Max(ToUInt(arguments[i].Substring(2)), 1U);
                         break;
                     case 'q':
                         quiet_ = true;
@@ -172,6 +226,8 @@ void Run(const Vector<String>& arguments)
             PrintLine("Package size: " + String(packageFile->GetTotalSize()));
             PrintLine("Checksum: " + String(packageFile->GetChecksum()));
             PrintLine("Compressed: " + String(packageFile->IsCompressed() ? "yes" : "no"));
+            if (packageFile->GetBlockSize())
+                PrintLine("Block size: " + String(packageFile->GetBlockSize()));
             break;
         case 'L':
             if (!packageFile->IsCompressed())
@@ -242,67 +298,92 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     }
 
     unsigned totalDataSize = 0;
-    unsigned lastOffset;
 
-    // Write file data, calculate checksums & correct offsets
-    for (unsigned i = 0; i < entries_.Size(); ++i)
+    // Write file data, calculate checksums & correct offsets. When compressing, read files in batches and compress
+    // the blocks of a batch in parallel
+    for (unsigned i = 0; i < entries_.Size();)
     {
-        lastOffset = entries_[i].offset_ = dest.GetSize();
-        String fileFullPath = rootDir + "/" + entries_[i].name_;
-
-        File srcFile(context_, fileFullPath);
-        if (!srcFile.IsOpen())
-            ErrorExit("Could not open file " + fileFullPath);
+        Vector<SharedArrayPtr<unsigned char> > buffers;
+        Vector<CompressBlock> blocks;
+        unsigned batchStart = i;
+        unsigned batchSize = 0;
 
-        unsigned dataSize = entries_[i].size_;
-        totalDataSize += dataSize;
-        SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
+        while (i < entries_.Size() && (i == batchStart || (compress_ && batchSize + entries_[i].size_ <= COMPRESS_BATCH_SIZE)))
+        {
+            String fileFullPath = rootDir + "/" + entries_[i].name_;
 
-        if (srcFile.Read(&buffer[0], dataSize) != dataSize)
-            ErrorExit("Could not read file " + fileFullPath);
-        srcFile.Close();
+            File srcFile(context_, fileFullPath);
+            if (!srcFile.IsOpen())
+                ErrorExit("Could not open file " + fileFullPath);
 
-        for (unsigned j = 0; j < dataSize; ++j)
-        {
-            checksum_ = SDBMHash(checksum_, buffer[j]);
-            entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
-        }
+            unsigned dataSize = entries_[i].size_;
+            totalDataSize += dataSize;
+            batchSize += dataSize;
+            SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
 
-        if (!compress_)
-        {
-            if (!quiet_)
-                PrintLine(entries_[i].name_ + " size " + String(dataSize));
-            dest.Write(&buffer[0], entries_[i].size_);
-        }
-        else
-        {
-            SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
+            if (srcFile.Read(&buffer[0], dataSize) != dataSize)
+                ErrorExit("Could not read file " + fileFullPath);
+            srcFile.Close();
 
-            unsigned pos = 0;
+            for (unsigned j = 0; j < dataSize; ++j)
+            {
+                checksum_ = SDBMHash(checksum_, buffer[j]);
+                entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
+            }
 
-            while (pos < dataSize)
+            if (compress_)
             {
-                unsigned unpackedSize = blockSize_;
-                if (pos + unpackedSize > dataSize)
-                    unpackedSize = dataSize - pos;
+                for (unsigned pos = 0; pos < dataSize; pos += blockSize_)
+                {
+                    CompressBlock block;
+                    block.data_ = &buffer[pos];
+                    block.size_ = Min(dataSize - pos, blockSize_);
+                    blocks.Push(block);
+                }
+            }
+
+            buffers.Push(buffer);
+            ++i;
+        }
+
+        if (compress_)
+            CompressBlocks(blocks);
 
-                auto packedSize = (unsigned)LZ4_compress_HC((const char*)&buffer[pos], (char*)compressBuffer.Get(), unpackedSize, LZ4_compressBound(unpackedSize), 0);
-                if (!packedSize)
-                    ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + String(pos));
+        unsigned blockIndex = 0;
+        for (unsigned j = batchStart; j < i; ++j)
+        {
+            FileEntry& entry = entries_[j];
+            entry.offset_ = dest.GetSize();
 
-                dest.WriteUShort((unsigned short)unpackedSize);
-                dest.WriteUShort((unsigned short)packedSize);
-                dest.Write(compressBuffer.Get(), packedSize);
+            if (!compress_)
+            {
+                if (!quiet_)
+                    PrintLine(entry.name_ + " size " + String(entry.size_));
+                dest.Write(buffers[j - batchStart].Get(), entry.size_);
+                continue;
+            }
 
-                pos += unpackedSize;
+            // Write the block index as the end offset of each block from the start of the file data, then the blocks
+            unsigned numBlocks = (entry.size_ + blockSize_ - 1) / blockSize_;
+            unsigned blockEnd = numBlocks * sizeof(unsigned);
+            for (unsigned k = 0; k < numBlocks; ++k)
+            {
+                blockEnd += blocks[blockIndex + k].packedData_.Size();
+                dest.WriteUInt(blockEnd);
+            }
+            for (unsigned k = 0; k < numBlocks; ++k)
+            {
+                const PODVector<unsigned char>& packedData = blocks[blockIndex + k].packedData_;
+                dest.Write(packedData.Begin().ptr_, packedData.Size());
             }
+            blockIndex += numBlocks;
 
             if (!quiet_)
             {
-                unsigned totalPackedBytes = dest.GetSize() - lastOffset;
-                String fileEntry(entries_[i].name_);
-                fileEntry.AppendWithFormat("\tin: %u\tout: %u\tratio: %f", dataSize, totalPackedBytes,
-                    totalPackedBytes ? 1.f * dataSize / totalPackedBytes : 0.f);
+                unsigned totalPackedBytes = dest.GetSize() - entry.offset_;
+                String fileEntry(entry.name_);
+                fileEntry.AppendWithFormat("\tin: %u\tout: %u\tratio: %f", entry.size_, totalPackedBytes,
+                    totalPackedBytes ? 1.f * entry.size_ / totalPackedBytes : 0.f);
                 PrintLine(fileEntry);
             }
         }
@@ -331,6 +412,8 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         PrintLine("Package size: " + String(dest.GetSize()));
         PrintLine("Checksum: " + String(checksum_));
         PrintLine("Compressed: " + String(compress_ ? "yes" : "no"));
+        if (compress_)
+            PrintLine("Block size: " + String(blockSize_));
     }
 }
 
@@ -339,7 +422,57 @@ void WriteHeader(File& dest)
     if (!compress_)
         dest.WriteFileID("UPAK");
     else
-        dest.WriteFileID("ULZ4");
+        dest.WriteFileID("ULZB");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
+    if (compress_)
+        dest.WriteUInt(blockSize_);
+}
+
+void CompressThread::ThreadFunction()
+{
+    for (unsigned i = start_; i < blocks_.Size(); i += step_)
+    {
+        CompressBlock& block = blocks_[i];
+        int bound = LZ4_compressBound(block.size_);
+        block.packedData_.Resize((unsigned)bound);
+
+        int packedSize = compressionLevel_ < LZ4HC_CLEVEL_MIN ?
+            LZ4_compress_default((const char*)block.data_, (char*)&block.packedData_[0], block.size_, bound) :
+            LZ4_compress_HC((const char*)block.data_, (char*)&block.packedData_[0], block.size_, bound, compressionLevel_);
+
+        // Store the block uncompressed if compression failed or did not help
+        if (packedSize <= 0 || (unsigned)packedSize >= block.size_)
+        {
+            block.packedData_.Resize(block.size_);
+            memcpy(&block.packedData_[0], block.data_, block.size_);
+        }
+        else
+            block.packedData_.Resize((unsigned)packedSize);
+    }
+}
+
+void CompressBlocks(Vector<CompressBlock>& blocks)
+{
+    unsigned numThreads = Min(numThreads_, blocks.Size());
+    if (numThreads <= 1)
+    {
+        CompressThread(blocks, 0, 1).ThreadFunction();
+        return;
+    }
+
+    PODVector<CompressThread*> threads;
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        threads.Push(new CompressThread(blocks, i, numThreads));
+        // Compress in this thread if threading is not available
+        if (!threads.Back()->Run())
+            threads.Back()->ThreadFunction();
+    }
+    // Stopping waits for the thread function to return
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        threads[i]->Stop();
+        delete threads[i];
+    }
 }
@@ -28,6 +28,7 @@
 #include "../Network/HttpRequest.h"
 #include "../Network/Network.h"
 #include "../Network/NetworkPriority.h"
+#include "../Network/ReplicationGrid.h"
 
 namespace Urho3D
 {
@@ -45,6 +46,14 @@ static void RegisterNetworkPriority(asIScriptEngine* engine)
     engine->RegisterObjectMethod("NetworkPriority", "bool get_alwaysUpdateOwner() const", asMETHOD(NetworkPriority, GetAlwaysUpdateOwner), asCALL_THISCALL);
 }
 
+static void RegisterReplicationGrid(asIScriptEngine* engine)
+{
+    RegisterComponent<ReplicationGrid>(engine, "ReplicationGrid");
+    engine->RegisterObjectMethod("ReplicationGrid", "void set_cellSize(float)", asMETHOD(ReplicationGrid, SetCellSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ReplicationGrid", "float get_cellSize() const", asMETHOD(ReplicationGrid, GetCellSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ReplicationGrid", "float get_maxInterestRadius() const", asMETHOD(ReplicationGrid, GetMaxInterestRadius), asCALL_THISCALL);
+}
+
 void SendRemoteEvent(const String& eventType, bool inOrder, const VariantMap& eventData, Connection* ptr)
 {
     ptr->SendRemoteEvent(eventType, inOrder, eventData);
@@ -195,6 +204,10 @@ void RegisterNetwork(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Network", "int get_simulatedLatency() const", asMETHOD(Network, GetSimulatedLatency), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_simulatedPacketLoss(float)", asMETHOD(Network, SetSimulatedPacketLoss), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "float get_simulatedPacketLoss() const", asMETHOD(Network, GetSimulatedPacketLoss), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_snapshotReplication(bool)", asMETHOD(Network, SetSnapshotReplication), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_snapshotReplication() const", asMETHOD(Network, GetSnapshotReplication), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_interpolationDelay(float)", asMETHOD(Network, SetInterpolationDelay), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "float get_interpolationDelay() const", asMETHOD(Network, GetInterpolationDelay), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_packageCacheDir(const String&in)", asMETHOD(Network, SetPackageCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "const String& get_packageCacheDir() const", asMETHOD(Network, GetPackageCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "const String& get_guid() const", asMETHOD(Network, GetGUID), asCALL_THISCALL);
@@ -207,6 +220,7 @@ void RegisterNetwork(asIScriptEngine* engine)
 void RegisterNetworkAPI(asIScriptEngine* engine)
 {
     RegisterNetworkPriority(engine);
+    RegisterReplicationGrid(engine);
     RegisterConnection(engine);
     RegisterHttpRequest(engine);
     RegisterNetwork(engine);
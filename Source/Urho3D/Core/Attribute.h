@@ -54,6 +54,34 @@ enum AttributeMode
 };
 URHO3D_FLAGSET(AttributeMode, AttributeModeFlags);
 
+/// Quaternion encoding in quantized network replication.
+enum RotationEncoding
+{
+    /// Quantize all four components.
+    RE_COMPONENTS = 0,
+    /// Quantize the three smallest components and send the index of the largest, which is reconstructed from unit length.
+    RE_SMALLESTTHREE,
+};
+
+/// Network quantization of an attribute. Supported for int, float, Vector2, Vector3, Vector4, Quaternion and Color attributes.
+struct AttributeQuantization
+{
+    /// Return whether values are quantized.
+    bool IsEnabled() const { return bits_ != 0; }
+
+    /// Minimum value of each component. Quaternion components use a fixed range.
+    float min_ = 0.0f;
+    /// Maximum value of each component.
+    float max_ = 0.0f;
+    /// Bits per component, at most 32. Zero sends values unquantized.
+    unsigned char bits_ = 0;
+    /// Encoding of quaternion values.
+    RotationEncoding rotationEncoding_ = RE_COMPONENTS;
+};
+
+/// Return quantization limited to what an attribute type can use. An integer range not representable with the bits is clamped with a warning.
+URHO3D_API AttributeQuantization ValidateAttributeQuantization(VariantType type, const AttributeQuantization& quantization);
+
 class Serializable;
 
 /// Abstract base class for invoking attribute accessors.
@@ -110,6 +138,8 @@ struct AttributeInfo
     AttributeModeFlags mode_ = AM_DEFAULT;
     /// Attribute metadata.
     VariantMap metadata_;
+    /// Network quantization.
+    AttributeQuantization quantization_;
     /// Attribute data pointer if elsewhere than in the Serializable.
     void* ptr_ = nullptr;
 };
@@ -137,6 +167,35 @@ public:
             networkAttributeInfo_->metadata_[key] = value;
         return *this;
     }
+
+    /// Set network quantization to a value range and number of bits per component.
+    AttributeHandle& SetQuantization(float min, float max, unsigned bits)
+    {
+        AttributeQuantization quantization;
+        quantization.min_ = min;
+        quantization.max_ = max;
+        quantization.bits_ = (unsigned char)Min(bits, 32U);
+        return SetQuantization(quantization);
+    }
+
+    /// Set network quantization of a quaternion attribute.
+    AttributeHandle& SetRotationEncoding(RotationEncoding encoding, unsigned bits)
+    {
+        AttributeQuantization quantization;
+        quantization.bits_ = (unsigned char)Min(bits, 32U);
+        quantization.rotationEncoding_ = encoding;
+        return SetQuantization(quantization);
+    }
+
+    /// Set network quantization.
+    AttributeHandle& SetQuantization(const AttributeQuantization& quantization)
+    {
+        if (attributeInfo_)
+            attributeInfo_->quantization_ = ValidateAttributeQuantization(attributeInfo_->type_, quantization);
+        if (networkAttributeInfo_)
+            networkAttributeInfo_->quantization_ = ValidateAttributeQuantization(networkAttributeInfo_->type_, quantization);
+        return *this;
+    }
 };
 
 }
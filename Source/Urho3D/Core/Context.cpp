@@ -193,6 +193,26 @@ void Context::RemoveSubsystem(StringHash objectType)
         subsystems_.Erase(i);
 }
 
+AttributeQuantization ValidateAttributeQuantization(VariantType type, const AttributeQuantization& quantization)
+{
+    AttributeQuantization ret = quantization;
+    if (type != VAR_INT || !ret.bits_ || ret.bits_ >= 32)
+        return ret;
+
+    // Integers are sent as the offset from the minimum, so the whole range must fit in the bits
+    auto min = (long long)(int)ret.min_;
+    auto max = (long long)(int)ret.max_;
+    long long maxValue = (1LL << ret.bits_) - 1;
+    if (max - min > maxValue)
+    {
+        URHO3D_LOGWARNINGF("Integer attribute quantization range %d to %d does not fit in %u bits, clamping the maximum to %d",
+            (int)min, (int)max, (unsigned)ret.bits_, (int)(min + maxValue));
+        ret.max_ = (float)(min + maxValue);
+    }
+
+    return ret;
+}
+
 AttributeHandle Context::RegisterAttribute(StringHash objectType, const AttributeInfo& attr)
 {
     // None or pointer types can not be supported
@@ -238,6 +258,27 @@ void Context::UpdateAttributeDefaultValue(StringHash objectType, const char* nam
         info->defaultValue_ = defaultValue;
 }
 
+void Context::UpdateAttributeQuantization(StringHash objectType, const char* name, const AttributeQuantization& quantization)
+{
+    AttributeInfo* info = GetAttribute(objectType, name);
+    if (info)
+        info->quantization_ = ValidateAttributeQuantization(info->type_, quantization);
+
+    // Also update the network attribute copy, which is used by the replication
+    HashMap<StringHash, Vector<AttributeInfo> >::Iterator i = networkAttributes_.Find(objectType);
+    if (i == networkAttributes_.End())
+        return;
+
+    for (Vector<AttributeInfo>::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+    {
+        if (!j->name_.Compare(name, true))
+        {
+            j->quantization_ = ValidateAttributeQuantization(j->type_, quantization);
+            break;
+        }
+    }
+}
+
 VariantMap& Context::GetEventDataMap()
 {
     unsigned nestingLevel = eventSenders_.Size();
@@ -23,7 +23,10 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../IO/File.h"
+#include "../IO/Log.h"
 
+#include <atomic>
 #include <cstdio>
 
 #include "../DebugNew.h"
@@ -31,11 +34,125 @@
 namespace Urho3D
 {
 
+static const unsigned THREAD_EVENT_BUFFER_SIZE = 16384;
+static const unsigned THREAD_EVENT_BUFFER_MASK = THREAD_EVENT_BUFFER_SIZE - 1;
+
+/// Block begin or end event recorded by a thread.
+struct ProfilerEvent
+{
+    /// Interned block name, or null for block end.
+    const char* name_;
+    /// Time in microseconds since the profiler was created.
+    long long time_;
+};
+
+/// Profiling event ring buffer of one thread. Written only by the owning thread and read only by the main thread at the end of each frame, so no locking is needed.
+class ProfilerThread
+{
+public:
+    /// Construct.
+    ProfilerThread(ThreadID threadID, unsigned index) :
+        threadID_(threadID),
+        index_(index),
+        writeIndex_(0),
+        readIndex_(0),
+        depth_(0),
+        skipDepth_(0),
+        root_(nullptr),
+        current_(nullptr)
+    {
+        events_.Resize(THREAD_EVENT_BUFFER_SIZE);
+
+        // The main thread is timed directly into the main profiling tree
+        if (index_)
+            root_ = current_ = new ProfilerBlock(nullptr, ("Thread " + String(index_)).CString());
+    }
+
+    /// Destruct.
+    ~ProfilerThread()
+    {
+        delete root_;
+    }
+
+    /// Record an event. Called by the owning thread only.
+    void Push(const char* name, long long time)
+    {
+        // If the buffer was full when a block began, skip the whole block to keep begins and ends matched
+        if (skipDepth_)
+        {
+            if (name)
+                ++skipDepth_;
+            else
+                --skipDepth_;
+            return;
+        }
+
+        if (name)
+            ++depth_;
+        else if (depth_)
+            --depth_;
+        else
+            return;
+
+        unsigned writeIndex = writeIndex_.load(std::memory_order_relaxed);
+        if (writeIndex - readIndex_.load(std::memory_order_acquire) >= THREAD_EVENT_BUFFER_SIZE)
+        {
+            if (name)
+            {
+                --depth_;
+                skipDepth_ = 1;
+            }
+            else
+                ++depth_;
+            return;
+        }
+
+        ProfilerEvent& event = events_[writeIndex & THREAD_EVENT_BUFFER_MASK];
+        event.name_ = name;
+        event.time_ = time;
+        writeIndex_.store(writeIndex + 1, std::memory_order_release);
+    }
+
+    /// Thread ID.
+    ThreadID threadID_;
+    /// Thread index in the timeline, 0 for the main thread.
+    unsigned index_;
+    /// Event ring buffer.
+    PODVector<ProfilerEvent> events_;
+    /// Total events written.
+    std::atomic<unsigned> writeIndex_;
+    /// Total events read.
+    std::atomic<unsigned> readIndex_;
+    /// Number of open blocks on the writing side.
+    unsigned depth_;
+    /// Nesting depth of the block being skipped due to a full buffer.
+    unsigned skipDepth_;
+    /// Interned names already looked up by the owning thread.
+    HashMap<StringHash, const char*> nameCache_;
+    /// Root block of the thread's profiling tree. Null for the main thread.
+    ProfilerBlock* root_;
+    /// Current block of the thread's profiling tree on the reading side.
+    ProfilerBlock* current_;
+    /// Names and begin times of the open blocks on the reading side.
+    PODVector<ProfilerEvent> openBlocks_;
+};
+
+/// Source of unique profiler IDs.
+static std::atomic<unsigned> nextProfilerID(1);
+/// The calling thread's most recently used event buffer.
+static thread_local ProfilerThread* currentThread = nullptr;
+/// ID of the profiler owning the calling thread's most recently used event buffer.
+static thread_local unsigned currentThreadOwner = 0;
+
 Profiler::Profiler(Context* context) :
     Object(context),
     current_(nullptr),
     root_(nullptr),
-    intervalFrames_(0)
+    intervalFrames_(0),
+    id_(nextProfilerID.fetch_add(1)),
+    captureFramesLeft_(0),
+    captureRequested_(false),
+    capturing_(false)
 {
     current_ = root_ = new ProfilerBlock(nullptr, "RunFrame");
 }
@@ -44,6 +161,9 @@ Profiler::~Profiler()
 {
     delete root_;
     root_ = nullptr;
+
+    for (PODVector<ProfilerThread*>::Iterator i = threads_.Begin(); i != threads_.End(); ++i)
+        delete *i;
 }
 
 void Profiler::BeginFrame()
@@ -52,7 +172,24 @@ void Profiler::BeginFrame()
     if (root_->count_)
         EndFrame();
 
+    if (captureRequested_)
+    {
+        captureRequested_ = false;
+        capturing_ = true;
+        capture_ = "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"Urho3D\"}}";
+    }
+
     root_->Begin();
+
+    if (capturing_)
+    {
+        char line[256];
+        auto* time = GetSubsystem<Time>();
+        sprintf(line, ",\n{\"name\":\"Frame %u\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%lld,\"pid\":0,\"tid\":0}",
+            time ? time->GetFrameNumber() : 0, clock_.GetUSec(false));
+        capture_.Append(line);
+        RecordThreadEvent(root_->name_);
+    }
 }
 
 void Profiler::EndFrame()
@@ -61,12 +198,212 @@ void Profiler::EndFrame()
     ++intervalFrames_;
     root_->EndFrame();
     current_ = root_;
+
+    CollectThreadEvents();
+
+    if (capturing_ && captureFramesLeft_ && !--captureFramesLeft_)
+        EndCapture();
 }
 
 void Profiler::BeginInterval()
 {
     root_->BeginInterval();
     intervalFrames_ = 0;
+
+    MutexLock lock(threadsMutex_);
+    for (PODVector<ProfilerThread*>::Iterator i = threads_.Begin(); i != threads_.End(); ++i)
+    {
+        if ((*i)->root_)
+            (*i)->root_->BeginInterval();
+    }
+}
+
+void Profiler::BeginCapture(const String& fileName, unsigned numFrames)
+{
+    if (IsCapturing())
+        EndCapture();
+
+    captureFileName_ = fileName;
+    captureFramesLeft_ = numFrames;
+    captureRequested_ = true;
+}
+
+bool Profiler::EndCapture()
+{
+    if (captureRequested_)
+    {
+        captureRequested_ = false;
+        return false;
+    }
+    if (!capturing_)
+        return false;
+
+    capturing_ = false;
+
+    {
+        char line[256];
+        MutexLock lock(threadsMutex_);
+        for (PODVector<ProfilerThread*>::ConstIterator i = threads_.Begin(); i != threads_.End(); ++i)
+        {
+            sprintf(line, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                (*i)->index_, (*i)->root_ ? (*i)->root_->name_ : "Main");
+            capture_.Append(line);
+        }
+    }
+    capture_ += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    File file(context_, captureFileName_, FILE_WRITE);
+    bool success = file.IsOpen() && file.Write(capture_.CString(), capture_.Length()) == capture_.Length();
+    capture_.Clear();
+
+    if (success)
+        URHO3D_LOGINFO("Wrote profiler capture to " + captureFileName_);
+    else
+        URHO3D_LOGERROR("Failed to write profiler capture to " + captureFileName_);
+
+    return success;
+}
+
+void Profiler::RecordThreadEvent(const char* name)
+{
+    ProfilerThread* thread = GetThread();
+    // Names from other threads may be temporary strings, so intern them. Main thread names come from the profiling tree
+    if (name && thread->index_)
+        name = InternName(name);
+    thread->Push(name, clock_.GetUSec(false));
+}
+
+ProfilerThread* Profiler::GetThread()
+{
+    if (currentThreadOwner == id_)
+        return currentThread;
+
+    ThreadID threadID = Thread::GetCurrentThreadID();
+    ProfilerThread* thread = nullptr;
+
+    {
+        MutexLock lock(threadsMutex_);
+        for (PODVector<ProfilerThread*>::ConstIterator i = threads_.Begin(); i != threads_.End(); ++i)
+        {
+            if ((*i)->threadID_ == threadID)
+            {
+                thread = *i;
+                break;
+            }
+        }
+
+        if (!thread)
+        {
+            unsigned index = 0;
+            if (!Thread::IsMainThread())
+            {
+                for (PODVector<ProfilerThread*>::ConstIterator i = threads_.Begin(); i != threads_.End(); ++i)
+                    index = Max(index, (*i)->index_);
+                ++index;
+            }
+            thread = new ProfilerThread(threadID, index);
+            threads_.Push(thread);
+        }
+    }
+
+    currentThread = thread;
+    currentThreadOwner = id_;
+    return thread;
+}
+
+const char* Profiler::InternName(const char* name)
+{
+    ProfilerThread* thread = GetThread();
+    StringHash hash(name);
+
+    HashMap<StringHash, const char*>::ConstIterator i = thread->nameCache_.Find(hash);
+    if (i != thread->nameCache_.End())
+        return i->second_;
+
+    const char* interned;
+    {
+        MutexLock lock(namesMutex_);
+        HashMap<StringHash, String>::Iterator j = names_.Find(hash);
+        if (j == names_.End())
+            j = names_.Insert(MakePair(hash, String(name)));
+        interned = j->second_.CString();
+    }
+
+    thread->nameCache_[hash] = interned;
+    return interned;
+}
+
+void Profiler::CollectThreadEvents()
+{
+    MutexLock lock(threadsMutex_);
+
+    for (PODVector<ProfilerThread*>::Iterator i = threads_.Begin(); i != threads_.End(); ++i)
+    {
+        ProfilerThread* thread = *i;
+        unsigned readIndex = thread->readIndex_.load(std::memory_order_relaxed);
+        unsigned writeIndex = thread->writeIndex_.load(std::memory_order_acquire);
+
+        for (; readIndex != writeIndex; ++readIndex)
+        {
+            const ProfilerEvent& event = thread->events_[readIndex & THREAD_EVENT_BUFFER_MASK];
+            if (event.name_)
+            {
+                thread->openBlocks_.Push(event);
+                if (thread->root_)
+                {
+                    thread->current_ = thread->current_->GetChild(event.name_);
+                    ++thread->current_->count_;
+                }
+            }
+            else if (!thread->openBlocks_.Empty())
+            {
+                ProfilerEvent begin = thread->openBlocks_.Back();
+                thread->openBlocks_.Pop();
+
+                if (thread->root_)
+                {
+                    ProfilerBlock* block = thread->current_;
+                    long long time = event.time_ - begin.time_;
+                    if (time > block->maxTime_)
+                        block->maxTime_ = time;
+                    block->time_ += time;
+                    if (block->parent_)
+                        thread->current_ = block->parent_;
+                }
+
+                if (capturing_)
+                    CaptureBlock(begin.name_, thread->index_, begin.time_, event.time_);
+            }
+        }
+
+        thread->readIndex_.store(readIndex, std::memory_order_release);
+
+        // The thread's root block measures the total busy time of the thread on this frame
+        if (thread->root_)
+        {
+            ProfilerBlock* root = thread->root_;
+            root->time_ = 0;
+            for (PODVector<ProfilerBlock*>::ConstIterator j = root->children_.Begin(); j != root->children_.End(); ++j)
+                root->time_ += (*j)->time_;
+            root->maxTime_ = root->time_;
+            root->count_ = root->time_ ? 1 : 0;
+            root->EndFrame();
+        }
+    }
+}
+
+void Profiler::CaptureBlock(const char* name, unsigned threadIndex, long long beginTime, long long endTime)
+{
+    static const int LINE_MAX_LENGTH = 512;
+
+    char line[LINE_MAX_LENGTH];
+    String escapedName(name);
+    escapedName.Replace("\\", "\\\\");
+    escapedName.Replace("\"", "\\\"");
+
+    snprintf(line, LINE_MAX_LENGTH, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":0,\"tid\":%u}",
+        escapedName.CString(), beginTime, endTime - beginTime, threadIndex);
+    capture_.Append(line);
 }
 
 const String& Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxDepth) const
@@ -86,6 +423,14 @@ const String& Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxD
 
     PrintData(root_, output, 0, maxDepth, showUnused, showTotal);
 
+    // Blocks timed in other threads follow, grouped per thread
+    MutexLock lock(threadsMutex_);
+    for (PODVector<ProfilerThread*>::ConstIterator i = threads_.Begin(); i != threads_.End(); ++i)
+    {
+        if ((*i)->root_)
+            PrintData((*i)->root_, output, 0, maxDepth, showUnused, showTotal);
+    }
+
     return output;
 }
 
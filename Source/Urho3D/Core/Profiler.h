@@ -22,7 +22,9 @@
 
 #pragma once
 
+#include "../Container/HashMap.h"
 #include "../Container/Str.h"
+#include "../Core/Mutex.h"
 #include "../Core/Thread.h"
 #include "../Core/Timer.h"
 
@@ -168,7 +170,9 @@ public:
     unsigned totalCount_;
 };
 
-/// Hierarchical performance profiler subsystem.
+class ProfilerThread;
+
+/// Hierarchical performance profiler subsystem. Blocks timed in other threads than the main thread are recorded into per-thread lock-free buffers, which are collected into per-thread profiling trees at the end of each frame.
 class URHO3D_API Profiler : public Object
 {
     URHO3D_OBJECT(Profiler, Object);
@@ -182,23 +186,32 @@ public:
     /// Begin timing a profiling block.
     void BeginBlock(const char* name)
     {
-        // Profiler supports only the main thread currently
         if (!Thread::IsMainThread())
+        {
+            RecordThreadEvent(name);
             return;
+        }
 
         current_ = current_->GetChild(name);
         current_->Begin();
+        if (capturing_)
+            RecordThreadEvent(current_->name_);
     }
 
     /// End timing the current profiling block.
     void EndBlock()
     {
         if (!Thread::IsMainThread())
+        {
+            RecordThreadEvent(nullptr);
             return;
+        }
 
         current_->End();
         if (current_->parent_)
             current_ = current_->parent_;
+        if (capturing_)
+            RecordThreadEvent(nullptr);
     }
 
     /// Begin the profiling frame. Called by HandleBeginFrame().
@@ -207,6 +220,13 @@ public:
     void EndFrame();
     /// Begin a new interval.
     void BeginInterval();
+    /// Begin capturing a timeline of all threads from the next frame on, for the specified number of frames (0 = until EndCapture() is called). The capture is written to the file as Chrome trace event JSON, which can be viewed in chrome://tracing or Perfetto.
+    void BeginCapture(const String& fileName, unsigned numFrames = 0);
+    /// End the timeline capture and write it to the file. Return true on success.
+    bool EndCapture();
+
+    /// Return whether a timeline capture is in progress or requested.
+    bool IsCapturing() const { return capturing_ || captureRequested_; }
 
     /// Return profiling data as text output. This method is not thread-safe.
     const String& PrintData(bool showUnused = false, bool showTotal = false, unsigned maxDepth = M_MAX_UNSIGNED) const;
@@ -218,6 +238,16 @@ public:
 protected:
     /// Return profiling data as text output for a specified profiling block.
     void PrintData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused, bool showTotal) const;
+    /// Record a block begin (non-null name) or end (null name) event into the calling thread's buffer.
+    void RecordThreadEvent(const char* name);
+    /// Return the calling thread's event buffer, creating it on first use.
+    ProfilerThread* GetThread();
+    /// Return a name that stays valid for the profiler's lifetime.
+    const char* InternName(const char* name);
+    /// Collect the recorded events of all threads into their profiling trees and the capture.
+    void CollectThreadEvents();
+    /// Append a completed block to the capture.
+    void CaptureBlock(const char* name, unsigned threadIndex, long long beginTime, long long endTime);
 
     /// Current profiling block.
     ProfilerBlock* current_;
@@ -225,6 +255,28 @@ protected:
     ProfilerBlock* root_;
     /// Frames in the current interval.
     unsigned intervalFrames_;
+    /// Unique ID of the profiler instance, to detect stale thread-local buffer pointers.
+    unsigned id_;
+    /// Clock shared by all threads for timeline events.
+    HiresTimer clock_;
+    /// Per-thread event buffers. The main thread's buffer is only used while capturing.
+    PODVector<ProfilerThread*> threads_;
+    /// Mutex for registering threads.
+    mutable Mutex threadsMutex_;
+    /// Interned block names of other threads.
+    HashMap<StringHash, String> names_;
+    /// Mutex for the interned names.
+    Mutex namesMutex_;
+    /// Capture output file name.
+    String captureFileName_;
+    /// Captured trace events as JSON.
+    String capture_;
+    /// Frames left to capture, 0 if unlimited.
+    unsigned captureFramesLeft_;
+    /// Capture requested to begin on the next frame flag.
+    bool captureRequested_;
+    /// Capturing flag.
+    volatile bool capturing_;
 };
 
 /// Helper class for automatically beginning and ending a profiling block
@@ -253,8 +305,11 @@ private:
 
 #ifdef URHO3D_PROFILING
 #define URHO3D_PROFILE(name) Urho3D::AutoProfileBlock profile_ ## name (GetSubsystem<Urho3D::Profiler>(), #name)
+/// Profile a block outside an Object's member function, for example in a work item function, using the object's profiler.
+#define URHO3D_PROFILE_OBJECT(name, object) Urho3D::AutoProfileBlock profile_ ## name ((object)->GetSubsystem<Urho3D::Profiler>(), #name)
 #else
 #define URHO3D_PROFILE(name)
+#define URHO3D_PROFILE_OBJECT(name, object)
 #endif
 
 }
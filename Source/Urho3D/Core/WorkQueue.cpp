@@ -60,8 +60,143 @@ private:
     unsigned index_;
 };
 
+/// Queue of work items owned by one thread, ordered by priority. The owner takes the most recently added items of the highest priority from the back, while other threads steal the oldest items of the highest priority.
+class WorkStealingDeque
+{
+public:
+    /// Construct.
+    WorkStealingDeque() :
+        head_(0),
+        size_(0),
+        topPriority_(0)
+    {
+    }
+
+    /// Add an item after the items of the same or lower priority.
+    void Push(WorkItem* item)
+    {
+        MutexLock lock(mutex_);
+        unsigned index = items_.Size();
+        while (index > head_ && items_[index - 1]->priority_ > item->priority_)
+            --index;
+        items_.Insert(index, item);
+        UpdateSize();
+    }
+
+    /// Take the newest item of the highest priority, if it has at least the specified priority. Return null if none.
+    WorkItem* Pop(unsigned priority)
+    {
+        if (!Size())
+            return nullptr;
+
+        MutexLock lock(mutex_);
+        if (items_.Size() == head_ || items_.Back()->priority_ < priority)
+            return nullptr;
+
+        WorkItem* item = items_.Back();
+        EraseAt(items_.Size() - 1);
+        return item;
+    }
+
+    /// Take the oldest item of the highest priority, if it has at least the specified priority. Return null if none.
+    WorkItem* Steal(unsigned priority)
+    {
+        if (!Size())
+            return nullptr;
+
+        MutexLock lock(mutex_);
+        if (items_.Size() == head_)
+            return nullptr;
+
+        unsigned top = items_.Back()->priority_;
+        if (top < priority)
+            return nullptr;
+
+        // Usually all items share the same priority, in which case the front item is the one to take
+        unsigned index = head_;
+        if (items_[index]->priority_ != top)
+        {
+            index = items_.Size() - 1;
+            while (items_[index - 1]->priority_ == top)
+                --index;
+        }
+
+        WorkItem* item = items_[index];
+        EraseAt(index);
+        return item;
+    }
+
+    /// Remove an item if it has not been taken yet. Return true if successfully removed.
+    bool Remove(WorkItem* item)
+    {
+        MutexLock lock(mutex_);
+        for (unsigned i = head_; i < items_.Size(); ++i)
+        {
+            if (items_[i] == item)
+            {
+                EraseAt(i);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Return number of items. May be checked without locking.
+    unsigned Size() const { return size_.load(std::memory_order_acquire); }
+
+    /// Return the highest priority of the queued items. May be checked without locking, valid only when the queue is not empty.
+    unsigned GetTopPriority() const { return topPriority_.load(std::memory_order_relaxed); }
+
+private:
+    /// Erase an item by index. Erasing from the front only advances the head, so stealing does not move memory.
+    void EraseAt(unsigned index)
+    {
+        if (index == head_)
+            ++head_;
+        else
+            items_.Erase(index);
+
+        if (head_ == items_.Size())
+        {
+            items_.Clear();
+            head_ = 0;
+        }
+
+        UpdateSize();
+    }
+
+    /// Update the lock-free readable size and top priority.
+    void UpdateSize()
+    {
+        if (items_.Size() > head_)
+            topPriority_.store(items_.Back()->priority_, std::memory_order_relaxed);
+        size_.store(items_.Size() - head_, std::memory_order_release);
+    }
+
+    /// Queue mutex. Only contended when another thread is stealing.
+    Mutex mutex_;
+    /// Item storage in ascending priority order. Items before the head index have already been taken.
+    PODVector<WorkItem*> items_;
+    /// Index of the front item.
+    unsigned head_;
+    /// Number of items, readable without locking.
+    std::atomic<unsigned> size_;
+    /// Highest priority of the queued items, readable without locking.
+    std::atomic<unsigned> topPriority_;
+};
+
+/// Execute one batch of a parallel for.
+static void ParallelForWork(const WorkItem* item, unsigned threadIndex)
+{
+    const std::function<void(unsigned, unsigned, unsigned)>& function =
+        *reinterpret_cast<const std::function<void(unsigned, unsigned, unsigned)>*>(item->aux_);
+    function(*reinterpret_cast<unsigned*>(item->start_), *reinterpret_cast<unsigned*>(item->end_), threadIndex);
+}
+
 WorkQueue::WorkQueue(Context* context) :
     Object(context),
+    nextQueue_(0),
     shutDown_(false),
     pausing_(false),
     paused_(false),
@@ -70,6 +205,9 @@ WorkQueue::WorkQueue(Context* context) :
     lastSize_(0),
     maxNonThreadedWorkMs_(5)
 {
+    // The main thread's queue always exists, so that work can be completed also without worker threads
+    queues_.Push(new WorkStealingDeque());
+
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -81,6 +219,9 @@ WorkQueue::~WorkQueue()
 
     for (unsigned i = 0; i < threads_.Size(); ++i)
         threads_[i]->Stop();
+
+    for (unsigned i = 0; i < queues_.Size(); ++i)
+        delete queues_[i];
 }
 
 void WorkQueue::CreateThreads(unsigned numThreads)
@@ -94,6 +235,10 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     // Start threads in paused mode
     Pause();
 
+    // Create all queues before any thread starts stealing from them
+    for (unsigned i = 0; i < numThreads; ++i)
+        queues_.Push(new WorkStealingDeque());
+
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -137,56 +282,67 @@ void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item)
     // Clear completed flag in case item is reused
     workItems_.Push(item);
     item->completed_ = false;
+    item->added_ = true;
 
-    // Make sure worker threads' list is safe to modify
-    if (threads_.Size() && !paused_)
-        queueMutex_.Acquire();
-
-    // Find position for new item
-    if (queue_.Empty())
-        queue_.Push(item);
-    else
+    if (item->group_)
     {
-        bool inserted = false;
+        item->group_->pending_.fetch_add(1, std::memory_order_relaxed);
+        item->group_->minPriority_ = Min(item->group_->minPriority_, item->priority_);
+    }
 
-        for (List<WorkItem*>::Iterator i = queue_.Begin(); i != queue_.End(); ++i)
+    // Queue now unless still waiting for prerequisites, in which case the last finishing prerequisite queues it.
+    // Distribute round-robin to the worker threads' queues; they steal from each other when running out of work
+    if (item->pendingDependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        unsigned queueIndex = 0;
+        if (threads_.Size())
         {
-            if ((*i)->priority_ <= item->priority_)
-            {
-                queue_.Insert(i, item);
-                inserted = true;
-                break;
-            }
+            queueIndex = nextQueue_ + 1;
+            nextQueue_ = (nextQueue_ + 1) % threads_.Size();
         }
-
-        if (!inserted)
-            queue_.Push(item);
+        QueueItem(item, queueIndex);
     }
 
     if (threads_.Size())
+        Resume();
+}
+
+bool WorkQueue::AddDependency(WorkItem* item, WorkItem* dependsOn)
+{
+    if (!item || !dependsOn || item == dependsOn)
+        return false;
+
+    // Both items must not be queued yet, as the prerequisite could otherwise complete while being modified
+    if (item->added_ || dependsOn->added_)
     {
-        queueMutex_.Release();
-        paused_ = false;
+        URHO3D_LOGERROR("Work item dependencies must be added before the items are added to the work queue");
+        return false;
     }
+
+    dependsOn->dependents_.Push(item);
+    item->pendingDependencies_.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
 bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 {
-    if (!item)
+    if (!item || !item->dependents_.Empty())
         return false;
 
-    MutexLock lock(queueMutex_);
-
     // Can only remove successfully if the item was not yet taken by threads for execution
-    List<WorkItem*>::Iterator i = queue_.Find(item.Get());
-    if (i != queue_.End())
+    for (unsigned i = 0; i < queues_.Size(); ++i)
     {
-        List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
-        if (j != workItems_.End())
+        if (queues_[i]->Remove(item.Get()))
         {
-            queue_.Erase(i);
-            ReturnToPool(item);
-            workItems_.Erase(j);
+            List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
+            if (j != workItems_.End())
+            {
+                if (item->group_)
+                    item->group_->pending_.fetch_sub(1, std::memory_order_release);
+                ResetItem(*j);
+                ReturnToPool(item);
+                workItems_.Erase(j);
+            }
             return true;
         }
     }
@@ -196,23 +352,12 @@ bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 
 unsigned WorkQueue::RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items)
 {
-    MutexLock lock(queueMutex_);
     unsigned removed = 0;
 
     for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
     {
-        List<WorkItem*>::Iterator j = queue_.Find(i->Get());
-        if (j != queue_.End())
-        {
-            List<SharedPtr<WorkItem> >::Iterator k = workItems_.Find(*i);
-            if (k != workItems_.End())
-            {
-                queue_.Erase(j);
-                ReturnToPool(*k);
-                workItems_.Erase(k);
-                ++removed;
-            }
-        }
+        if (RemoveWorkItem(*i))
+            ++removed;
     }
 
     return removed;
@@ -224,7 +369,7 @@ void WorkQueue::Pause()
     {
         pausing_ = true;
 
-        queueMutex_.Acquire();
+        pauseMutex_.Acquire();
         paused_ = true;
 
         pausing_ = false;
@@ -235,7 +380,7 @@ void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
+        pauseMutex_.Release();
         paused_ = false;
     }
 }
@@ -243,56 +388,115 @@ void WorkQueue::Resume()
 
 void WorkQueue::Complete(unsigned priority)
 {
+    URHO3D_PROFILE(CompleteWork);
+
     completing_ = true;
 
     if (threads_.Size())
     {
         Resume();
 
-        // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.Empty())
+        // Take work items also in the main thread, stealing from the worker threads, until all high-priority work has completed
+        for (;;)
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.Release();
+            WorkItem* item = TakeItem(0, priority);
+            if (item)
+                ExecuteItem(item, 0);
+            else if (IsCompleted(priority))
                 break;
-            }
-        }
-
-        // Wait for threaded work to complete
-        while (!IsCompleted(priority))
-        {
         }
 
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
+        if (!GetNumQueuedItems())
             Pause();
     }
     else
     {
         // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-        {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
-        }
+        while (WorkItem* item = TakeItem(0, priority))
+            ExecuteItem(item, 0);
     }
 
     PurgeCompleted(priority);
     completing_ = false;
 }
 
+void WorkQueue::Complete(WorkItemGroup& group)
+{
+    if (threads_.Size())
+        Resume();
+
+    // Help with work of the group's priority until the group is done. Without worker threads everything is executed here
+    while (!group.IsCompleted())
+    {
+        WorkItem* item = TakeItem(0, group.minPriority_);
+        if (item)
+            ExecuteItem(item, 0);
+        else if (threads_.Empty())
+        {
+            URHO3D_LOGERROR("Work item group can not complete, items are waiting for unfinished dependencies");
+            break;
+        }
+    }
+}
+
+void WorkQueue::ParallelFor(unsigned count, unsigned minBatchSize, const std::function<void(unsigned, unsigned, unsigned)>& function)
+{
+    if (!count)
+        return;
+
+    // Aim for a few batches per thread so that stealing can balance uneven work. Outside the main thread the group can not
+    // be completed, so process the whole range in the calling thread instead
+    unsigned numThreads = threads_.Size() + 1;
+    unsigned batchSize = Max(Max(minBatchSize, 1U), (count + numThreads * 4 - 1) / (numThreads * 4));
+    if (threads_.Empty() || batchSize >= count || !Thread::IsMainThread())
+    {
+        function(0, count, 0);
+        return;
+    }
+
+    // Batch boundaries must stay in place while the items execute
+    PODVector<unsigned> bounds;
+    for (unsigned i = 0; i < count; i += batchSize)
+        bounds.Push(i);
+    bounds.Push(count);
+
+    WorkItemGroup group;
+    for (unsigned i = 0; i < bounds.Size() - 1; ++i)
+    {
+        SharedPtr<WorkItem> item = GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = ParallelForWork;
+        item->start_ = &bounds[i];
+        item->end_ = &bounds[i + 1];
+        item->aux_ = const_cast<std::function<void(unsigned, unsigned, unsigned)>*>(&function);
+        item->group_ = &group;
+        AddWorkItem(item);
+    }
+
+    Complete(group);
+
+    // Detach the finished items from the group and the boundaries, which go out of scope now
+    for (List<SharedPtr<WorkItem> >::Iterator i = workItems_.Begin(); i != workItems_.End(); ++i)
+    {
+        if ((*i)->group_ == &group)
+        {
+            (*i)->group_ = nullptr;
+            (*i)->start_ = nullptr;
+            (*i)->end_ = nullptr;
+            (*i)->aux_ = nullptr;
+        }
+    }
+}
+
+unsigned WorkQueue::GetNumQueuedItems() const
+{
+    unsigned num = 0;
+    for (unsigned i = 0; i < queues_.Size(); ++i)
+        num += queues_[i]->Size();
+    return num;
+}
+
 bool WorkQueue::IsCompleted(unsigned priority) const
 {
     for (List<SharedPtr<WorkItem> >::ConstIterator i = workItems_.Begin(); i != workItems_.End(); ++i)
@@ -306,39 +510,85 @@ bool WorkQueue::IsCompleted(unsigned priority) const
 
 void WorkQueue::ProcessItems(unsigned threadIndex)
 {
-    bool wasActive = false;
-
     for (;;)
     {
         if (shutDown_)
             return;
 
-        if (pausing_ && !wasActive)
-            Time::Sleep(0);
+        WorkItem* item = TakeItem(threadIndex, 0);
+        if (item)
+            ExecuteItem(item, threadIndex);
         else
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty())
+            // Out of work. If the main thread has paused the queue, block until resumed
+            if (paused_ && !pausing_)
             {
-                wasActive = true;
-
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
+                pauseMutex_.Acquire();
+                pauseMutex_.Release();
             }
-            else
-            {
-                wasActive = false;
+            Time::Sleep(0);
+        }
+    }
+}
+
+void WorkQueue::QueueItem(WorkItem* item, unsigned queueIndex)
+{
+    queues_[queueIndex]->Push(item);
+}
 
-                queueMutex_.Release();
-                Time::Sleep(0);
+WorkItem* WorkQueue::TakeItem(unsigned threadIndex, unsigned priority)
+{
+    unsigned numQueues = queues_.Size();
+
+    for (;;)
+    {
+        // Find the queue with the highest priority work, preferring the thread's own queue and then the next threads on ties
+        unsigned bestQueue = M_MAX_UNSIGNED;
+        unsigned bestPriority = 0;
+        for (unsigned i = 0; i < numQueues; ++i)
+        {
+            unsigned queueIndex = (threadIndex + i) % numQueues;
+            WorkStealingDeque* queue = queues_[queueIndex];
+            if (!queue->Size())
+                continue;
+
+            unsigned topPriority = queue->GetTopPriority();
+            if (topPriority >= priority && (bestQueue == M_MAX_UNSIGNED || topPriority > bestPriority))
+            {
+                bestQueue = queueIndex;
+                bestPriority = topPriority;
             }
         }
+
+        if (bestQueue == M_MAX_UNSIGNED)
+            return nullptr;
+
+        WorkItem* item = bestQueue == threadIndex ? queues_[bestQueue]->Pop(priority) : queues_[bestQueue]->Steal(priority);
+        if (item)
+            return item;
+
+        // Another thread took the work first, look again
     }
 }
 
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    item->workFunction_(item, threadIndex);
+
+    // Continue with dependents whose last prerequisite this was. Queue them to this thread, as they likely use the same data
+    for (PODVector<WorkItem*>::ConstIterator i = item->dependents_.Begin(); i != item->dependents_.End(); ++i)
+    {
+        if ((*i)->pendingDependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            QueueItem(*i, threadIndex);
+    }
+
+    if (item->group_)
+        item->group_->pending_.fetch_sub(1, std::memory_order_release);
+
+    // The item may be purged by the main thread once it is marked completed, so this must be last
+    item->completed_ = true;
+}
+
 void WorkQueue::PurgeCompleted(unsigned priority)
 {
     // Purge completed work items and send completion events. Do not signal items lower than priority threshold,
@@ -357,6 +607,7 @@ void WorkQueue::PurgeCompleted(unsigned priority)
                 SendEvent(E_WORKITEMCOMPLETED, eventData);
             }
 
+            ResetItem(*i);
             ReturnToPool(*i);
             i = workItems_.Erase(i);
         }
@@ -377,6 +628,13 @@ void WorkQueue::PurgePool()
     lastSize_ = currentSize;
 }
 
+void WorkQueue::ResetItem(WorkItem* item)
+{
+    item->added_ = false;
+    item->dependents_.Clear();
+    item->pendingDependencies_.store(1, std::memory_order_relaxed);
+}
+
 void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 {
     // Check if this was a pooled item and set it to usable
@@ -393,6 +651,7 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
         item->priority_ = M_MAX_UNSIGNED;
         item->sendEvent_ = false;
         item->completed_ = false;
+        item->group_ = nullptr;
 
         poolItems_.Push(item);
     }
@@ -401,18 +660,18 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     // If no worker threads, complete low-priority work here
-    if (threads_.Empty() && !queue_.Empty())
+    if (threads_.Empty() && GetNumQueuedItems())
     {
         URHO3D_PROFILE(CompleteWorkNonthreaded);
 
         HiresTimer timer;
 
-        while (!queue_.Empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
+        while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkItem* item = TakeItem(0, 0);
+            if (!item)
+                break;
+            ExecuteItem(item, 0);
         }
     }
 
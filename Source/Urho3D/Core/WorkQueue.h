@@ -26,6 +26,9 @@
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
+#include <atomic>
+#include <functional>
+
 namespace Urho3D
 {
 
@@ -36,6 +39,26 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 }
 
 class WorkerThread;
+class WorkStealingDeque;
+
+/// Group of work items that can be waited on independently of the rest of the queue.
+struct WorkItemGroup
+{
+    /// Construct.
+    WorkItemGroup() :
+        pending_(0),
+        minPriority_(M_MAX_UNSIGNED)
+    {
+    }
+
+    /// Return whether all items of the group have completed.
+    bool IsCompleted() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+    /// Number of items added to the group that have not completed yet.
+    std::atomic<unsigned> pending_;
+    /// Lowest priority among the items of the group. The waiting thread only helps with work of at least this priority.
+    unsigned minPriority_;
+};
 
 /// Work queue item.
 struct WorkItem : public RefCounted
@@ -57,9 +80,17 @@ public:
     bool sendEvent_{};
     /// Completed flag.
     volatile bool completed_{};
+    /// Group the item belongs to, or null. The group must outlive the item's execution.
+    WorkItemGroup* group_{};
 
 private:
     bool pooled_{};
+    /// Whether the item has been added to the queue and not yet purged.
+    bool added_{};
+    /// Number of unfinished prerequisites, plus one while the item has not been added to the queue.
+    std::atomic<int> pendingDependencies_{1};
+    /// Items which depend on this one and are released when it completes.
+    PODVector<WorkItem*> dependents_;
 };
 
 /// Work queue subsystem for multithreading.
@@ -79,9 +110,11 @@ public:
     void CreateThreads(unsigned numThreads);
     /// Get pointer to an usable WorkItem from the item pool. Allocate one if no more free items.
     SharedPtr<WorkItem> GetFreeItem();
-    /// Add a work item and resume worker threads.
+    /// Add a work item and resume worker threads. If the item has unfinished dependencies, it will be queued for execution once they complete.
     void AddWorkItem(const SharedPtr<WorkItem>& item);
-    /// Remove a work item before it has started executing. Return true if successfully removed.
+    /// Make an item wait for the completion of another item before executing. Must be called before either item is added to the queue.
+    bool AddDependency(WorkItem* item, WorkItem* dependsOn);
+    /// Remove a work item before it has started executing. Items waiting for dependencies or having dependents can not be removed. Return true if successfully removed.
     bool RemoveWorkItem(SharedPtr<WorkItem> item);
     /// Remove a number of work items before they have started executing. Return the number of items successfully removed.
     unsigned RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items);
@@ -91,6 +124,10 @@ public:
     void Resume();
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(unsigned priority);
+    /// Execute queued work also in the calling thread until all items of the group have completed. Must be called from the main thread.
+    void Complete(WorkItemGroup& group);
+    /// Split the index range [0, count) into batches of at least minBatchSize and process them in parallel, including the main thread. Return when all batches are finished. The function is called with the batch start and end index and the thread index. When called outside the main thread, the whole range is processed in the calling thread as one batch with thread index 0.
+    void ParallelFor(unsigned count, unsigned minBatchSize, const std::function<void(unsigned, unsigned, unsigned)>& function);
 
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
@@ -101,6 +138,8 @@ public:
     /// Return number of worker threads.
     unsigned GetNumThreads() const { return threads_.Size(); }
 
+    /// Return number of work items waiting for execution in the threads' queues.
+    unsigned GetNumQueuedItems() const;
     /// Return whether all work with at least the specified priority is finished.
     bool IsCompleted(unsigned priority) const;
     /// Return whether the queue is currently completing work in the main thread.
@@ -115,10 +154,18 @@ public:
 private:
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
+    /// Push a runnable item to a thread's queue.
+    void QueueItem(WorkItem* item, unsigned queueIndex);
+    /// Take the highest priority item with at least the specified priority, from the thread's own queue or by stealing from other threads. Return null if none found.
+    WorkItem* TakeItem(unsigned threadIndex, unsigned priority);
+    /// Execute an item in the given thread and release the items depending on it.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
     /// Purge the pool to reduce allocation where its unneeded.
     void PurgePool();
+    /// Clear the dependency state of a work item that is leaving the queue.
+    void ResetItem(WorkItem* item);
     /// Return a work item to the pool.
     void ReturnToPool(SharedPtr<WorkItem>& item);
     /// Handle frame start event. Purge completed work from the main thread queue, and perform work if no threads at all.
@@ -130,16 +177,18 @@ private:
     List<SharedPtr<WorkItem> > poolItems_;
     /// Work item collection. Accessed only by the main thread.
     List<SharedPtr<WorkItem> > workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems.)
-    List<WorkItem*> queue_;
-    /// Worker queue mutex.
-    Mutex queueMutex_;
+    /// Per-thread work-stealing queues, index 0 for the main thread. Pointers are guaranteed to be valid (point to workItems.)
+    PODVector<WorkStealingDeque*> queues_;
+    /// Mutex locked while paused to keep idle worker threads from using up CPU time.
+    Mutex pauseMutex_;
+    /// Round-robin index of the next worker queue to receive items added from the main thread.
+    unsigned nextQueue_;
     /// Shutting down flag.
     volatile bool shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
+    /// Pausing flag. Indicates the worker threads should not contend for the pause mutex.
     volatile bool pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
-    bool paused_;
+    /// Paused flag. Indicates the pause mutex being locked to prevent worker threads using up CPU time.
+    volatile bool paused_;
     /// Completing work in the main thread flag.
     bool completing_;
     /// Tolerance for the shared pool before it begins to deallocate.
@@ -67,6 +67,18 @@ static bool CompareAnimationOrder(const SharedPtr<AnimationState>& lhs, const Sh
 
 static const unsigned MAX_ANIMATION_STATES = 256;
 
+/// Return whether an animated model exists in the node's parents, which could move the node during the threaded update.
+static bool HasAnimatedParent(Node* node)
+{
+    for (Node* parent = node->GetParent(); parent; parent = parent->GetParent())
+    {
+        if (parent->GetComponent<AnimatedModel>())
+            return true;
+    }
+
+    return false;
+}
+
 AnimatedModel::AnimatedModel(Context* context) :
     StaticModel(context),
     animationLodFrameNumber_(0),
@@ -83,19 +95,38 @@ AnimatedModel::AnimatedModel(Context* context) :
     isMaster_(true),
     loading_(false),
     assignBonesPending_(false),
-    forceAnimationUpdate_(false)
+    forceAnimationUpdate_(false),
+    poseBufferMode_(false)
 {
 }
 
 AnimatedModel::~AnimatedModel()
 {
     // When being destroyed, remove the bone hierarchy if appropriate (last AnimatedModel in the node)
-    Bone* rootBone = skeleton_.GetRootBone();
-    if (rootBone && rootBone->node_)
+    if (poseBufferMode_)
     {
-        Node* parent = rootBone->node_->GetParent();
-        if (parent && !parent->GetComponent<AnimatedModel>())
-            RemoveRootBone();
+        // In pose buffer mode the requested bone nodes are direct children of the model's node
+        const Vector<Bone>& bones = skeleton_.GetBones();
+        for (Vector<Bone>::ConstIterator i = bones.Begin(); i != bones.End(); ++i)
+        {
+            if (i->node_)
+            {
+                Node* parent = i->node_->GetParent();
+                if (parent && !parent->GetComponent<AnimatedModel>())
+                    RemoveRootBone();
+                break;
+            }
+        }
+    }
+    else
+    {
+        Bone* rootBone = skeleton_.GetRootBone();
+        if (rootBone && rootBone->node_)
+        {
+            Node* parent = rootBone->node_->GetParent();
+            if (parent && !parent->GetComponent<AnimatedModel>())
+                RemoveRootBone();
+        }
     }
 }
 
@@ -123,6 +154,7 @@ void AnimatedModel::RegisterObject(Context* context)
         .SetMetadata(AttributeMetadata::P_VECTOR_STRUCT_ELEMENTS, animationStatesStructureElementNames);
     URHO3D_ACCESSOR_ATTRIBUTE("Morphs", GetMorphsAttr, SetMorphsAttr, PODVector<unsigned char>, Variant::emptyBuffer,
         AM_DEFAULT | AM_NOEDIT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Pose Buffer Mode", GetPoseBufferMode, SetPoseBufferMode, bool, false, AM_DEFAULT);
 }
 
 bool AnimatedModel::Load(Deserializer& source)
@@ -174,11 +206,24 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
 
     const Vector<Bone>& bones = skeleton_.GetBones();
     Sphere boneSphere;
+    // In pose buffer mode the bone transforms are read from the pose buffer instead of bone nodes
+    AnimatedModel* poseSource = GetPoseSource();
+    const Matrix3x4& worldTransform = node_->GetWorldTransform();
 
     for (unsigned i = 0; i < bones.Size(); ++i)
     {
         const Bone& bone = bones[i];
-        if (!bone.node_)
+        Matrix3x4 transform;
+        if (poseSource)
+        {
+            unsigned index = poseSource == this ? i : masterBoneIndices_[i];
+            if (index >= poseSource->boneModelTransforms_.Size())
+                continue;
+            transform = worldTransform * poseSource->boneModelTransforms_[index];
+        }
+        else if (bone.node_)
+            transform = bone.node_->GetWorldTransform();
+        else
             continue;
 
         float distance;
@@ -188,7 +233,6 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
         {
             // Do an initial crude test using the bone's AABB
             const BoundingBox& box = bone.boundingBox_;
-            const Matrix3x4& transform = bone.node_->GetWorldTransform();
             distance = query.ray_.HitDistance(box.Transformed(transform));
             if (distance >= query.maxDistance_)
                 continue;
@@ -204,7 +248,7 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
         }
         else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
         {
-            boneSphere.center_ = bone.node_->GetWorldPosition();
+            boneSphere.center_ = transform.Translation();
             boneSphere.radius_ = bone.radius_;
             distance = query.ray_.HitDistance(boneSphere);
             if (distance >= query.maxDistance_)
@@ -254,6 +298,15 @@ void AnimatedModel::Update(const FrameInfo& frame)
         UpdateAnimation(frame);
     else if (boneBoundingBoxDirty_)
         UpdateBoneBoundingBox();
+
+    // If the model was visible last frame, it is likely to be rendered again, so calculate the skin matrices now while
+    // animation is being updated in parallel. If the bones are moved afterward, skinning will be dirtied and updated again
+    // when preparing the geometry for rendering. Only the master model, whose bones no other model animates, is skinned
+    // here: non-master models share the master's bones and an animated parent may still be moving this model's node
+    // in another thread, so they are skinned in UpdateGeometry after all animation has been applied
+    if (skinningDirty_ && isMaster_ && !morphsDirty_ && !forceAnimationUpdate_ && frame.camera_ &&
+        abs((int)frame.frameNumber_ - (int)viewFrameNumber_) <= 1 && !HasAnimatedParent(node_))
+        UpdateSkinning();
 }
 
 void AnimatedModel::UpdateBatches(const FrameInfo& frame)
@@ -325,7 +378,31 @@ void AnimatedModel::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
     if (debug && IsEnabledEffective())
     {
         debug->AddBoundingBox(GetWorldBoundingBox(), Color::GREEN, depthTest);
-        debug->AddSkeleton(skeleton_, Color(0.75f, 0.75f, 0.75f), depthTest);
+
+        const Vector<Bone>& bones = skeleton_.GetBones();
+        if (poseBufferMode_ && boneModelTransforms_.Size() == bones.Size())
+        {
+            // Draw the skeleton from the pose buffer, as there are no bone nodes
+            const Matrix3x4& worldTransform = node_->GetWorldTransform();
+            Color color(0.75f, 0.75f, 0.75f);
+            for (unsigned i = 0; i < bones.Size(); ++i)
+            {
+                // Skip if bone contains no skinned geometry
+                if (bones[i].radius_ < M_EPSILON && bones[i].boundingBox_.Size().LengthSquared() < M_EPSILON)
+                    continue;
+
+                Vector3 start = worldTransform * boneModelTransforms_[i].Translation();
+                Vector3 end = start;
+                unsigned j = bones[i].parentIndex_;
+                if (j != i && j < bones.Size() && (bones[j].radius_ >= M_EPSILON ||
+                    bones[j].boundingBox_.Size().LengthSquared() >= M_EPSILON))
+                    end = worldTransform * boneModelTransforms_[j].Translation();
+
+                debug->AddLine(start, end, color, depthTest);
+            }
+        }
+        else
+            debug->AddSkeleton(skeleton_, Color(0.75f, 0.75f, 0.75f), depthTest);
     }
 }
 
@@ -549,6 +626,39 @@ void AnimatedModel::SetUpdateInvisible(bool enable)
 }
 
 
+void AnimatedModel::SetPoseBufferMode(bool enable)
+{
+    if (enable == poseBufferMode_)
+        return;
+
+    // If bones have already been set up, replace the bone nodes of the old mode. Any nodes attached to the bones are removed as well
+    if (isMaster_ && node_ && skeleton_.GetNumBones() && !assignBonesPending_)
+    {
+        RemoveRootBone();
+        poseBufferMode_ = enable;
+        if (!poseBufferMode_)
+            CreateBoneNodes();
+        InitializePose();
+
+        // Reassign the animation tracks to the bones or the pose buffer
+        for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
+        {
+            AnimationState* state = *i;
+            state->stateTracks_.Clear();
+            state->SetStartBone(state->GetStartBone());
+        }
+
+        MarkAnimationDirty();
+    }
+    else
+    {
+        poseBufferMode_ = enable;
+        InitializePose();
+    }
+
+    MarkNetworkUpdate();
+}
+
 void AnimatedModel::SetMorphWeight(unsigned index, float weight)
 {
     if (index >= morphs_.Size())
@@ -654,6 +764,31 @@ float AnimatedModel::GetMorphWeight(StringHash nameHash) const
     return 0.0f;
 }
 
+Node* AnimatedModel::GetBoneNode(const String& boneName)
+{
+    Bone* bone = skeleton_.GetBone(boneName);
+    if (!bone)
+        return nullptr;
+
+    if (!bone->node_ && poseBufferMode_ && isMaster_ && node_)
+    {
+        // Create as local and temporary, as the node only follows the pose buffer and is recreated on request
+        Node* boneNode = node_->CreateChild(bone->name_, LOCAL, 0, true);
+        unsigned index = skeleton_.GetBoneIndex(bone);
+        if (index < boneModelTransforms_.Size())
+        {
+            Vector3 position;
+            Quaternion rotation;
+            Vector3 scale;
+            boneModelTransforms_[index].Decompose(position, rotation, scale);
+            boneNode->SetTransform(position, rotation, scale);
+        }
+        bone->node_ = boneNode;
+    }
+
+    return bone->node_;
+}
+
 AnimationState* AnimatedModel::GetAnimationState(Animation* animation) const
 {
     for (Vector<SharedPtr<AnimationState> >::ConstIterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
@@ -710,8 +845,8 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
 
             for (unsigned i = 0; i < destBones.Size(); ++i)
             {
-                if (destBones[i].node_ && destBones[i].name_ == srcBones[i].name_ && destBones[i].parentIndex_ ==
-                                                                                     srcBones[i].parentIndex_)
+                if ((destBones[i].node_ || poseBufferMode_) && destBones[i].name_ == srcBones[i].name_ &&
+                    destBones[i].parentIndex_ == srcBones[i].parentIndex_)
                 {
                     // If compatible, just copy the values and retain the old node and animated status
                     Node* boneNode = destBones[i].node_;
@@ -741,26 +876,19 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
         // Merge bounding boxes from non-master models
         FinalizeBoneBoundingBoxes();
 
-        Vector<Bone>& bones = skeleton_.GetModifiableBones();
-        // Create scene nodes for the bones
-        if (createBones)
-        {
-            for (Vector<Bone>::Iterator i = bones.Begin(); i != bones.End(); ++i)
-            {
-                // Create bones as local, as they are never to be directly synchronized over the network
-                Node* boneNode = node_->CreateChild(i->name_, LOCAL);
-                boneNode->AddListener(this);
-                boneNode->SetTransform(i->initialPosition_, i->initialRotation_, i->initialScale_);
-                // Copy the model component's temporary status
-                boneNode->SetTemporary(IsTemporary());
-                i->node_ = boneNode;
-            }
+        // Create scene nodes for the bones, unless animating the pose buffer only
+        if (createBones && !poseBufferMode_)
+            CreateBoneNodes();
+        InitializePose();
 
-            for (unsigned i = 0; i < bones.Size(); ++i)
+        // Non-master models need to remap their bones to the master's pose buffer
+        if (node_)
+        {
+            const Vector<SharedPtr<Component> >& components = node_->GetComponents();
+            for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
             {
-                unsigned parentIndex = bones[i].parentIndex_;
-                if (parentIndex != i && parentIndex < bones.Size())
-                    bones[parentIndex].node_->AddChild(bones[i].node_);
+                if ((*i)->GetType() == AnimatedModel::GetTypeStatic())
+                    static_cast<AnimatedModel*>(i->Get())->masterBoneIndices_.Clear();
             }
         }
 
@@ -774,6 +902,7 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
     {
         // For non-master models: use the bone nodes of the master model
         skeleton_.Define(skeleton);
+        masterBoneIndices_.Clear();
 
         // Instruct the master model to refresh (merge) its bone bounding boxes
         auto* master = node_->GetComponent<AnimatedModel>();
@@ -912,6 +1041,24 @@ void AnimatedModel::UpdateBoneBoundingBox()
         Matrix3x4 inverseNodeTransform = node_->GetWorldTransform().Inverse();
 
         const Vector<Bone>& bones = skeleton_.GetBones();
+
+        // In pose buffer mode the model space bone transforms are readily available
+        if (poseBufferMode_ && boneModelTransforms_.Size() == bones.Size())
+        {
+            for (unsigned i = 0; i < bones.Size(); ++i)
+            {
+                const Bone& bone = bones[i];
+                if (bone.collisionMask_ & BONECOLLISION_BOX)
+                    boneBoundingBox_.Merge(bone.boundingBox_.Transformed(boneModelTransforms_[i]));
+                else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
+                    boneBoundingBox_.Merge(Sphere(boneModelTransforms_[i].Translation(), bone.radius_ * 0.5f));
+            }
+
+            boneBoundingBoxDirty_ = false;
+            worldBoundingBoxDirty_ = true;
+            return;
+        }
+
         for (Vector<Bone>::ConstIterator i = bones.Begin(); i != bones.End(); ++i)
         {
             Node* boneNode = i->node_;
@@ -983,6 +1130,18 @@ void AnimatedModel::AssignBoneNodes()
     if (!node_)
         return;
 
+    // In pose buffer mode bone nodes are only created on request. Assign the animation tracks to the pose buffer
+    if (poseBufferMode_ && isMaster_)
+    {
+        InitializePose();
+        for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
+        {
+            AnimationState* state = *i;
+            state->SetStartBone(state->GetStartBone());
+        }
+        return;
+    }
+
     // Find the bone nodes from the node hierarchy and add listeners
     Vector<Bone>& bones = skeleton_.GetModifiableBones();
     bool boneFound = false;
@@ -1074,11 +1233,154 @@ void AnimatedModel::FinalizeBoneBoundingBoxes()
 
 void AnimatedModel::RemoveRootBone()
 {
+    if (poseBufferMode_)
+    {
+        Vector<Bone>& bones = skeleton_.GetModifiableBones();
+        for (Vector<Bone>::Iterator i = bones.Begin(); i != bones.End(); ++i)
+        {
+            if (i->node_)
+            {
+                i->node_->Remove();
+                i->node_.Reset();
+            }
+        }
+        return;
+    }
+
     Bone* rootBone = skeleton_.GetRootBone();
     if (rootBone && rootBone->node_)
         rootBone->node_->Remove();
 }
 
+void AnimatedModel::CreateBoneNodes()
+{
+    Vector<Bone>& bones = skeleton_.GetModifiableBones();
+    for (Vector<Bone>::Iterator i = bones.Begin(); i != bones.End(); ++i)
+    {
+        // Create bones as local, as they are never to be directly synchronized over the network
+        Node* boneNode = node_->CreateChild(i->name_, LOCAL);
+        boneNode->AddListener(this);
+        boneNode->SetTransform(i->initialPosition_, i->initialRotation_, i->initialScale_);
+        // Copy the model component's temporary status
+        boneNode->SetTemporary(IsTemporary());
+        i->node_ = boneNode;
+    }
+
+    for (unsigned i = 0; i < bones.Size(); ++i)
+    {
+        unsigned parentIndex = bones[i].parentIndex_;
+        if (parentIndex != i && parentIndex < bones.Size())
+            bones[parentIndex].node_->AddChild(bones[i].node_);
+    }
+}
+
+void AnimatedModel::InitializePose()
+{
+    if (!poseBufferMode_)
+    {
+        bonePoses_.Clear();
+        boneModelTransforms_.Clear();
+        boneUpdateOrder_.Clear();
+        return;
+    }
+
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    unsigned numBones = bones.Size();
+    bonePoses_.Resize(numBones);
+    boneModelTransforms_.Resize(numBones);
+    for (unsigned i = 0; i < numBones; ++i)
+    {
+        BonePose& pose = bonePoses_[i];
+        pose.position_ = bones[i].initialPosition_;
+        pose.rotation_ = bones[i].initialRotation_;
+        pose.scale_ = bones[i].initialScale_;
+    }
+
+    // Order the bones so that parents are always updated before their children. For each bone walk up to the first already
+    // ordered ancestor, then add the chain top-down
+    boneUpdateOrder_.Clear();
+    boneUpdateOrder_.Reserve(numBones);
+    PODVector<bool> ordered(numBones);
+    for (unsigned i = 0; i < numBones; ++i)
+        ordered[i] = false;
+    PODVector<unsigned> chain;
+
+    for (unsigned i = 0; i < numBones; ++i)
+    {
+        unsigned index = i;
+        while (index < numBones && !ordered[index] && chain.Size() < numBones)
+        {
+            chain.Push(index);
+            unsigned parentIndex = bones[index].parentIndex_;
+            if (parentIndex == index)
+                break;
+            index = parentIndex;
+        }
+
+        while (!chain.Empty())
+        {
+            unsigned j = chain.Back();
+            chain.Pop();
+            if (!ordered[j])
+            {
+                ordered[j] = true;
+                boneUpdateOrder_.Push(j);
+            }
+        }
+    }
+
+    UpdatePoseTransforms();
+}
+
+void AnimatedModel::UpdatePoseTransforms()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+
+    for (PODVector<unsigned>::ConstIterator i = boneUpdateOrder_.Begin(); i != boneUpdateOrder_.End(); ++i)
+    {
+        unsigned index = *i;
+        const BonePose& pose = bonePoses_[index];
+        unsigned parentIndex = bones[index].parentIndex_;
+        if (parentIndex != index && parentIndex < boneModelTransforms_.Size())
+            boneModelTransforms_[index] = boneModelTransforms_[parentIndex] * Matrix3x4(pose.position_, pose.rotation_, pose.scale_);
+        else
+            boneModelTransforms_[index] = Matrix3x4(pose.position_, pose.rotation_, pose.scale_);
+
+        // Bone nodes requested for attachments are direct children of the model's node, so they get the model space transform
+        Node* boneNode = bones[index].node_;
+        if (boneNode)
+        {
+            Vector3 position;
+            Quaternion rotation;
+            Vector3 scale;
+            boneModelTransforms_[index].Decompose(position, rotation, scale);
+            boneNode->SetTransformSilent(position, rotation, scale);
+            boneNode->MarkDirty();
+        }
+    }
+}
+
+AnimatedModel* AnimatedModel::GetPoseSource()
+{
+    if (isMaster_)
+        return poseBufferMode_ ? this : nullptr;
+
+    auto* master = node_ ? node_->GetComponent<AnimatedModel>() : nullptr;
+    if (!master || master == this || !master->poseBufferMode_)
+        return nullptr;
+
+    // Map the bones to the master's skeleton by name
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    if (masterBoneIndices_.Size() != bones.Size())
+    {
+        masterBoneIndices_.Resize(bones.Size());
+        for (unsigned i = 0; i < bones.Size(); ++i)
+            masterBoneIndices_[i] = master->skeleton_.GetBoneIndex(bones[i].nameHash_);
+    }
+
+    return master;
+}
+
 void AnimatedModel::MarkAnimationDirty()
 {
     if (isMaster_)
@@ -1284,7 +1586,44 @@ void AnimatedModel::ApplyAnimation()
 
     // Reset skeleton, apply all animations, calculate bones' bounding box. Make sure this is only done for the master model
     // (first AnimatedModel in a node)
-    if (isMaster_)
+    if (isMaster_ && poseBufferMode_)
+    {
+        const Vector<Bone>& bones = skeleton_.GetBones();
+        if (bonePoses_.Size() != bones.Size())
+            InitializePose();
+
+        // Reset the animated bones in the pose buffer, apply all animations and calculate the model space transforms
+        for (unsigned i = 0; i < bones.Size(); ++i)
+        {
+            const Bone& bone = bones[i];
+            if (bone.animated_)
+            {
+                BonePose& pose = bonePoses_[i];
+                pose.position_ = bone.initialPosition_;
+                pose.rotation_ = bone.initialRotation_;
+                pose.scale_ = bone.initialScale_;
+            }
+        }
+        for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
+            (*i)->Apply();
+
+        UpdatePoseTransforms();
+        UpdateBoneBoundingBox();
+
+        // The model's node did not move, so only skinning needs to be marked dirty, including other models of the node that
+        // skin from this pose buffer
+        skinningDirty_ = true;
+        if (!updateQueued_ && octant_)
+            octant_->GetRoot()->QueueUpdate(this);
+
+        const Vector<SharedPtr<Component> >& components = node_->GetComponents();
+        for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
+        {
+            if (i->Get() != this && (*i)->GetType() == AnimatedModel::GetTypeStatic())
+                static_cast<AnimatedModel*>(i->Get())->OnMarkedDirty(node_);
+        }
+    }
+    else if (isMaster_)
     {
         skeleton_.ResetSilent();
         for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
@@ -1302,24 +1641,28 @@ void AnimatedModel::ApplyAnimation()
 
 void AnimatedModel::UpdateSkinning()
 {
+    // Clear the dirty flag first, so that bones being moved while the matrices are calculated dirty the skinning again
+    skinningDirty_ = false;
+
     // Note: the model's world transform will be baked in the skin matrices
     const Vector<Bone>& bones = skeleton_.GetBones();
     // Use model's world transform in case a bone is missing
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    // In pose buffer mode calculate directly from the model space bone transforms
+    AnimatedModel* poseSource = GetPoseSource();
 
-    // Skinning with global matrices only
-    if (!geometrySkinMatrices_.Size())
+    if (poseSource)
     {
+        const PODVector<Matrix3x4>& modelTransforms = poseSource->boneModelTransforms_;
         for (unsigned i = 0; i < bones.Size(); ++i)
         {
-            const Bone& bone = bones[i];
-            if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
+            unsigned index = poseSource == this ? i : masterBoneIndices_[i];
+            if (index < modelTransforms.Size())
+                skinMatrices_[i] = worldTransform * modelTransforms[index] * bones[i].offsetMatrix_;
             else
                 skinMatrices_[i] = worldTransform;
         }
     }
-    // Skinning with per-geometry matrices
     else
     {
         for (unsigned i = 0; i < bones.Size(); ++i)
@@ -1329,14 +1672,18 @@ void AnimatedModel::UpdateSkinning()
                 skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
             else
                 skinMatrices_[i] = worldTransform;
+        }
+    }
 
-            // Copy the skin matrix to per-geometry matrices as needed
+    // Copy the skin matrices to per-geometry matrices as needed
+    if (geometrySkinMatrices_.Size())
+    {
+        for (unsigned i = 0; i < bones.Size(); ++i)
+        {
             for (unsigned j = 0; j < geometrySkinMatrixPtrs_[i].Size(); ++j)
                 *geometrySkinMatrixPtrs_[i][j] = skinMatrices_[i];
         }
     }
-
-    skinningDirty_ = false;
 }
 
 void AnimatedModel::UpdateMorphs()
@@ -26,12 +26,25 @@
 #include "../Graphics/Skeleton.h"
 #include "../Graphics/StaticModel.h"
 
+#include <atomic>
+
 namespace Urho3D
 {
 
 class Animation;
 class AnimationState;
 
+/// Local transform of a bone in the pose buffer.
+struct BonePose
+{
+    /// Position.
+    Vector3 position_;
+    /// Rotation.
+    Quaternion rotation_;
+    /// Scale.
+    Vector3 scale_;
+};
+
 /// Animated model component.
 class URHO3D_API AnimatedModel : public StaticModel
 {
@@ -88,6 +101,8 @@ public:
     void SetAnimationLodBias(float bias);
     /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
     void SetUpdateInvisible(bool enable);
+    /// Set pose buffer mode. In pose buffer mode no bone scene nodes are created; animations are applied to a flat array of bone transforms instead. Bone nodes can still be requested individually with GetBoneNode().
+    void SetPoseBufferMode(bool enable);
     /// Set vertex morph weight by index.
     void SetMorphWeight(unsigned index, float weight);
     /// Set vertex morph weight by name.
@@ -123,6 +138,18 @@ public:
     /// Return whether to update animation when not visible.
     bool GetUpdateInvisible() const { return updateInvisible_; }
 
+    /// Return whether pose buffer mode is enabled.
+    bool GetPoseBufferMode() const { return poseBufferMode_; }
+
+    /// Return the bones' local transforms in pose buffer mode.
+    const Vector<BonePose>& GetBonePoses() const { return bonePoses_; }
+
+    /// Return the bones' model space transforms in pose buffer mode.
+    const PODVector<Matrix3x4>& GetBoneModelTransforms() const { return boneModelTransforms_; }
+
+    /// Return the scene node of a bone by name. In pose buffer mode the node is created on first request as a temporary child of the model's node, and follows the animated bone. Return null if no such bone.
+    Node* GetBoneNode(const String& boneName);
+
     /// Return all vertex morphs.
     const Vector<ModelMorph>& GetMorphs() const { return morphs_; }
 
@@ -181,8 +208,16 @@ private:
     void AssignBoneNodes();
     /// Finalize master model bone bounding boxes by merging from matching non-master bones.. Performed whenever any of the AnimatedModels in the same node changes its model.
     void FinalizeBoneBoundingBoxes();
-    /// Remove (old) skeleton root bone.
+    /// Remove (old) skeleton root bone, or in pose buffer mode the individually created bone nodes.
     void RemoveRootBone();
+    /// Create the scene node hierarchy for the bones.
+    void CreateBoneNodes();
+    /// Size the pose buffer to the skeleton, reset it to the initial pose and calculate the bone update order.
+    void InitializePose();
+    /// Calculate model space bone transforms from the pose buffer and update the requested bone nodes.
+    void UpdatePoseTransforms();
+    /// Return the model whose pose buffer this model is skinned from, or null if not using a pose buffer.
+    AnimatedModel* GetPoseSource();
     /// Mark animation and skinning to require an update.
     void MarkAnimationDirty();
     /// Mark animation and skinning to require a forced update (blending order changed.)
@@ -225,6 +260,14 @@ private:
     Vector<PODVector<Matrix3x4> > geometrySkinMatrices_;
     /// Subgeometry skinning matrix pointers, if more bones than skinning shader can manage.
     Vector<PODVector<Matrix3x4*> > geometrySkinMatrixPtrs_;
+    /// Bone local transforms in pose buffer mode.
+    Vector<BonePose> bonePoses_;
+    /// Bone model space transforms in pose buffer mode.
+    PODVector<Matrix3x4> boneModelTransforms_;
+    /// Bone indices ordered so that parents come before their children, used in pose buffer mode.
+    PODVector<unsigned> boneUpdateOrder_;
+    /// Indices of own bones in the master model's skeleton, used when skinning from the master model's pose buffer.
+    PODVector<unsigned> masterBoneIndices_;
     /// Bounding box calculated from bones.
     BoundingBox boneBoundingBox_;
     /// Attribute buffer.
@@ -247,8 +290,8 @@ private:
     bool animationOrderDirty_;
     /// Vertex morphs dirty flag.
     bool morphsDirty_;
-    /// Skinning dirty flag.
-    bool skinningDirty_;
+    /// Skinning dirty flag. Atomic as bone nodes may be marked dirty from another model's animation update in a worker thread.
+    std::atomic<bool> skinningDirty_;
     /// Bone bounding box dirty flag.
     bool boneBoundingBoxDirty_;
     /// Master model flag.
@@ -259,6 +302,8 @@ private:
     bool assignBonesPending_;
     /// Force animation update after becoming visible flag.
     bool forceAnimationUpdate_;
+    /// Pose buffer mode flag.
+    bool poseBufferMode_;
 };
 
 }
@@ -39,6 +39,125 @@
 namespace Urho3D
 {
 
+/// Largest quantized value of a smallest-three rotation component.
+static const float QUAT_COMPONENT_MAX = 32767.0f;
+/// Scale to bring the smallest three components from [-1/sqrt(2), 1/sqrt(2)] to [-1, 1].
+static const float QUAT_COMPONENT_SCALE = 1.41421356f;
+/// Largest quantized value of a position or scale component.
+static const float VECTOR_COMPONENT_MAX = 65535.0f;
+
+/// Evaluate keyframes at time without wrapping. Index is used as a search hint.
+static void EvaluateKeyFrames(const AnimationTrack& track, float time, unsigned& index, AnimationKeyFrame& dest)
+{
+    track.GetKeyFrameIndex(time, index);
+    const AnimationKeyFrame& keyFrame = track.keyFrames_[index];
+    if (index + 1 < track.keyFrames_.Size())
+    {
+        const AnimationKeyFrame& nextKeyFrame = track.keyFrames_[index + 1];
+        float timeInterval = nextKeyFrame.time_ - keyFrame.time_;
+        float t = timeInterval > 0.0f ? Clamp((time - keyFrame.time_) / timeInterval, 0.0f, 1.0f) : 1.0f;
+        dest.position_ = keyFrame.position_.Lerp(nextKeyFrame.position_, t);
+        dest.rotation_ = keyFrame.rotation_.Slerp(nextKeyFrame.rotation_, t);
+        dest.scale_ = keyFrame.scale_.Lerp(nextKeyFrame.scale_, t);
+    }
+    else
+        dest = keyFrame;
+    dest.time_ = time;
+}
+
+/// Encode a rotation as the three smallest components in 15 bits each. The index of the omitted component goes to the top bits of the first two values.
+static void EncodeRotation(const Quaternion& rotation, unsigned short* dest)
+{
+    Quaternion normalized = rotation.Normalized();
+    const float components[4] = {normalized.w_, normalized.x_, normalized.y_, normalized.z_};
+
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, so flip to make the omitted component positive
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    unsigned j = 0;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float value = Clamp(components[i] * sign * QUAT_COMPONENT_SCALE * 0.5f + 0.5f, 0.0f, 1.0f);
+        dest[j++] = (unsigned short)(value * QUAT_COMPONENT_MAX + 0.5f);
+    }
+
+    dest[0] |= (unsigned short)((largest & 1u) << 15u);
+    dest[1] |= (unsigned short)((largest >> 1u) << 15u);
+}
+
+/// Decode a smallest-three rotation.
+static Quaternion DecodeRotation(const unsigned short* src)
+{
+    unsigned largest = (src[0] >> 15u) | ((src[1] >> 15u) << 1u);
+    float components[4];
+    float sumSquares = 0.0f;
+
+    unsigned j = 0;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float value = ((src[j++] & 0x7fffu) * (2.0f / QUAT_COMPONENT_MAX) - 1.0f) / QUAT_COMPONENT_SCALE;
+        components[i] = value;
+        sumSquares += value * value;
+    }
+    components[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+
+    return Quaternion(components[0], components[1], components[2], components[3]);
+}
+
+/// Decode a 16-bit quantized vector.
+static Vector3 DecodeVector(const unsigned short* src, const Vector3& min, const Vector3& step)
+{
+    return Vector3(min.x_ + src[0] * step.x_, min.y_ + src[1] * step.y_, min.z_ + src[2] * step.z_);
+}
+
+/// Return whether a compressed channel's sample count is valid: absent, constant or sampled at every sample.
+static bool IsValidSampleCount(unsigned count, unsigned numSamples)
+{
+    return count <= 1 || count == numSamples;
+}
+
+/// Quantize a vector channel of baked samples and append to sample data. Constant channels are stored as a single sample.
+static void QuantizeVectors(const Vector<AnimationKeyFrame>& samples, Vector3 AnimationKeyFrame::* member, PODVector<unsigned short>& data,
+    unsigned& offset, unsigned& count, Vector3& min, Vector3& step)
+{
+    Vector3 max = samples[0].*member;
+    min = max;
+    for (unsigned i = 1; i < samples.Size(); ++i)
+    {
+        min = VectorMin(min, samples[i].*member);
+        max = VectorMax(max, samples[i].*member);
+    }
+
+    Vector3 range = max - min;
+    bool constant = range.Equals(Vector3::ZERO);
+    step = constant ? Vector3::ZERO : range / VECTOR_COMPONENT_MAX;
+    count = constant ? 1 : samples.Size();
+    offset = data.Size();
+    data.Resize(offset + count * 3);
+
+    unsigned short* dest = &data[offset];
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const float* value = (samples[i].*member).Data();
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            float stepValue = step.Data()[j];
+            *dest++ = stepValue > 0.0f ? (unsigned short)Clamp((value[j] - min.Data()[j]) / stepValue + 0.5f, 0.0f,
+                VECTOR_COMPONENT_MAX) : 0;
+        }
+    }
+}
+
 inline bool CompareTriggers(AnimationTriggerPoint& lhs, AnimationTriggerPoint& rhs)
 {
     return lhs.time_ < rhs.time_;
@@ -108,7 +227,8 @@ void AnimationTrack::GetKeyFrameIndex(float time, unsigned& index) const
 
 Animation::Animation(Context* context) :
     ResourceWithMetadata(context),
-    length_(0.f)
+    length_(0.f),
+    numSamples_(0)
 {
 }
 
@@ -123,18 +243,22 @@ bool Animation::BeginLoad(Deserializer& source)
 {
     unsigned memoryUse = sizeof(Animation);
 
-    // Check ID
-    if (source.ReadFileID() != "UANI")
+    // Check ID. UAN2 is the compressed format
+    String fileID = source.ReadFileID();
+    if (fileID != "UANI" && fileID != "UAN2")
     {
         URHO3D_LOGERROR(source.GetName() + " is not a valid animation file");
         return false;
     }
+    bool compressed = fileID == "UAN2";
 
     // Read name and length
     animationName_ = source.ReadString();
     animationNameHash_ = animationName_;
     length_ = source.ReadFloat();
     tracks_.Clear();
+    numSamples_ = compressed ? source.ReadUInt() : 0;
+    sampleData_.Clear();
 
     unsigned tracks = source.ReadUInt();
     memoryUse += tracks * sizeof(AnimationTrack);
@@ -145,6 +269,24 @@ bool Animation::BeginLoad(Deserializer& source)
         AnimationTrack* newTrack = CreateTrack(source.ReadString());
         newTrack->channelMask_ = AnimationChannelFlags(source.ReadUByte());
 
+        if (compressed)
+        {
+            CompressedTrackData& data = newTrack->compressed_;
+            data.positionOffset_ = source.ReadUInt();
+            data.positionSamples_ = source.ReadUInt();
+            data.positionMin_ = source.ReadVector3();
+            data.positionStep_ = source.ReadVector3();
+            data.rotationOffset_ = source.ReadUInt();
+            data.rotationSamples_ = source.ReadUInt();
+            data.scaleOffset_ = source.ReadUInt();
+            data.scaleSamples_ = source.ReadUInt();
+            data.scaleMin_ = source.ReadVector3();
+            data.scaleStep_ = source.ReadVector3();
+            data.lastKeyTime_ = source.ReadFloat();
+            data.wrapTime_ = source.ReadFloat();
+            continue;
+        }
+
         unsigned keyFrames = source.ReadUInt();
         newTrack->keyFrames_.Resize(keyFrames);
         memoryUse += keyFrames * sizeof(AnimationKeyFrame);
@@ -163,6 +305,44 @@ bool Animation::BeginLoad(Deserializer& source)
         }
     }
 
+    // Read the sample data of all tracks in one go
+    if (compressed)
+    {
+        unsigned numValues = source.ReadUInt();
+        unsigned long long dataSize = (unsigned long long)numValues * sizeof(unsigned short);
+        if (dataSize > source.GetSize() - source.GetPosition())
+        {
+            URHO3D_LOGERROR(source.GetName() + " has truncated animation sample data");
+            return false;
+        }
+        sampleData_.Resize(numValues);
+        if (dataSize && source.Read(&sampleData_[0], (unsigned)dataSize) != dataSize)
+        {
+            URHO3D_LOGERROR(source.GetName() + " has truncated animation sample data");
+            return false;
+        }
+        memoryUse += (unsigned)dataSize;
+
+        // Each channel is either absent, constant or sampled at every sample, and must fit within the sample data
+        for (HashMap<StringHash, AnimationTrack>::ConstIterator i = tracks_.Begin(); i != tracks_.End(); ++i)
+        {
+            const CompressedTrackData& data = i->second_.compressed_;
+            if (!IsValidSampleCount(data.positionSamples_, numSamples_) || !IsValidSampleCount(data.rotationSamples_, numSamples_) ||
+                !IsValidSampleCount(data.scaleSamples_, numSamples_))
+            {
+                URHO3D_LOGERROR(source.GetName() + " has invalid animation sample counts");
+                return false;
+            }
+            if ((unsigned long long)data.positionOffset_ + data.positionSamples_ * 3ULL > sampleData_.Size() ||
+                (unsigned long long)data.rotationOffset_ + data.rotationSamples_ * 3ULL > sampleData_.Size() ||
+                (unsigned long long)data.scaleOffset_ + data.scaleSamples_ * 3ULL > sampleData_.Size())
+            {
+                URHO3D_LOGERROR(source.GetName() + " has invalid animation sample offsets");
+                return false;
+            }
+        }
+    }
+
     // Optionally read triggers from an XML file
     auto* cache = GetSubsystem<ResourceCache>();
     String xmlName = ReplaceExtension(GetName(), ".xml");
@@ -224,9 +404,12 @@ bool Animation::BeginLoad(Deserializer& source)
 bool Animation::Save(Serializer& dest) const
 {
     // Write ID, name and length
-    dest.WriteFileID("UANI");
+    bool compressed = IsCompressed();
+    dest.WriteFileID(compressed ? "UAN2" : "UANI");
     dest.WriteString(animationName_);
     dest.WriteFloat(length_);
+    if (compressed)
+        dest.WriteUInt(numSamples_);
 
     // Write tracks
     dest.WriteUInt(tracks_.Size());
@@ -235,6 +418,25 @@ bool Animation::Save(Serializer& dest) const
         const AnimationTrack& track = i->second_;
         dest.WriteString(track.name_);
         dest.WriteUByte(track.channelMask_);
+
+        if (compressed)
+        {
+            const CompressedTrackData& data = track.compressed_;
+            dest.WriteUInt(data.positionOffset_);
+            dest.WriteUInt(data.positionSamples_);
+            dest.WriteVector3(data.positionMin_);
+            dest.WriteVector3(data.positionStep_);
+            dest.WriteUInt(data.rotationOffset_);
+            dest.WriteUInt(data.rotationSamples_);
+            dest.WriteUInt(data.scaleOffset_);
+            dest.WriteUInt(data.scaleSamples_);
+            dest.WriteVector3(data.scaleMin_);
+            dest.WriteVector3(data.scaleStep_);
+            dest.WriteFloat(data.lastKeyTime_);
+            dest.WriteFloat(data.wrapTime_);
+            continue;
+        }
+
         dest.WriteUInt(track.keyFrames_.Size());
 
         // Write keyframes of the track
@@ -251,6 +453,13 @@ bool Animation::Save(Serializer& dest) const
         }
     }
 
+    if (compressed)
+    {
+        dest.WriteUInt(sampleData_.Size());
+        if (!sampleData_.Empty())
+            dest.Write(&sampleData_[0], sampleData_.Size() * sizeof(unsigned short));
+    }
+
     // If triggers have been defined, write an XML file for them
     if (!triggers_.Empty() || HasMetadata())
     {
@@ -375,12 +584,174 @@ SharedPtr<Animation> Animation::Clone(const String& cloneName) const
     ret->length_ = length_;
     ret->tracks_ = tracks_;
     ret->triggers_ = triggers_;
+    ret->numSamples_ = numSamples_;
+    ret->sampleData_ = sampleData_;
     ret->CopyMetadata(*this);
     ret->SetMemoryUse(GetMemoryUse());
 
     return ret;
 }
 
+bool Animation::Compress(float sampleRate)
+{
+    if (IsCompressed())
+        return true;
+
+    if (sampleRate <= 0.0f)
+    {
+        URHO3D_LOGERROR("Invalid animation sample rate " + String(sampleRate));
+        return false;
+    }
+
+    URHO3D_PROFILE(CompressAnimation);
+
+    unsigned numSamples = Max((unsigned)CeilToInt(length_ * sampleRate) + 1, 2u);
+    float timeStep = length_ / (float)(numSamples - 1);
+
+    // Bake all tracks first, so that the sample data can be laid out one channel type at a time
+    Vector<Vector<AnimationKeyFrame> > bakedTracks;
+    bakedTracks.Reserve(tracks_.Size());
+    for (HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Begin(); i != tracks_.End(); ++i)
+    {
+        AnimationTrack& track = i->second_;
+        track.compressed_ = CompressedTrackData();
+        bakedTracks.Resize(bakedTracks.Size() + 1);
+        if (track.keyFrames_.Empty())
+        {
+            // Nothing to play back
+            track.channelMask_ = CHANNEL_NONE;
+            continue;
+        }
+
+        // The samples hold the last keyframe until the end. Looped playback interpolates from it back to the first keyframe
+        // at sampling time instead, as the same samples serve both looped and non-looped playback
+        track.compressed_.lastKeyTime_ = track.keyFrames_.Back().time_;
+        track.compressed_.wrapTime_ = length_ - track.keyFrames_.Back().time_ + track.keyFrames_.Front().time_;
+
+        Vector<AnimationKeyFrame>& samples = bakedTracks.Back();
+        samples.Resize(numSamples);
+        unsigned index = 0;
+        for (unsigned j = 0; j < numSamples; ++j)
+            EvaluateKeyFrames(track, j * timeStep, index, samples[j]);
+    }
+
+    PODVector<unsigned short> data;
+    unsigned trackIndex = 0;
+    for (HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Begin(); i != tracks_.End(); ++i, ++trackIndex)
+    {
+        AnimationTrack& track = i->second_;
+        CompressedTrackData& compressed = track.compressed_;
+        if (track.channelMask_ & CHANNEL_POSITION)
+        {
+            QuantizeVectors(bakedTracks[trackIndex], &AnimationKeyFrame::position_, data, compressed.positionOffset_,
+                compressed.positionSamples_, compressed.positionMin_, compressed.positionStep_);
+        }
+    }
+
+    trackIndex = 0;
+    for (HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Begin(); i != tracks_.End(); ++i, ++trackIndex)
+    {
+        AnimationTrack& track = i->second_;
+        if (!(track.channelMask_ & CHANNEL_ROTATION))
+            continue;
+
+        const Vector<AnimationKeyFrame>& samples = bakedTracks[trackIndex];
+        bool constant = true;
+        for (unsigned j = 1; j < samples.Size() && constant; ++j)
+            constant = samples[j].rotation_.Equals(samples[0].rotation_);
+
+        CompressedTrackData& compressed = track.compressed_;
+        compressed.rotationSamples_ = constant ? 1 : samples.Size();
+        compressed.rotationOffset_ = data.Size();
+        data.Resize(data.Size() + compressed.rotationSamples_ * 3);
+        for (unsigned j = 0; j < compressed.rotationSamples_; ++j)
+            EncodeRotation(samples[j].rotation_, &data[compressed.rotationOffset_ + j * 3]);
+    }
+
+    trackIndex = 0;
+    for (HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Begin(); i != tracks_.End(); ++i, ++trackIndex)
+    {
+        AnimationTrack& track = i->second_;
+        CompressedTrackData& compressed = track.compressed_;
+        if (track.channelMask_ & CHANNEL_SCALE)
+        {
+            QuantizeVectors(bakedTracks[trackIndex], &AnimationKeyFrame::scale_, data, compressed.scaleOffset_,
+                compressed.scaleSamples_, compressed.scaleMin_, compressed.scaleStep_);
+        }
+        track.keyFrames_.Clear();
+    }
+
+    numSamples_ = numSamples;
+    sampleData_ = data;
+
+    unsigned memoryUse = sizeof(Animation) + tracks_.Size() * sizeof(AnimationTrack) + sampleData_.Size() * sizeof(unsigned short) +
+        triggers_.Size() * sizeof(AnimationTriggerPoint);
+    SetMemoryUse(memoryUse);
+    return true;
+}
+
+void Animation::SampleTrack(const AnimationTrack& track, float time, bool looped, Vector3& position, Quaternion& rotation,
+    Vector3& scale) const
+{
+    if (!numSamples_)
+        return;
+
+    const CompressedTrackData& compressed = track.compressed_;
+    const unsigned short* data = sampleData_.Buffer();
+
+    unsigned index;
+    unsigned nextIndex;
+    float t;
+    if (looped && time > compressed.lastKeyTime_ && compressed.wrapTime_ > 0.0f)
+    {
+        // Past the last keyframe, interpolate from the last sample to the first
+        index = numSamples_ - 1;
+        nextIndex = 0;
+        t = Min((time - compressed.lastKeyTime_) / compressed.wrapTime_, 1.0f);
+    }
+    else
+    {
+        // Uniform sampling: the sample index follows directly from the time. With a single sample all channels are constant
+        float samplePos = numSamples_ > 1 && length_ > 0.0f ? Clamp(time / length_, 0.0f, 1.0f) * (float)(numSamples_ - 1) : 0.0f;
+        index = numSamples_ > 1 ? Min((unsigned)samplePos, numSamples_ - 2) : 0;
+        nextIndex = Min(index + 1, numSamples_ - 1);
+        t = samplePos - (float)index;
+    }
+
+    if (track.channelMask_ & CHANNEL_POSITION)
+    {
+        if (compressed.positionSamples_ > 1)
+        {
+            const unsigned short* src = data + compressed.positionOffset_;
+            position = DecodeVector(src + index * 3, compressed.positionMin_, compressed.positionStep_).Lerp(
+                DecodeVector(src + nextIndex * 3, compressed.positionMin_, compressed.positionStep_), t);
+        }
+        else if (compressed.positionSamples_)
+            position = compressed.positionMin_;
+    }
+    if (track.channelMask_ & CHANNEL_ROTATION)
+    {
+        if (compressed.rotationSamples_ > 1)
+        {
+            const unsigned short* src = data + compressed.rotationOffset_;
+            rotation = DecodeRotation(src + index * 3).Nlerp(DecodeRotation(src + nextIndex * 3), t, true);
+        }
+        else if (compressed.rotationSamples_)
+            rotation = DecodeRotation(data + compressed.rotationOffset_);
+    }
+    if (track.channelMask_ & CHANNEL_SCALE)
+    {
+        if (compressed.scaleSamples_ > 1)
+        {
+            const unsigned short* src = data + compressed.scaleOffset_;
+            scale = DecodeVector(src + index * 3, compressed.scaleMin_, compressed.scaleStep_).Lerp(
+                DecodeVector(src + nextIndex * 3, compressed.scaleMin_, compressed.scaleStep_), t);
+        }
+        else if (compressed.scaleSamples_)
+            scale = compressed.scaleMin_;
+    }
+}
+
 AnimationTrack* Animation::GetTrack(unsigned index)
 {
     if (index >= GetNumTracks())
@@ -60,6 +60,35 @@ struct AnimationKeyFrame
     Vector3 scale_;
 };
 
+/// Location of a track's quantized samples inside a compressed animation.
+struct CompressedTrackData
+{
+    /// Offset of the first position sample in the animation's sample data.
+    unsigned positionOffset_{};
+    /// Offset of the first rotation sample in the animation's sample data.
+    unsigned rotationOffset_{};
+    /// Offset of the first scale sample in the animation's sample data.
+    unsigned scaleOffset_{};
+    /// Number of position samples. 1 means the channel is constant.
+    unsigned positionSamples_{};
+    /// Number of rotation samples. 1 means the channel is constant.
+    unsigned rotationSamples_{};
+    /// Number of scale samples. 1 means the channel is constant.
+    unsigned scaleSamples_{};
+    /// Position dequantization minimum.
+    Vector3 positionMin_;
+    /// Position dequantization step.
+    Vector3 positionStep_;
+    /// Scale dequantization minimum.
+    Vector3 scaleMin_;
+    /// Scale dequantization step.
+    Vector3 scaleStep_;
+    /// Time of the last keyframe. The samples after it hold the last keyframe.
+    float lastKeyTime_{};
+    /// Time from the last keyframe to the first keyframe of the next loop, over which looped playback interpolates from the last sample to the first.
+    float wrapTime_{};
+};
+
 /// Skeletal animation track, stores keyframes of a single bone.
 struct URHO3D_API AnimationTrack
 {
@@ -92,8 +121,10 @@ struct URHO3D_API AnimationTrack
     StringHash nameHash_;
     /// Bitmask of included data (position, rotation, scale.)
     AnimationChannelFlags channelMask_{};
-    /// Keyframes.
+    /// Keyframes. Empty when the animation has been compressed.
     Vector<AnimationKeyFrame> keyFrames_;
+    /// Compressed sample data location, used when the animation is compressed.
+    CompressedTrackData compressed_;
 };
 
 /// %Animation trigger point.
@@ -153,6 +184,8 @@ public:
     void SetNumTriggers(unsigned num);
     /// Clone the animation.
     SharedPtr<Animation> Clone(const String& cloneName = String::EMPTY) const;
+    /// Convert keyframes to uniformly sampled, quantized tracks at the given rate (samples per second). Keyframes are discarded. Return true if successful.
+    bool Compress(float sampleRate = 30.0f);
 
     /// Return animation name.
     const String& GetAnimationName() const { return animationName_; }
@@ -186,6 +219,15 @@ public:
     /// Return a trigger point by index.
     AnimationTriggerPoint* GetTrigger(unsigned index);
 
+    /// Return whether the animation is stored in compressed form.
+    bool IsCompressed() const { return numSamples_ > 0; }
+
+    /// Return number of uniform samples per track when compressed.
+    unsigned GetNumSamples() const { return numSamples_; }
+
+    /// Sample a track of a compressed animation at the given time. When looped, the time after the last keyframe wraps to the first keyframe like keyframe playback does. Only the channels in the track's channel mask are written.
+    void SampleTrack(const AnimationTrack& track, float time, bool looped, Vector3& position, Quaternion& rotation, Vector3& scale) const;
+
 private:
     /// Animation name.
     String animationName_;
@@ -197,6 +239,10 @@ private:
     HashMap<StringHash, AnimationTrack> tracks_;
     /// Animation trigger points.
     Vector<AnimationTriggerPoint> triggers_;
+    /// Number of uniform samples per track, zero when not compressed.
+    unsigned numSamples_;
+    /// Quantized samples of all tracks: all positions, then all rotations, then all scales.
+    PODVector<unsigned short> sampleData_;
 };
 
 }
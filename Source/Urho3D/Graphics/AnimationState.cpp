@@ -36,6 +36,7 @@ namespace Urho3D
 AnimationStateTrack::AnimationStateTrack() :
     track_(nullptr),
     bone_(nullptr),
+    boneIndex_(M_MAX_UNSIGNED),
     weight_(1.0f),
     keyFrame_(0)
 {
@@ -125,9 +126,14 @@ void AnimationState::SetStartBone(Bone* startBone)
     const HashMap<StringHash, AnimationTrack>& tracks = animation_->GetTracks();
     stateTracks_.Clear();
 
-    if (!startBone->node_)
+    // In pose buffer mode the bone hierarchy is found from the skeleton instead of bone nodes
+    bool poseBufferMode = model_->GetPoseBufferMode();
+    if (!poseBufferMode && !startBone->node_)
         return;
 
+    unsigned startBoneIndex = skeleton.GetBoneIndex(startBone);
+    const Vector<Bone>& bones = skeleton.GetBones();
+
     for (HashMap<StringHash, AnimationTrack>::ConstIterator i = tracks.Begin(); i != tracks.End(); ++i)
     {
         AnimationStateTrack stateTrack;
@@ -139,6 +145,23 @@ void AnimationState::SetStartBone(Bone* startBone)
 
         if (nameHash == startBone->nameHash_)
             trackBone = startBone;
+        else if (poseBufferMode)
+        {
+            unsigned index = skeleton.GetBoneIndex(nameHash);
+            // Walk up the parents to check whether the bone is under the start bone
+            for (unsigned depth = 0; index < bones.Size() && depth < bones.Size(); ++depth)
+            {
+                unsigned parentIndex = bones[index].parentIndex_;
+                if (parentIndex == index)
+                    break;
+                if (parentIndex == startBoneIndex)
+                {
+                    trackBone = skeleton.GetBone(nameHash);
+                    break;
+                }
+                index = parentIndex;
+            }
+        }
         else
         {
             Node* trackBoneNode = startBone->node_->GetChild(nameHash, true);
@@ -146,9 +169,10 @@ void AnimationState::SetStartBone(Bone* startBone)
                 trackBone = skeleton.GetBone(nameHash);
         }
 
-        if (trackBone && trackBone->node_)
+        if (trackBone && (poseBufferMode || trackBone->node_))
         {
             stateTrack.bone_ = trackBone;
+            stateTrack.boneIndex_ = skeleton.GetBoneIndex(trackBone);
             stateTrack.node_ = trackBone->node_;
             stateTracks_.Push(stateTrack);
         }
@@ -219,7 +243,19 @@ void AnimationState::SetBoneWeight(unsigned index, float weight, bool recursive)
     if (recursive)
     {
         Node* boneNode = stateTracks_[index].node_;
-        if (boneNode)
+        if (model_ && model_->GetPoseBufferMode())
+        {
+            // In pose buffer mode find the child bones from the skeleton
+            const Vector<Bone>& bones = model_->GetSkeleton().GetBones();
+            unsigned boneIndex = stateTracks_[index].boneIndex_;
+            for (unsigned i = 0; i < stateTracks_.Size(); ++i)
+            {
+                unsigned childIndex = stateTracks_[i].boneIndex_;
+                if (childIndex < bones.Size() && childIndex != boneIndex && bones[childIndex].parentIndex_ == boneIndex)
+                    SetBoneWeight(i, weight, true);
+            }
+        }
+        else if (boneNode)
         {
             const Vector<SharedPtr<Node> >& children = boneNode->GetChildren();
             for (unsigned i = 0; i < children.Size(); ++i)
@@ -405,8 +441,10 @@ unsigned AnimationState::GetTrackIndex(const String& name) const
 {
     for (unsigned i = 0; i < stateTracks_.Size(); ++i)
     {
+        // Bone nodes may not exist in pose buffer mode, so compare bone names when animating a model
+        const Bone* bone = stateTracks_[i].bone_;
         Node* node = stateTracks_[i].node_;
-        if (node && node->GetName() == name)
+        if (bone ? bone->name_ == name : (node && node->GetName() == name))
             return i;
     }
 
@@ -428,8 +466,9 @@ unsigned AnimationState::GetTrackIndex(StringHash nameHash) const
 {
     for (unsigned i = 0; i < stateTracks_.Size(); ++i)
     {
+        const Bone* bone = stateTracks_[i].bone_;
         Node* node = stateTracks_[i].node_;
-        if (node && node->GetNameHash() == nameHash)
+        if (bone ? bone->nameHash_ == nameHash : (node && node->GetNameHash() == nameHash))
             return i;
     }
 
@@ -479,56 +518,72 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
     const AnimationTrack* track = stateTrack.track_;
     Node* node = stateTrack.node_;
 
-    if (track->keyFrames_.Empty() || !node)
-        return;
-
-    unsigned& frame = stateTrack.keyFrame_;
-    track->GetKeyFrameIndex(time_, frame);
-
-    // Check if next frame to interpolate to is valid, or if wrapping is needed (looping animation only)
-    unsigned nextFrame = frame + 1;
-    bool interpolate = true;
-    if (nextFrame >= track->keyFrames_.Size())
+    // In pose buffer mode write to the model's bone transform array instead of the bone node
+    BonePose* pose = nullptr;
+    if (model_ && model_->poseBufferMode_)
     {
-        if (!looped_)
-        {
-            nextFrame = frame;
-            interpolate = false;
-        }
-        else
-            nextFrame = 0;
+        if (stateTrack.boneIndex_ >= model_->bonePoses_.Size())
+            return;
+        pose = &model_->bonePoses_[stateTrack.boneIndex_];
     }
 
-    const AnimationKeyFrame* keyFrame = &track->keyFrames_[frame];
+    const bool compressed = animation_->IsCompressed();
+    if ((!compressed && track->keyFrames_.Empty()) || (!node && !pose))
+        return;
+
     const AnimationChannelFlags channelMask = track->channelMask_;
 
     Vector3 newPosition;
     Quaternion newRotation;
     Vector3 newScale;
 
-    if (interpolate)
-    {
-        const AnimationKeyFrame* nextKeyFrame = &track->keyFrames_[nextFrame];
-        float timeInterval = nextKeyFrame->time_ - keyFrame->time_;
-        if (timeInterval < 0.0f)
-            timeInterval += animation_->GetLength();
-        float t = timeInterval > 0.0f ? (time_ - keyFrame->time_) / timeInterval : 1.0f;
-
-        if (channelMask & CHANNEL_POSITION)
-            newPosition = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
-        if (channelMask & CHANNEL_ROTATION)
-            newRotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
-        if (channelMask & CHANNEL_SCALE)
-            newScale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
-    }
+    if (compressed)
+        animation_->SampleTrack(*track, time_, looped_, newPosition, newRotation, newScale);
     else
     {
-        if (channelMask & CHANNEL_POSITION)
-            newPosition = keyFrame->position_;
-        if (channelMask & CHANNEL_ROTATION)
-            newRotation = keyFrame->rotation_;
-        if (channelMask & CHANNEL_SCALE)
-            newScale = keyFrame->scale_;
+        unsigned& frame = stateTrack.keyFrame_;
+        track->GetKeyFrameIndex(time_, frame);
+
+        // Check if next frame to interpolate to is valid, or if wrapping is needed (looping animation only)
+        unsigned nextFrame = frame + 1;
+        bool interpolate = true;
+        if (nextFrame >= track->keyFrames_.Size())
+        {
+            if (!looped_)
+            {
+                nextFrame = frame;
+                interpolate = false;
+            }
+            else
+                nextFrame = 0;
+        }
+
+        const AnimationKeyFrame* keyFrame = &track->keyFrames_[frame];
+
+        if (interpolate)
+        {
+            const AnimationKeyFrame* nextKeyFrame = &track->keyFrames_[nextFrame];
+            float timeInterval = nextKeyFrame->time_ - keyFrame->time_;
+            if (timeInterval < 0.0f)
+                timeInterval += animation_->GetLength();
+            float t = timeInterval > 0.0f ? (time_ - keyFrame->time_) / timeInterval : 1.0f;
+
+            if (channelMask & CHANNEL_POSITION)
+                newPosition = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
+            if (channelMask & CHANNEL_ROTATION)
+                newRotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
+            if (channelMask & CHANNEL_SCALE)
+                newScale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
+        }
+        else
+        {
+            if (channelMask & CHANNEL_POSITION)
+                newPosition = keyFrame->position_;
+            if (channelMask & CHANNEL_ROTATION)
+                newRotation = keyFrame->rotation_;
+            if (channelMask & CHANNEL_SCALE)
+                newScale = keyFrame->scale_;
+        }
     }
 
     if (blendingMode_ == ABM_ADDITIVE) // not ABM_LERP
@@ -536,19 +591,20 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         if (channelMask & CHANNEL_POSITION)
         {
             Vector3 delta = newPosition - stateTrack.bone_->initialPosition_;
-            newPosition = node->GetPosition() + delta * weight;
+            newPosition = (pose ? pose->position_ : node->GetPosition()) + delta * weight;
         }
         if (channelMask & CHANNEL_ROTATION)
         {
+            const Quaternion& oldRotation = pose ? pose->rotation_ : node->GetRotation();
             Quaternion delta = newRotation * stateTrack.bone_->initialRotation_.Inverse();
-            newRotation = (delta * node->GetRotation()).Normalized();
+            newRotation = (delta * oldRotation).Normalized();
             if (!Equals(weight, 1.0f))
-                newRotation = node->GetRotation().Slerp(newRotation, weight);
+                newRotation = oldRotation.Slerp(newRotation, weight);
         }
         if (channelMask & CHANNEL_SCALE)
         {
             Vector3 delta = newScale - stateTrack.bone_->initialScale_;
-            newScale = node->GetScale() + delta * weight;
+            newScale = (pose ? pose->scale_ : node->GetScale()) + delta * weight;
         }
     }
     else
@@ -556,15 +612,24 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         if (!Equals(weight, 1.0f)) // not full weight
         {
             if (channelMask & CHANNEL_POSITION)
-                newPosition = node->GetPosition().Lerp(newPosition, weight);
+                newPosition = (pose ? pose->position_ : node->GetPosition()).Lerp(newPosition, weight);
             if (channelMask & CHANNEL_ROTATION)
-                newRotation = node->GetRotation().Slerp(newRotation, weight);
+                newRotation = (pose ? pose->rotation_ : node->GetRotation()).Slerp(newRotation, weight);
             if (channelMask & CHANNEL_SCALE)
-                newScale = node->GetScale().Lerp(newScale, weight);
+                newScale = (pose ? pose->scale_ : node->GetScale()).Lerp(newScale, weight);
         }
     }
 
-    if (silent)
+    if (pose)
+    {
+        if (channelMask & CHANNEL_POSITION)
+            pose->position_ = newPosition;
+        if (channelMask & CHANNEL_ROTATION)
+            pose->rotation_ = newRotation;
+        if (channelMask & CHANNEL_SCALE)
+            pose->scale_ = newScale;
+    }
+    else if (silent)
     {
         if (channelMask & CHANNEL_POSITION)
             node->SetPositionSilent(newPosition);
@@ -57,6 +57,8 @@ struct AnimationStateTrack
     const AnimationTrack* track_;
     /// Bone pointer.
     Bone* bone_;
+    /// Bone index in the skeleton.
+    unsigned boneIndex_;
     /// Scene node pointer.
     WeakPtr<Node> node_;
     /// Blending weight.
@@ -68,6 +70,8 @@ struct AnimationStateTrack
 /// %Animation instance.
 class URHO3D_API AnimationState : public RefCounted
 {
+    friend class AnimatedModel;
+
 public:
     /// Construct with animated model and animation pointers.
     AnimationState(AnimatedModel* model, Animation* animation);
@@ -24,6 +24,8 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/BillboardSet.h"
 #include "../Graphics/Camera.h"
@@ -69,10 +71,10 @@ static const StringVector billboardsStructureElementNames =
     "   Is Enabled"
 };
 
-inline bool CompareBillboards(Billboard* lhs, Billboard* rhs)
-{
-    return lhs->sortDistance_ > rhs->sortDistance_;
-}
+/// Minimum number of billboards to split vertex generation across worker threads.
+static const unsigned MIN_THREADED_BILLBOARDS = 4096;
+/// Number of billboards per worker thread batch in vertex generation.
+static const unsigned BILLBOARDS_PER_BATCH = 1024;
 
 BillboardSet::BillboardSet(Context* context) :
     Drawable(context, DRAWABLE_GEOMETRY),
@@ -591,32 +593,28 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
     }
 
     unsigned numBillboards = billboards_.Size();
-    unsigned enabledBillboards = 0;
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
     Matrix3x4 billboardTransform = relative_ ? worldTransform : Matrix3x4::IDENTITY;
     Vector3 billboardScale = scaled_ ? worldTransform.Scale() : Vector3::ONE;
 
-    // First check number of enabled billboards
-    for (unsigned i = 0; i < numBillboards; ++i)
-    {
-        if (billboards_[i].enabled_)
-            ++enabledBillboards;
-    }
-
-    sortedBillboards_.Resize(enabledBillboards);
-    unsigned index = 0;
-
-    // Then set initial sort order and distances
+    // Collect the enabled billboards and their sort distances
+    enabledBillboards_.Clear();
+    if (sorted_)
+        sortDistances_.Resize(numBillboards);
     for (unsigned i = 0; i < numBillboards; ++i)
     {
         Billboard& billboard = billboards_[i];
         if (billboard.enabled_)
         {
-            sortedBillboards_[index++] = &billboard;
+            enabledBillboards_.Push(i);
             if (sorted_)
-                billboard.sortDistance_ = frame.camera_->GetDistanceSquared(billboardTransform * billboards_[i].position_);
+            {
+                billboard.sortDistance_ = frame.camera_->GetDistanceSquared(billboardTransform * billboard.position_);
+                sortDistances_[i] = billboard.sortDistance_;
+            }
         }
     }
+    unsigned enabledBillboards = enabledBillboards_.Size();
 
     batches_[0].geometry_->SetDrawRange(TRIANGLE_LIST, 0, enabledBillboards * 6, false);
 
@@ -625,9 +623,11 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
     if (!enabledBillboards)
         return;
 
+    const unsigned* order = enabledBillboards_.Buffer();
     if (sorted_)
     {
-        Sort(sortedBillboards_.Begin(), sortedBillboards_.End(), CompareBillboards);
+        // The previous order is usually still nearly correct, in which case it is just refined
+        order = sorter_.Sort(enabledBillboards_, sortDistances_).Buffer();
         Vector3 worldPos = node_->GetWorldPosition();
         // Store the "last sorted position" now
         previousOffset_ = (worldPos - frame.camera_->GetNode()->GetWorldPosition());
@@ -637,11 +637,30 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
     if (!dest)
         return;
 
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (enabledBillboards >= MIN_THREADED_BILLBOARDS && queue && queue->GetNumThreads() && Thread::IsMainThread())
+    {
+        URHO3D_PROFILE(GenerateBillboardVertices);
+        queue->ParallelFor(enabledBillboards, BILLBOARDS_PER_BATCH, [&](unsigned start, unsigned end, unsigned /*threadIndex*/)
+        {
+            WriteVertices(dest, order, start, end, billboardScale);
+        });
+    }
+    else
+        WriteVertices(dest, order, 0, enabledBillboards, billboardScale);
+
+    vertexBuffer_->Unlock();
+    vertexBuffer_->ClearDataLost();
+}
+
+void BillboardSet::WriteVertices(float* dest, const unsigned* order, unsigned start, unsigned end, const Vector3& billboardScale)
+{
     if (faceCameraMode_ != FC_DIRECTION)
     {
-        for (unsigned i = 0; i < enabledBillboards; ++i)
+        dest += start * 32;
+        for (unsigned i = start; i < end; ++i)
         {
-            Billboard& billboard = *sortedBillboards_[i];
+            const Billboard& billboard = billboards_[order[i]];
 
             Vector2 size(billboard.size_.x_ * billboardScale.x_, billboard.size_.y_ * billboardScale.y_);
             unsigned color = billboard.color_.ToUInt();
@@ -694,9 +713,10 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
     }
     else
     {
-        for (unsigned i = 0; i < enabledBillboards; ++i)
+        dest += start * 44;
+        for (unsigned i = start; i < end; ++i)
         {
-            Billboard& billboard = *sortedBillboards_[i];
+            const Billboard& billboard = billboards_[order[i]];
 
             Vector2 size(billboard.size_.x_ * billboardScale.x_, billboard.size_.y_ * billboardScale.y_);
             unsigned color = billboard.color_.ToUInt();
@@ -759,9 +779,6 @@ void BillboardSet::UpdateVertexBuffer(const FrameInfo& frame)
             dest += 44;
         }
     }
-
-    vertexBuffer_->Unlock();
-    vertexBuffer_->ClearDataLost();
 }
 
 void BillboardSet::MarkPositionsDirty()
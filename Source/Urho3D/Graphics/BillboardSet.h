@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Graphics/DepthSorter.h"
 #include "../Graphics/Drawable.h"
 #include "../IO/VectorBuffer.h"
 #include "../Math/Color.h"
@@ -176,6 +177,8 @@ private:
     void UpdateBufferSize();
     /// Rewrite billboard vertex buffer.
     void UpdateVertexBuffer(const FrameInfo& frame);
+    /// Write vertices for a range of billboards in the given draw order.
+    void WriteVertices(float* dest, const unsigned* order, unsigned start, unsigned end, const Vector3& billboardScale);
     /// Calculate billboard scale factors in fixed screen size mode.
     void CalculateFixedScreenSize(const FrameInfo& frame);
 
@@ -203,8 +206,12 @@ private:
     unsigned sortFrameNumber_;
     /// Previous offset to camera for determining whether sorting is necessary.
     Vector3 previousOffset_;
-    /// Billboard pointers for sorting.
-    Vector<Billboard*> sortedBillboards_;
+    /// Indices of enabled billboards.
+    PODVector<unsigned> enabledBillboards_;
+    /// Billboard distances for sorting.
+    PODVector<float> sortDistances_;
+    /// Depth sorter. Keeps the previous order for reuse.
+    DepthSorter sorter_;
     /// Attribute buffer for network replication.
     mutable VectorBuffer attrBuffer_;
 };
@@ -24,6 +24,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/AnimatedModel.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/Camera.h"
@@ -33,6 +34,7 @@
 #include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/Tangent.h"
+#include "../Graphics/TriangleBVH.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
@@ -128,6 +130,85 @@ static void ClipPolygon(PODVector<DecalVertex>& dest, const PODVector<DecalVerte
         dest.Push(ClipEdge(src[last], src[0], lastDistance, distance, skinned));
 }
 
+/// CPU-side data of a target geometry for decal projection.
+struct DecalTargetGeometry
+{
+    /// Geometry.
+    SharedPtr<Geometry> geometry_;
+    /// Triangle hierarchy of the geometry, or null to test all triangles.
+    SharedPtr<TriangleBVH> bvh_;
+    /// Vertex buffers the data pointers refer to, held while projecting in a worker thread.
+    Vector<SharedPtr<VertexBuffer> > vertexBuffers_;
+    /// Index buffer the index data pointer refers to.
+    SharedPtr<IndexBuffer> indexBuffer_;
+    /// Shadow or raw data arrays the data pointers refer to, held so that they stay alive even if the buffers are resized.
+    Vector<SharedArrayPtr<unsigned char> > dataArrays_;
+    /// Vertex position data.
+    const unsigned char* positionData_{};
+    /// Vertex normal data.
+    const unsigned char* normalData_{};
+    /// Vertex blend weight data.
+    const unsigned char* skinningData_{};
+    /// Index data.
+    const unsigned char* indexData_{};
+    /// Position data stride.
+    unsigned positionStride_{};
+    /// Normal data stride.
+    unsigned normalStride_{};
+    /// Blend weight data stride.
+    unsigned skinningStride_{};
+    /// Index size.
+    unsigned indexStride_{};
+    /// Batch index in the target drawable.
+    unsigned batchIndex_{};
+};
+
+/// Decal projection state, which can be processed in a worker thread.
+struct DecalProjection : public RefCounted
+{
+    /// Target geometries.
+    Vector<DecalTargetGeometry> targets_;
+    /// Decal frustum in the target's local space.
+    Frustum frustum_;
+    /// Decal frustum transform in the target's local space.
+    Matrix3x4 frustumTransform_;
+    /// Transform from the target's local space to the decal set's local space.
+    Matrix3x4 vertexTransform_;
+    /// Decal normal in the target's local space.
+    Vector3 decalNormal_;
+    /// Top-left texture coordinate.
+    Vector2 topLeftUV_;
+    /// Bottom-right texture coordinate.
+    Vector2 bottomRightUV_;
+    /// Normal cutoff.
+    float normalCutoff_{};
+    /// Decal size.
+    float size_{};
+    /// Decal aspect ratio.
+    float aspectRatio_{};
+    /// Decal depth.
+    float depth_{};
+    /// Maximum vertices of the decal set.
+    unsigned maxVertices_{};
+    /// Maximum indices of the decal set.
+    unsigned maxIndices_{};
+    /// Skinned mode flag.
+    bool skinned_{};
+    /// Discarded flag. Set if the decals were removed while projecting.
+    bool discarded_{};
+    /// Resulting decal.
+    Decal decal_;
+    /// Work item group for waiting on the projection.
+    WorkItemGroup group_;
+};
+
+void ProjectDecalWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* decalSet = reinterpret_cast<DecalSet*>(item->start_);
+    auto* projection = reinterpret_cast<DecalProjection*>(item->aux_);
+    decalSet->ProjectDecal(*projection, nullptr);
+}
+
 void Decal::AddVertex(const DecalVertex& vertex)
 {
     for (unsigned i = 0; i < vertices_.Size(); ++i)
@@ -175,7 +256,16 @@ DecalSet::DecalSet(Context* context) :
     batches_[0].geometryType_ = GEOM_STATIC_NOINSTANCING;
 }
 
-DecalSet::~DecalSet() = default;
+DecalSet::~DecalSet()
+{
+    // The work items refer to this decal set, so wait for any unfinished projections
+    auto* queue = GetSubsystem<WorkQueue>();
+    for (unsigned i = 0; i < pendingDecals_.Size(); ++i)
+    {
+        if (queue && !pendingDecals_[i]->group_.IsCompleted())
+            queue->Complete(pendingDecals_[i]->group_);
+    }
+}
 
 void DecalSet::RegisterObject(Context* context)
 {
@@ -304,6 +394,50 @@ bool DecalSet::AddDecal(Drawable* target, const Vector3& worldPosition, const Qu
 {
     URHO3D_PROFILE(AddDecal);
 
+    DecalProjection projection;
+    if (!PrepareProjection(projection, target, worldPosition, worldRotation, size, aspectRatio, depth, topLeftUV, bottomRightUV,
+        timeToLive, normalCutoff, subGeometry))
+        return false;
+
+    ProjectDecal(projection, target);
+    return CommitDecal(projection.decal_);
+}
+
+bool DecalSet::AddDecalAsync(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size,
+    float aspectRatio, float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive, float normalCutoff,
+    unsigned subGeometry)
+{
+    // Skinned decals remap the target's bones while gathering faces, so they are always added immediately
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (!queue || !queue->GetNumThreads() || !GetScene() || dynamic_cast<AnimatedModel*>(target))
+        return AddDecal(target, worldPosition, worldRotation, size, aspectRatio, depth, topLeftUV, bottomRightUV, timeToLive,
+            normalCutoff, subGeometry);
+
+    URHO3D_PROFILE(AddDecalAsync);
+
+    SharedPtr<DecalProjection> projection(new DecalProjection());
+    if (!PrepareProjection(*projection, target, worldPosition, worldRotation, size, aspectRatio, depth, topLeftUV, bottomRightUV,
+        timeToLive, normalCutoff, subGeometry))
+        return false;
+
+    SharedPtr<WorkItem> item = queue->GetFreeItem();
+    item->priority_ = 0;
+    item->workFunction_ = ProjectDecalWork;
+    item->start_ = this;
+    item->aux_ = projection.Get();
+    item->group_ = &projection->group_;
+    queue->AddWorkItem(item);
+
+    pendingDecals_.Push(projection);
+    // The decal is committed on scene post-update once the projection has finished
+    UpdateEventSubscription(false);
+    return true;
+}
+
+bool DecalSet::PrepareProjection(DecalProjection& projection, Drawable* target, const Vector3& worldPosition,
+    const Quaternion& worldRotation, float size, float aspectRatio, float depth, const Vector2& topLeftUV,
+    const Vector2& bottomRightUV, float timeToLive, float normalCutoff, unsigned subGeometry)
+{
     // Do not add decals in headless mode
     if (!node_ || !GetSubsystem<Graphics>())
         return false;
@@ -373,32 +507,51 @@ bool DecalSet::AddDecal(Drawable* target, const Vector3& worldPosition, const Qu
     }
 
     // Build the decal frustum
-    Frustum decalFrustum;
-    Matrix3x4 frustumTransform = targetTransform * Matrix3x4(adjustedWorldPosition, worldRotation, 1.0f);
-    decalFrustum.DefineOrtho(size, aspectRatio, 1.0, 0.0f, depth, frustumTransform);
-
-    Vector3 decalNormal = (targetTransform * Vector4(worldRotation * Vector3::BACK, 0.0f)).Normalized();
-
-    decals_.Resize(decals_.Size() + 1);
-    Decal& newDecal = decals_.Back();
-    newDecal.timeToLive_ = timeToLive;
-
-    Vector<PODVector<DecalVertex> > faces;
-    PODVector<DecalVertex> tempFace;
+    projection.frustumTransform_ = targetTransform * Matrix3x4(adjustedWorldPosition, worldRotation, 1.0f);
+    projection.frustum_.DefineOrtho(size, aspectRatio, 1.0, 0.0f, depth, projection.frustumTransform_);
+    projection.decalNormal_ = (targetTransform * Vector4(worldRotation * Vector3::BACK, 0.0f)).Normalized();
+    projection.normalCutoff_ = normalCutoff;
+    projection.size_ = size;
+    projection.aspectRatio_ = aspectRatio;
+    projection.depth_ = depth;
+    projection.topLeftUV_ = topLeftUV;
+    projection.bottomRightUV_ = bottomRightUV;
+    projection.maxVertices_ = maxVertices_;
+    projection.maxIndices_ = maxIndices_;
+    projection.skinned_ = skinned_;
+    projection.decal_.timeToLive_ = timeToLive;
+
+    // Transform from the target geometry to this node's local space
+    Matrix3x4 decalTransform = node_->GetWorldTransform().Inverse() * target->GetNode()->GetWorldTransform();
+    projection.vertexTransform_ = skinned_ ? Matrix3x4::IDENTITY : decalTransform;
 
     unsigned numBatches = target->GetBatches().Size();
 
     // Use either a specified subgeometry in the target, or all
     if (subGeometry < numBatches)
-        GetFaces(faces, target, subGeometry, decalFrustum, decalNormal, normalCutoff);
+        GetTargetGeometry(projection, target, subGeometry);
     else
     {
         for (unsigned i = 0; i < numBatches; ++i)
-            GetFaces(faces, target, i, decalFrustum, decalNormal, normalCutoff);
+            GetTargetGeometry(projection, target, i);
     }
 
+    return true;
+}
+
+void DecalSet::ProjectDecal(DecalProjection& projection, Drawable* target)
+{
+    Decal& newDecal = projection.decal_;
+    Vector<PODVector<DecalVertex> > faces;
+    PODVector<DecalVertex> tempFace;
+    PODVector<unsigned> triangles;
+
+    for (unsigned i = 0; i < projection.targets_.Size(); ++i)
+        GetFaces(faces, triangles, projection.targets_[i], target, projection.frustum_, projection.decalNormal_,
+            projection.normalCutoff_, projection.skinned_);
+
     // Clip the acquired faces against all frustum planes
-    for (const auto& plane : decalFrustum.planes_)
+    for (const auto& plane : projection.frustum_.planes_)
     {
         for (unsigned j = 0; j < faces.Size(); ++j)
         {
@@ -406,7 +559,7 @@ bool DecalSet::AddDecal(Drawable* target, const Vector3& worldPosition, const Qu
             if (face.Empty())
                 continue;
 
-            ClipPolygon(tempFace, face, plane, skinned_);
+            ClipPolygon(tempFace, face, plane, projection.skinned_);
             face = tempFace;
         }
     }
@@ -426,45 +579,50 @@ bool DecalSet::AddDecal(Drawable* target, const Vector3& worldPosition, const Qu
         }
     }
 
+    // Check if resulted in no triangles or too many vertices; the decal will be rejected when committing
+    if (newDecal.vertices_.Empty() || newDecal.vertices_.Size() > projection.maxVertices_ ||
+        newDecal.indices_.Size() > projection.maxIndices_)
+        return;
+
+    // Calculate UVs
+    Matrix4 projectionMatrix(Matrix4::ZERO);
+    projectionMatrix.m11_ = (1.0f / (projection.size_ * 0.5f));
+    projectionMatrix.m00_ = projectionMatrix.m11_ / projection.aspectRatio_;
+    projectionMatrix.m22_ = 1.0f / projection.depth_;
+    projectionMatrix.m33_ = 1.0f;
+
+    CalculateUVs(newDecal, projection.frustumTransform_.Inverse(), projectionMatrix, projection.topLeftUV_,
+        projection.bottomRightUV_);
+
+    // Transform vertices to this node's local space and generate tangents
+    TransformVertices(newDecal, projection.vertexTransform_);
+    GenerateTangents(&newDecal.vertices_[0], sizeof(DecalVertex), &newDecal.indices_[0], sizeof(unsigned short), 0,
+        newDecal.indices_.Size(), offsetof(DecalVertex, normal_), offsetof(DecalVertex, texCoord_), offsetof(DecalVertex,
+        tangent_));
+
+    newDecal.CalculateBoundingBox();
+}
+
+bool DecalSet::CommitDecal(const Decal& newDecal)
+{
     // Check if resulted in no triangles
     if (newDecal.vertices_.Empty())
-    {
-        decals_.Pop();
         return true;
-    }
 
     if (newDecal.vertices_.Size() > maxVertices_)
     {
         URHO3D_LOGWARNING("Can not add decal, vertex count " + String(newDecal.vertices_.Size()) + " exceeds maximum " +
                    String(maxVertices_));
-        decals_.Pop();
         return false;
     }
     if (newDecal.indices_.Size() > maxIndices_)
     {
         URHO3D_LOGWARNING("Can not add decal, index count " + String(newDecal.indices_.Size()) + " exceeds maximum " +
                    String(maxIndices_));
-        decals_.Pop();
         return false;
     }
 
-    // Calculate UVs
-    Matrix4 projection(Matrix4::ZERO);
-    projection.m11_ = (1.0f / (size * 0.5f));
-    projection.m00_ = projection.m11_ / aspectRatio;
-    projection.m22_ = 1.0f / depth;
-    projection.m33_ = 1.0f;
-
-    CalculateUVs(newDecal, frustumTransform.Inverse(), projection, topLeftUV, bottomRightUV);
-
-    // Transform vertices to this node's local space and generate tangents
-    Matrix3x4 decalTransform = node_->GetWorldTransform().Inverse() * target->GetNode()->GetWorldTransform();
-    TransformVertices(newDecal, skinned_ ? Matrix3x4::IDENTITY : decalTransform);
-    GenerateTangents(&newDecal.vertices_[0], sizeof(DecalVertex), &newDecal.indices_[0], sizeof(unsigned short), 0,
-        newDecal.indices_.Size(), offsetof(DecalVertex, normal_), offsetof(DecalVertex, texCoord_), offsetof(DecalVertex,
-        tangent_));
-
-    newDecal.CalculateBoundingBox();
+    decals_.Push(newDecal);
     numVertices_ += newDecal.vertices_.Size();
     numIndices_ += newDecal.indices_.Size();
 
@@ -482,6 +640,20 @@ bool DecalSet::AddDecal(Drawable* target, const Vector3& worldPosition, const Qu
     return true;
 }
 
+void DecalSet::CommitPendingDecals()
+{
+    // Commit in the order the decals were added, so that the oldest decals are removed first
+    while (!pendingDecals_.Empty() && pendingDecals_.Front()->group_.IsCompleted())
+    {
+        SharedPtr<DecalProjection> projection = pendingDecals_.Front();
+        pendingDecals_.Erase(0);
+
+        // Drop the decal if decals were removed or the set switched to skinned mode meanwhile
+        if (!projection->discarded_ && projection->skinned_ == skinned_)
+            CommitDecal(projection->decal_);
+    }
+}
+
 void DecalSet::RemoveDecals(unsigned num)
 {
     while (num-- && decals_.Size())
@@ -490,6 +662,10 @@ void DecalSet::RemoveDecals(unsigned num)
 
 void DecalSet::RemoveAllDecals()
 {
+    // Decals still being projected are dropped once they finish
+    for (unsigned i = 0; i < pendingDecals_.Size(); ++i)
+        pendingDecals_[i]->discarded_ = true;
+
     if (!decals_.Empty())
     {
         decals_.Clear();
@@ -694,28 +870,24 @@ void DecalSet::OnWorldBoundingBoxUpdate()
     }
 }
 
-void DecalSet::GetFaces(Vector<PODVector<DecalVertex> >& faces, Drawable* target, unsigned batchIndex, const Frustum& frustum,
-    const Vector3& decalNormal, float normalCutoff)
+void DecalSet::GetTargetGeometry(DecalProjection& projection, Drawable* target, unsigned batchIndex)
 {
     // Try to use the most accurate LOD level if possible
     Geometry* geometry = target->GetLodGeometry(batchIndex, 0);
     if (!geometry || geometry->GetPrimitiveType() != TRIANGLE_LIST)
         return;
 
-    const unsigned char* positionData = nullptr;
-    const unsigned char* normalData = nullptr;
-    const unsigned char* skinningData = nullptr;
-    const unsigned char* indexData = nullptr;
-    unsigned positionStride = 0;
-    unsigned normalStride = 0;
-    unsigned skinningStride = 0;
-    unsigned indexStride = 0;
+    DecalTargetGeometry data;
+    data.geometry_ = geometry;
+    data.batchIndex_ = batchIndex;
 
     IndexBuffer* ib = geometry->GetIndexBuffer();
-    if (ib)
+    if (ib && ib->GetShadowData())
     {
-        indexData = ib->GetShadowData();
-        indexStride = ib->GetIndexSize();
+        data.indexData_ = ib->GetShadowData();
+        data.indexStride_ = ib->GetIndexSize();
+        data.indexBuffer_ = ib;
+        data.dataArrays_.Push(ib->GetShadowDataShared());
     }
 
     // For morphed models positions, normals and skinning may be in different buffers
@@ -726,68 +898,105 @@ void DecalSet::GetFaces(Vector<PODVector<DecalVertex> >& faces, Drawable* target
             continue;
 
         unsigned elementMask = vb->GetElementMask();
-        unsigned char* data = vb->GetShadowData();
-        if (!data)
+        unsigned char* vbData = vb->GetShadowData();
+        if (!vbData)
             continue;
 
+        data.vertexBuffers_.Push(SharedPtr<VertexBuffer>(vb));
+        data.dataArrays_.Push(vb->GetShadowDataShared());
+
         if (elementMask & MASK_POSITION)
         {
-            positionData = data;
-            positionStride = vb->GetVertexSize();
+            data.positionData_ = vbData;
+            data.positionStride_ = vb->GetVertexSize();
         }
         if (elementMask & MASK_NORMAL)
         {
-            normalData = data + vb->GetElementOffset(SEM_NORMAL);
-            normalStride = vb->GetVertexSize();
+            data.normalData_ = vbData + vb->GetElementOffset(SEM_NORMAL);
+            data.normalStride_ = vb->GetVertexSize();
         }
         if (elementMask & MASK_BLENDWEIGHTS)
         {
-            skinningData = data + vb->GetElementOffset(SEM_BLENDWEIGHTS);
-            skinningStride = vb->GetVertexSize();
+            data.skinningData_ = vbData + vb->GetElementOffset(SEM_BLENDWEIGHTS);
+            data.skinningStride_ = vb->GetVertexSize();
         }
     }
 
     // Positions and indices are needed
-    if (!positionData)
+    if (!data.positionData_)
     {
         // As a fallback, try to get the geometry's raw vertex/index data
+        SharedArrayPtr<unsigned char> rawVertexData;
+        SharedArrayPtr<unsigned char> rawIndexData;
         const PODVector<VertexElement>* elements;
-        geometry->GetRawData(positionData, positionStride, indexData, indexStride, elements);
-        if (!positionData)
+        geometry->GetRawDataShared(rawVertexData, data.positionStride_, rawIndexData, data.indexStride_, elements);
+        if (!rawVertexData)
         {
             URHO3D_LOGWARNING("Can not add decal, target drawable has no CPU-side geometry data");
             return;
         }
+
+        data.positionData_ = rawVertexData;
+        data.indexData_ = rawIndexData;
+        data.dataArrays_.Push(rawVertexData);
+        if (rawIndexData)
+            data.dataArrays_.Push(rawIndexData);
     }
 
-    if (indexData)
+    // Use the geometry's triangle hierarchy if it covers the same position data. Animated models may morph their vertices
+    // in place, so they always use the full triangle list
+    if (!dynamic_cast<AnimatedModel*>(target))
+    {
+        TriangleBVH* bvh = geometry->GetTriangleBVH();
+        if (bvh && bvh->GetVertexData() == data.positionData_)
+            data.bvh_ = bvh;
+    }
+
+    projection.targets_.Push(data);
+}
+
+void DecalSet::GetFaces(Vector<PODVector<DecalVertex> >& faces, PODVector<unsigned>& triangles, const DecalTargetGeometry& data,
+    Drawable* target, const Frustum& frustum, const Vector3& decalNormal, float normalCutoff, bool skinned)
+{
+    Geometry* geometry = data.geometry_;
+
+    if (data.bvh_)
+    {
+        // Only visit the triangles that the hierarchy does not reject
+        triangles.Clear();
+        data.bvh_->GetTriangles(frustum, triangles);
+        for (unsigned i = 0; i < triangles.Size(); ++i)
+        {
+            const unsigned* indices = data.bvh_->GetTriangleIndices(triangles[i]);
+            GetFace(faces, data, target, indices[0], indices[1], indices[2], frustum, decalNormal, normalCutoff, skinned);
+        }
+    }
+    else if (data.indexData_)
     {
         unsigned indexStart = geometry->GetIndexStart();
         unsigned indexCount = geometry->GetIndexCount();
 
         // 16-bit indices
-        if (indexStride == sizeof(unsigned short))
+        if (data.indexStride_ == sizeof(unsigned short))
         {
-            const unsigned short* indices = ((const unsigned short*)indexData) + indexStart;
+            const unsigned short* indices = ((const unsigned short*)data.indexData_) + indexStart;
             const unsigned short* indicesEnd = indices + indexCount;
 
             while (indices < indicesEnd)
             {
-                GetFace(faces, target, batchIndex, indices[0], indices[1], indices[2], positionData, normalData, skinningData,
-                    positionStride, normalStride, skinningStride, frustum, decalNormal, normalCutoff);
+                GetFace(faces, data, target, indices[0], indices[1], indices[2], frustum, decalNormal, normalCutoff, skinned);
                 indices += 3;
             }
         }
         else
         // 32-bit indices
         {
-            const unsigned* indices = ((const unsigned*)indexData) + indexStart;
+            const unsigned* indices = ((const unsigned*)data.indexData_) + indexStart;
             const unsigned* indicesEnd = indices + indexCount;
 
             while (indices < indicesEnd)
             {
-                GetFace(faces, target, batchIndex, indices[0], indices[1], indices[2], positionData, normalData, skinningData,
-                    positionStride, normalStride, skinningStride, frustum, decalNormal, normalCutoff);
+                GetFace(faces, data, target, indices[0], indices[1], indices[2], frustum, decalNormal, normalCutoff, skinned);
                 indices += 3;
             }
         }
@@ -800,20 +1009,24 @@ void DecalSet::GetFaces(Vector<PODVector<DecalVertex> >& faces, Drawable* target
 
         while (indices + 2 < indicesEnd)
         {
-            GetFace(faces, target, batchIndex, indices, indices + 1, indices + 2, positionData, normalData, skinningData,
-                positionStride, normalStride, skinningStride, frustum, decalNormal, normalCutoff);
+            GetFace(faces, data, target, indices, indices + 1, indices + 2, frustum, decalNormal, normalCutoff, skinned);
             indices += 3;
         }
     }
 }
 
-void DecalSet::GetFace(Vector<PODVector<DecalVertex> >& faces, Drawable* target, unsigned batchIndex, unsigned i0, unsigned i1,
-    unsigned i2, const unsigned char* positionData, const unsigned char* normalData, const unsigned char* skinningData,
-    unsigned positionStride, unsigned normalStride, unsigned skinningStride, const Frustum& frustum, const Vector3& decalNormal,
-    float normalCutoff)
+void DecalSet::GetFace(Vector<PODVector<DecalVertex> >& faces, const DecalTargetGeometry& data, Drawable* target, unsigned i0,
+    unsigned i1, unsigned i2, const Frustum& frustum, const Vector3& decalNormal, float normalCutoff, bool skinned)
 {
+    const unsigned char* positionData = data.positionData_;
+    const unsigned char* normalData = data.normalData_;
+    const unsigned char* skinningData = data.skinningData_;
+    unsigned positionStride = data.positionStride_;
+    unsigned normalStride = data.normalStride_;
+    unsigned skinningStride = data.skinningStride_;
+
     bool hasNormals = normalData != nullptr;
-    bool hasSkinning = skinned_ && skinningData != nullptr;
+    bool hasSkinning = skinned && skinningData != nullptr;
 
     const Vector3& v0 = *((const Vector3*)(&positionData[i0 * positionStride]));
     const Vector3& v1 = *((const Vector3*)(&positionData[i1 * positionStride]));
@@ -870,8 +1083,8 @@ void DecalSet::GetFace(Vector<PODVector<DecalVertex> >& faces, Drawable* target,
         unsigned char nbi2[4];
 
         // Make sure all bones are found and that there is room in the skinning matrices
-        if (!GetBones(target, batchIndex, bw0, bi0, nbi0) || !GetBones(target, batchIndex, bw1, bi1, nbi1) ||
-            !GetBones(target, batchIndex, bw2, bi2, nbi2))
+        if (!GetBones(target, data.batchIndex_, bw0, bi0, nbi0) || !GetBones(target, data.batchIndex_, bw1, bi1, nbi1) ||
+            !GetBones(target, data.batchIndex_, bw2, bi2, nbi2))
             return;
 
         face.Reserve(3);
@@ -1140,8 +1353,8 @@ void DecalSet::UpdateEventSubscription(bool checkAllDecals)
             }
         }
 
-        // If no time limited decals, no need to subscribe to scene update
-        enabled = hasTimeLimitedDecals;
+        // If no time limited or pending decals, no need to subscribe to scene update
+        enabled = hasTimeLimitedDecals || !pendingDecals_.Empty();
     }
 
     if (enabled && !subscribed_)
@@ -1162,6 +1375,13 @@ void DecalSet::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData
 
     float timeStep = eventData[P_TIMESTEP].GetFloat();
 
+    if (!pendingDecals_.Empty())
+    {
+        CommitPendingDecals();
+        if (pendingDecals_.Empty())
+            UpdateEventSubscription(true);
+    }
+
     for (List<Decal>::Iterator i = decals_.Begin(); i != decals_.End();)
     {
         i->timer_ += timeStep;
@@ -32,6 +32,9 @@ namespace Urho3D
 
 class IndexBuffer;
 class VertexBuffer;
+struct DecalProjection;
+struct DecalTargetGeometry;
+struct WorkItem;
 
 /// %Decal vertex.
 struct DecalVertex
@@ -137,6 +140,10 @@ public:
     bool AddDecal(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size, float aspectRatio,
         float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive = 0.0f, float normalCutoff = 0.1f,
         unsigned subGeometry = M_MAX_UNSIGNED);
+    /// Add a decal at world coordinates, projecting it onto the target geometry in a worker thread. The decal becomes visible on the next scene post-update after the projection finishes. Decals on animated models are added immediately. Return true if the projection was started or the decal was added.
+    bool AddDecalAsync(Drawable* target, const Vector3& worldPosition, const Quaternion& worldRotation, float size,
+        float aspectRatio, float depth, const Vector2& topLeftUV, const Vector2& bottomRightUV, float timeToLive = 0.0f,
+        float normalCutoff = 0.1f, unsigned subGeometry = M_MAX_UNSIGNED);
     /// Remove n oldest decals.
     void RemoveDecals(unsigned num);
     /// Remove all decals.
@@ -147,6 +154,8 @@ public:
 
     /// Return number of decals.
     unsigned GetNumDecals() const { return decals_.Size(); }
+    /// Return number of decals still being projected in worker threads.
+    unsigned GetNumPendingDecals() const { return pendingDecals_.Size(); }
 
     /// Retur number of vertices in the decals.
     unsigned GetNumVertices() const { return numVertices_; }
@@ -179,15 +188,24 @@ protected:
     void OnMarkedDirty(Node* node) override;
 
 private:
+    /// Set up the decal frustum and gather the target geometry data. Return true if successful.
+    bool PrepareProjection(DecalProjection& projection, Drawable* target, const Vector3& worldPosition,
+        const Quaternion& worldRotation, float size, float aspectRatio, float depth, const Vector2& topLeftUV,
+        const Vector2& bottomRightUV, float timeToLive, float normalCutoff, unsigned subGeometry);
+    /// Project, clip and triangulate the decal. The target is only accessed for skinned decals.
+    void ProjectDecal(DecalProjection& projection, Drawable* target);
+    /// Add a projected decal to the set. Return true if successful.
+    bool CommitDecal(const Decal& newDecal);
+    /// Add the asynchronously projected decals that have finished.
+    void CommitPendingDecals();
+    /// Gather the CPU-side data of a target geometry.
+    void GetTargetGeometry(DecalProjection& projection, Drawable* target, unsigned batchIndex);
     /// Get triangle faces from the target geometry.
-    void GetFaces(Vector<PODVector<DecalVertex> >& faces, Drawable* target, unsigned batchIndex, const Frustum& frustum,
-        const Vector3& decalNormal, float normalCutoff);
+    void GetFaces(Vector<PODVector<DecalVertex> >& faces, PODVector<unsigned>& triangles, const DecalTargetGeometry& data,
+        Drawable* target, const Frustum& frustum, const Vector3& decalNormal, float normalCutoff, bool skinned);
     /// Get triangle face from the target geometry.
-    void GetFace
-        (Vector<PODVector<DecalVertex> >& faces, Drawable* target, unsigned batchIndex, unsigned i0, unsigned i1, unsigned i2,
-            const unsigned char* positionData, const unsigned char* normalData, const unsigned char* skinningData,
-            unsigned positionStride, unsigned normalStride, unsigned skinningStride, const Frustum& frustum,
-            const Vector3& decalNormal, float normalCutoff);
+    void GetFace(Vector<PODVector<DecalVertex> >& faces, const DecalTargetGeometry& data, Drawable* target, unsigned i0,
+        unsigned i1, unsigned i2, const Frustum& frustum, const Vector3& decalNormal, float normalCutoff, bool skinned);
     /// Get bones referenced by skinning data and remap the skinning indices. Return true if successful.
     bool GetBones(Drawable* target, unsigned batchIndex, const float* blendWeights, const unsigned char* blendIndices,
         unsigned char* newBlendIndices);
@@ -215,6 +233,9 @@ private:
     /// Handle scene post-update event.
     void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
 
+    /// Decal projection work function.
+    friend void ProjectDecalWork(const WorkItem* item, unsigned threadIndex);
+
     /// Geometry.
     SharedPtr<Geometry> geometry_;
     /// Vertex buffer.
@@ -223,6 +244,8 @@ private:
     SharedPtr<IndexBuffer> indexBuffer_;
     /// Decals.
     List<Decal> decals_;
+    /// Decals being projected in worker threads, in the order they were added.
+    Vector<SharedPtr<DecalProjection> > pendingDecals_;
     /// Bones used for skinned decals.
     Vector<Bone> bones_;
     /// Skinning matrices.
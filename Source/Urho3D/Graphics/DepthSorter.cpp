@@ -0,0 +1,229 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Graphics/DepthSorter.h"
+#include "../Math/MathDefs.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Item count below which a full sort is done by insertion sort instead of radix sort.
+static const unsigned MIN_RADIX_SORT_ITEMS = 64;
+/// Number of item moves per item allowed when reusing the previous order, before falling back to radix sort.
+static const unsigned MAX_INSERTION_MOVES_PER_ITEM = 4;
+
+DepthSorter::DepthSorter() :
+    stamp_(0),
+    orderReused_(false)
+{
+}
+
+const PODVector<unsigned>& DepthSorter::Sort(const PODVector<unsigned>& items, const PODVector<float>& distances)
+{
+    orderReused_ = MergePreviousOrder(items, distances);
+    if (!orderReused_)
+        order_ = items;
+
+    // When reusing last frame's order only a few items should need to move. Small sets are always insertion sorted
+    if ((orderReused_ || order_.Size() < MIN_RADIX_SORT_ITEMS) && InsertionSort(distances))
+        return order_;
+
+    orderReused_ = false;
+    RadixSort(distances);
+    return order_;
+}
+
+void DepthSorter::ResetOrder()
+{
+    order_.Clear();
+}
+
+void DepthSorter::RemoveLeadingItems(unsigned count)
+{
+    if (!count)
+        return;
+
+    unsigned kept = 0;
+    for (unsigned i = 0; i < order_.Size(); ++i)
+    {
+        if (order_[i] >= count)
+            order_[kept++] = order_[i] - count;
+    }
+    order_.Resize(kept);
+}
+
+bool DepthSorter::MergePreviousOrder(const PODVector<unsigned>& items, const PODVector<float>& distances)
+{
+    unsigned numTotalItems = distances.Size();
+    if (order_.Empty() || items.Empty())
+        return false;
+
+    unsigned oldNumStamps = stamps_.Size();
+    if (oldNumStamps < numTotalItems)
+    {
+        stamps_.Resize(numTotalItems);
+        for (unsigned i = oldNumStamps; i < numTotalItems; ++i)
+            stamps_[i] = 0;
+    }
+    // On wraparound, clear the stamps so that stale values can not match
+    if (++stamp_ == 0)
+    {
+        for (unsigned i = 0; i < stamps_.Size(); ++i)
+            stamps_[i] = 0;
+        stamp_ = 1;
+    }
+
+    // Mark the items to be sorted, then keep the previous order of those that still exist
+    for (unsigned i = 0; i < items.Size(); ++i)
+        stamps_[items[i]] = stamp_;
+
+    unsigned kept = 0;
+    for (unsigned i = 0; i < order_.Size(); ++i)
+    {
+        unsigned index = order_[i];
+        if (index < numTotalItems && stamps_[index] == stamp_)
+        {
+            order_[kept++] = index;
+            // Mark as consumed so that duplicates or new items are detected
+            stamps_[index] = stamp_ - 1;
+        }
+    }
+    order_.Resize(kept);
+
+    // Sort the items that were not in the previous order, and merge them in
+    tempOrder_.Clear();
+    for (unsigned i = 0; i < items.Size(); ++i)
+    {
+        if (stamps_[items[i]] == stamp_)
+            tempOrder_.Push(items[i]);
+    }
+    if (tempOrder_.Empty())
+        return true;
+
+    Urho3D::Sort(tempOrder_.Begin(), tempOrder_.End(), [&distances](unsigned lhs, unsigned rhs)
+    {
+        return distances[lhs] > distances[rhs];
+    });
+
+    unsigned numNew = tempOrder_.Size();
+    order_.Resize(kept + numNew);
+    unsigned* order = order_.Buffer();
+    unsigned src = kept;
+    unsigned dest = kept + numNew;
+    while (numNew)
+    {
+        if (src > 0 && distances[order[src - 1]] < distances[tempOrder_[numNew - 1]])
+            order[--dest] = order[--src];
+        else
+            order[--dest] = tempOrder_[--numNew];
+    }
+
+    return true;
+}
+
+bool DepthSorter::InsertionSort(const PODVector<float>& distances)
+{
+    unsigned* order = order_.Buffer();
+    unsigned count = order_.Size();
+    unsigned maxMoves = Max(count * MAX_INSERTION_MOVES_PER_ITEM, MIN_RADIX_SORT_ITEMS * MIN_RADIX_SORT_ITEMS);
+    unsigned moves = 0;
+
+    for (unsigned i = 1; i < count; ++i)
+    {
+        unsigned index = order[i];
+        float distance = distances[index];
+        unsigned j = i;
+        while (j > 0 && distances[order[j - 1]] < distance)
+        {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = index;
+
+        moves += i - j;
+        if (moves > maxMoves)
+            return false;
+    }
+
+    return true;
+}
+
+void DepthSorter::RadixSort(const PODVector<float>& distances)
+{
+    unsigned count = order_.Size();
+    if (!count)
+        return;
+
+    float minDistance = M_INFINITY;
+    float maxDistance = -M_INFINITY;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        float distance = distances[order_[i]];
+        minDistance = Min(minDistance, distance);
+        maxDistance = Max(maxDistance, distance);
+    }
+
+    // Quantize to 16 bits so that two 8-bit passes suffice. The key is inverted so that the farthest item sorts first
+    float range = maxDistance - minDistance;
+    float scale = range > 0.0f ? 65535.0f / range : 0.0f;
+    keys_.Resize(count);
+    for (unsigned i = 0; i < count; ++i)
+        keys_[i] = (unsigned short)((maxDistance - distances[order_[i]]) * scale + 0.5f);
+
+    tempOrder_.Resize(count);
+    tempKeys_.Resize(count);
+
+    for (unsigned shift = 0; shift < 16; shift += 8)
+    {
+        unsigned offsets[256];
+        for (unsigned i = 0; i < 256; ++i)
+            offsets[i] = 0;
+        for (unsigned i = 0; i < count; ++i)
+            ++offsets[(keys_[i] >> shift) & 0xffu];
+
+        unsigned sum = 0;
+        for (unsigned i = 0; i < 256; ++i)
+        {
+            unsigned bucketSize = offsets[i];
+            offsets[i] = sum;
+            sum += bucketSize;
+        }
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            unsigned dest = offsets[(keys_[i] >> shift) & 0xffu]++;
+            tempOrder_[dest] = order_[i];
+            tempKeys_[dest] = keys_[i];
+        }
+
+        order_.Swap(tempOrder_);
+        keys_.Swap(tempKeys_);
+    }
+}
+
+}
@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Vector.h"
+
+namespace Urho3D
+{
+
+/// Back-to-front distance sorter for billboard-like geometry. Reuses the previous order when it is still nearly sorted, and otherwise radix sorts quantized distances.
+class URHO3D_API DepthSorter
+{
+public:
+    /// Construct.
+    DepthSorter();
+
+    /// Sort items back to front. Items are given as indices to the distances array, which must be sized to the total number of items. Returns the sorted indices.
+    const PODVector<unsigned>& Sort(const PODVector<unsigned>& items, const PODVector<float>& distances);
+    /// Forget the previous order, so that the next sort starts from scratch.
+    void ResetOrder();
+    /// Adjust the previous order after the given number of items were removed from the start of the item array.
+    void RemoveLeadingItems(unsigned count);
+
+    /// Return the sorted indices from the last sort.
+    const PODVector<unsigned>& GetOrder() const { return order_; }
+    /// Return whether the last sort was able to reuse the previous order.
+    bool GetOrderReused() const { return orderReused_; }
+
+private:
+    /// Rebuild the order from the previous order, removing items that are gone and merging in new items. Return false if there is no usable previous order.
+    bool MergePreviousOrder(const PODVector<unsigned>& items, const PODVector<float>& distances);
+    /// Insertion sort the order, giving up if too many items have to move. Return true if completed.
+    bool InsertionSort(const PODVector<float>& distances);
+    /// Radix sort the order by quantized distance.
+    void RadixSort(const PODVector<float>& distances);
+
+    /// Sorted item indices.
+    PODVector<unsigned> order_;
+    /// Temporary item indices for radix sorting.
+    PODVector<unsigned> tempOrder_;
+    /// Quantized sort keys.
+    PODVector<unsigned short> keys_;
+    /// Temporary sort keys for radix sorting.
+    PODVector<unsigned short> tempKeys_;
+    /// Per-item stamp for checking which items are included in the current sort.
+    PODVector<unsigned> stamps_;
+    /// Current stamp value.
+    unsigned stamp_;
+    /// Whether the last sort reused the previous order.
+    bool orderReused_;
+};
+
+}
@@ -111,7 +111,6 @@ class URHO3D_API Drawable : public Component
 
     friend class Octant;
     friend class Octree;
-    friend void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex);
 
 public:
     /// Construct.
@@ -345,6 +344,10 @@ protected:
     bool zoneDirty_;
     /// Octree octant.
     Octant* octant_;
+    /// Index in the octant's drawable vector.
+    unsigned octantIndex_;
+    /// Leaf node index in the octree's bounding volume hierarchy, or M_MAX_UNSIGNED if not in one.
+    unsigned bvhLeaf_;
     /// Current zone.
     Zone* zone_;
     /// View mask.
@@ -0,0 +1,549 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/DebugRenderer.h"
+#include "../Graphics/Drawable.h"
+#include "../Graphics/DrawableBVH.h"
+#include "../Graphics/OctreeQuery.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned NO_NODE = M_MAX_UNSIGNED;
+/// Leaf box enlargement relative to drawable size.
+static const float LEAF_MARGIN_RATIO = 0.1f;
+/// Minimum leaf box enlargement in world units.
+static const float LEAF_MARGIN_MIN = 0.1f;
+/// Maximum number of leaf drawables collected before testing them against a query.
+static const unsigned QUERY_BATCH_SIZE = 64;
+
+/// Leaf drawables collected during a query. Drawables intersecting the query volume are tested four at a time with their bounding boxes packed.
+struct DrawableBVHQueryBatch
+{
+    /// Construct.
+    explicit DrawableBVHQueryBatch(OctreeQuery& query) :
+        query_(query),
+        numDrawables_(0),
+        numInsideDrawables_(0)
+    {
+    }
+
+    /// Add a drawable that needs to be tested.
+    void Add(Drawable* drawable)
+    {
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+        Vector3 center = box.Center();
+        Vector3 halfSize = 0.5f * box.Size();
+
+        DrawableBoundsBlock& block = bounds_[numDrawables_ >> 2u];
+        unsigned lane = numDrawables_ & 3u;
+        block.centerX_[lane] = center.x_;
+        block.centerY_[lane] = center.y_;
+        block.centerZ_[lane] = center.z_;
+        block.halfSizeX_[lane] = halfSize.x_;
+        block.halfSizeY_[lane] = halfSize.y_;
+        block.halfSizeZ_[lane] = halfSize.z_;
+
+        drawables_[numDrawables_++] = drawable;
+        if (numDrawables_ == QUERY_BATCH_SIZE)
+            FlushDrawables();
+    }
+
+    /// Add a drawable known to be inside the query volume.
+    void AddInside(Drawable* drawable)
+    {
+        insideDrawables_[numInsideDrawables_++] = drawable;
+        if (numInsideDrawables_ == QUERY_BATCH_SIZE)
+            FlushInsideDrawables();
+    }
+
+    /// Test the collected drawables.
+    void Flush()
+    {
+        FlushDrawables();
+        FlushInsideDrawables();
+    }
+
+    /// Test the collected drawables with their packed bounding boxes.
+    void FlushDrawables()
+    {
+        if (numDrawables_)
+        {
+            query_.TestPackedDrawables(drawables_, drawables_ + numDrawables_, bounds_, false);
+            numDrawables_ = 0;
+        }
+    }
+
+    /// Pass the collected inside drawables to the query.
+    void FlushInsideDrawables()
+    {
+        if (numInsideDrawables_)
+        {
+            query_.TestDrawables(insideDrawables_, insideDrawables_ + numInsideDrawables_, true);
+            numInsideDrawables_ = 0;
+        }
+    }
+
+    /// Query.
+    OctreeQuery& query_;
+    /// Drawables to test.
+    Drawable* drawables_[QUERY_BATCH_SIZE];
+    /// Bounding boxes of the drawables to test in blocks of four.
+    DrawableBoundsBlock bounds_[QUERY_BATCH_SIZE / 4];
+    /// Drawables inside the query volume.
+    Drawable* insideDrawables_[QUERY_BATCH_SIZE];
+    /// Number of drawables to test.
+    unsigned numDrawables_;
+    /// Number of drawables inside the query volume.
+    unsigned numInsideDrawables_;
+};
+
+static float SurfaceArea(const BoundingBox& box)
+{
+    Vector3 size = box.Size();
+    return 2.0f * (size.x_ * size.y_ + size.y_ * size.z_ + size.z_ * size.x_);
+}
+
+static BoundingBox Combine(const BoundingBox& lhs, const BoundingBox& rhs)
+{
+    BoundingBox ret(lhs);
+    ret.Merge(rhs);
+    return ret;
+}
+
+static BoundingBox EnlargeLeafBox(const BoundingBox& box)
+{
+    // Drawables without a defined box are indexed as a point, their actual bounds are tested by the query
+    if (!box.Defined())
+        return BoundingBox(Vector3::ZERO, Vector3::ZERO);
+
+    Vector3 margin = VectorMax(box.Size() * LEAF_MARGIN_RATIO, Vector3::ONE * LEAF_MARGIN_MIN);
+    return BoundingBox(box.min_ - margin, box.max_ + margin);
+}
+
+DrawableBVH::DrawableBVH() :
+    root_(NO_NODE),
+    freeList_(NO_NODE),
+    numLeaves_(0)
+{
+}
+
+unsigned DrawableBVH::Insert(Drawable* drawable, const BoundingBox& box)
+{
+    unsigned leaf = AllocateNode();
+    DrawableBVHNode& node = nodes_[leaf];
+    node.box_ = EnlargeLeafBox(box);
+    node.drawable_ = drawable;
+    node.height_ = 0;
+    ++numLeaves_;
+
+    InsertLeaf(leaf);
+    return leaf;
+}
+
+void DrawableBVH::Remove(unsigned leaf)
+{
+    assert(leaf < nodes_.Size() && nodes_[leaf].IsLeaf());
+    RemoveLeaf(leaf);
+    FreeNode(leaf);
+    --numLeaves_;
+}
+
+bool DrawableBVH::Move(unsigned leaf, const BoundingBox& box)
+{
+    assert(leaf < nodes_.Size() && nodes_[leaf].IsLeaf());
+
+    // Refitting is not needed while the drawable stays within its enlarged box
+    if (box.Defined() && nodes_[leaf].box_.IsInside(box) == INSIDE)
+        return false;
+
+    RemoveLeaf(leaf);
+    nodes_[leaf].box_ = EnlargeLeafBox(box);
+    InsertLeaf(leaf);
+    return true;
+}
+
+void DrawableBVH::Clear()
+{
+    nodes_.Clear();
+    root_ = NO_NODE;
+    freeList_ = NO_NODE;
+    numLeaves_ = 0;
+}
+
+void DrawableBVH::GetDrawables(OctreeQuery& query) const
+{
+    if (root_ != NO_NODE)
+    {
+        DrawableBVHQueryBatch batch(query);
+        GetDrawablesInternal(root_, batch, false);
+        batch.Flush();
+    }
+}
+
+void DrawableBVH::Raycast(RayOctreeQuery& query) const
+{
+    if (root_ != NO_NODE)
+        RaycastInternal(root_, query);
+}
+
+void DrawableBVH::GetDrawablesOnly(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const
+{
+    if (root_ != NO_NODE)
+        GetDrawablesOnlyInternal(root_, query, drawables);
+}
+
+void DrawableBVH::DrawDebugGeometry(DebugRenderer* debug, bool depthTest) const
+{
+    if (!debug || root_ == NO_NODE)
+        return;
+
+    PODVector<unsigned> stack;
+    stack.Push(root_);
+    while (!stack.Empty())
+    {
+        const DrawableBVHNode& node = nodes_[stack.Back()];
+        stack.Pop();
+        if (node.IsLeaf() || !debug->IsInside(node.box_))
+            continue;
+
+        debug->AddBoundingBox(node.box_, Color(0.25f, 0.25f, 0.25f), depthTest);
+        stack.Push(node.left_);
+        stack.Push(node.right_);
+    }
+}
+
+unsigned DrawableBVH::AllocateNode()
+{
+    unsigned index;
+    if (freeList_ != NO_NODE)
+    {
+        index = freeList_;
+        freeList_ = nodes_[index].parent_;
+    }
+    else
+    {
+        index = nodes_.Size();
+        nodes_.Resize(index + 1);
+    }
+
+    DrawableBVHNode& node = nodes_[index];
+    node.drawable_ = nullptr;
+    node.parent_ = NO_NODE;
+    node.left_ = NO_NODE;
+    node.right_ = NO_NODE;
+    node.height_ = 0;
+    return index;
+}
+
+void DrawableBVH::FreeNode(unsigned index)
+{
+    DrawableBVHNode& node = nodes_[index];
+    node.drawable_ = nullptr;
+    node.parent_ = freeList_;
+    node.height_ = -1;
+    freeList_ = index;
+}
+
+void DrawableBVH::InsertLeaf(unsigned leaf)
+{
+    if (root_ == NO_NODE)
+    {
+        root_ = leaf;
+        nodes_[leaf].parent_ = NO_NODE;
+        return;
+    }
+
+    // Descend towards the sibling that gives the least surface area increase
+    BoundingBox leafBox = nodes_[leaf].box_;
+    unsigned index = root_;
+    while (!nodes_[index].IsLeaf())
+    {
+        const DrawableBVHNode& node = nodes_[index];
+        float area = SurfaceArea(node.box_);
+        float combinedArea = SurfaceArea(Combine(node.box_, leafBox));
+
+        // Cost of creating a new parent for this node and the leaf, and the minimum cost of pushing the leaf further down
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        const DrawableBVHNode& left = nodes_[node.left_];
+        float leftCost = SurfaceArea(Combine(left.box_, leafBox)) + inheritanceCost;
+        if (!left.IsLeaf())
+            leftCost -= SurfaceArea(left.box_);
+
+        const DrawableBVHNode& right = nodes_[node.right_];
+        float rightCost = SurfaceArea(Combine(right.box_, leafBox)) + inheritanceCost;
+        if (!right.IsLeaf())
+            rightCost -= SurfaceArea(right.box_);
+
+        if (cost < leftCost && cost < rightCost)
+            break;
+
+        index = leftCost < rightCost ? node.left_ : node.right_;
+    }
+
+    unsigned sibling = index;
+    unsigned oldParent = nodes_[sibling].parent_;
+    unsigned newParent = AllocateNode();
+
+    DrawableBVHNode& parentNode = nodes_[newParent];
+    parentNode.parent_ = oldParent;
+    parentNode.box_ = Combine(leafBox, nodes_[sibling].box_);
+    parentNode.height_ = nodes_[sibling].height_ + 1;
+    parentNode.left_ = sibling;
+    parentNode.right_ = leaf;
+    nodes_[sibling].parent_ = newParent;
+    nodes_[leaf].parent_ = newParent;
+
+    if (oldParent != NO_NODE)
+    {
+        if (nodes_[oldParent].left_ == sibling)
+            nodes_[oldParent].left_ = newParent;
+        else
+            nodes_[oldParent].right_ = newParent;
+    }
+    else
+        root_ = newParent;
+
+    Refit(nodes_[leaf].parent_);
+}
+
+void DrawableBVH::RemoveLeaf(unsigned leaf)
+{
+    if (leaf == root_)
+    {
+        root_ = NO_NODE;
+        return;
+    }
+
+    unsigned parent = nodes_[leaf].parent_;
+    unsigned grandParent = nodes_[parent].parent_;
+    unsigned sibling = nodes_[parent].left_ == leaf ? nodes_[parent].right_ : nodes_[parent].left_;
+
+    // Replace the parent with the sibling
+    if (grandParent != NO_NODE)
+    {
+        if (nodes_[grandParent].left_ == parent)
+            nodes_[grandParent].left_ = sibling;
+        else
+            nodes_[grandParent].right_ = sibling;
+        nodes_[sibling].parent_ = grandParent;
+        FreeNode(parent);
+        Refit(grandParent);
+    }
+    else
+    {
+        root_ = sibling;
+        nodes_[sibling].parent_ = NO_NODE;
+        FreeNode(parent);
+    }
+
+    nodes_[leaf].parent_ = NO_NODE;
+}
+
+void DrawableBVH::Refit(unsigned index)
+{
+    while (index != NO_NODE)
+    {
+        index = Balance(index);
+
+        DrawableBVHNode& node = nodes_[index];
+        const DrawableBVHNode& left = nodes_[node.left_];
+        const DrawableBVHNode& right = nodes_[node.right_];
+        node.height_ = 1 + Max(left.height_, right.height_);
+        node.box_ = Combine(left.box_, right.box_);
+
+        index = node.parent_;
+    }
+}
+
+unsigned DrawableBVH::Balance(unsigned iA)
+{
+    DrawableBVHNode& a = nodes_[iA];
+    if (a.IsLeaf() || a.height_ < 2)
+        return iA;
+
+    unsigned iB = a.left_;
+    unsigned iC = a.right_;
+    DrawableBVHNode& b = nodes_[iB];
+    DrawableBVHNode& c = nodes_[iC];
+    int balance = c.height_ - b.height_;
+
+    if (balance > 1)
+    {
+        // Rotate the right child up
+        unsigned iF = c.left_;
+        unsigned iG = c.right_;
+        DrawableBVHNode& f = nodes_[iF];
+        DrawableBVHNode& g = nodes_[iG];
+
+        c.left_ = iA;
+        c.parent_ = a.parent_;
+        a.parent_ = iC;
+        if (c.parent_ != NO_NODE)
+        {
+            if (nodes_[c.parent_].left_ == iA)
+                nodes_[c.parent_].left_ = iC;
+            else
+                nodes_[c.parent_].right_ = iC;
+        }
+        else
+            root_ = iC;
+
+        if (f.height_ > g.height_)
+        {
+            c.right_ = iF;
+            a.right_ = iG;
+            g.parent_ = iA;
+            a.box_ = Combine(b.box_, g.box_);
+            c.box_ = Combine(a.box_, f.box_);
+            a.height_ = 1 + Max(b.height_, g.height_);
+            c.height_ = 1 + Max(a.height_, f.height_);
+        }
+        else
+        {
+            c.right_ = iG;
+            a.right_ = iF;
+            f.parent_ = iA;
+            a.box_ = Combine(b.box_, f.box_);
+            c.box_ = Combine(a.box_, g.box_);
+            a.height_ = 1 + Max(b.height_, f.height_);
+            c.height_ = 1 + Max(a.height_, g.height_);
+        }
+
+        return iC;
+    }
+
+    if (balance < -1)
+    {
+        // Rotate the left child up
+        unsigned iD = b.left_;
+        unsigned iE = b.right_;
+        DrawableBVHNode& d = nodes_[iD];
+        DrawableBVHNode& e = nodes_[iE];
+
+        b.left_ = iA;
+        b.parent_ = a.parent_;
+        a.parent_ = iB;
+        if (b.parent_ != NO_NODE)
+        {
+            if (nodes_[b.parent_].left_ == iA)
+                nodes_[b.parent_].left_ = iB;
+            else
+                nodes_[b.parent_].right_ = iB;
+        }
+        else
+            root_ = iB;
+
+        if (d.height_ > e.height_)
+        {
+            b.right_ = iD;
+            a.left_ = iE;
+            e.parent_ = iA;
+            a.box_ = Combine(c.box_, e.box_);
+            b.box_ = Combine(a.box_, d.box_);
+            a.height_ = 1 + Max(c.height_, e.height_);
+            b.height_ = 1 + Max(a.height_, d.height_);
+        }
+        else
+        {
+            b.right_ = iE;
+            a.left_ = iD;
+            d.parent_ = iA;
+            a.box_ = Combine(c.box_, d.box_);
+            b.box_ = Combine(a.box_, e.box_);
+            a.height_ = 1 + Max(c.height_, d.height_);
+            b.height_ = 1 + Max(a.height_, e.height_);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
+
+void DrawableBVH::GetDrawablesInternal(unsigned index, DrawableBVHQueryBatch& batch, bool inside) const
+{
+    const DrawableBVHNode& node = nodes_[index];
+    if (node.IsLeaf())
+    {
+        if (inside)
+            batch.AddInside(node.drawable_);
+        else
+            batch.Add(node.drawable_);
+        return;
+    }
+
+    Intersection res = batch.query_.TestOctant(node.box_, inside);
+    if (res == INSIDE)
+        inside = true;
+    else if (res == OUTSIDE)
+        return;
+
+    GetDrawablesInternal(node.left_, batch, inside);
+    GetDrawablesInternal(node.right_, batch, inside);
+}
+
+void DrawableBVH::RaycastInternal(unsigned index, RayOctreeQuery& query) const
+{
+    const DrawableBVHNode& node = nodes_[index];
+    // Leaves are not tested against the ray, the drawable's own test is tighter
+    if (node.IsLeaf())
+    {
+        Drawable* drawable = node.drawable_;
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawable->ProcessRayQuery(query, query.result_);
+        return;
+    }
+
+    if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+        return;
+
+    RaycastInternal(node.left_, query);
+    RaycastInternal(node.right_, query);
+}
+
+void DrawableBVH::GetDrawablesOnlyInternal(unsigned index, RayOctreeQuery& query, PODVector<Drawable*>& drawables) const
+{
+    const DrawableBVHNode& node = nodes_[index];
+    if (node.IsLeaf())
+    {
+        Drawable* drawable = node.drawable_;
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawables.Push(drawable);
+        return;
+    }
+
+    if (query.ray_.HitDistance(node.box_) >= query.maxDistance_)
+        return;
+
+    GetDrawablesOnlyInternal(node.left_, query, drawables);
+    GetDrawablesOnlyInternal(node.right_, query, drawables);
+}
+
+}
@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/BoundingBox.h"
+
+namespace Urho3D
+{
+
+class DebugRenderer;
+class Drawable;
+class OctreeQuery;
+class RayOctreeQuery;
+struct DrawableBVHQueryBatch;
+
+/// Node of a drawable bounding volume hierarchy.
+struct DrawableBVHNode
+{
+    /// Return whether is a leaf node.
+    bool IsLeaf() const { return left_ == M_MAX_UNSIGNED; }
+
+    /// Bounding box. For leaves this is the drawable's bounding box enlarged with a margin for movement.
+    BoundingBox box_;
+    /// Drawable object of a leaf node.
+    Drawable* drawable_;
+    /// Parent node index. Next free node index when the node is unused.
+    unsigned parent_;
+    /// Left child node index.
+    unsigned left_;
+    /// Right child node index.
+    unsigned right_;
+    /// Height of the subtree, zero for leaves.
+    int height_;
+};
+
+/// Dynamic bounding volume hierarchy of drawable objects. Leaves store enlarged bounding boxes, so a moving drawable is only reinserted once it leaves its box. Kept balanced with tree rotations.
+class URHO3D_API DrawableBVH
+{
+public:
+    /// Construct empty.
+    DrawableBVH();
+
+    /// Insert a drawable object with its world bounding box. Return leaf node index.
+    unsigned Insert(Drawable* drawable, const BoundingBox& box);
+    /// Remove a leaf node.
+    void Remove(unsigned leaf);
+    /// Update the bounding box of a leaf node. Return true if the leaf had to be reinserted.
+    bool Move(unsigned leaf, const BoundingBox& box);
+    /// Remove all nodes.
+    void Clear();
+
+    /// Return drawable objects by a query.
+    void GetDrawables(OctreeQuery& query) const;
+    /// Return drawable objects by a ray query.
+    void Raycast(RayOctreeQuery& query) const;
+    /// Return drawable objects only for a ray query.
+    void GetDrawablesOnly(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Draw the bounds of internal nodes to the debug graphics.
+    void DrawDebugGeometry(DebugRenderer* debug, bool depthTest) const;
+
+    /// Return number of leaf nodes.
+    unsigned GetNumLeaves() const { return numLeaves_; }
+
+    /// Return height of the tree.
+    int GetHeight() const { return root_ != M_MAX_UNSIGNED ? nodes_[root_].height_ : 0; }
+
+private:
+    /// Allocate a node from the free list or grow the node vector.
+    unsigned AllocateNode();
+    /// Return a node to the free list.
+    void FreeNode(unsigned index);
+    /// Link a leaf into the tree at the position of least surface area increase.
+    void InsertLeaf(unsigned leaf);
+    /// Unlink a leaf from the tree.
+    void RemoveLeaf(unsigned leaf);
+    /// Refit bounding boxes and heights from a node up to the root, rebalancing on the way.
+    void Refit(unsigned index);
+    /// Rotate an unbalanced subtree. Return the index of the new subtree root.
+    unsigned Balance(unsigned index);
+    /// Return drawable objects by a query, called internally. Leaf drawables are collected to the batch.
+    void GetDrawablesInternal(unsigned index, DrawableBVHQueryBatch& batch, bool inside) const;
+    /// Return drawable objects by a ray query, called internally.
+    void RaycastInternal(unsigned index, RayOctreeQuery& query) const;
+    /// Return drawable objects only for a ray query, called internally.
+    void GetDrawablesOnlyInternal(unsigned index, RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+
+    /// Nodes.
+    Vector<DrawableBVHNode> nodes_;
+    /// Root node index.
+    unsigned root_;
+    /// First free node index.
+    unsigned freeList_;
+    /// Number of leaf nodes.
+    unsigned numLeaves_;
+};
+
+}
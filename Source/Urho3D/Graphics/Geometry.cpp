@@ -22,6 +22,8 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/IndexBuffer.h"
@@ -34,6 +36,52 @@
 namespace Urho3D
 {
 
+/// Minimum triangle count for building a triangle hierarchy.
+static const unsigned MIN_BVH_TRIANGLES = 64;
+
+/// Triangle hierarchy build state, which can be processed in a worker thread.
+struct TriangleBVHBuild : public RefCounted
+{
+    /// Hierarchy being built.
+    SharedPtr<TriangleBVH> bvh_;
+    /// Vertex data, held so that it stays alive while building even if the buffers are changed.
+    SharedArrayPtr<unsigned char> vertexData_;
+    /// Index data, held so that it stays alive while building.
+    SharedArrayPtr<unsigned char> indexData_;
+    /// Vertex size.
+    unsigned vertexSize_{};
+    /// Index size, zero if not indexed.
+    unsigned indexSize_{};
+    /// Start index or vertex.
+    unsigned start_{};
+    /// Index or vertex count.
+    unsigned count_{};
+    /// Success flag.
+    bool success_{};
+    /// Work item group for waiting on the build.
+    WorkItemGroup group_;
+};
+
+/// Work item for building a triangle hierarchy. Holds the build state, including the group waited on, until the item has been purged, so that the geometry can drop the build at any time.
+struct TriangleBVHBuildItem : public WorkItem
+{
+    /// Build state.
+    SharedPtr<TriangleBVHBuild> build_;
+};
+
+/// Build a triangle hierarchy.
+static void BuildTriangleBVH(TriangleBVHBuild& build)
+{
+    build.success_ = build.bvh_->Build(build.vertexData_, build.vertexSize_, build.indexData_, build.indexSize_, build.start_,
+        build.count_);
+}
+
+/// Build a triangle hierarchy in a worker thread.
+static void BuildTriangleBVHWork(const WorkItem* item, unsigned /*threadIndex*/)
+{
+    BuildTriangleBVH(*static_cast<const TriangleBVHBuildItem*>(item)->build_);
+}
+
 Geometry::Geometry(Context* context) :
     Object(context),
     primitiveType_(TRIANGLE_LIST),
@@ -48,7 +96,10 @@ Geometry::Geometry(Context* context) :
     SetNumVertexBuffers(1);
 }
 
-Geometry::~Geometry() = default;
+Geometry::~Geometry()
+{
+    ClearTriangleBVH();
+}
 
 bool Geometry::SetNumVertexBuffers(unsigned num)
 {
@@ -73,12 +124,14 @@ bool Geometry::SetVertexBuffer(unsigned index, VertexBuffer* buffer)
     }
 
     vertexBuffers_[index] = buffer;
+    ClearTriangleBVH();
     return true;
 }
 
 void Geometry::SetIndexBuffer(IndexBuffer* buffer)
 {
     indexBuffer_ = buffer;
+    ClearTriangleBVH();
 }
 
 bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned indexCount, bool getUsedVertexRange)
@@ -98,6 +151,7 @@ bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned in
     primitiveType_ = type;
     indexStart_ = indexStart;
     indexCount_ = indexCount;
+    ClearTriangleBVH();
 
     // Get min.vertex index and num of vertices from index buffer. If it fails, use full range as fallback
     if (indexCount)
@@ -141,6 +195,7 @@ bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned in
     indexCount_ = indexCount;
     vertexStart_ = vertexStart;
     vertexCount_ = vertexCount;
+    ClearTriangleBVH();
 
     return true;
 }
@@ -158,6 +213,7 @@ void Geometry::SetRawVertexData(const SharedArrayPtr<unsigned char>& data, const
     rawVertexData_ = data;
     rawVertexSize_ = VertexBuffer::GetVertexSize(elements);
     rawElements_ = elements;
+    ClearTriangleBVH();
 }
 
 void Geometry::SetRawVertexData(const SharedArrayPtr<unsigned char>& data, unsigned elementMask)
@@ -165,12 +221,14 @@ void Geometry::SetRawVertexData(const SharedArrayPtr<unsigned char>& data, unsig
     rawVertexData_ = data;
     rawVertexSize_ = VertexBuffer::GetVertexSize(elementMask);
     rawElements_ = VertexBuffer::GetElements(elementMask);
+    ClearTriangleBVH();
 }
 
 void Geometry::SetRawIndexData(const SharedArrayPtr<unsigned char>& data, unsigned indexSize)
 {
     rawIndexData_ = data;
     rawIndexSize_ = indexSize;
+    ClearTriangleBVH();
 }
 
 void Geometry::Draw(Graphics* graphics)
@@ -188,6 +246,71 @@ void Geometry::Draw(Graphics* graphics)
     }
 }
 
+TriangleBVH* Geometry::GetTriangleBVH()
+{
+    if (triangleBVH_ || primitiveType_ != TRIANGLE_LIST)
+        return triangleBVH_;
+
+    // Take the hierarchy into use once the build has finished. A failed build is not retried until the data changes
+    if (triangleBVHBuild_)
+    {
+        if (!triangleBVHBuild_->group_.IsCompleted() || !triangleBVHBuild_->vertexData_)
+            return nullptr;
+
+        if (triangleBVHBuild_->success_)
+            triangleBVH_ = triangleBVHBuild_->bvh_;
+        triangleBVHBuild_->bvh_.Reset();
+        triangleBVHBuild_->vertexData_.Reset();
+        triangleBVHBuild_->indexData_.Reset();
+        return triangleBVH_;
+    }
+
+    SharedArrayPtr<unsigned char> vertexData;
+    SharedArrayPtr<unsigned char> indexData;
+    unsigned vertexSize;
+    unsigned indexSize;
+    const PODVector<VertexElement>* elements;
+
+    GetRawDataShared(vertexData, vertexSize, indexData, indexSize, elements);
+
+    if (!vertexData || !elements || VertexBuffer::GetElementOffset(*elements, TYPE_VECTOR3, SEM_POSITION) != 0)
+        return nullptr;
+    if ((indexData ? indexCount_ : vertexCount_) / 3 < MIN_BVH_TRIANGLES)
+        return nullptr;
+
+    triangleBVHBuild_ = new TriangleBVHBuild();
+    triangleBVHBuild_->bvh_ = new TriangleBVH();
+    triangleBVHBuild_->vertexData_ = vertexData;
+    triangleBVHBuild_->indexData_ = indexData;
+    triangleBVHBuild_->vertexSize_ = vertexSize;
+    triangleBVHBuild_->indexSize_ = indexData ? indexSize : 0;
+    triangleBVHBuild_->start_ = indexData ? indexStart_ : vertexStart_;
+    triangleBVHBuild_->count_ = indexData ? indexCount_ : vertexCount_;
+
+    // Build in a worker thread if possible, so that the first use does not stall the main thread
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (queue && queue->GetNumThreads() && Thread::IsMainThread())
+    {
+        SharedPtr<TriangleBVHBuildItem> item(new TriangleBVHBuildItem());
+        item->priority_ = 0;
+        item->workFunction_ = BuildTriangleBVHWork;
+        item->build_ = triangleBVHBuild_;
+        item->group_ = &triangleBVHBuild_->group_;
+        queue->AddWorkItem(SharedPtr<WorkItem>(item));
+        return nullptr;
+    }
+
+    BuildTriangleBVH(*triangleBVHBuild_);
+    return GetTriangleBVH();
+}
+
+void Geometry::ClearTriangleBVH()
+{
+    // An unfinished build is not waited for, as its work item keeps the build state alive and the result is discarded
+    triangleBVHBuild_.Reset();
+    triangleBVH_.Reset();
+}
+
 VertexBuffer* Geometry::GetVertexBuffer(unsigned index) const
 {
     return index < vertexBuffers_.Size() ? vertexBuffers_[index] : nullptr;
@@ -322,6 +445,30 @@ float Geometry::GetHitDistance(const Ray& ray, Vector3* outNormal, Vector2* outU
         outUV = nullptr;
     }
 
+    // Use the triangle hierarchy if it has been built from the same data
+    if (triangleBVH_ && triangleBVH_->GetVertexData() == vertexData)
+    {
+        unsigned triangle;
+        Vector3 barycentric;
+        float distance = triangleBVH_->Raycast(ray, outNormal, &triangle, outUV ? &barycentric : nullptr);
+        if (outUV)
+        {
+            if (distance == M_INFINITY)
+                *outUV = Vector2::ZERO;
+            else
+            {
+                // Interpolate the UV coordinate using barycentric coordinate
+                const unsigned* indices = triangleBVH_->GetTriangleIndices(triangle);
+                const Vector2& uv0 = *((const Vector2*)(&vertexData[uvOffset + indices[0] * vertexSize]));
+                const Vector2& uv1 = *((const Vector2*)(&vertexData[uvOffset + indices[1] * vertexSize]));
+                const Vector2& uv2 = *((const Vector2*)(&vertexData[uvOffset + indices[2] * vertexSize]));
+                *outUV = Vector2(uv0.x_ * barycentric.x_ + uv1.x_ * barycentric.y_ + uv2.x_ * barycentric.z_,
+                    uv0.y_ * barycentric.x_ + uv1.y_ * barycentric.y_ + uv2.y_ * barycentric.z_);
+            }
+        }
+        return distance;
+    }
+
     return indexData ? ray.HitDistance(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_, outNormal, outUV,
         uvOffset) : ray.HitDistance(vertexData, vertexSize, vertexStart_, vertexCount_, outNormal, outUV, uvOffset);
 }
@@ -25,6 +25,7 @@
 #include "../Container/ArrayPtr.h"
 #include "../Core/Object.h"
 #include "../Graphics/GraphicsDefs.h"
+#include "../Graphics/TriangleBVH.h"
 
 namespace Urho3D
 {
@@ -33,6 +34,7 @@ class IndexBuffer;
 class Ray;
 class Graphics;
 class VertexBuffer;
+struct TriangleBVHBuild;
 
 /// Defines one or more vertex buffers, an index buffer and a draw range.
 class URHO3D_API Geometry : public Object
@@ -66,6 +68,10 @@ public:
     void SetRawIndexData(const SharedArrayPtr<unsigned char>& data, unsigned indexSize);
     /// Draw.
     void Draw(Graphics* graphics);
+    /// Return the triangle hierarchy of the raw data. On first use the hierarchy is built in a worker thread if available, and null is returned until it has finished. Return null also if the geometry has no raw position data or is too small to benefit. Raycasts use the hierarchy once it exists. Call ClearTriangleBVH() if vertex data is modified in place.
+    TriangleBVH* GetTriangleBVH();
+    /// Discard the triangle hierarchy. Waits for an unfinished build.
+    void ClearTriangleBVH();
 
     /// Return all vertex buffers.
     const Vector<SharedPtr<VertexBuffer> >& GetVertexBuffers() const { return vertexBuffers_; }
@@ -139,6 +145,10 @@ private:
     unsigned rawVertexSize_;
     /// Raw index data override size.
     unsigned rawIndexSize_;
+    /// Triangle hierarchy for CPU-side queries.
+    SharedPtr<TriangleBVH> triangleBVH_;
+    /// Triangle hierarchy build in progress or finished.
+    SharedPtr<TriangleBVHBuild> triangleBVHBuild_;
 };
 
 }
@@ -290,7 +290,12 @@ void Graphics::SetShaderCacheDir(const String& path)
 {
     String trimmedPath = path.Trimmed();
     if (trimmedPath.Length())
+    {
         shaderCacheDir_ = AddTrailingSlash(trimmedPath);
+#ifdef URHO3D_OPENGL
+        LoadProgramBinaries();
+#endif
+    }
 }
 
 void Graphics::AddGPUObject(GPUObject* object)
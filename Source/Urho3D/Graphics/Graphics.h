@@ -249,7 +249,7 @@ public:
     void EndDumpShaders();
     /// Precache shader variations from an XML file generated with BeginDumpShaders().
     void PrecacheShaders(Deserializer& source);
-    /// Set shader cache directory, Direct3D only. This can either be an absolute path or a path within the resource system.
+    /// Set shader cache directory for Direct3D shader bytecode and OpenGL program binaries. On Direct3D this can either be an absolute path or a path within the resource system.
     void SetShaderCacheDir(const String& path);
 
     /// Return whether rendering initialized.
@@ -487,7 +487,7 @@ public:
     /// Return whether a custom clipping plane is in use.
     bool GetUseClipPlane() const { return useClipPlane_; }
 
-    /// Return shader cache directory, Direct3D only.
+    /// Return shader cache directory.
     const String& GetShaderCacheDir() const { return shaderCacheDir_; }
 
     /// Return current rendertarget width and height.
@@ -626,6 +626,16 @@ private:
     void SetVertexAttribDivisor(unsigned location, unsigned divisor);
     /// Release/clear GPU objects and optionally close the window. Used only on OpenGL.
     void Release(bool clearGPUObjects, bool closeWindow);
+    /// Compile a shader if not yet compiled. Return true if compiled, or false if failed now or on an earlier attempt. Used only on OpenGL.
+    bool CompileShader(ShaderVariation* shader);
+    /// Begin loading program binaries from the shader cache directory in a worker thread, up to a size limit. Binaries not used within some frames after loading are released. Used only on OpenGL.
+    void LoadProgramBinaries();
+    /// Wait for the program binaries to finish loading. Used only on OpenGL.
+    void WaitProgramBinaries();
+    /// Return a cached program binary for a shader combination. If it has not been loaded in advance, it is read from the shader cache directory. Used only on OpenGL.
+    bool GetProgramBinary(ShaderVariation* vs, ShaderVariation* ps, unsigned& format, PODVector<unsigned char>& data);
+    /// Save the binary of a linked shader program to the shader cache directory. Used only on OpenGL.
+    void SaveProgramBinary(ShaderProgram* program);
 
     /// Mutex for accessing the GPU objects vector from several threads.
     Mutex gpuObjectMutex_;
@@ -779,7 +789,7 @@ private:
     const void* shaderParameterSources_[MAX_SHADER_PARAMETER_GROUPS]{};
     /// Base directory for shaders.
     String shaderPath_;
-    /// Cache directory for Direct3D binary shaders.
+    /// Cache directory for Direct3D binary shaders and OpenGL program binaries.
     String shaderCacheDir_;
     /// File extension for shaders.
     String shaderExtension_;
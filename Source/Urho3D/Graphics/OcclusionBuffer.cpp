@@ -47,6 +47,8 @@ URHO3D_FLAGSET(ClipMask, ClipMaskFlags);
 void DrawOcclusionBatchWork(const WorkItem* item, unsigned threadIndex)
 {
     auto* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
+    URHO3D_PROFILE_OBJECT(DrawOcclusionBatchWork, buffer);
+
     OcclusionBatch& batch = *reinterpret_cast<OcclusionBatch*>(item->start_);
     buffer->DrawBatch(batch, threadIndex);
 }
@@ -45,23 +45,16 @@ namespace Urho3D
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+static const unsigned DRAWABLES_PER_UPDATE_BATCH = 4;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
+static const char* spatialIndexNames[] =
 {
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
-
-    while (start != end)
-    {
-        Drawable* drawable = *start;
-        if (drawable)
-            drawable->Update(frame);
-        ++start;
-    }
-}
+    "Octree",
+    "BVH",
+    nullptr
+};
 
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
@@ -85,10 +78,11 @@ Octant::~Octant()
         for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
         {
             (*i)->SetOctant(root_);
-            root_->drawables_.Push(*i);
+            root_->PushDrawable(*i);
             root_->QueueUpdate(*i);
         }
         drawables_.Clear();
+        drawableBounds_.Clear();
         numDrawables_ = 0;
     }
 
@@ -148,11 +142,18 @@ void Octant::InsertDrawable(Drawable* drawable)
         Octant* oldOctant = drawable->octant_;
         if (oldOctant != this)
         {
-            // Add first, then remove, because drawable count going to zero deletes the octree branch in question
-            AddDrawable(drawable);
-            if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
+            // Add first, then decrease the old count, because drawable count going to zero deletes the octree branch in
+            // question. The old octant's vector must be erased before adding, as the drawable's index changes
+            if (oldOctant && oldOctant->EraseDrawable(drawable))
+            {
+                AddDrawable(drawable);
+                oldOctant->DecDrawableCount();
+            }
+            else
+                AddDrawable(drawable);
         }
+        else
+            UpdateDrawableBounds(drawable);
     }
     else
     {
@@ -195,7 +196,10 @@ void Octant::ResetRoot()
 
     // The whole octree is being destroyed, just detach the drawables
     for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+    {
         (*i)->SetOctant(nullptr);
+        (*i)->bvhLeaf_ = M_MAX_UNSIGNED;
+    }
 
     for (auto& child : children_)
     {
@@ -226,7 +230,74 @@ void Octant::Initialize(const BoundingBox& box)
     cullingBox_ = BoundingBox(worldBoundingBox_.min_ - halfSize_, worldBoundingBox_.max_ + halfSize_);
 }
 
-void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
+void Octant::PushDrawable(Drawable* drawable)
+{
+    unsigned index = drawables_.Size();
+    drawable->octantIndex_ = index;
+    drawables_.Push(drawable);
+    if (!(index & 3u))
+        drawableBounds_.Push(DrawableBoundsBlock{});
+
+    UpdateDrawableBounds(drawable);
+}
+
+bool Octant::EraseDrawable(Drawable* drawable)
+{
+    unsigned index = drawable->octantIndex_;
+    if (index >= drawables_.Size() || drawables_[index] != drawable)
+        return false;
+
+    if (drawable->bvhLeaf_ != M_MAX_UNSIGNED)
+    {
+        if (root_)
+            root_->bvh_.Remove(drawable->bvhLeaf_);
+        drawable->bvhLeaf_ = M_MAX_UNSIGNED;
+    }
+
+    // Move the last drawable and its bounds into the erased slot to keep both vectors packed
+    unsigned last = drawables_.Size() - 1;
+    DrawableBoundsBlock& lastBlock = drawableBounds_[last >> 2u];
+    unsigned lastLane = last & 3u;
+    if (index != last)
+    {
+        Drawable* moved = drawables_[last];
+        drawables_[index] = moved;
+        moved->octantIndex_ = index;
+
+        DrawableBoundsBlock& block = drawableBounds_[index >> 2u];
+        unsigned lane = index & 3u;
+        block.centerX_[lane] = lastBlock.centerX_[lastLane];
+        block.centerY_[lane] = lastBlock.centerY_[lastLane];
+        block.centerZ_[lane] = lastBlock.centerZ_[lastLane];
+        block.halfSizeX_[lane] = lastBlock.halfSizeX_[lastLane];
+        block.halfSizeY_[lane] = lastBlock.halfSizeY_[lastLane];
+        block.halfSizeZ_[lane] = lastBlock.halfSizeZ_[lastLane];
+    }
+
+    drawables_.Pop();
+    if (!lastLane)
+        drawableBounds_.Pop();
+    return true;
+}
+
+void Octant::UpdateDrawableBounds(Drawable* drawable)
+{
+    const BoundingBox& box = drawable->GetWorldBoundingBox();
+    Vector3 center = box.Center();
+    Vector3 halfSize = 0.5f * box.Size();
+
+    unsigned index = drawable->octantIndex_;
+    DrawableBoundsBlock& block = drawableBounds_[index >> 2u];
+    unsigned lane = index & 3u;
+    block.centerX_[lane] = center.x_;
+    block.centerY_[lane] = center.y_;
+    block.centerZ_[lane] = center.z_;
+    block.halfSizeX_[lane] = halfSize.x_;
+    block.halfSizeY_[lane] = halfSize.y_;
+    block.halfSizeZ_[lane] = halfSize.z_;
+}
+
+void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside, bool packedBounds) const
 {
     if (this != root_)
     {
@@ -244,13 +315,16 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     {
         auto** start = const_cast<Drawable**>(&drawables_[0]);
         Drawable** end = start + drawables_.Size();
-        query.TestDrawables(start, end, inside);
+        if (packedBounds)
+            query.TestPackedDrawables(start, end, &drawableBounds_[0], inside);
+        else
+            query.TestDrawables(start, end, inside);
     }
 
     for (auto child : children_)
     {
         if (child)
-            child->GetDrawablesInternal(query, inside);
+            child->GetDrawablesInternal(query, inside, packedBounds);
     }
 }
 
@@ -311,7 +385,8 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*
 Octree::Octree(Context* context) :
     Component(context),
     Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, nullptr, this),
-    numLevels_(DEFAULT_OCTREE_LEVELS)
+    numLevels_(DEFAULT_OCTREE_LEVELS),
+    spatialIndex_(SPATIAL_INDEX_OCTREE)
 {
     // If the engine is running headless, subscribe to RenderUpdate events for manually updating the octree
     // to allow raycasts and animation update
@@ -336,6 +411,8 @@ void Octree::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE_EX("Bounding Box Min", Vector3, worldBoundingBox_.min_, UpdateOctreeSize, defaultBoundsMin, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Bounding Box Max", Vector3, worldBoundingBox_.max_, UpdateOctreeSize, defaultBoundsMax, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Number of Levels", int, numLevels_, UpdateOctreeSize, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+    URHO3D_ENUM_ACCESSOR_ATTRIBUTE("Spatial Index", GetSpatialIndex, SetSpatialIndex, SpatialIndexType, spatialIndexNames,
+        SPATIAL_INDEX_OCTREE, AM_DEFAULT);
 }
 
 void Octree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
@@ -345,6 +422,8 @@ void Octree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
         URHO3D_PROFILE(OctreeDrawDebug);
 
         Octant::DrawDebugGeometry(debug, depthTest);
+        if (spatialIndex_ == SPATIAL_INDEX_BVH)
+            bvh_.DrawDebugGeometry(debug, depthTest);
     }
 }
 
@@ -361,6 +440,69 @@ void Octree::SetSize(const BoundingBox& box, unsigned numLevels)
     numLevels_ = Max(numLevels, 1U);
 }
 
+void Octree::SetSpatialIndex(SpatialIndexType type)
+{
+    if (type == spatialIndex_)
+        return;
+
+    URHO3D_PROFILE(ChangeSpatialIndex);
+
+    // Gather all drawables to the root octant first
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+        DeleteChild(i);
+    numDrawables_ = drawables_.Size();
+
+    spatialIndex_ = type;
+    if (spatialIndex_ == SPATIAL_INDEX_BVH)
+    {
+        for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+            (*i)->bvhLeaf_ = bvh_.Insert(*i, (*i)->GetWorldBoundingBox());
+    }
+    else
+    {
+        bvh_.Clear();
+
+        // Let the next update sort the drawables into octants
+        for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+        {
+            Drawable* drawable = *i;
+            drawable->bvhLeaf_ = M_MAX_UNSIGNED;
+            if (!drawable->updateQueued_)
+                QueueUpdate(drawable);
+        }
+    }
+}
+
+void Octree::InsertDrawable(Drawable* drawable)
+{
+    if (spatialIndex_ == SPATIAL_INDEX_OCTREE)
+    {
+        Octant::InsertDrawable(drawable);
+        return;
+    }
+
+    // With the BVH all drawables belong to the root octant
+    Octant* oldOctant = drawable->octant_;
+    if (oldOctant != this)
+    {
+        if (oldOctant && oldOctant->EraseDrawable(drawable))
+        {
+            AddDrawable(drawable);
+            oldOctant->DecDrawableCount();
+        }
+        else
+            AddDrawable(drawable);
+    }
+    else
+        UpdateDrawableBounds(drawable);
+
+    const BoundingBox& box = drawable->GetWorldBoundingBox();
+    if (drawable->bvhLeaf_ == M_MAX_UNSIGNED)
+        drawable->bvhLeaf_ = bvh_.Insert(drawable, box);
+    else
+        bvh_.Move(drawable->bvhLeaf_, box);
+}
+
 void Octree::Update(const FrameInfo& frame)
 {
     if (!Thread::IsMainThread())
@@ -380,30 +522,20 @@ void Octree::Update(const FrameInfo& frame)
         auto* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
-
-        PODVector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            PODVector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
+        // Split into small batches so that expensive updates, such as animated models applying their animations and
+        // skinning, get balanced across the threads
+        Drawable** drawables = drawableUpdates_.Begin().ptr_;
+        queue->ParallelFor(drawableUpdates_.Size(), DRAWABLES_PER_UPDATE_BATCH,
+            [drawables, &frame](unsigned start, unsigned end, unsigned /*threadIndex*/)
+            {
+                for (unsigned i = start; i < end; ++i)
+                {
+                    Drawable* drawable = drawables[i];
+                    if (drawable)
+                        drawable->Update(frame);
+                }
+            });
 
-        queue->Complete(M_MAX_UNSIGNED);
         scene->EndThreadedUpdate();
     }
 
@@ -453,9 +585,18 @@ void Octree::Update(const FrameInfo& frame)
             // Skip if no octant or does not belong to this octree anymore
             if (!octant || octant->GetRoot() != this)
                 continue;
-            // Skip if still fits the current octant
+            // The BVH refits the drawable's leaf, or reinserts it only if it left the leaf's enlarged box
+            if (spatialIndex_ == SPATIAL_INDEX_BVH)
+            {
+                InsertDrawable(drawable);
+                continue;
+            }
+            // Skip if still fits the current octant, but refresh the packed bounds used for culling
             if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            {
+                octant->UpdateDrawableBounds(drawable);
                 continue;
+            }
 
             InsertDrawable(drawable);
 
@@ -479,7 +620,10 @@ void Octree::AddManualDrawable(Drawable* drawable)
     if (!drawable || drawable->GetOctant())
         return;
 
-    AddDrawable(drawable);
+    if (spatialIndex_ == SPATIAL_INDEX_BVH)
+        InsertDrawable(drawable);
+    else
+        AddDrawable(drawable);
 }
 
 void Octree::RemoveManualDrawable(Drawable* drawable)
@@ -495,7 +639,14 @@ void Octree::RemoveManualDrawable(Drawable* drawable)
 void Octree::GetDrawables(OctreeQuery& query) const
 {
     query.result_.Clear();
-    GetDrawablesInternal(query, false);
+    if (spatialIndex_ == SPATIAL_INDEX_BVH)
+    {
+        bvh_.GetDrawables(query);
+        return;
+    }
+
+    // Drawables waiting for update may have moved since their packed bounds were stored
+    GetDrawablesInternal(query, false, drawableUpdates_.Empty() && threadedDrawableUpdates_.Empty());
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -503,7 +654,10 @@ void Octree::Raycast(RayOctreeQuery& query) const
     URHO3D_PROFILE(Raycast);
 
     query.result_.Clear();
-    GetDrawablesInternal(query);
+    if (spatialIndex_ == SPATIAL_INDEX_BVH)
+        bvh_.Raycast(query);
+    else
+        GetDrawablesInternal(query);
     Sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
 }
 
@@ -513,7 +667,10 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 
     query.result_.Clear();
     rayQueryDrawables_.Clear();
-    GetDrawablesOnlyInternal(query, rayQueryDrawables_);
+    if (spatialIndex_ == SPATIAL_INDEX_BVH)
+        bvh_.GetDrawablesOnly(query, rayQueryDrawables_);
+    else
+        GetDrawablesOnlyInternal(query, rayQueryDrawables_);
 
     // Sort by increasing hit distance to AABB
     for (PODVector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
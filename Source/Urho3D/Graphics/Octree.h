@@ -25,6 +25,7 @@
 #include "../Container/List.h"
 #include "../Core/Mutex.h"
 #include "../Graphics/Drawable.h"
+#include "../Graphics/DrawableBVH.h"
 #include "../Graphics/OctreeQuery.h"
 
 namespace Urho3D
@@ -35,9 +36,20 @@ class Octree;
 static const int NUM_OCTANTS = 8;
 static const unsigned ROOT_INDEX = M_MAX_UNSIGNED;
 
+/// Spatial index used by the octree component for storing and querying drawables.
+enum SpatialIndexType
+{
+    /// Drawables are sorted into a fixed-depth octant hierarchy.
+    SPATIAL_INDEX_OCTREE = 0,
+    /// Drawables are stored in a dynamic bounding volume hierarchy. Suits scenes with many fast-moving objects or very large worlds.
+    SPATIAL_INDEX_BVH
+};
+
 /// %Octree octant
 class URHO3D_API Octant
 {
+    friend class Octree;
+
 public:
     /// Construct.
     Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* root, unsigned index = ROOT_INDEX);
@@ -57,14 +69,14 @@ public:
     void AddDrawable(Drawable* drawable)
     {
         drawable->SetOctant(this);
-        drawables_.Push(drawable);
+        PushDrawable(drawable);
         IncDrawableCount();
     }
 
     /// Remove a drawable object from this octant.
     void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
     {
-        if (drawables_.Remove(drawable))
+        if (EraseDrawable(drawable))
         {
             if (resetOctant)
                 drawable->SetOctant(nullptr);
@@ -72,6 +84,9 @@ public:
         }
     }
 
+    /// Refresh the packed bounding box of a drawable in this octant. Called when the drawable has moved but stays in the octant.
+    void UpdateDrawableBounds(Drawable* drawable);
+
     /// Return world-space bounding box.
     const BoundingBox& GetWorldBoundingBox() const { return worldBoundingBox_; }
 
@@ -101,8 +116,12 @@ public:
 protected:
     /// Initialize bounding box.
     void Initialize(const BoundingBox& box);
-    /// Return drawable objects by a query, called internally.
-    void GetDrawablesInternal(OctreeQuery& query, bool inside) const;
+    /// Append a drawable object and its packed bounding box without changing the drawable counts.
+    void PushDrawable(Drawable* drawable);
+    /// Remove a drawable object and its packed bounding box without changing the drawable counts. Return true if was found.
+    bool EraseDrawable(Drawable* drawable);
+    /// Return drawable objects by a query, called internally. Packed bounds may only be used when no drawable updates are pending.
+    void GetDrawablesInternal(OctreeQuery& query, bool inside, bool packedBounds) const;
     /// Return drawable objects by a ray query, called internally.
     void GetDrawablesInternal(RayOctreeQuery& query) const;
     /// Return drawable objects only for a threaded ray query, called internally.
@@ -138,6 +157,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     PODVector<Drawable*> drawables_;
+    /// World bounding boxes of the drawable objects in blocks of four, in the same order as the drawables.
+    PODVector<DrawableBoundsBlock> drawableBounds_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS]{};
     /// World bounding box center.
@@ -161,6 +182,8 @@ class URHO3D_API Octree : public Component, public Octant
 {
     URHO3D_OBJECT(Octree, Component);
 
+    friend class Octant;
+
 public:
     /// Construct.
     explicit Octree(Context* context);
@@ -174,6 +197,10 @@ public:
 
     /// Set size and maximum subdivision levels. If octree is not empty, drawable objects will be temporarily moved to the root.
     void SetSize(const BoundingBox& box, unsigned numLevels);
+    /// Set spatial index type. Existing drawable objects are moved to the new index.
+    void SetSpatialIndex(SpatialIndexType type);
+    /// Insert a drawable object into the active spatial index, or update its position there.
+    void InsertDrawable(Drawable* drawable);
     /// Update and reinsert drawable objects.
     void Update(const FrameInfo& frame);
     /// Add a drawable manually.
@@ -191,6 +218,12 @@ public:
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
 
+    /// Return spatial index type.
+    SpatialIndexType GetSpatialIndex() const { return spatialIndex_; }
+
+    /// Return the bounding volume hierarchy. Empty unless the spatial index type is SPATIAL_INDEX_BVH.
+    const DrawableBVH& GetBVH() const { return bvh_; }
+
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
     /// Cancel drawable object's update.
@@ -214,6 +247,10 @@ private:
     mutable PODVector<Drawable*> rayQueryDrawables_;
     /// Subdivision level.
     unsigned numLevels_;
+    /// Spatial index type.
+    SpatialIndexType spatialIndex_;
+    /// Bounding volume hierarchy of drawables when using SPATIAL_INDEX_BVH.
+    DrawableBVH bvh_;
 };
 
 }
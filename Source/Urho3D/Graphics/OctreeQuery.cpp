@@ -24,6 +24,10 @@
 
 #include "../Graphics/OctreeQuery.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -118,6 +122,99 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
 }
 
 
+void FrustumOctreeQuery::TestPackedDrawables(Drawable** start, Drawable** end, const DrawableBoundsBlock* bounds, bool inside)
+{
+    if (inside)
+    {
+        TestDrawables(start, end, true);
+        return;
+    }
+
+    auto count = (unsigned)(end - start);
+    unsigned runStart = 0;
+
+#ifdef URHO3D_SSE
+    __m128 planeNormalX[NUM_FRUSTUM_PLANES];
+    __m128 planeNormalY[NUM_FRUSTUM_PLANES];
+    __m128 planeNormalZ[NUM_FRUSTUM_PLANES];
+    __m128 planeAbsNormalX[NUM_FRUSTUM_PLANES];
+    __m128 planeAbsNormalY[NUM_FRUSTUM_PLANES];
+    __m128 planeAbsNormalZ[NUM_FRUSTUM_PLANES];
+    __m128 planeD[NUM_FRUSTUM_PLANES];
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        const Plane& plane = frustum_.planes_[i];
+        planeNormalX[i] = _mm_set1_ps(plane.normal_.x_);
+        planeNormalY[i] = _mm_set1_ps(plane.normal_.y_);
+        planeNormalZ[i] = _mm_set1_ps(plane.normal_.z_);
+        planeAbsNormalX[i] = _mm_set1_ps(plane.absNormal_.x_);
+        planeAbsNormalY[i] = _mm_set1_ps(plane.absNormal_.y_);
+        planeAbsNormalZ[i] = _mm_set1_ps(plane.absNormal_.z_);
+        planeD[i] = _mm_set1_ps(plane.d_);
+    }
+    const __m128 zero = _mm_setzero_ps();
+#endif
+
+    for (unsigned i = 0; i < count; i += 4)
+    {
+        const DrawableBoundsBlock& block = bounds[i >> 2u];
+        unsigned visible = 0;
+
+#ifdef URHO3D_SSE
+        __m128 centerX = _mm_loadu_ps(block.centerX_);
+        __m128 centerY = _mm_loadu_ps(block.centerY_);
+        __m128 centerZ = _mm_loadu_ps(block.centerZ_);
+        __m128 halfSizeX = _mm_loadu_ps(block.halfSizeX_);
+        __m128 halfSizeY = _mm_loadu_ps(block.halfSizeY_);
+        __m128 halfSizeZ = _mm_loadu_ps(block.halfSizeZ_);
+        __m128 outside = zero;
+        for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeNormalX[j], centerX), _mm_mul_ps(planeNormalY[j], centerY)),
+                _mm_add_ps(_mm_mul_ps(planeNormalZ[j], centerZ), planeD[j]));
+            __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeAbsNormalX[j], halfSizeX), _mm_mul_ps(planeAbsNormalY[j],
+                halfSizeY)), _mm_mul_ps(planeAbsNormalZ[j], halfSizeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, absDist), zero));
+        }
+        visible = ~(unsigned)_mm_movemask_ps(outside) & 0xfu;
+#else
+        for (unsigned k = 0; k < 4; ++k)
+        {
+            bool isOutside = false;
+            for (const auto& plane : frustum_.planes_)
+            {
+                float dist = plane.normal_.x_ * block.centerX_[k] + plane.normal_.y_ * block.centerY_[k] +
+                    plane.normal_.z_ * block.centerZ_[k] + plane.d_;
+                float absDist = plane.absNormal_.x_ * block.halfSizeX_[k] + plane.absNormal_.y_ * block.halfSizeY_[k] +
+                    plane.absNormal_.z_ * block.halfSizeZ_[k];
+                if (dist < -absDist)
+                {
+                    isOutside = true;
+                    break;
+                }
+            }
+            if (!isOutside)
+                visible |= 1u << k;
+        }
+#endif
+
+        // Forward runs of drawables inside the frustum for the query's own filtering
+        unsigned lanes = Min(count - i, 4U);
+        for (unsigned k = 0; k < lanes; ++k)
+        {
+            if (!(visible & (1u << k)))
+            {
+                if (runStart < i + k)
+                    TestDrawables(start + runStart, start + i + k, true);
+                runStart = i + k + 1;
+            }
+        }
+    }
+
+    if (runStart < count)
+        TestDrawables(start + runStart, end, true);
+}
+
 Intersection AllContentOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     return INSIDE;
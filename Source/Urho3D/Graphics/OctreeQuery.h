@@ -34,6 +34,23 @@ namespace Urho3D
 class Drawable;
 class Node;
 
+/// World-space bounding boxes of four drawables in structure-of-arrays layout, so that they can be culled together.
+struct DrawableBoundsBlock
+{
+    /// Box center X coordinates.
+    float centerX_[4];
+    /// Box center Y coordinates.
+    float centerY_[4];
+    /// Box center Z coordinates.
+    float centerZ_[4];
+    /// Box half size along X.
+    float halfSizeX_[4];
+    /// Box half size along Y.
+    float halfSizeY_[4];
+    /// Box half size along Z.
+    float halfSizeZ_[4];
+};
+
 /// Base class for octree queries.
 class URHO3D_API OctreeQuery
 {
@@ -58,6 +75,11 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables with their world bounding boxes packed in blocks of four. By default the packed boxes are not used.
+    virtual void TestPackedDrawables(Drawable** start, Drawable** end, const DrawableBoundsBlock* bounds, bool inside)
+    {
+        TestDrawables(start, end, inside);
+    }
 
     /// Result vector reference.
     PODVector<Drawable*>& result_;
@@ -146,6 +168,8 @@ public:
     Intersection TestOctant(const BoundingBox& box, bool inside) override;
     /// Intersection test for drawables.
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override;
+    /// Intersection test for drawables, testing four packed bounding boxes against the frustum at once. Drawables passing the frustum test are forwarded to TestDrawables().
+    void TestPackedDrawables(Drawable** start, Drawable** end, const DrawableBoundsBlock* bounds, bool inside) override;
 
     /// Frustum.
     Frustum frustum_;
@@ -40,6 +40,7 @@
 #include "../../Graphics/TextureCube.h"
 #include "../../Graphics/VertexBuffer.h"
 #include "../../IO/File.h"
+#include "../../IO/FileSystem.h"
 #include "../../IO/Log.h"
 #include "../../Resource/ResourceCache.h"
 
@@ -217,6 +218,50 @@ static void GetGLPrimitiveType(unsigned elementCount, PrimitiveType type, unsign
     }
 }
 
+static const char* PROGRAM_BINARY_EXTENSION = ".glp";
+/// Maximum total size of program binaries loaded in advance. The rest are read when needed.
+static const unsigned MAX_PROGRAM_BINARY_LOAD_SIZE = 16 * 1024 * 1024;
+/// Number of frames after loading to keep program binaries that have not been used.
+static const unsigned PROGRAM_BINARY_KEEP_FRAMES = 300;
+
+/// Result of reading a program binary file.
+enum ProgramBinaryReadResult
+{
+    PROGRAM_BINARY_OK = 0,
+    PROGRAM_BINARY_OTHER_DRIVER,
+    PROGRAM_BINARY_INVALID
+};
+
+static String GetProgramBinaryFileName(const String& dir, ShaderVariation* vs, ShaderVariation* ps)
+{
+    return dir + vs->GetName() + "_" + vs->GetSourceHash().ToString() + "_" + ps->GetName() + "_" + ps->GetSourceHash().ToString() +
+        PROGRAM_BINARY_EXTENSION;
+}
+
+static ProgramBinaryReadResult ReadProgramBinary(Deserializer& source, StringHash driverHash, Pair<StringHash, StringHash>& key,
+    ProgramBinary& binary)
+{
+    // The header is the file ID followed by the driver hash, the shader source hashes and the binary format
+    if (source.GetSize() < 5 * sizeof(unsigned) || source.ReadFileID() != "UGLP")
+        return PROGRAM_BINARY_INVALID;
+
+    // Reject binaries saved by a different driver, as they would fail to load or be incompatible
+    if (StringHash(source.ReadUInt()) != driverHash)
+        return PROGRAM_BINARY_OTHER_DRIVER;
+
+    key.first_ = StringHash(source.ReadUInt());
+    key.second_ = StringHash(source.ReadUInt());
+    binary.format_ = source.ReadUInt();
+
+    // Do not trust the stored size beyond the actual file size, as the file may be truncated or corrupt
+    unsigned size = source.IsEof() ? 0 : source.ReadVLE();
+    if (!size || size > source.GetSize() - source.GetPosition())
+        return PROGRAM_BINARY_INVALID;
+
+    binary.data_.Resize(size);
+    return source.Read(&binary.data_[0], size) == size ? PROGRAM_BINARY_OK : PROGRAM_BINARY_INVALID;
+}
+
 const Vector2 Graphics::pixelUVOffset(0.0f, 0.0f);
 bool Graphics::gl3Support = false;
 
@@ -246,6 +291,7 @@ Graphics::Graphics(Context* context) :
 
 Graphics::~Graphics()
 {
+    WaitProgramBinaries();
     Close();
 
     delete impl_;
@@ -657,6 +703,15 @@ void Graphics::EndFrame()
 
     // Clean up too large scratch buffers
     CleanupScratchBuffers();
+
+    // Release program binaries that have not been used some time after loading, as they would likely stay unused
+    if (impl_->programBinaryGroup_.IsCompleted() && !impl_->programBinaries_.Empty() &&
+        ++impl_->programBinaryFrames_ >= PROGRAM_BINARY_KEEP_FRAMES)
+    {
+        MutexLock lock(impl_->programBinaryMutex_);
+        impl_->programBinaries_.Clear();
+        impl_->programBinarySize_ = 0;
+    }
 }
 
 void Graphics::Clear(ClearTargetFlags flags, const Color& color, float depth, unsigned stencil)
@@ -1031,47 +1086,43 @@ void Graphics::SetIndexBuffer(IndexBuffer* buffer)
     indexBuffer_ = buffer;
 }
 
+bool Graphics::CompileShader(ShaderVariation* shader)
+{
+    if (shader->GetGPUObjectName())
+        return true;
+    // If already attempted, do not retry
+    if (!shader->GetCompilerOutput().Empty())
+        return false;
+
+    URHO3D_PROFILE(CompileShader);
+
+    const char* typeName = shader->GetShaderType() == VS ? "vertex" : "pixel";
+    bool success = shader->Create();
+    if (success)
+        URHO3D_LOGDEBUG("Compiled " + String(typeName) + " shader " + shader->GetFullName());
+    else
+        URHO3D_LOGERROR("Failed to compile " + String(typeName) + " shader " + shader->GetFullName() + ":\n" + shader->GetCompilerOutput());
+
+    return success;
+}
+
 void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
 {
     if (vs == vertexShader_ && ps == pixelShader_)
         return;
 
+    // For a new combination, check first for a cached program binary, in which case the shaders do not need to be compiled
+    bool linked = vs && ps && impl_->shaderPrograms_.Contains(MakePair(vs, ps));
+    unsigned binaryFormat = 0;
+    PODVector<unsigned char> binary;
+    bool hasBinary = vs && ps && !linked && GetProgramBinary(vs, ps, binaryFormat, binary);
+
     // Compile the shaders now if not yet compiled. If already attempted, do not retry
-    if (vs && !vs->GetGPUObjectName())
+    if (!linked && !hasBinary)
     {
-        if (vs->GetCompilerOutput().Empty())
-        {
-            URHO3D_PROFILE(CompileVertexShader);
-
-            bool success = vs->Create();
-            if (success)
-                URHO3D_LOGDEBUG("Compiled vertex shader " + vs->GetFullName());
-            else
-            {
-                URHO3D_LOGERROR("Failed to compile vertex shader " + vs->GetFullName() + ":\n" + vs->GetCompilerOutput());
-                vs = nullptr;
-            }
-        }
-        else
+        if (vs && !CompileShader(vs))
             vs = nullptr;
-    }
-
-    if (ps && !ps->GetGPUObjectName())
-    {
-        if (ps->GetCompilerOutput().Empty())
-        {
-            URHO3D_PROFILE(CompilePixelShader);
-
-            bool success = ps->Create();
-            if (success)
-                URHO3D_LOGDEBUG("Compiled pixel shader " + ps->GetFullName());
-            else
-            {
-                URHO3D_LOGERROR("Failed to compile pixel shader " + ps->GetFullName() + ":\n" + ps->GetCompilerOutput());
-                ps = nullptr;
-            }
-        }
-        else
+        if (ps && !CompileShader(ps))
             ps = nullptr;
     }
 
@@ -1110,10 +1161,29 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
             URHO3D_PROFILE(LinkShaders);
 
             SharedPtr<ShaderProgram> newProgram(new ShaderProgram(this, vs, ps));
-            if (newProgram->Link())
+            bool success = false;
+            if (hasBinary)
             {
-                URHO3D_LOGDEBUG("Linked vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
-                // Note: Link() calls glUseProgram() to set the texture sampler uniforms,
+                success = newProgram->LinkBinary(binaryFormat, binary);
+                if (success)
+                    URHO3D_LOGDEBUG("Loaded program binary for vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+                else
+                    URHO3D_LOGDEBUG("Discarded program binary for vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+            }
+            // If the program binary was rejected, fall back to compiling the shaders
+            if (!success && CompileShader(vs) && CompileShader(ps))
+            {
+                success = newProgram->Link();
+                if (success)
+                {
+                    URHO3D_LOGDEBUG("Linked vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+                    SaveProgramBinary(newProgram);
+                }
+            }
+
+            if (success)
+            {
+                // Note: Link() and LinkBinary() call glUseProgram() to set the texture sampler uniforms,
                 // so it is not necessary to call it again
                 impl_->shaderProgram_ = newProgram;
             }
@@ -2343,6 +2413,174 @@ void Graphics::CleanupShaderPrograms(ShaderVariation* variation)
         impl_->shaderProgram_ = nullptr;
 }
 
+void LoadProgramBinariesWork(const WorkItem* item, unsigned /*threadIndex*/)
+{
+    auto* graphics = static_cast<Graphics*>(item->aux_);
+    GraphicsImpl* impl = graphics->GetImpl();
+    auto* fileSystem = graphics->GetSubsystem<FileSystem>();
+
+    Vector<String> fileNames;
+    fileSystem->ScanDir(fileNames, impl->programBinaryDir_, "*" + String(PROGRAM_BINARY_EXTENSION), SCAN_FILES, false);
+
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        String fileName = impl->programBinaryDir_ + fileNames[i];
+        Pair<StringHash, StringHash> key;
+        ProgramBinary binary;
+
+        File file(graphics->GetContext(), fileName);
+        ProgramBinaryReadResult result = ReadProgramBinary(file, impl->driverHash_, key, binary);
+        if (result != PROGRAM_BINARY_OK)
+        {
+            // Remove binaries of other drivers, as they would be overwritten only if the same shader combination is used
+            // again. Keep invalid files, which may be rewritten by another instance of the application right now
+            if (result == PROGRAM_BINARY_OTHER_DRIVER)
+            {
+                file.Close();
+                fileSystem->Delete(fileName);
+            }
+            continue;
+        }
+
+        MutexLock lock(impl->programBinaryMutex_);
+        // Skip binaries that were already read directly and used
+        if (impl->usedProgramBinaries_.Contains(key))
+            continue;
+        // Leave the rest to be read when needed once the size limit is reached
+        if (impl->programBinarySize_ + binary.data_.Size() > MAX_PROGRAM_BINARY_LOAD_SIZE)
+            break;
+        impl->programBinarySize_ += binary.data_.Size();
+        ProgramBinary& dest = impl->programBinaries_[key];
+        dest.format_ = binary.format_;
+        dest.data_.Swap(binary.data_);
+    }
+}
+
+void Graphics::LoadProgramBinaries()
+{
+    WaitProgramBinaries();
+
+    impl_->programBinaries_.Clear();
+    impl_->usedProgramBinaries_.Clear();
+    impl_->programBinaryDir_.Clear();
+    impl_->programBinarySize_ = 0;
+    impl_->programBinaryFrames_ = 0;
+
+    if (!impl_->programBinarySupport_ || shaderCacheDir_.Empty())
+        return;
+
+    impl_->programBinaryDir_ = shaderCacheDir_;
+    if (!GetSubsystem<FileSystem>()->DirExists(impl_->programBinaryDir_))
+        return;
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    SharedPtr<WorkItem> item = queue->GetFreeItem();
+    item->workFunction_ = LoadProgramBinariesWork;
+    item->aux_ = this;
+    item->group_ = &impl_->programBinaryGroup_;
+    queue->AddWorkItem(item);
+}
+
+void Graphics::WaitProgramBinaries()
+{
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (queue && !impl_->programBinaryGroup_.IsCompleted())
+        queue->Complete(impl_->programBinaryGroup_);
+}
+
+bool Graphics::GetProgramBinary(ShaderVariation* vs, ShaderVariation* ps, unsigned& format, PODVector<unsigned char>& data)
+{
+    if (impl_->programBinaryDir_.Empty())
+        return false;
+
+    Pair<StringHash, StringHash> key(vs->GetSourceHash(), ps->GetSourceHash());
+    {
+        MutexLock lock(impl_->programBinaryMutex_);
+
+        ProgramBinaryMap::Iterator i = impl_->programBinaries_.Find(key);
+        if (i != impl_->programBinaries_.End())
+        {
+            format = i->second_.format_;
+            data.Swap(i->second_.data_);
+            impl_->programBinaries_.Erase(i);
+            impl_->programBinarySize_ -= data.Size();
+            return true;
+        }
+    }
+
+    // Read the file directly if the binaries are still loading, or the binary was not loaded due to the size limit or has
+    // been released
+    String fileName = GetProgramBinaryFileName(impl_->programBinaryDir_, vs, ps);
+    if (GetSubsystem<FileSystem>()->FileExists(fileName))
+    {
+        File file(context_, fileName);
+        Pair<StringHash, StringHash> fileKey;
+        ProgramBinary binary;
+        if (ReadProgramBinary(file, impl_->driverHash_, fileKey, binary) == PROGRAM_BINARY_OK && fileKey == key)
+        {
+            // Make sure the loading does not keep another copy of the binary, whether it has been loaded meanwhile or not
+            MutexLock lock(impl_->programBinaryMutex_);
+            if (!impl_->programBinaryGroup_.IsCompleted())
+                impl_->usedProgramBinaries_.Insert(key);
+            ProgramBinaryMap::Iterator i = impl_->programBinaries_.Find(key);
+            if (i != impl_->programBinaries_.End())
+            {
+                impl_->programBinarySize_ -= i->second_.data_.Size();
+                impl_->programBinaries_.Erase(i);
+            }
+
+            format = binary.format_;
+            data.Swap(binary.data_);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Graphics::SaveProgramBinary(ShaderProgram* program)
+{
+    if (impl_->programBinaryDir_.Empty())
+        return;
+
+    ProgramBinary binary;
+    if (!program->GetBinary(binary.format_, binary.data_))
+        return;
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    if (!fileSystem->DirExists(impl_->programBinaryDir_))
+        fileSystem->CreateDir(impl_->programBinaryDir_);
+
+    // Write to a temporary file first and rename it, so that the loading never sees a partially written binary
+    String fileName = GetProgramBinaryFileName(impl_->programBinaryDir_, program->GetVertexShader(), program->GetPixelShader());
+    String tempFileName = fileName + ".tmp";
+    {
+        File file(context_, tempFileName, FILE_WRITE);
+        if (!file.IsOpen())
+            return;
+
+        file.WriteFileID("UGLP");
+        file.WriteUInt(impl_->driverHash_.Value());
+        file.WriteUInt(program->GetVertexShader()->GetSourceHash().Value());
+        file.WriteUInt(program->GetPixelShader()->GetSourceHash().Value());
+        file.WriteUInt(binary.format_);
+        if (!file.WriteBuffer(binary.data_))
+        {
+            file.Close();
+            fileSystem->Delete(tempFileName);
+            return;
+        }
+    }
+
+    // Renaming does not replace an existing file on all platforms
+    if (!fileSystem->Rename(tempFileName, fileName))
+    {
+        fileSystem->Delete(fileName);
+        if (!fileSystem->Rename(tempFileName, fileName))
+            fileSystem->Delete(tempFileName);
+    }
+}
+
 ConstantBuffer* Graphics::GetOrCreateConstantBuffer(ShaderType /*type*/,  unsigned index, unsigned size)
 {
     // Note: shaderType parameter is not used on OpenGL, instead binding index should already use the PS range
@@ -2511,12 +2749,28 @@ void Graphics::Restore()
         // In case of trouble or for wanting maximum compatibility, simply remove the glEnable below.
         if (gl3Support || GLEW_ARB_seamless_cube_map)
             glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+        // Check for program binary support. Some drivers expose the functions but no binary formats
+        impl_->programBinarySupport_ = false;
+        if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+        {
+            int numFormats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+            impl_->programBinarySupport_ = numFormats > 0;
+        }
 #endif
 
+        // Identify the driver so that program binaries from a different driver are not used
+        impl_->driverHash_ = StringHash(String((const char*)glGetString(GL_VENDOR)) + (const char*)glGetString(GL_RENDERER) +
+            (const char*)glGetString(GL_VERSION));
+
         // Set up texture data read/write alignment. It is important that this is done before uploading any texture data
         glPixelStorei(GL_PACK_ALIGNMENT, 1);
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         ResetCachedState();
+
+        // Load program binaries for the new context
+        LoadProgramBinaries();
     }
 
     {
@@ -23,7 +23,10 @@
 #pragma once
 
 #include "../../Container/HashMap.h"
+#include "../../Container/HashSet.h"
+#include "../../Core/Mutex.h"
 #include "../../Core/Timer.h"
+#include "../../Core/WorkQueue.h"
 #include "../../Graphics/ConstantBuffer.h"
 #include "../../Graphics/ShaderProgram.h"
 #include "../../Graphics/Texture2D.h"
@@ -71,8 +74,18 @@ namespace Urho3D
 
 class Context;
 
+/// Program binary loaded from the shader cache directory.
+struct ProgramBinary
+{
+    /// Driver-specific binary format.
+    unsigned format_{};
+    /// Binary data.
+    PODVector<unsigned char> data_;
+};
+
 using ConstantBufferMap = HashMap<unsigned, SharedPtr<ConstantBuffer> >;
 using ShaderProgramMap = HashMap<Pair<ShaderVariation*, ShaderVariation*>, SharedPtr<ShaderProgram> >;
+using ProgramBinaryMap = HashMap<Pair<StringHash, StringHash>, ProgramBinary>;
 
 /// Cached state of a frame buffer object
 struct FrameBufferObject
@@ -93,6 +106,7 @@ struct FrameBufferObject
 class URHO3D_API GraphicsImpl
 {
     friend class Graphics;
+    friend void LoadProgramBinariesWork(const WorkItem* item, unsigned threadIndex);
 
 public:
     /// Construct.
@@ -101,6 +115,9 @@ public:
     /// Return the GL Context.
     const SDL_GLContext& GetGLContext() { return context_; }
 
+    /// Return whether shader program binaries can be retrieved and cached.
+    bool GetProgramBinarySupport() const { return programBinarySupport_; }
+
 private:
     /// SDL OpenGL context.
     SDL_GLContext context_{};
@@ -146,6 +163,24 @@ private:
     ShaderProgram* shaderProgram_{};
     /// Linked shader programs.
     ShaderProgramMap shaderPrograms_;
+    /// Program binaries loaded from the shader cache directory and not yet used, by vertex and pixel shader source hashes.
+    ProgramBinaryMap programBinaries_;
+    /// Total size of the loaded program binaries not yet used.
+    unsigned programBinarySize_{};
+    /// Frames since the program binaries finished loading.
+    unsigned programBinaryFrames_{};
+    /// Program binaries read directly while the loading was in progress. They are skipped when the loading reaches them.
+    HashSet<Pair<StringHash, StringHash> > usedProgramBinaries_;
+    /// Mutex for the program binaries, which are loaded in a worker thread.
+    Mutex programBinaryMutex_;
+    /// Work item group for loading the program binaries.
+    WorkItemGroup programBinaryGroup_;
+    /// Directory the program binaries are loaded from and saved to.
+    String programBinaryDir_;
+    /// Hash of the OpenGL vendor, renderer and version strings. Program binaries from a different driver are discarded.
+    StringHash driverHash_;
+    /// Program binary support flag.
+    bool programBinarySupport_{};
     /// Need FBO commit flag.
     bool fboDirty_{};
     /// Need vertex attribute pointer update flag.
@@ -126,8 +126,67 @@ bool ShaderProgram::Link()
 
     glAttachShader(object_.name_, vertexShader_->GetGPUObjectName());
     glAttachShader(object_.name_, pixelShader_->GetGPUObjectName());
+#ifndef GL_ES_VERSION_2_0
+    // Allow the binary to be retrieved for the program binary cache
+    if (graphics_->GetImpl()->GetProgramBinarySupport())
+        glProgramParameteri(object_.name_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
     glLinkProgram(object_.name_);
 
+    return ExamineLinkedProgram();
+}
+
+bool ShaderProgram::LinkBinary(unsigned format, const PODVector<unsigned char>& data)
+{
+    Release();
+
+#ifndef GL_ES_VERSION_2_0
+    if (!vertexShader_ || !pixelShader_ || data.Empty() || !graphics_->GetImpl()->GetProgramBinarySupport())
+        return false;
+
+    object_.name_ = glCreateProgram();
+    if (!object_.name_)
+    {
+        linkerOutput_ = "Could not create shader program";
+        return false;
+    }
+
+    glProgramBinary(object_.name_, format, &data[0], (GLsizei)data.Size());
+
+    return ExamineLinkedProgram();
+#else
+    return false;
+#endif
+}
+
+bool ShaderProgram::GetBinary(unsigned& format, PODVector<unsigned char>& data) const
+{
+#ifndef GL_ES_VERSION_2_0
+    if (!object_.name_ || !graphics_->GetImpl()->GetProgramBinarySupport())
+        return false;
+
+    int length = 0;
+    glGetProgramiv(object_.name_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    data.Resize((unsigned)length);
+    GLenum binaryFormat = 0;
+    int outLength = 0;
+    glGetProgramBinary(object_.name_, length, &outLength, &binaryFormat, &data[0]);
+    if (outLength <= 0)
+        return false;
+
+    data.Resize((unsigned)outLength);
+    format = binaryFormat;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShaderProgram::ExamineLinkedProgram()
+{
     int linked, length;
     glGetProgramiv(object_.name_, GL_LINK_STATUS, &linked);
     if (!linked)
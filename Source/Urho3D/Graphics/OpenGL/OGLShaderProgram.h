@@ -50,6 +50,10 @@ public:
 
     /// Link the shaders and examine the uniforms and samplers used. Return true if successful.
     bool Link();
+    /// Create from a previously retrieved program binary and examine the uniforms and samplers used. The shaders do not need to be compiled. Return true if successful.
+    bool LinkBinary(unsigned format, const PODVector<unsigned char>& data);
+    /// Retrieve the linked program binary. Return true if successful.
+    bool GetBinary(unsigned& format, PODVector<unsigned char>& data) const;
 
     /// Return the vertex shader.
     ShaderVariation* GetVertexShader() const;
@@ -87,6 +91,9 @@ public:
     static void ClearGlobalParameterSource(ShaderParameterGroup group);
 
 private:
+    /// Check the link status of the program object and examine the vertex attributes, uniforms and samplers used. Return true if successful.
+    bool ExamineLinkedProgram();
+
     /// Vertex shader.
     WeakPtr<ShaderVariation> vertexShader_;
     /// Pixel shader.
@@ -52,6 +52,7 @@ void ShaderVariation::OnDeviceLost()
     GPUObject::OnDeviceLost();
 
     compilerOutput_.Clear();
+    sourceHash_ = StringHash();
 }
 
 void ShaderVariation::Release()
@@ -78,15 +79,21 @@ void ShaderVariation::Release()
         }
 
         object_.name_ = 0;
-        graphics_->CleanupShaderPrograms(this);
     }
 
+    // Shader programs may also have been created from a cached program binary without compiling this variation
+    if (graphics_)
+        graphics_->CleanupShaderPrograms(this);
+
     compilerOutput_.Clear();
+    sourceHash_ = StringHash();
 }
 
 bool ShaderVariation::Create()
 {
-    Release();
+    // Do not release when not compiled yet, as shader programs may exist from cached program binaries
+    if (object_.name_)
+        Release();
 
     if (!owner_)
     {
@@ -101,6 +108,33 @@ bool ShaderVariation::Create()
         return false;
     }
 
+    String shaderCode = GetFinalSourceCode();
+    const char* shaderCStr = shaderCode.CString();
+    glShaderSource(object_.name_, 1, &shaderCStr, nullptr);
+    glCompileShader(object_.name_);
+
+    int compiled, length;
+    glGetShaderiv(object_.name_, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
+    {
+        glGetShaderiv(object_.name_, GL_INFO_LOG_LENGTH, &length);
+        compilerOutput_.Resize((unsigned)length);
+        int outLength;
+        glGetShaderInfoLog(object_.name_, length, &outLength, &compilerOutput_[0]);
+        glDeleteShader(object_.name_);
+        object_.name_ = 0;
+    }
+    else
+        compilerOutput_.Clear();
+
+    return object_.name_ != 0;
+}
+
+String ShaderVariation::GetFinalSourceCode() const
+{
+    if (!owner_)
+        return String::EMPTY;
+
     const String& originalShaderCode = owner_->GetSourceCode(type_);
     String shaderCode;
 
@@ -166,30 +200,21 @@ bool ShaderVariation::Create()
     else
         shaderCode += originalShaderCode;
 
-    const char* shaderCStr = shaderCode.CString();
-    glShaderSource(object_.name_, 1, &shaderCStr, nullptr);
-    glCompileShader(object_.name_);
+    return shaderCode;
+}
 
-    int compiled, length;
-    glGetShaderiv(object_.name_, GL_COMPILE_STATUS, &compiled);
-    if (!compiled)
-    {
-        glGetShaderiv(object_.name_, GL_INFO_LOG_LENGTH, &length);
-        compilerOutput_.Resize((unsigned)length);
-        int outLength;
-        glGetShaderInfoLog(object_.name_, length, &outLength, &compilerOutput_[0]);
-        glDeleteShader(object_.name_);
-        object_.name_ = 0;
-    }
-    else
-        compilerOutput_.Clear();
+StringHash ShaderVariation::GetSourceHash() const
+{
+    if (!sourceHash_)
+        sourceHash_ = StringHash(GetFinalSourceCode());
 
-    return object_.name_ != 0;
+    return sourceHash_;
 }
 
 void ShaderVariation::SetDefines(const String& defines)
 {
     defines_ = defines;
+    sourceHash_ = StringHash();
 }
 
 // These methods are no-ops for OpenGL
@@ -24,6 +24,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DrawableEvents.h"
 #include "../Graphics/ParticleEffect.h"
 #include "../Graphics/ParticleEmitter.h"
@@ -32,6 +33,12 @@
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 
+#include <atomic>
+
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -40,11 +47,16 @@ namespace Urho3D
 extern const char* GEOMETRY_CATEGORY;
 extern const char* faceCameraModeNames[];
 static const unsigned MAX_PARTICLES_IN_FRAME = 100;
+/// Minimum number of particles to split the update across worker threads.
+static const unsigned MIN_THREADED_PARTICLES = 2048;
+/// Number of particle blocks per worker thread batch.
+static const unsigned PARTICLE_BLOCKS_PER_BATCH = 128;
 
 extern const char* autoRemoveModeNames[];
 
 ParticleEmitter::ParticleEmitter(Context* context) :
     BillboardSet(context),
+    numParticles_(0),
     periodTimer_(0.0f),
     emissionTimer_(0.0f),
     lastTimeStep_(0.0f),
@@ -107,9 +119,14 @@ void ParticleEmitter::Update(const FrameInfo& frame)
     if (!needUpdate_)
         return;
 
+    UpdateParticles(false);
+}
+
+void ParticleEmitter::UpdateParticles(bool threaded)
+{
     // If there is an amount mismatch between particles and billboards, correct it
-    if (particles_.Size() != billboards_.Size())
-        SetNumBillboards(particles_.Size());
+    if (numParticles_ != billboards_.Size())
+        SetNumBillboards(numParticles_);
 
     bool needCommit = false;
 
@@ -166,98 +183,193 @@ void ParticleEmitter::Update(const FrameInfo& frame)
     }
 
     // Update existing particles
-    Vector3 relativeConstantForce = node_->GetWorldRotation().Inverse() * effect_->GetConstantForce();
+    Vector3 constantForce = effect_->GetConstantForce();
+    if (relative_)
+        constantForce = node_->GetWorldRotation().Inverse() * constantForce;
     // If billboards are not relative, apply scaling to the position update
     Vector3 scaleVector = Vector3::ONE;
     if (scaled_ && !relative_)
         scaleVector = node_->GetWorldScale();
 
-    for (unsigned i = 0; i < particles_.Size(); ++i)
+    if (threaded)
     {
-        Particle& particle = particles_[i];
-        Billboard& billboard = billboards_[i];
+        std::atomic<bool> anyEnabled(false);
+        GetSubsystem<WorkQueue>()->ParallelFor(particleBlocks_.Size(), PARTICLE_BLOCKS_PER_BATCH,
+            [&](unsigned start, unsigned end, unsigned /*threadIndex*/)
+            {
+                if (UpdateParticleBlocks(start, end, constantForce, scaleVector))
+                    anyEnabled.store(true, std::memory_order_relaxed);
+            });
+        needCommit |= anyEnabled.load();
+    }
+    else
+        needCommit |= UpdateParticleBlocks(0, particleBlocks_.Size(), constantForce, scaleVector);
 
-        if (billboard.enabled_)
-        {
-            needCommit = true;
+    if (needCommit)
+        Commit();
 
-            // Time to live
-            if (particle.timer_ >= particle.timeToLive_)
-            {
-                billboard.enabled_ = false;
-                continue;
-            }
-            particle.timer_ += lastTimeStep_;
+    needUpdate_ = false;
+}
+
+bool ParticleEmitter::UpdateParticleBlocks(unsigned start, unsigned end, const Vector3& constantForce, const Vector3& scaleVector)
+{
+    const float timeStep = lastTimeStep_;
+    const float dampingForce = effect_->GetDampingForce();
+    const float sizeAdd = effect_->GetSizeAdd();
+    const float sizeMul = effect_->GetSizeMul();
+    const bool scaling = sizeAdd != 0.0f || sizeMul != 1.0f;
+    const float scaleMul = sizeMul != 1.0f ? (timeStep * (sizeMul - 1.0f)) + 1.0f : 1.0f;
+    const Vector3 velocityAdd = timeStep * constantForce;
+    const float velocityMul = 1.0f - timeStep * dampingForce;
+    const Vector<ColorFrame>& colorFrames = effect_->GetColorFrames();
+    const Vector<TextureFrame>& textureFrames = effect_->GetTextureFrames();
+    bool needCommit = false;
 
-            // Velocity & position
-            const Vector3& constantForce = effect_->GetConstantForce();
-            if (constantForce != Vector3::ZERO)
+#ifdef URHO3D_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 timeStep4 = _mm_set1_ps(timeStep);
+    const __m128 velocityAddX = _mm_set1_ps(velocityAdd.x_);
+    const __m128 velocityAddY = _mm_set1_ps(velocityAdd.y_);
+    const __m128 velocityAddZ = _mm_set1_ps(velocityAdd.z_);
+    const __m128 velocityMul4 = _mm_set1_ps(velocityMul);
+    const __m128 moveX = _mm_set1_ps(timeStep * scaleVector.x_);
+    const __m128 moveY = _mm_set1_ps(timeStep * scaleVector.y_);
+    const __m128 moveZ = _mm_set1_ps(timeStep * scaleVector.z_);
+    const __m128 scaleAdd4 = _mm_set1_ps(timeStep * sizeAdd);
+    const __m128 scaleMul4 = _mm_set1_ps(scaleMul);
+#endif
+
+    for (unsigned i = start; i < end; ++i)
+    {
+        ParticleBlock& block = particleBlocks_[i];
+        Billboard* billboards = &billboards_[i * 4];
+        unsigned count = Min(numParticles_ - i * 4, 4U);
+
+        // Retire particles whose time to live has passed, and find out which are still active
+        unsigned activeMask = 0;
+        for (unsigned j = 0; j < count; ++j)
+        {
+            if (billboards[j].enabled_)
             {
-                if (relative_)
-                    particle.velocity_ += lastTimeStep_ * relativeConstantForce;
+                needCommit = true;
+                if (block.timer_[j] >= block.timeToLive_[j])
+                    billboards[j].enabled_ = false;
                 else
-                    particle.velocity_ += lastTimeStep_ * constantForce;
+                    activeMask |= 1u << j;
             }
+        }
+        if (!activeMask)
+            continue;
+
+        float positionDeltaX[4];
+        float positionDeltaY[4];
+        float positionDeltaZ[4];
+        float invVelocityLength[4];
+
+#ifdef URHO3D_SSE
+        // Integrate all four particles, then keep the results only for the active ones, so that the state of inactive
+        // particles does not decay into denormals
+        const __m128 active = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_and_si128(_mm_set1_epi32(activeMask),
+            _mm_set_epi32(8, 4, 2, 1)), _mm_setzero_si128()));
+
+        __m128 velocityX = _mm_loadu_ps(block.velocityX_);
+        __m128 velocityY = _mm_loadu_ps(block.velocityY_);
+        __m128 velocityZ = _mm_loadu_ps(block.velocityZ_);
+        velocityX = _mm_mul_ps(_mm_add_ps(velocityX, velocityAddX), velocityMul4);
+        velocityY = _mm_mul_ps(_mm_add_ps(velocityY, velocityAddY), velocityMul4);
+        velocityZ = _mm_mul_ps(_mm_add_ps(velocityZ, velocityAddZ), velocityMul4);
+        _mm_storeu_ps(block.velocityX_, _mm_or_ps(_mm_and_ps(active, velocityX), _mm_andnot_ps(active, _mm_loadu_ps(block.velocityX_))));
+        _mm_storeu_ps(block.velocityY_, _mm_or_ps(_mm_and_ps(active, velocityY), _mm_andnot_ps(active, _mm_loadu_ps(block.velocityY_))));
+        _mm_storeu_ps(block.velocityZ_, _mm_or_ps(_mm_and_ps(active, velocityZ), _mm_andnot_ps(active, _mm_loadu_ps(block.velocityZ_))));
+
+        _mm_storeu_ps(positionDeltaX, _mm_mul_ps(velocityX, moveX));
+        _mm_storeu_ps(positionDeltaY, _mm_mul_ps(velocityY, moveY));
+        _mm_storeu_ps(positionDeltaZ, _mm_mul_ps(velocityZ, moveZ));
+
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(velocityX, velocityX), _mm_mul_ps(velocityY, velocityY)),
+            _mm_mul_ps(velocityZ, velocityZ));
+        __m128 nonZero = _mm_cmpgt_ps(lengthSquared, zero);
+        __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_or_ps(_mm_and_ps(nonZero, lengthSquared), _mm_andnot_ps(nonZero, one))));
+        _mm_storeu_ps(invVelocityLength, invLength);
+
+        __m128 timer = _mm_loadu_ps(block.timer_);
+        _mm_storeu_ps(block.timer_, _mm_add_ps(timer, _mm_and_ps(active, timeStep4)));
+
+        if (scaling)
+        {
+            __m128 scale = _mm_loadu_ps(block.scale_);
+            __m128 newScale = _mm_mul_ps(_mm_max_ps(_mm_add_ps(scale, scaleAdd4), zero), scaleMul4);
+            _mm_storeu_ps(block.scale_, _mm_or_ps(_mm_and_ps(active, newScale), _mm_andnot_ps(active, scale)));
+        }
+#else
+        for (unsigned j = 0; j < count; ++j)
+        {
+            if (!(activeMask & (1u << j)))
+                continue;
 
-            float dampingForce = effect_->GetDampingForce();
-            if (dampingForce != 0.0f)
-            {
-                Vector3 force = -dampingForce * particle.velocity_;
-                particle.velocity_ += lastTimeStep_ * force;
-            }
-            billboard.position_ += lastTimeStep_ * particle.velocity_ * scaleVector;
-            billboard.direction_ = particle.velocity_.Normalized();
+            float velocityX = (block.velocityX_[j] + velocityAdd.x_) * velocityMul;
+            float velocityY = (block.velocityY_[j] + velocityAdd.y_) * velocityMul;
+            float velocityZ = (block.velocityZ_[j] + velocityAdd.z_) * velocityMul;
+            block.velocityX_[j] = velocityX;
+            block.velocityY_[j] = velocityY;
+            block.velocityZ_[j] = velocityZ;
 
-            // Rotation
-            billboard.rotation_ += lastTimeStep_ * particle.rotationSpeed_;
+            positionDeltaX[j] = velocityX * timeStep * scaleVector.x_;
+            positionDeltaY[j] = velocityY * timeStep * scaleVector.y_;
+            positionDeltaZ[j] = velocityZ * timeStep * scaleVector.z_;
 
-            // Scaling
-            float sizeAdd = effect_->GetSizeAdd();
-            float sizeMul = effect_->GetSizeMul();
-            if (sizeAdd != 0.0f || sizeMul != 1.0f)
-            {
-                particle.scale_ += lastTimeStep_ * sizeAdd;
-                if (particle.scale_ < 0.0f)
-                    particle.scale_ = 0.0f;
-                if (sizeMul != 1.0f)
-                    particle.scale_ *= (lastTimeStep_ * (sizeMul - 1.0f)) + 1.0f;
-                billboard.size_ = particle.size_ * particle.scale_;
-            }
+            float lengthSquared = velocityX * velocityX + velocityY * velocityY + velocityZ * velocityZ;
+            invVelocityLength[j] = lengthSquared > 0.0f ? 1.0f / sqrtf(lengthSquared) : 1.0f;
+
+            block.timer_[j] += timeStep;
+
+            if (scaling)
+                block.scale_[j] = Max(block.scale_[j] + timeStep * sizeAdd, 0.0f) * scaleMul;
+        }
+#endif
+
+        // Write the results to the billboards, and advance the color and texture animations
+        for (unsigned j = 0; j < count; ++j)
+        {
+            if (!(activeMask & (1u << j)))
+                continue;
+
+            Billboard& billboard = billboards[j];
+            billboard.position_ += Vector3(positionDeltaX[j], positionDeltaY[j], positionDeltaZ[j]);
+            billboard.direction_ = Vector3(block.velocityX_[j], block.velocityY_[j], block.velocityZ_[j]) * invVelocityLength[j];
+            billboard.rotation_ += timeStep * block.rotationSpeed_[j];
+            if (scaling)
+                billboard.size_ = Vector2(block.sizeX_[j], block.sizeY_[j]) * block.scale_[j];
 
-            // Color interpolation
-            unsigned& index = particle.colorIndex_;
-            const Vector<ColorFrame>& colorFrames_ = effect_->GetColorFrames();
-            if (index < colorFrames_.Size())
+            float timer = block.timer_[j];
+            unsigned& index = block.colorIndex_[j];
+            if (index < colorFrames.Size())
             {
-                if (index < colorFrames_.Size() - 1)
+                if (index < colorFrames.Size() - 1)
                 {
-                    if (particle.timer_ >= colorFrames_[index + 1].time_)
+                    if (timer >= colorFrames[index + 1].time_)
                         ++index;
                 }
-                if (index < colorFrames_.Size() - 1)
-                    billboard.color_ = colorFrames_[index].Interpolate(colorFrames_[index + 1], particle.timer_);
+                if (index < colorFrames.Size() - 1)
+                    billboard.color_ = colorFrames[index].Interpolate(colorFrames[index + 1], timer);
                 else
-                    billboard.color_ = colorFrames_[index].color_;
+                    billboard.color_ = colorFrames[index].color_;
             }
 
-            // Texture animation
-            unsigned& texIndex = particle.texIndex_;
-            const Vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
-            if (textureFrames_.Size() && texIndex < textureFrames_.Size() - 1)
+            unsigned& texIndex = block.texIndex_[j];
+            if (textureFrames.Size() && texIndex < textureFrames.Size() - 1)
             {
-                if (particle.timer_ >= textureFrames_[texIndex + 1].time_)
+                if (timer >= textureFrames[texIndex + 1].time_)
                 {
-                    billboard.uv_ = textureFrames_[texIndex + 1].uv_;
+                    billboard.uv_ = textureFrames[texIndex + 1].uv_;
                     ++texIndex;
                 }
             }
         }
     }
 
-    if (needCommit)
-        Commit();
-
-    needUpdate_ = false;
+    return needCommit;
 }
 
 void ParticleEmitter::SetEffect(ParticleEffect* effect)
@@ -286,7 +398,14 @@ void ParticleEmitter::SetNumParticles(unsigned num)
     if (num > M_MAX_INT)
         num = 0;
 
-    particles_.Resize(num);
+    // Clear new blocks, as all four particles of a block are processed together
+    unsigned oldNumBlocks = particleBlocks_.Size();
+    unsigned numBlocks = (num + 3) / 4;
+    particleBlocks_.Resize(numBlocks);
+    if (numBlocks > oldNumBlocks)
+        memset(&particleBlocks_[oldNumBlocks], 0, (numBlocks - oldNumBlocks) * sizeof(ParticleBlock));
+
+    numParticles_ = num;
     SetNumBillboards(num);
 }
 
@@ -371,16 +490,23 @@ void ParticleEmitter::SetParticlesAttr(const VariantVector& value)
     unsigned index = 0;
     SetNumParticles(index < value.Size() ? value[index++].GetUInt() : 0);
 
-    for (PODVector<Particle>::Iterator i = particles_.Begin(); i != particles_.End() && index < value.Size(); ++i)
+    for (unsigned i = 0; i < numParticles_ && index < value.Size(); ++i)
     {
-        i->velocity_ = value[index++].GetVector3();
-        i->size_ = value[index++].GetVector2();
-        i->timer_ = value[index++].GetFloat();
-        i->timeToLive_ = value[index++].GetFloat();
-        i->scale_ = value[index++].GetFloat();
-        i->rotationSpeed_ = value[index++].GetFloat();
-        i->colorIndex_ = (unsigned)value[index++].GetInt();
-        i->texIndex_ = (unsigned)value[index++].GetInt();
+        ParticleBlock& block = particleBlocks_[i >> 2u];
+        unsigned j = i & 3u;
+        const Vector3& velocity = value[index++].GetVector3();
+        block.velocityX_[j] = velocity.x_;
+        block.velocityY_[j] = velocity.y_;
+        block.velocityZ_[j] = velocity.z_;
+        const Vector2& size = value[index++].GetVector2();
+        block.sizeX_[j] = size.x_;
+        block.sizeY_[j] = size.y_;
+        block.timer_[j] = value[index++].GetFloat();
+        block.timeToLive_[j] = value[index++].GetFloat();
+        block.scale_[j] = value[index++].GetFloat();
+        block.rotationSpeed_[j] = value[index++].GetFloat();
+        block.colorIndex_[j] = (unsigned)value[index++].GetInt();
+        block.texIndex_[j] = (unsigned)value[index++].GetInt();
     }
 }
 
@@ -389,22 +515,24 @@ VariantVector ParticleEmitter::GetParticlesAttr() const
     VariantVector ret;
     if (!serializeParticles_)
     {
-        ret.Push(particles_.Size());
+        ret.Push(numParticles_);
         return ret;
     }
 
-    ret.Reserve(particles_.Size() * 8 + 1);
-    ret.Push(particles_.Size());
-    for (PODVector<Particle>::ConstIterator i = particles_.Begin(); i != particles_.End(); ++i)
+    ret.Reserve(numParticles_ * 8 + 1);
+    ret.Push(numParticles_);
+    for (unsigned i = 0; i < numParticles_; ++i)
     {
-        ret.Push(i->velocity_);
-        ret.Push(i->size_);
-        ret.Push(i->timer_);
-        ret.Push(i->timeToLive_);
-        ret.Push(i->scale_);
-        ret.Push(i->rotationSpeed_);
-        ret.Push(i->colorIndex_);
-        ret.Push(i->texIndex_);
+        const ParticleBlock& block = particleBlocks_[i >> 2u];
+        unsigned j = i & 3u;
+        ret.Push(Vector3(block.velocityX_[j], block.velocityY_[j], block.velocityZ_[j]));
+        ret.Push(Vector2(block.sizeX_[j], block.sizeY_[j]));
+        ret.Push(block.timer_[j]);
+        ret.Push(block.timeToLive_[j]);
+        ret.Push(block.scale_[j]);
+        ret.Push(block.rotationSpeed_[j]);
+        ret.Push(block.colorIndex_[j]);
+        ret.Push(block.texIndex_[j]);
     }
     return ret;
 }
@@ -450,8 +578,9 @@ bool ParticleEmitter::EmitNewParticle()
     unsigned index = GetFreeParticle();
     if (index == M_MAX_UNSIGNED)
         return false;
-    assert(index < particles_.Size());
-    Particle& particle = particles_[index];
+    assert(index < numParticles_);
+    ParticleBlock& block = particleBlocks_[index >> 2u];
+    unsigned j = index & 3u;
     Billboard& billboard = billboards_[index];
 
     Vector3 startDir;
@@ -486,17 +615,19 @@ bool ParticleEmitter::EmitNewParticle()
         break;
     }
 
-    particle.size_ = effect_->GetRandomSize();
-    particle.timer_ = 0.0f;
-    particle.timeToLive_ = effect_->GetRandomTimeToLive();
-    particle.scale_ = 1.0f;
-    particle.rotationSpeed_ = effect_->GetRandomRotationSpeed();
-    particle.colorIndex_ = 0;
-    particle.texIndex_ = 0;
+    Vector2 size = effect_->GetRandomSize();
+    block.sizeX_[j] = size.x_;
+    block.sizeY_[j] = size.y_;
+    block.timer_[j] = 0.0f;
+    block.timeToLive_[j] = effect_->GetRandomTimeToLive();
+    block.scale_[j] = 1.0f;
+    block.rotationSpeed_[j] = effect_->GetRandomRotationSpeed();
+    block.colorIndex_[j] = 0;
+    block.texIndex_[j] = 0;
 
     if (faceCameraMode_ == FC_DIRECTION)
     {
-        startPos += startDir * particle.size_.y_;
+        startPos += startDir * size.y_;
     }
 
     if (!relative_)
@@ -505,10 +636,13 @@ bool ParticleEmitter::EmitNewParticle()
         startDir = node_->GetWorldRotation() * startDir;
     };
 
-    particle.velocity_ = effect_->GetRandomVelocity() * startDir;
+    Vector3 velocity = effect_->GetRandomVelocity() * startDir;
+    block.velocityX_[j] = velocity.x_;
+    block.velocityY_[j] = velocity.y_;
+    block.velocityZ_[j] = velocity.z_;
 
     billboard.position_ = startPos;
-    billboard.size_ = particles_[index].size_;
+    billboard.size_ = size;
     const Vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
     billboard.uv_ = textureFrames_.Size() ? textureFrames_[0].uv_ : Rect::POSITIVE;
     billboard.rotation_ = effect_->GetRandomRotation();
@@ -557,7 +691,17 @@ void ParticleEmitter::HandleScenePostUpdate(StringHash eventType, VariantMap& ev
     {
         lastUpdateFrameNumber_ = viewFrameNumber_;
         needUpdate_ = true;
-        MarkForUpdate();
+
+        // Drawable updates are already distributed over the worker threads, but one large emitter would be processed
+        // by one thread. Therefore update large emitters now, splitting the particles across all threads
+        auto* queue = GetSubsystem<WorkQueue>();
+        if (effect_ && numParticles_ >= MIN_THREADED_PARTICLES && queue && queue->GetNumThreads())
+        {
+            URHO3D_PROFILE(UpdateParticles);
+            UpdateParticles(true);
+        }
+        else
+            MarkForUpdate();
     }
 
     // Send finished event only once all particles are gone
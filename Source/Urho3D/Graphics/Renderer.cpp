@@ -1266,6 +1266,8 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows,
     // Log error if shaders could not be assigned, but only once per technique
     if (!batch.vertexShader_ || !batch.pixelShader_)
     {
+        // Batches may be prepared in worker threads
+        MutexLock lock(rendererMutex_);
         if (!shaderErrorDisplayed_.Contains(tech))
         {
             shaderErrorDisplayed_.Insert(tech);
@@ -1274,6 +1276,15 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows,
     }
 }
 
+bool Renderer::HasPassShaders(Pass* pass, const BatchQueue& queue) const
+{
+    if (pass->GetShadersLoadedFrameNumber() != shadersChangedFrameNumber_)
+        return false;
+
+    return queue.hasExtraDefines_ ? pass->HasShaders(queue.vsExtraDefinesHash_, queue.psExtraDefinesHash_) :
+        pass->HasShaders(StringHash(), StringHash());
+}
+
 void Renderer::SetLightVolumeBatchShaders(Batch& batch, Camera* camera, const String& vsName, const String& psName, const String& vsDefines,
     const String& psDefines)
 {
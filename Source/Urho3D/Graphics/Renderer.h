@@ -411,6 +411,8 @@ public:
     View* GetPreparedView(Camera* camera);
     /// Choose shaders for a forward rendering batch. The related batch queue is provided in case it has extra shader compilation defines.
     void SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows, const BatchQueue& queue);
+    /// Return whether a pass has up-to-date shaders loaded for a batch queue. If true, SetBatchShaders can be called for the pass and queue from worker threads.
+    bool HasPassShaders(Pass* pass, const BatchQueue& queue) const;
     /// Choose shaders for a deferred light volume batch.
     void SetLightVolumeBatchShaders
         (Batch& batch, Camera* camera, const String& vsName, const String& psName, const String& vsDefines, const String& psDefines);
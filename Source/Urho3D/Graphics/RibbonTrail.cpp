@@ -48,11 +48,6 @@ const char* trailTypeNames[] =
     nullptr
 };
 
-inline bool CompareTails(TrailPoint* lhs, TrailPoint* rhs)
-{
-    return lhs->sortDistance_ > rhs->sortDistance_;
-}
-
 TrailPoint::TrailPoint(const Vector3& position, const Vector3& forward) :
     position_{position},
     forward_{forward}
@@ -242,6 +237,8 @@ void RibbonTrail::UpdateTail(float timeStep)
     if (expiredIndex != -1)
     {
         points_.Erase(0, (unsigned)(expiredIndex + 1));
+        // Keep the previous sort order in step with the remaining points
+        sorter_.RemoveLeadingItems((unsigned)(expiredIndex + 1));
 
         // Update endTail pointer
         if (points_.Size() > 1)
@@ -548,17 +545,28 @@ void RibbonTrail::UpdateVertexBuffer(const FrameInfo& frame)
 
     // Fill sorted points vector
     sortedPoints_.Resize(numPoints_);
-    for (unsigned i = 0; i < numPoints_; ++i)
+    if (sorted_)
     {
-        TrailPoint& point = points_[i];
-        sortedPoints_[i] = &point;
-        if (sorted_)
+        pointIndices_.Resize(numPoints_);
+        sortDistances_.Resize(numPoints_);
+        for (unsigned i = 0; i < numPoints_; ++i)
+        {
+            TrailPoint& point = points_[i];
             point.sortDistance_ = frame.camera_->GetDistanceSquared(point.position_);
-    }
+            sortDistances_[i] = point.sortDistance_;
+            pointIndices_[i] = i;
+        }
 
-    // Sort points
-    if (sorted_)
-        Sort(sortedPoints_.Begin(), sortedPoints_.End(), CompareTails);
+        // Sort points, reusing the previous order
+        const PODVector<unsigned>& order = sorter_.Sort(pointIndices_, sortDistances_);
+        for (unsigned i = 0; i < numPoints_; ++i)
+            sortedPoints_[i] = &points_[order[i]];
+    }
+    else
+    {
+        for (unsigned i = 0; i < numPoints_; ++i)
+            sortedPoints_[i] = &points_[i];
+    }
 
     // Update individual trail elapsed length
     float trailLength = 0.0f;
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Graphics/DepthSorter.h"
 #include "../Graphics/Drawable.h"
 
 namespace Urho3D
@@ -239,6 +240,12 @@ private:
     Vector3 previousOffset_;
     /// Trail pointers for sorting.
     Vector<TrailPoint*> sortedPoints_;
+    /// Trail point indices for sorting.
+    PODVector<unsigned> pointIndices_;
+    /// Trail point distances for sorting.
+    PODVector<float> sortDistances_;
+    /// Depth sorter. Keeps the previous order for reuse.
+    DepthSorter sorter_;
     /// Force update flag (ignore animation LOD momentarily.)
     bool forceUpdate_;
     /// Currently emitting flag.
@@ -137,6 +137,11 @@ public:
     /// Return defines with the CLIPPLANE define appended. Used internally on Direct3D11 only, will be empty on other APIs.
     const String& GetDefinesClipPlane() { return definesClipPlane_; }
 
+    /// Return the complete source code to compile, with the defines prepended. Used only on OpenGL.
+    String GetFinalSourceCode() const;
+    /// Return hash of the complete source code, used to identify cached program binaries. Used only on OpenGL.
+    StringHash GetSourceHash() const;
+
     /// D3D11 vertex semantic names. Used internally.
     static const char* elementSemanticNames[];
 
@@ -174,6 +179,8 @@ private:
     String definesClipPlane_;
     /// Shader compile error string.
     String compilerOutput_;
+    /// Cached hash of the complete source code. Used only on OpenGL.
+    mutable StringHash sourceHash_;
 };
 
 }
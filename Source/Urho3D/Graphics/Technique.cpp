@@ -226,6 +226,29 @@ Vector<SharedPtr<ShaderVariation> >& Pass::GetPixelShaders(const StringHash& ext
         return extraPixelShaders_[extraDefinesHash];
 }
 
+bool Pass::HasShaders(const StringHash& vsExtraDefinesHash, const StringHash& psExtraDefinesHash) const
+{
+    const Vector<SharedPtr<ShaderVariation> >* vertexShaders = &vertexShaders_;
+    const Vector<SharedPtr<ShaderVariation> >* pixelShaders = &pixelShaders_;
+
+    if (vsExtraDefinesHash.Value())
+    {
+        HashMap<StringHash, Vector<SharedPtr<ShaderVariation> > >::ConstIterator i = extraVertexShaders_.Find(vsExtraDefinesHash);
+        if (i == extraVertexShaders_.End())
+            return false;
+        vertexShaders = &i->second_;
+    }
+    if (psExtraDefinesHash.Value())
+    {
+        HashMap<StringHash, Vector<SharedPtr<ShaderVariation> > >::ConstIterator i = extraPixelShaders_.Find(psExtraDefinesHash);
+        if (i == extraPixelShaders_.End())
+            return false;
+        pixelShaders = &i->second_;
+    }
+
+    return vertexShaders->Size() && pixelShaders->Size();
+}
+
 unsigned Technique::basePassIndex = 0;
 unsigned Technique::alphaPassIndex = 0;
 unsigned Technique::materialPassIndex = 0;
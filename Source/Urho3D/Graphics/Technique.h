@@ -136,6 +136,8 @@ public:
     Vector<SharedPtr<ShaderVariation> >& GetVertexShaders(const StringHash& extraDefinesHash);
     /// Return pixel shaders with extra defines from the renderpath.
     Vector<SharedPtr<ShaderVariation> >& GetPixelShaders(const StringHash& extraDefinesHash);
+    /// Return whether both vertex and pixel shaders have been loaded for the given extra defines. Does not create missing shader lists, so is safe to call from worker threads.
+    bool HasShaders(const StringHash& vsExtraDefinesHash, const StringHash& psExtraDefinesHash) const;
     /// Return the effective vertex shader defines, accounting for excludes. Called internally by Renderer.
     String GetEffectiveVertexShaderDefines() const;
     /// Return the effective pixel shader defines, accounting for excludes. Called internally by Renderer.
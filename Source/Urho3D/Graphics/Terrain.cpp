@@ -24,6 +24,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DrawableEvents.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/IndexBuffer.h"
@@ -38,6 +39,7 @@
 #include "../Resource/ResourceEvents.h"
 #include "../Scene/Node.h"
 #include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
 
 #include "../DebugNew.h"
 
@@ -56,6 +58,46 @@ static const unsigned STITCH_NORTH = 1;
 static const unsigned STITCH_SOUTH = 2;
 static const unsigned STITCH_WEST = 4;
 static const unsigned STITCH_EAST = 8;
+static const unsigned VERTEX_FLOATS = 12;
+static const float DEFAULT_STREAMING_DISTANCE = 512.0f;
+static const float TILE_UNLOAD_DISTANCE_FACTOR = 1.25f;
+static const unsigned MAX_CONCURRENT_TILE_LOADS = 4;
+
+/// Patch vertices and LOD errors calculated from the height data, possibly in a worker thread.
+struct TerrainPatchBuild : public RefCounted
+{
+    /// Patch.
+    SharedPtr<TerrainPatch> patch_;
+    /// Patch coordinates.
+    IntVector2 coords_;
+    /// Vertex and height spacing.
+    Vector3 spacing_;
+    /// Patch size, quads per side.
+    int patchSize_{};
+    /// Number of LOD levels.
+    unsigned numLodLevels_{};
+    /// LOD level used for occlusion.
+    unsigned occlusionLevel_{};
+    /// Vertex buffer data.
+    PODVector<float> vertexData_;
+    /// CPU-side position data.
+    SharedArrayPtr<unsigned char> positionData_;
+    /// CPU-side position data for occlusion.
+    SharedArrayPtr<unsigned char> occlusionData_;
+    /// Bounding box.
+    BoundingBox box_;
+    /// LOD errors.
+    PODVector<float> lodErrors_;
+    /// Work item group for waiting on the build.
+    WorkItemGroup group_;
+};
+
+void BuildTerrainPatchWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* terrain = reinterpret_cast<Terrain*>(item->start_);
+    auto* build = reinterpret_cast<TerrainPatchBuild*>(item->aux_);
+    terrain->BuildPatch(*build);
+}
 
 inline void GrowUpdateRegion(IntRect& updateRegion, int x, int y)
 {
@@ -87,6 +129,8 @@ Terrain::Terrain(Context* context) :
     numVertices_(IntVector2::ZERO),
     lastNumVertices_(IntVector2::ZERO),
     numPatches_(IntVector2::ZERO),
+    numTiles_(IntVector2::ZERO),
+    tileSize_(0),
     patchSize_(DEFAULT_PATCH_SIZE),
     lastPatchSize_(0),
     numLodLevels_(1),
@@ -105,17 +149,23 @@ Terrain::Terrain(Context* context) :
     shadowDistance_(0.0f),
     lodBias_(1.0f),
     maxLights_(0),
+    streamingDistance_(DEFAULT_STREAMING_DISTANCE),
     northID_(0),
     southID_(0),
     westID_(0),
     eastID_(0),
     recreateTerrain_(false),
-    neighborsDirty_(false)
+    neighborsDirty_(false),
+    hasDirtyPatches_(false)
 {
     indexBuffer_->SetShadowed(true);
 }
 
-Terrain::~Terrain() = default;
+Terrain::~Terrain()
+{
+    // The patch build work items refer to this terrain
+    WaitPatchBuilds();
+}
 
 void Terrain::RegisterObject(Context* context)
 {
@@ -134,6 +184,11 @@ void Terrain::RegisterObject(Context* context)
     URHO3D_ACCESSOR_ATTRIBUTE("Patch Size", GetPatchSize, SetPatchSizeAttr, int, DEFAULT_PATCH_SIZE, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Max LOD Levels", GetMaxLodLevels, SetMaxLodLevelsAttr, unsigned, MAX_LOD_LEVELS, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Smooth Height Map", bool, smoothing_, MarkTerrainDirty, false, AM_DEFAULT);
+    URHO3D_ATTRIBUTE_EX("Height Map Tile Format", String, heightMapTileFormat_, MarkTerrainDirty, String::EMPTY, AM_DEFAULT);
+    URHO3D_ATTRIBUTE_EX("Height Map Tiles", IntVector2, numTiles_, MarkTerrainDirty, IntVector2::ZERO, AM_DEFAULT);
+    URHO3D_ATTRIBUTE_EX("Height Map Tile Size", int, tileSize_, MarkTerrainDirty, 0, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Streaming Distance", GetStreamingDistance, SetStreamingDistance, float, DEFAULT_STREAMING_DISTANCE,
+        AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Is Occluder", IsOccluder, SetOccluder, bool, false, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Can Be Occluded", IsOccludee, SetOccludee, bool, true, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Cast Shadows", GetCastShadows, SetCastShadows, bool, false, AM_DEFAULT);
@@ -515,6 +570,167 @@ void Terrain::ApplyHeightMap()
         CreateGeometry();
 }
 
+bool Terrain::SetHeights(const IntRect& region, const float* heights)
+{
+    if (!heights)
+    {
+        URHO3D_LOGERROR("Null height data for terrain");
+        return false;
+    }
+    if (!heightData_ && tileHeightData_.Empty())
+    {
+        URHO3D_LOGERROR("Can not set heights of a terrain without height data");
+        return false;
+    }
+    if (region.left_ < 0 || region.top_ < 0 || region.right_ > numVertices_.x_ || region.bottom_ > numVertices_.y_ ||
+        region.left_ >= region.right_ || region.top_ >= region.bottom_)
+    {
+        URHO3D_LOGERROR("Terrain height region is out of bounds");
+        return false;
+    }
+
+    URHO3D_PROFILE(SetTerrainHeights);
+
+    WaitPatchBuilds();
+
+    // Heightmap rows run from north to south, while the height data is stored from south to north
+    int width = region.Width();
+    IntRect dataRegion(region.left_, numVertices_.y_ - region.bottom_, region.right_ - 1, numVertices_.y_ - 1 - region.top_);
+    float* dest = smoothing_ && sourceHeightData_ ? sourceHeightData_.Get() : heightData_.Get();
+
+    for (int y = region.top_; y < region.bottom_; ++y)
+    {
+        const float* src = heights + (y - region.top_) * width;
+        int z = numVertices_.y_ - 1 - y;
+
+        for (int x = region.left_; x < region.right_; ++x)
+        {
+            if (dest)
+                dest[z * numVertices_.x_ + x] = *src;
+            else
+                SetTileHeight(x, z, *src);
+            ++src;
+        }
+    }
+
+    // Smoothing spreads the changed heights to their neighbors
+    if (dest && dest == sourceHeightData_.Get())
+    {
+        dataRegion = IntRect(dataRegion.left_ - 1, dataRegion.top_ - 1, dataRegion.right_ + 1, dataRegion.bottom_ + 1);
+        SmoothHeights(dataRegion);
+    }
+
+    MarkHeightsDirty(dataRegion);
+    UpdateEventSubscription();
+    return true;
+}
+
+bool Terrain::SetHeight(const IntVector2& pixelPosition, float height)
+{
+    return SetHeights(IntRect(pixelPosition.x_, pixelPosition.y_, pixelPosition.x_ + 1, pixelPosition.y_ + 1), &height);
+}
+
+void Terrain::UpdatePatches(bool wait)
+{
+    if (wait)
+        WaitPatchBuilds();
+
+    // Apply finished rebuilds in the order they were started, so that an older build never overwrites a newer one
+    unsigned numFinished = 0;
+    while (numFinished < patchBuilds_.Size() && patchBuilds_[numFinished]->group_.IsCompleted())
+        CommitPatchBuild(*patchBuilds_[numFinished++]);
+    if (numFinished)
+        patchBuilds_.Erase(0, numFinished);
+
+    if (hasDirtyPatches_)
+    {
+        URHO3D_PROFILE(UpdateTerrainPatches);
+
+        PODVector<TerrainPatch*> patches;
+        for (unsigned i = 0; i < dirtyPatches_.Size(); ++i)
+        {
+            if (dirtyPatches_[i] && patches_[i])
+                patches.Push(patches_[i]);
+            dirtyPatches_[i] = false;
+        }
+        hasDirtyPatches_ = false;
+
+        auto* queue = GetSubsystem<WorkQueue>();
+        if (!wait && queue && queue->GetNumThreads())
+        {
+            for (unsigned i = 0; i < patches.Size(); ++i)
+            {
+                SharedPtr<TerrainPatchBuild> build = CreatePatchBuild(patches[i]);
+
+                SharedPtr<WorkItem> item = queue->GetFreeItem();
+                item->priority_ = 0;
+                item->workFunction_ = BuildTerrainPatchWork;
+                item->start_ = this;
+                item->aux_ = build.Get();
+                item->group_ = &build->group_;
+                queue->AddWorkItem(item);
+
+                patchBuilds_.Push(build);
+            }
+        }
+        else
+            BuildPatches(patches);
+    }
+
+    UpdateEventSubscription();
+}
+
+bool Terrain::SetHeightMapTiles(const String& nameFormat, const IntVector2& numTiles, int tileSize)
+{
+    if (!nameFormat.Empty() && (numTiles.x_ <= 0 || numTiles.y_ <= 0 || tileSize < patchSize_ ||
+        !IsPowerOfTwo((unsigned)tileSize)))
+    {
+        URHO3D_LOGERROR("Heightmap tiles must be at least the patch size and a power of two");
+        return false;
+    }
+
+    // Tiles replace the heightmap image
+    if (!nameFormat.Empty() && heightMap_)
+        SetHeightMapInternal(nullptr, false);
+
+    heightMapTileFormat_ = nameFormat;
+    numTiles_ = numTiles;
+    tileSize_ = tileSize;
+
+    CreateGeometry();
+    MarkNetworkUpdate();
+    return true;
+}
+
+void Terrain::SetStreamingFocus(Node* node)
+{
+    streamingFocus_ = node;
+    UpdateEventSubscription();
+}
+
+void Terrain::SetStreamingDistance(float distance)
+{
+    streamingDistance_ = Max(distance, 0.0f);
+    MarkNetworkUpdate();
+}
+
+bool Terrain::IsTileLoaded(int x, int z) const
+{
+    if (x < 0 || z < 0 || x >= numTiles_.x_ || z >= numTiles_.y_)
+        return false;
+
+    auto index = (unsigned)(z * numTiles_.x_ + x);
+    return index < tileHeightData_.Size() && tileHeightData_[index];
+}
+
+void Terrain::OnSceneSet(Scene* scene)
+{
+    if (scene)
+        UpdateEventSubscription();
+    else
+        UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+}
+
 Image* Terrain::GetHeightMap() const
 {
     return heightMap_;
@@ -599,17 +815,17 @@ Vector3 Terrain::GetNormal(const Vector3& worldPosition) const
 
         if (xFrac + zFrac >= 1.0f)
         {
-            n1 = GetRawNormal((unsigned)xPos + 1, (unsigned)zPos + 1);
-            n2 = GetRawNormal((unsigned)xPos, (unsigned)zPos + 1);
-            n3 = GetRawNormal((unsigned)xPos + 1, (unsigned)zPos);
+            n1 = GetRawNormal((unsigned)xPos + 1, (unsigned)zPos + 1, spacing_);
+            n2 = GetRawNormal((unsigned)xPos, (unsigned)zPos + 1, spacing_);
+            n3 = GetRawNormal((unsigned)xPos + 1, (unsigned)zPos, spacing_);
             xFrac = 1.0f - xFrac;
             zFrac = 1.0f - zFrac;
         }
         else
         {
-            n1 = GetRawNormal((unsigned)xPos, (unsigned)zPos);
-            n2 = GetRawNormal((unsigned)xPos + 1, (unsigned)zPos);
-            n3 = GetRawNormal((unsigned)xPos, (unsigned)zPos + 1);
+            n1 = GetRawNormal((unsigned)xPos, (unsigned)zPos, spacing_);
+            n2 = GetRawNormal((unsigned)xPos + 1, (unsigned)zPos, spacing_);
+            n3 = GetRawNormal((unsigned)xPos, (unsigned)zPos + 1, spacing_);
         }
 
         Vector3 n = (n1 * (1.0f - xFrac - zFrac) + n2 * xFrac + n3 * zFrac).Normalized();
@@ -652,114 +868,211 @@ void Terrain::CreatePatchGeometry(TerrainPatch* patch)
 {
     URHO3D_PROFILE(CreatePatchGeometry);
 
-    auto row = (unsigned)(patchSize_ + 1);
-    VertexBuffer* vertexBuffer = patch->GetVertexBuffer();
-    Geometry* geometry = patch->GetGeometry();
-    Geometry* maxLodGeometry = patch->GetMaxLodGeometry();
-    Geometry* occlusionGeometry = patch->GetOcclusionGeometry();
-
-    if (vertexBuffer->GetVertexCount() != row * row)
-        vertexBuffer->SetSize(row * row, MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1 | MASK_TANGENT);
+    SharedPtr<TerrainPatchBuild> build = CreatePatchBuild(patch);
+    BuildPatch(*build);
+    CommitPatchBuild(*build);
+}
 
-    SharedArrayPtr<unsigned char> cpuVertexData(new unsigned char[row * row * sizeof(Vector3)]);
-    SharedArrayPtr<unsigned char> occlusionCpuVertexData(new unsigned char[row * row * sizeof(Vector3)]);
+SharedPtr<TerrainPatchBuild> Terrain::CreatePatchBuild(TerrainPatch* patch) const
+{
+    SharedPtr<TerrainPatchBuild> build(new TerrainPatchBuild());
+    build->patch_ = patch;
+    build->coords_ = patch->GetCoordinates();
+    build->spacing_ = spacing_;
+    build->patchSize_ = patchSize_;
+    build->numLodLevels_ = numLodLevels_;
+    build->occlusionLevel_ = Min(occlusionLodLevel_, numLodLevels_ - 1);
+    return build;
+}
 
-    auto* vertexData = (float*)vertexBuffer->Lock(0, vertexBuffer->GetVertexCount());
-    auto* positionData = (float*)cpuVertexData.Get();
-    auto* occlusionData = (float*)occlusionCpuVertexData.Get();
-    BoundingBox box;
+void Terrain::BuildPatch(TerrainPatchBuild& build) const
+{
+    const IntVector2& coords = build.coords_;
+    const Vector3& spacing = build.spacing_;
+    int patchSize = build.patchSize_;
+    auto row = (unsigned)(patchSize + 1);
+
+    build.vertexData_.Resize(row * row * VERTEX_FLOATS);
+    build.positionData_ = new unsigned char[row * row * sizeof(Vector3)];
+    build.occlusionData_ = new unsigned char[row * row * sizeof(Vector3)];
+    build.box_.Clear();
+
+    float* vertexData = &build.vertexData_[0];
+    auto* positionData = (float*)build.positionData_.Get();
+    auto* occlusionData = (float*)build.occlusionData_.Get();
+    unsigned lodExpand = (1u << build.occlusionLevel_) - 1;
+    int halfLodExpand = (1 << build.occlusionLevel_) / 2;
+
+    for (int z = 0; z <= patchSize; ++z)
+    {
+        for (int x = 0; x <= patchSize; ++x)
+        {
+            int xPos = coords.x_ * patchSize + x;
+            int zPos = coords.y_ * patchSize + z;
+
+            // Position
+            Vector3 position((float)x * spacing.x_, GetRawHeight(xPos, zPos), (float)z * spacing.z_);
+            *vertexData++ = position.x_;
+            *vertexData++ = position.y_;
+            *vertexData++ = position.z_;
+            *positionData++ = position.x_;
+            *positionData++ = position.y_;
+            *positionData++ = position.z_;
+
+            build.box_.Merge(position);
+
+            // For vertices that are part of the occlusion LOD, calculate the minimum height in the neighborhood
+            // to prevent false positive occlusion due to inaccuracy between occlusion LOD & visible LOD
+            float minHeight = position.y_;
+            if (halfLodExpand > 0 && (x & lodExpand) == 0 && (z & lodExpand) == 0)
+            {
+                int minX = Max(xPos - halfLodExpand, 0);
+                int maxX = Min(xPos + halfLodExpand, numVertices_.x_ - 1);
+                int minZ = Max(zPos - halfLodExpand, 0);
+                int maxZ = Min(zPos + halfLodExpand, numVertices_.y_ - 1);
+                for (int nZ = minZ; nZ <= maxZ; ++nZ)
+                {
+                    for (int nX = minX; nX <= maxX; ++nX)
+                        minHeight = Min(minHeight, GetRawHeight(nX, nZ));
+                }
+            }
+            *occlusionData++ = position.x_;
+            *occlusionData++ = minHeight;
+            *occlusionData++ = position.z_;
+
+            // Normal
+            Vector3 normal = GetRawNormal(xPos, zPos, spacing);
+            *vertexData++ = normal.x_;
+            *vertexData++ = normal.y_;
+            *vertexData++ = normal.z_;
+
+            // Texture coordinate
+            Vector2 texCoord((float)xPos / (float)(numVertices_.x_ - 1), 1.0f - (float)zPos / (float)(numVertices_.y_ - 1));
+            *vertexData++ = texCoord.x_;
+            *vertexData++ = texCoord.y_;
+
+            // Tangent
+            Vector3 xyz = (Vector3::RIGHT - normal * normal.DotProduct(Vector3::RIGHT)).Normalized();
+            *vertexData++ = xyz.x_;
+            *vertexData++ = xyz.y_;
+            *vertexData++ = xyz.z_;
+            *vertexData++ = 1.0f;
+        }
+    }
 
-    unsigned occlusionLevel = occlusionLodLevel_;
-    if (occlusionLevel > numLodLevels_ - 1)
-        occlusionLevel = numLodLevels_ - 1;
+    // Calculate LOD errors
+    int xStart = coords.x_ * patchSize;
+    int zStart = coords.y_ * patchSize;
+    int xEnd = xStart + patchSize;
+    int zEnd = zStart + patchSize;
 
-    if (vertexData)
+    build.lodErrors_.Clear();
+    for (unsigned i = 0; i < build.numLodLevels_; ++i)
     {
-        const IntVector2& coords = patch->GetCoordinates();
-        unsigned lodExpand = (1u << (occlusionLevel)) - 1;
-        unsigned halfLodExpand = (1u << (occlusionLevel)) / 2;
+        float maxError = 0.0f;
+        int divisor = 1u << i;
 
-        for (unsigned z = 0; z <= patchSize_; ++z)
+        if (i > 0)
         {
-            for (unsigned x = 0; x <= patchSize_; ++x)
+            for (int z = zStart; z <= zEnd; ++z)
             {
-                int xPos = coords.x_ * patchSize_ + x;
-                int zPos = coords.y_ * patchSize_ + z;
-
-                // Position
-                Vector3 position((float)x * spacing_.x_, GetRawHeight(xPos, zPos), (float)z * spacing_.z_);
-                *vertexData++ = position.x_;
-                *vertexData++ = position.y_;
-                *vertexData++ = position.z_;
-                *positionData++ = position.x_;
-                *positionData++ = position.y_;
-                *positionData++ = position.z_;
-
-                box.Merge(position);
-
-                // For vertices that are part of the occlusion LOD, calculate the minimum height in the neighborhood
-                // to prevent false positive occlusion due to inaccuracy between occlusion LOD & visible LOD
-                float minHeight = position.y_;
-                if (halfLodExpand > 0 && (x & lodExpand) == 0 && (z & lodExpand) == 0)
+                for (int x = xStart; x <= xEnd; ++x)
                 {
-                    int minX = Max(xPos - halfLodExpand, 0);
-                    int maxX = Min(xPos + halfLodExpand, numVertices_.x_ - 1);
-                    int minZ = Max(zPos - halfLodExpand, 0);
-                    int maxZ = Min(zPos + halfLodExpand, numVertices_.y_ - 1);
-                    for (int nZ = minZ; nZ <= maxZ; ++nZ)
+                    if (x % divisor || z % divisor)
                     {
-                        for (int nX = minX; nX <= maxX; ++nX)
-                            minHeight = Min(minHeight, GetRawHeight(nX, nZ));
+                        float error = Abs(GetLodHeight(x, z, i) - GetRawHeight(x, z));
+                        maxError = Max(error, maxError);
                     }
                 }
-                *occlusionData++ = position.x_;
-                *occlusionData++ = minHeight;
-                *occlusionData++ = position.z_;
-
-                // Normal
-                Vector3 normal = GetRawNormal(xPos, zPos);
-                *vertexData++ = normal.x_;
-                *vertexData++ = normal.y_;
-                *vertexData++ = normal.z_;
-
-                // Texture coordinate
-                Vector2 texCoord((float)xPos / (float)(numVertices_.x_ - 1), 1.0f - (float)zPos / (float)(numVertices_.y_ - 1));
-                *vertexData++ = texCoord.x_;
-                *vertexData++ = texCoord.y_;
-
-                // Tangent
-                Vector3 xyz = (Vector3::RIGHT - normal * normal.DotProduct(Vector3::RIGHT)).Normalized();
-                *vertexData++ = xyz.x_;
-                *vertexData++ = xyz.y_;
-                *vertexData++ = xyz.z_;
-                *vertexData++ = 1.0f;
             }
+
+            // Set error to be at least same as (half vertex spacing x LOD) to prevent horizontal stretches getting too inaccurate
+            maxError = Max(maxError, 0.25f * (spacing.x_ + spacing.z_) * (float)(1u << i));
         }
 
-        vertexBuffer->Unlock();
-        vertexBuffer->ClearDataLost();
+        build.lodErrors_.Push(maxError);
     }
+}
+
+void Terrain::BuildPatches(const PODVector<TerrainPatch*>& patches)
+{
+    Vector<SharedPtr<TerrainPatchBuild> > builds(patches.Size());
+    for (unsigned i = 0; i < patches.Size(); ++i)
+        builds[i] = CreatePatchBuild(patches[i]);
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (queue && queue->GetNumThreads() && builds.Size() > 1)
+    {
+        queue->ParallelFor(builds.Size(), 1, [&](unsigned start, unsigned end, unsigned /*threadIndex*/)
+        {
+            for (unsigned i = start; i < end; ++i)
+                BuildPatch(*builds[i]);
+        });
+    }
+    else
+    {
+        for (unsigned i = 0; i < builds.Size(); ++i)
+            BuildPatch(*builds[i]);
+    }
+
+    for (unsigned i = 0; i < builds.Size(); ++i)
+        CommitPatchBuild(*builds[i]);
+}
+
+void Terrain::CommitPatchBuild(TerrainPatchBuild& build)
+{
+    TerrainPatch* patch = build.patch_;
+
+    // The patch may have been removed, or the terrain recreated with a different layout
+    if (!patch->GetNode() || patch->GetOwner() != this || build.patchSize_ != patchSize_ ||
+        build.numLodLevels_ != numLodLevels_)
+        return;
 
-    patch->SetBoundingBox(box);
+    auto row = (unsigned)(patchSize_ + 1);
+    VertexBuffer* vertexBuffer = patch->GetVertexBuffer();
+    Geometry* geometry = patch->GetGeometry();
+    Geometry* maxLodGeometry = patch->GetMaxLodGeometry();
+    Geometry* occlusionGeometry = patch->GetOcclusionGeometry();
+
+    if (vertexBuffer->GetVertexCount() != row * row)
+        vertexBuffer->SetSize(row * row, MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1 | MASK_TANGENT);
+    if (vertexBuffer->SetData(&build.vertexData_[0]))
+        vertexBuffer->ClearDataLost();
+
+    patch->SetBoundingBox(build.box_);
+    patch->GetLodErrors() = build.lodErrors_;
 
     if (drawRanges_.Size())
     {
-        unsigned occlusionDrawRange = occlusionLevel << 4u;
+        unsigned occlusionDrawRange = build.occlusionLevel_ << 4u;
 
         geometry->SetIndexBuffer(indexBuffer_);
         geometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[0].first_, drawRanges_[0].second_, false);
-        geometry->SetRawVertexData(cpuVertexData, MASK_POSITION);
+        geometry->SetRawVertexData(build.positionData_, MASK_POSITION);
         maxLodGeometry->SetIndexBuffer(indexBuffer_);
         maxLodGeometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[0].first_, drawRanges_[0].second_, false);
-        maxLodGeometry->SetRawVertexData(cpuVertexData, MASK_POSITION);
+        maxLodGeometry->SetRawVertexData(build.positionData_, MASK_POSITION);
         occlusionGeometry->SetIndexBuffer(indexBuffer_);
         occlusionGeometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[occlusionDrawRange].first_, drawRanges_[occlusionDrawRange].second_, false);
-        occlusionGeometry->SetRawVertexData(occlusionCpuVertexData, MASK_POSITION);
+        occlusionGeometry->SetRawVertexData(build.occlusionData_, MASK_POSITION);
     }
 
     patch->ResetLod();
 }
 
+void Terrain::WaitPatchBuilds()
+{
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (!queue)
+        return;
+
+    for (unsigned i = 0; i < patchBuilds_.Size(); ++i)
+    {
+        if (!patchBuilds_[i]->group_.IsCompleted())
+            queue->Complete(patchBuilds_[i]->group_);
+    }
+}
+
 void Terrain::UpdatePatchLod(TerrainPatch* patch)
 {
     Geometry* geometry = patch->GetGeometry();
@@ -854,6 +1167,10 @@ void Terrain::CreateGeometry()
 
     URHO3D_PROFILE(CreateTerrainGeometry);
 
+    // Worker threads may be reading the height data. Heightmap tiles are reloaded after the terrain is recreated
+    WaitPatchBuilds();
+    tileHeightData_.Clear();
+
     unsigned prevNumPatches = patches_.Size();
 
     // Determine number of LOD levels
@@ -869,28 +1186,48 @@ void Terrain::CreateGeometry()
     patchWorldSize_ = Vector2(spacing_.x_ * (float)patchSize_, spacing_.z_ * (float)patchSize_);
     bool updateAll = false;
 
-    if (heightMap_)
+    if (!heightMap_ && !heightMapTileFormat_.Empty() && !IsTiled())
+        URHO3D_LOGWARNING("Heightmap tiles must be at least the patch size and a power of two");
+
+    if (heightMap_ || IsTiled())
     {
-        numPatches_ = IntVector2((heightMap_->GetWidth() - 1) / patchSize_, (heightMap_->GetHeight() - 1) / patchSize_);
+        if (heightMap_)
+            numPatches_ = IntVector2((heightMap_->GetWidth() - 1) / patchSize_, (heightMap_->GetHeight() - 1) / patchSize_);
+        else
+            numPatches_ = IntVector2(numTiles_.x_ * (tileSize_ / patchSize_), numTiles_.y_ * (tileSize_ / patchSize_));
         numVertices_ = IntVector2(numPatches_.x_ * patchSize_ + 1, numPatches_.y_ * patchSize_ + 1);
         patchWorldOrigin_ =
             Vector2(-0.5f * (float)numPatches_.x_ * patchWorldSize_.x_, -0.5f * (float)numPatches_.y_ * patchWorldSize_.y_);
         if (numVertices_ != lastNumVertices_ || lastSpacing_ != spacing_ || patchSize_ != lastPatchSize_)
             updateAll = true;
-        auto newDataSize = (unsigned)(numVertices_.x_ * numVertices_.y_);
 
-        // Create new height data if terrain size changed
-        if (!heightData_ || updateAll)
-            heightData_ = new float[newDataSize];
+        if (heightMap_)
+        {
+            auto newDataSize = (unsigned)(numVertices_.x_ * numVertices_.y_);
 
-        // Ensure that the source (unsmoothed) data exists if smoothing is active
-        if (smoothing_ && (!sourceHeightData_ || updateAll))
+            // Create new height data if terrain size changed
+            if (!heightData_ || updateAll)
+            {
+                heightData_ = new float[newDataSize];
+                updateAll = true;
+            }
+
+            // Ensure that the source (unsmoothed) data exists if smoothing is active
+            if (smoothing_ && (!sourceHeightData_ || updateAll))
+            {
+                sourceHeightData_ = new float[newDataSize];
+                updateAll = true;
+            }
+            else if (!smoothing_)
+                sourceHeightData_.Reset();
+        }
+        else
         {
-            sourceHeightData_ = new float[newDataSize];
+            // Heightmap tiles are stored separately and their patches are created as they load
+            heightData_.Reset();
+            sourceHeightData_.Reset();
             updateAll = true;
         }
-        else if (!smoothing_)
-            sourceHeightData_.Reset();
     }
     else
     {
@@ -920,7 +1257,7 @@ void Terrain::CreateGeometry()
             {
                 int x = ToInt(coords[0]);
                 int z = ToInt(coords[1]);
-                if (x < numPatches_.x_ && z < numPatches_.y_)
+                if (x < numPatches_.x_ && z < numPatches_.y_ && heightMap_)
                     nodeOk = true;
             }
 
@@ -930,9 +1267,13 @@ void Terrain::CreateGeometry()
     }
 
     // Keep track of which patches actually need an update
-    PODVector<bool> dirtyPatches((unsigned)(numPatches_.x_ * numPatches_.y_));
-    for (unsigned i = 0; i < dirtyPatches.Size(); ++i)
-        dirtyPatches[i] = updateAll;
+    if (updateAll)
+    {
+        dirtyPatches_.Resize((unsigned)(numPatches_.x_ * numPatches_.y_));
+        for (unsigned i = 0; i < dirtyPatches_.Size(); ++i)
+            dirtyPatches_[i] = true;
+        hasDirtyPatches_ = !dirtyPatches_.Empty();
+    }
 
     patches_.Clear();
 
@@ -999,30 +1340,11 @@ void Terrain::CreateGeometry()
         }
 
         // If updating a region of the heightmap, check which patches change
-        if (!updateAll)
-        {
-            int lodExpand = 1u << (numLodLevels_ - 1);
-            // Expand the right & bottom 1 pixel more, as patches share vertices at the edge
-            updateRegion.left_ -= lodExpand;
-            updateRegion.right_ += lodExpand + 1;
-            updateRegion.top_ -= lodExpand;
-            updateRegion.bottom_ += lodExpand + 1;
-
-            int sX = Max(updateRegion.left_ / patchSize_, 0);
-            int eX = Min(updateRegion.right_ / patchSize_, numPatches_.x_ - 1);
-            int sY = Max(updateRegion.top_ / patchSize_, 0);
-            int eY = Min(updateRegion.bottom_ / patchSize_, numPatches_.y_ - 1);
-            for (int y = sY; y <= eY; ++y)
-            {
-                for (int x = sX; x <= eX; ++x)
-                    dirtyPatches[y * numPatches_.x_ + x] = true;
-            }
-        }
+        if (!updateAll && updateRegion.left_ >= 0)
+            MarkHeightsDirty(updateRegion);
 
         patches_.Reserve((unsigned)(numPatches_.x_ * numPatches_.y_));
 
-        bool enabled = IsEnabledEffective();
-
         {
             URHO3D_PROFILE(CreatePatches);
 
@@ -1030,45 +1352,7 @@ void Terrain::CreateGeometry()
             for (int z = 0; z < numPatches_.y_; ++z)
             {
                 for (int x = 0; x < numPatches_.x_; ++x)
-                {
-                    String nodeName = "Patch_" + String(x) + "_" + String(z);
-                    Node* patchNode = node_->GetChild(nodeName);
-
-                    if (!patchNode)
-                    {
-                        // Create the patch scene node as local and temporary so that it is not unnecessarily serialized to either
-                        // file or replicated over the network
-                        patchNode = node_->CreateTemporaryChild(nodeName, LOCAL);
-                    }
-
-                    patchNode->SetPosition(Vector3(patchWorldOrigin_.x_ + (float)x * patchWorldSize_.x_, 0.0f,
-                        patchWorldOrigin_.y_ + (float)z * patchWorldSize_.y_));
-
-                    auto* patch = patchNode->GetComponent<TerrainPatch>();
-                    if (!patch)
-                    {
-                        patch = patchNode->CreateComponent<TerrainPatch>();
-                        patch->SetOwner(this);
-                        patch->SetCoordinates(IntVector2(x, z));
-
-                        // Copy initial drawable parameters
-                        patch->SetEnabled(enabled);
-                        patch->SetMaterial(material_);
-                        patch->SetDrawDistance(drawDistance_);
-                        patch->SetShadowDistance(shadowDistance_);
-                        patch->SetLodBias(lodBias_);
-                        patch->SetViewMask(viewMask_);
-                        patch->SetLightMask(lightMask_);
-                        patch->SetShadowMask(shadowMask_);
-                        patch->SetZoneMask(zoneMask_);
-                        patch->SetMaxLights(maxLights_);
-                        patch->SetCastShadows(castShadows_);
-                        patch->SetOccluder(occluder_);
-                        patch->SetOccludee(occludee_);
-                    }
-
-                    patches_.Push(WeakPtr<TerrainPatch>(patch));
-                }
+                    patches_.Push(WeakPtr<TerrainPatch>(CreatePatch(x, z)));
             }
         }
 
@@ -1083,44 +1367,34 @@ void Terrain::CreateGeometry()
 
             for (unsigned i = 0; i < patches_.Size(); ++i)
             {
-                if (dirtyPatches[i])
+                if (dirtyPatches_[i])
                 {
-                    TerrainPatch* patch = patches_[i];
-                    const IntVector2& coords = patch->GetCoordinates();
-                    int startX = coords.x_ * patchSize_;
-                    int endX = startX + patchSize_;
-                    int startZ = coords.y_ * patchSize_;
-                    int endZ = startZ + patchSize_;
-
-                    for (int z = startZ; z <= endZ; ++z)
-                    {
-                        for (int x = startX; x <= endX; ++x)
-                        {
-                            float smoothedHeight = (
-                                GetSourceHeight(x - 1, z - 1) + GetSourceHeight(x, z - 1) * 2.0f + GetSourceHeight(x + 1, z - 1) +
-                                GetSourceHeight(x - 1, z) * 2.0f + GetSourceHeight(x, z) * 4.0f + GetSourceHeight(x + 1, z) * 2.0f +
-                                GetSourceHeight(x - 1, z + 1) + GetSourceHeight(x, z + 1) * 2.0f + GetSourceHeight(x + 1, z + 1)
-                            ) / 16.0f;
-
-                            heightData_[z * numVertices_.x_ + x] = smoothedHeight;
-                        }
-                    }
+                    const IntVector2& coords = patches_[i]->GetCoordinates();
+                    SmoothHeights(IntRect(coords.x_ * patchSize_, coords.y_ * patchSize_, (coords.x_ + 1) * patchSize_,
+                        (coords.y_ + 1) * patchSize_));
                 }
             }
         }
 
+        UpdatePatches(true);
+
         for (unsigned i = 0; i < patches_.Size(); ++i)
-        {
-            TerrainPatch* patch = patches_[i];
+            SetPatchNeighbors(patches_[i]);
+    }
+    else if (IsTiled())
+    {
+        // Patches are created as the heightmap tiles around the streaming focus load
+        patches_.Resize((unsigned)(numPatches_.x_ * numPatches_.y_));
+        tileHeightData_.Resize((unsigned)(numTiles_.x_ * numTiles_.y_));
+        hasDirtyPatches_ = false;
+        for (unsigned i = 0; i < dirtyPatches_.Size(); ++i)
+            dirtyPatches_[i] = false;
 
-            if (dirtyPatches[i])
-            {
-                CreatePatchGeometry(patch);
-                CalculateLodErrors(patch);
-            }
+        if (updateAll)
+            CreateIndexData();
 
-            SetPatchNeighbors(patch);
-        }
+        UpdatePatches(true);
+        UpdateStreaming();
     }
 
     // Send event only if new geometry was generated, or the old was cleared
@@ -1134,6 +1408,47 @@ void Terrain::CreateGeometry()
     }
 }
 
+TerrainPatch* Terrain::CreatePatch(int x, int z)
+{
+    String nodeName = "Patch_" + String(x) + "_" + String(z);
+    Node* patchNode = node_->GetChild(nodeName);
+
+    if (!patchNode)
+    {
+        // Create the patch scene node as local and temporary so that it is not unnecessarily serialized to either
+        // file or replicated over the network
+        patchNode = node_->CreateTemporaryChild(nodeName, LOCAL);
+    }
+
+    patchNode->SetPosition(Vector3(patchWorldOrigin_.x_ + (float)x * patchWorldSize_.x_, 0.0f,
+        patchWorldOrigin_.y_ + (float)z * patchWorldSize_.y_));
+
+    auto* patch = patchNode->GetComponent<TerrainPatch>();
+    if (!patch)
+    {
+        patch = patchNode->CreateComponent<TerrainPatch>();
+        patch->SetOwner(this);
+        patch->SetCoordinates(IntVector2(x, z));
+
+        // Copy initial drawable parameters
+        patch->SetEnabled(IsEnabledEffective());
+        patch->SetMaterial(material_);
+        patch->SetDrawDistance(drawDistance_);
+        patch->SetShadowDistance(shadowDistance_);
+        patch->SetLodBias(lodBias_);
+        patch->SetViewMask(viewMask_);
+        patch->SetLightMask(lightMask_);
+        patch->SetShadowMask(shadowMask_);
+        patch->SetZoneMask(zoneMask_);
+        patch->SetMaxLights(maxLights_);
+        patch->SetCastShadows(castShadows_);
+        patch->SetOccluder(occluder_);
+        patch->SetOccludee(occludee_);
+    }
+
+    return patch;
+}
+
 void Terrain::CreateIndexData()
 {
     URHO3D_PROFILE(CreateIndexData);
@@ -1296,12 +1611,16 @@ void Terrain::CreateIndexData()
 
 float Terrain::GetRawHeight(int x, int z) const
 {
-    if (!heightData_)
+    if (!heightData_ && tileHeightData_.Empty())
         return 0.0f;
 
     x = Clamp(x, 0, numVertices_.x_ - 1);
     z = Clamp(z, 0, numVertices_.y_ - 1);
-    return heightData_[z * numVertices_.x_ + x];
+    if (heightData_)
+        return heightData_[z * numVertices_.x_ + x];
+
+    const float* height = GetTileHeightPtr(x, z);
+    return height ? *height : 0.0f;
 }
 
 float Terrain::GetSourceHeight(int x, int z) const
@@ -1339,7 +1658,7 @@ float Terrain::GetLodHeight(int x, int z, unsigned lodLevel) const
     return h1 * (1.0f - xFrac - zFrac) + h2 * xFrac + h3 * zFrac;
 }
 
-Vector3 Terrain::GetRawNormal(int x, int z) const
+Vector3 Terrain::GetRawNormal(int x, int z, const Vector3& spacing) const
 {
     float baseHeight = GetRawHeight(x, z);
     float nSlope = GetRawHeight(x, z - 1) - baseHeight;
@@ -1350,7 +1669,7 @@ Vector3 Terrain::GetRawNormal(int x, int z) const
     float swSlope = GetRawHeight(x - 1, z + 1) - baseHeight;
     float wSlope = GetRawHeight(x - 1, z) - baseHeight;
     float nwSlope = GetRawHeight(x - 1, z - 1) - baseHeight;
-    float up = 0.5f * (spacing_.x_ + spacing_.z_);
+    float up = 0.5f * (spacing.x_ + spacing.z_);
 
     return (Vector3(0.0f, up, nSlope) +
             Vector3(-neSlope, up, neSlope) +
@@ -1362,47 +1681,312 @@ Vector3 Terrain::GetRawNormal(int x, int z) const
             Vector3(nwSlope, up, nwSlope)).Normalized();
 }
 
-void Terrain::CalculateLodErrors(TerrainPatch* patch)
+void Terrain::SmoothHeights(const IntRect& region)
 {
-    URHO3D_PROFILE(CalculateLodErrors);
+    int startX = Max(region.left_, 0);
+    int endX = Min(region.right_, numVertices_.x_ - 1);
+    int startZ = Max(region.top_, 0);
+    int endZ = Min(region.bottom_, numVertices_.y_ - 1);
 
-    const IntVector2& coords = patch->GetCoordinates();
-    PODVector<float>& lodErrors = patch->GetLodErrors();
-    lodErrors.Clear();
-    lodErrors.Reserve(numLodLevels_);
+    for (int z = startZ; z <= endZ; ++z)
+    {
+        for (int x = startX; x <= endX; ++x)
+        {
+            float smoothedHeight = (
+                GetSourceHeight(x - 1, z - 1) + GetSourceHeight(x, z - 1) * 2.0f + GetSourceHeight(x + 1, z - 1) +
+                GetSourceHeight(x - 1, z) * 2.0f + GetSourceHeight(x, z) * 4.0f + GetSourceHeight(x + 1, z) * 2.0f +
+                GetSourceHeight(x - 1, z + 1) + GetSourceHeight(x, z + 1) * 2.0f + GetSourceHeight(x + 1, z + 1)
+            ) / 16.0f;
 
-    int xStart = coords.x_ * patchSize_;
-    int zStart = coords.y_ * patchSize_;
-    int xEnd = xStart + patchSize_;
-    int zEnd = zStart + patchSize_;
+            heightData_[z * numVertices_.x_ + x] = smoothedHeight;
+        }
+    }
+}
 
-    for (unsigned i = 0; i < numLodLevels_; ++i)
+void Terrain::MarkHeightsDirty(const IntRect& region)
+{
+    if (dirtyPatches_.Size() != patches_.Size())
+        return;
+
+    int lodExpand = 1u << (numLodLevels_ - 1);
+    // Expand the right & bottom 1 pixel more, as patches share vertices at the edge
+    int sX = Max((region.left_ - lodExpand) / patchSize_, 0);
+    int eX = Min((region.right_ + lodExpand + 1) / patchSize_, numPatches_.x_ - 1);
+    int sY = Max((region.top_ - lodExpand) / patchSize_, 0);
+    int eY = Min((region.bottom_ + lodExpand + 1) / patchSize_, numPatches_.y_ - 1);
+    for (int y = sY; y <= eY; ++y)
     {
-        float maxError = 0.0f;
-        int divisor = 1u << i;
+        for (int x = sX; x <= eX; ++x)
+            dirtyPatches_[y * numPatches_.x_ + x] = true;
+    }
 
-        if (i > 0)
+    hasDirtyPatches_ = true;
+}
+
+bool Terrain::IsTiled() const
+{
+    return !heightMapTileFormat_.Empty() && numTiles_.x_ > 0 && numTiles_.y_ > 0 && tileSize_ >= patchSize_ &&
+        IsPowerOfTwo((unsigned)tileSize_);
+}
+
+String Terrain::GetTileName(int x, int z) const
+{
+    String name = heightMapTileFormat_;
+    name.Replace("{x}", String(x));
+    name.Replace("{z}", String(z));
+    return name;
+}
+
+float* Terrain::GetTileHeightPtr(int x, int z) const
+{
+    int tileX = Min(x / tileSize_, numTiles_.x_ - 1);
+    int tileZ = Min(z / tileSize_, numTiles_.y_ - 1);
+
+    // Tiles overlap by one pixel, so vertices on a tile's west or south edge can also be found from the neighbor tile
+    for (int dz = 0; dz <= 1; ++dz)
+    {
+        for (int dx = 0; dx <= 1; ++dx)
         {
-            for (int z = zStart; z <= zEnd; ++z)
+            int localX = x - (tileX - dx) * tileSize_;
+            int localZ = z - (tileZ - dz) * tileSize_;
+            if (tileX - dx < 0 || tileZ - dz < 0 || localX > tileSize_ || localZ > tileSize_)
+                continue;
+
+            float* data = tileHeightData_[(tileZ - dz) * numTiles_.x_ + tileX - dx].Get();
+            if (data)
+                return data + localZ * (tileSize_ + 1) + localX;
+        }
+    }
+
+    return nullptr;
+}
+
+void Terrain::SetTileHeight(int x, int z, float height)
+{
+    int tileX = Min(x / tileSize_, numTiles_.x_ - 1);
+    int tileZ = Min(z / tileSize_, numTiles_.y_ - 1);
+
+    for (int dz = 0; dz <= 1; ++dz)
+    {
+        for (int dx = 0; dx <= 1; ++dx)
+        {
+            int localX = x - (tileX - dx) * tileSize_;
+            int localZ = z - (tileZ - dz) * tileSize_;
+            if (tileX - dx < 0 || tileZ - dz < 0 || localX > tileSize_ || localZ > tileSize_)
+                continue;
+
+            float* data = tileHeightData_[(tileZ - dz) * numTiles_.x_ + tileX - dx].Get();
+            if (data)
+                data[localZ * (tileSize_ + 1) + localX] = height;
+        }
+    }
+}
+
+float Terrain::GetTileDistance(int x, int z, const Vector3& position) const
+{
+    Vector2 tileWorldSize(spacing_.x_ * (float)tileSize_, spacing_.z_ * (float)tileSize_);
+    float minX = patchWorldOrigin_.x_ + (float)x * tileWorldSize.x_;
+    float minZ = patchWorldOrigin_.y_ + (float)z * tileWorldSize.y_;
+    float dx = Max(Max(minX - position.x_, position.x_ - minX - tileWorldSize.x_), 0.0f);
+    float dz = Max(Max(minZ - position.z_, position.z_ - minZ - tileWorldSize.y_), 0.0f);
+    return sqrtf(dx * dx + dz * dz);
+}
+
+void Terrain::UpdateStreaming()
+{
+    if (!node_ || !streamingFocus_ || tileHeightData_.Empty())
+        return;
+
+    URHO3D_PROFILE(UpdateTerrainStreaming);
+
+    Vector3 position = node_->GetWorldTransform().Inverse() * streamingFocus_->GetWorldPosition();
+
+    // Unload tiles that are out of range. Use a larger distance than for loading to avoid reloading at the boundary
+    for (int z = 0; z < numTiles_.y_; ++z)
+    {
+        for (int x = 0; x < numTiles_.x_; ++x)
+        {
+            if (tileHeightData_[z * numTiles_.x_ + x] &&
+                GetTileDistance(x, z, position) > streamingDistance_ * TILE_UNLOAD_DISTANCE_FACTOR)
+                UnloadTile(x, z);
+        }
+    }
+
+    if (loadingTiles_.Size() >= MAX_CONCURRENT_TILE_LOADS)
+        return;
+
+    // Request the nearest missing tiles in range
+    PODVector<Pair<float, unsigned> > candidates;
+    for (int z = 0; z < numTiles_.y_; ++z)
+    {
+        for (int x = 0; x < numTiles_.x_; ++x)
+        {
+            auto index = (unsigned)(z * numTiles_.x_ + x);
+            if (tileHeightData_[index])
+                continue;
+
+            float distance = GetTileDistance(x, z, position);
+            if (distance > streamingDistance_)
+                continue;
+
+            bool loading = false;
+            for (HashMap<StringHash, unsigned>::ConstIterator i = loadingTiles_.Begin(); i != loadingTiles_.End(); ++i)
             {
-                for (int x = xStart; x <= xEnd; ++x)
+                if (i->second_ == index)
                 {
-                    if (x % divisor || z % divisor)
-                    {
-                        float error = Abs(GetLodHeight(x, z, i) - GetRawHeight(x, z));
-                        maxError = Max(error, maxError);
-                    }
+                    loading = true;
+                    break;
                 }
             }
+            if (!loading)
+                candidates.Push(MakePair(distance, index));
+        }
+    }
 
-            // Set error to be at least same as (half vertex spacing x LOD) to prevent horizontal stretches getting too inaccurate
-            maxError = Max(maxError, 0.25f * (spacing_.x_ + spacing_.z_) * (float)(1u << i));
+    Sort(candidates.Begin(), candidates.End());
+    for (unsigned i = 0; i < candidates.Size() && loadingTiles_.Size() < MAX_CONCURRENT_TILE_LOADS; ++i)
+    {
+        unsigned index = candidates[i].second_;
+        RequestTile(index % numTiles_.x_, index / numTiles_.x_);
+    }
+}
+
+void Terrain::RequestTile(int x, int z)
+{
+    auto* cache = GetSubsystem<ResourceCache>();
+    String name = cache->SanitateResourceName(GetTileName(x, z));
+
+    // Tiles without an image are flat, which is not an error
+    if (!cache->Exists(name))
+    {
+        SetTileHeightMap(x, z, nullptr);
+        return;
+    }
+
+    auto* image = cache->GetExistingResource<Image>(name);
+    if (!image)
+    {
+        // The loaded event is sent also if the image was already queued for loading elsewhere
+        cache->BackgroundLoadResource<Image>(name);
+
+        // Without threading support the image has been loaded synchronously
+        image = cache->GetExistingResource<Image>(name);
+        if (!image)
+        {
+            if (!HasSubscribedToEvent(E_RESOURCEBACKGROUNDLOADED))
+                SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, URHO3D_HANDLER(Terrain, HandleTileLoaded));
+            loadingTiles_[StringHash(name)] = (unsigned)(z * numTiles_.x_ + x);
+            return;
+        }
+    }
+
+    SetTileHeightMap(x, z, image);
+    cache->ReleaseResource(Image::GetTypeStatic(), name);
+}
+
+void Terrain::SetTileHeightMap(int x, int z, Image* image)
+{
+    auto row = (unsigned)(tileSize_ + 1);
+    if (image && (image->IsCompressed() || image->GetWidth() != (int)row || image->GetHeight() != (int)row))
+    {
+        URHO3D_LOGERROR("Heightmap tile " + image->GetName() + " must be an uncompressed image of " + String(row) + "x" +
+            String(row) + " pixels");
+        image = nullptr;
+    }
+
+    WaitPatchBuilds();
+
+    SharedArrayPtr<float> heights(new float[row * row]);
+    float* dest = heights.Get();
+    if (image)
+    {
+        const unsigned char* src = image->GetData();
+        unsigned imgComps = image->GetComponents();
+
+        // Image rows run from north to south. If more than 1 component, use the green channel for more accuracy
+        for (unsigned tz = 0; tz < row; ++tz)
+        {
+            const unsigned char* srcRow = src + (row - 1 - tz) * row * imgComps;
+            for (unsigned tx = 0; tx < row; ++tx)
+            {
+                const unsigned char* pixel = srcRow + tx * imgComps;
+                float height = imgComps == 1 ? (float)pixel[0] : (float)pixel[0] + (float)pixel[1] / 256.0f;
+                *dest++ = height * spacing_.y_;
+            }
         }
+    }
+    else
+    {
+        for (unsigned i = 0; i < row * row; ++i)
+            dest[i] = 0.0f;
+    }
+
+    tileHeightData_[z * numTiles_.x_ + x] = heights;
+
+    // Create the tile's patches and link them with the neighbor patches
+    int patchesPerTile = tileSize_ / patchSize_;
+    int startX = x * patchesPerTile;
+    int startZ = z * patchesPerTile;
+    for (int pz = startZ; pz < startZ + patchesPerTile; ++pz)
+    {
+        for (int px = startX; px < startX + patchesPerTile; ++px)
+            patches_[pz * numPatches_.x_ + px] = CreatePatch(px, pz);
+    }
+    for (int pz = startZ - 1; pz <= startZ + patchesPerTile; ++pz)
+    {
+        for (int px = startX - 1; px <= startX + patchesPerTile; ++px)
+            SetPatchNeighbors(GetPatch(px, pz));
+    }
+
+    // Also rebuild the edges of loaded neighbor tiles, as their normals depend on this tile
+    MarkHeightsDirty(IntRect(x * tileSize_ - 1, z * tileSize_ - 1, (x + 1) * tileSize_ + 1, (z + 1) * tileSize_ + 1));
+    UpdateEventSubscription();
+}
+
+void Terrain::UnloadTile(int x, int z)
+{
+    WaitPatchBuilds();
 
-        lodErrors.Push(maxError);
+    int patchesPerTile = tileSize_ / patchSize_;
+    int startX = x * patchesPerTile;
+    int startZ = z * patchesPerTile;
+    for (int pz = startZ; pz < startZ + patchesPerTile; ++pz)
+    {
+        for (int px = startX; px < startX + patchesPerTile; ++px)
+        {
+            auto index = (unsigned)(pz * numPatches_.x_ + px);
+            TerrainPatch* patch = patches_[index];
+            if (patch)
+                node_->RemoveChild(patch->GetNode());
+            patches_[index].Reset();
+            dirtyPatches_[index] = false;
+        }
+    }
+
+    tileHeightData_[z * numTiles_.x_ + x].Reset();
+
+    for (int pz = startZ - 1; pz <= startZ + patchesPerTile; ++pz)
+    {
+        for (int px = startX - 1; px <= startX + patchesPerTile; ++px)
+            SetPatchNeighbors(GetPatch(px, pz));
     }
 }
 
+void Terrain::UpdateEventSubscription()
+{
+    Scene* scene = GetScene();
+    if (!scene)
+        return;
+
+    bool needUpdate = hasDirtyPatches_ || !patchBuilds_.Empty() || (streamingFocus_ && !tileHeightData_.Empty());
+    bool subscribed = HasSubscribedToEvent(scene, E_SCENEPOSTUPDATE);
+
+    if (needUpdate && !subscribed)
+        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(Terrain, HandleScenePostUpdate));
+    else if (!needUpdate && subscribed)
+        UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
+}
+
 void Terrain::SetPatchNeighbors(TerrainPatch* patch)
 {
     if (!patch)
@@ -1428,6 +2012,9 @@ bool Terrain::SetHeightMapInternal(Image* image, bool recreateNow)
         SubscribeToEvent(image, E_RELOADFINISHED, URHO3D_HANDLER(Terrain, HandleHeightMapReloadFinished));
 
     heightMap_ = image;
+    // A heightmap image replaces heightmap tiles
+    if (image)
+        heightMapTileFormat_.Clear();
 
     if (recreateNow)
         CreateGeometry();
@@ -1442,6 +2029,41 @@ void Terrain::HandleHeightMapReloadFinished(StringHash /*eventType*/, VariantMap
     CreateGeometry();
 }
 
+void Terrain::HandleScenePostUpdate(StringHash /*eventType*/, VariantMap& eventData)
+{
+    UpdateStreaming();
+    UpdatePatches();
+}
+
+void Terrain::HandleTileLoaded(StringHash /*eventType*/, VariantMap& eventData)
+{
+    using namespace ResourceBackgroundLoaded;
+
+    const String& name = eventData[P_RESOURCENAME].GetString();
+    HashMap<StringHash, unsigned>::Iterator i = loadingTiles_.Find(StringHash(name));
+    if (i == loadingTiles_.End())
+        return;
+
+    unsigned index = i->second_;
+    loadingTiles_.Erase(i);
+
+    auto* resource = static_cast<Resource*>(eventData[P_RESOURCE].GetPtr());
+    bool success = eventData[P_SUCCESS].GetBool() && resource && resource->GetType() == Image::GetTypeStatic();
+
+    // The terrain may have been recreated while the tile was loading
+    auto* cache = GetSubsystem<ResourceCache>();
+    if (numTiles_.x_ > 0 && index < tileHeightData_.Size() && !tileHeightData_[index])
+    {
+        int x = index % numTiles_.x_;
+        int z = index / numTiles_.x_;
+        if (cache->SanitateResourceName(GetTileName(x, z)) == name)
+            SetTileHeightMap(x, z, success ? static_cast<Image*>(resource) : nullptr);
+    }
+
+    if (success)
+        cache->ReleaseResource(Image::GetTypeStatic(), name);
+}
+
 void Terrain::HandleNeighborTerrainCreated(StringHash /*eventType*/, VariantMap& eventData)
 {
     UpdateEdgePatchNeighbors();
@@ -33,6 +33,8 @@ class IndexBuffer;
 class Material;
 class Node;
 class TerrainPatch;
+struct TerrainPatchBuild;
+struct WorkItem;
 
 /// Heightmap terrain component.
 class URHO3D_API Terrain : public Component
@@ -100,6 +102,18 @@ public:
     void SetOccludee(bool enable);
     /// Apply changes from the heightmap image.
     void ApplyHeightMap();
+    /// Set heights of a heightmap region in pixel coordinates, as returned by WorldToHeightMap(). Heights are in local units and in row-major order. The heightmap image is not modified. Affected patches are rebuilt in worker threads if available and updated on a following scene post-update. Return true if successful.
+    bool SetHeights(const IntRect& region, const float* heights);
+    /// Set height at a heightmap pixel position. Return true if successful.
+    bool SetHeight(const IntVector2& pixelPosition, float height);
+    /// Rebuild the patches affected by height changes and apply the finished rebuilds. If wait is true, finish all rebuilds immediately. Called automatically on scene post-update.
+    void UpdatePatches(bool wait = false);
+    /// Set heightmap tiles to stream instead of a single heightmap image. {x} and {z} in the name format are replaced with the tile coordinates, with z increasing northward. Tiles are images of tile size + 1 pixels per side and overlap their neighbors by one pixel. Missing tiles are flat. Tiles are not smoothed and height edits are lost when a tile is unloaded. Return true if successful.
+    bool SetHeightMapTiles(const String& nameFormat, const IntVector2& numTiles, int tileSize);
+    /// Set node around which heightmap tiles are loaded. Without a focus no tiles are loaded.
+    void SetStreamingFocus(Node* node);
+    /// Set distance from the streaming focus within which heightmap tiles are loaded, in local units.
+    void SetStreamingDistance(float distance);
 
     /// Return patch quads per side.
     int GetPatchSize() const { return patchSize_; }
@@ -122,6 +136,26 @@ public:
     /// Return whether smoothing is in use.
     bool GetSmoothing() const { return smoothing_; }
 
+    /// Return heightmap tile name format.
+    const String& GetHeightMapTileFormat() const { return heightMapTileFormat_; }
+
+    /// Return number of heightmap tiles.
+    const IntVector2& GetNumHeightMapTiles() const { return numTiles_; }
+
+    /// Return heightmap tile size in quads.
+    int GetHeightMapTileSize() const { return tileSize_; }
+
+    /// Return streaming focus node.
+    Node* GetStreamingFocus() const { return streamingFocus_; }
+
+    /// Return streaming distance.
+    float GetStreamingDistance() const { return streamingDistance_; }
+
+    /// Return number of patch rebuilds not yet applied.
+    unsigned GetNumPendingPatchBuilds() const { return patchBuilds_.Size(); }
+
+    /// Return whether a heightmap tile is loaded.
+    bool IsTileLoaded(int x, int z) const;
     /// Return heightmap image.
     Image* GetHeightMap() const;
     /// Return material.
@@ -153,7 +187,7 @@ public:
     /// Return east neighbor terrain.
     Terrain* GetEastNeighbor() const { return east_; }
 
-    /// Return raw height data.
+    /// Return raw height data. Null when using heightmap tiles.
     SharedArrayPtr<float> GetHeightData() const { return heightData_; }
 
     /// Return draw distance.
@@ -211,11 +245,17 @@ public:
     /// Return material attribute.
     ResourceRef GetMaterialAttr() const;
 
+protected:
+    /// Handle scene being assigned.
+    void OnSceneSet(Scene* scene) override;
+
 private:
     /// Regenerate terrain geometry.
     void CreateGeometry();
     /// Create index data shared by all patches.
     void CreateIndexData();
+    /// Create or reuse the node and component of a patch.
+    TerrainPatch* CreatePatch(int x, int z);
     /// Return an uninterpolated terrain height value, clamping to edges.
     float GetRawHeight(int x, int z) const;
     /// Return a source terrain height value, clamping to edges. The source data is used for smoothing.
@@ -223,9 +263,41 @@ private:
     /// Return interpolated height for a specific LOD level.
     float GetLodHeight(int x, int z, unsigned lodLevel) const;
     /// Get slope-based terrain normal at position.
-    Vector3 GetRawNormal(int x, int z) const;
-    /// Calculate LOD errors for a patch.
-    void CalculateLodErrors(TerrainPatch* patch);
+    Vector3 GetRawNormal(int x, int z, const Vector3& spacing) const;
+    /// Recalculate smoothed heights in a height data region. The region includes its right and bottom edges.
+    void SmoothHeights(const IntRect& region);
+    /// Mark the patches using a height data region dirty. The region includes its right and bottom edges.
+    void MarkHeightsDirty(const IntRect& region);
+    /// Create a patch build with the current terrain parameters.
+    SharedPtr<TerrainPatchBuild> CreatePatchBuild(TerrainPatch* patch) const;
+    /// Calculate patch vertices and LOD errors from the height data. May be called from a worker thread.
+    void BuildPatch(TerrainPatchBuild& build) const;
+    /// Build patches immediately, in parallel if worker threads are available.
+    void BuildPatches(const PODVector<TerrainPatch*>& patches);
+    /// Apply a finished build to its patch.
+    void CommitPatchBuild(TerrainPatchBuild& build);
+    /// Wait for the patch rebuilds in worker threads to finish. Must be called before modifying the height data.
+    void WaitPatchBuilds();
+    /// Return whether valid heightmap tiles are in use.
+    bool IsTiled() const;
+    /// Return heightmap tile file name.
+    String GetTileName(int x, int z) const;
+    /// Return tile height data at a height data position, or null if no tile containing it is loaded.
+    float* GetTileHeightPtr(int x, int z) const;
+    /// Set height in all loaded tiles containing a height data position.
+    void SetTileHeight(int x, int z, float height);
+    /// Return distance on the XZ plane from a local position to a heightmap tile.
+    float GetTileDistance(int x, int z, const Vector3& position) const;
+    /// Load and unload heightmap tiles around the streaming focus.
+    void UpdateStreaming();
+    /// Start loading a heightmap tile.
+    void RequestTile(int x, int z);
+    /// Copy heights from a loaded heightmap tile image and create its patches. A null image creates a flat tile.
+    void SetTileHeightMap(int x, int z, Image* image);
+    /// Remove a heightmap tile's height data and patches.
+    void UnloadTile(int x, int z);
+    /// Subscribe to or unsubscribe from scene post-update as necessary.
+    void UpdateEventSubscription();
     /// Set neighbors for a patch.
     void SetPatchNeighbors(TerrainPatch* patch);
     /// Set heightmap image and optionally recreate the geometry immediately. Return true if successful.
@@ -236,6 +308,12 @@ private:
     void HandleNeighborTerrainCreated(StringHash eventType, VariantMap& eventData);
     /// Update edge patch neighbors when neighbor terrain(s) change or are recreated.
     void UpdateEdgePatchNeighbors();
+    /// Handle scene post-update event.
+    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle heightmap tile background load finished.
+    void HandleTileLoaded(StringHash eventType, VariantMap& eventData);
+    /// Patch build work function.
+    friend void BuildTerrainPatchWork(const WorkItem* item, unsigned threadIndex);
     /// Mark neighbors dirty.
     void MarkNeighborsDirty() { neighborsDirty_ = true; }
     /// Mark terrain dirty.
@@ -251,8 +329,20 @@ private:
     SharedArrayPtr<float> sourceHeightData_;
     /// Material.
     SharedPtr<Material> material_;
-    /// Terrain patches.
+    /// Terrain patches. Null for patches of heightmap tiles that are not loaded.
     Vector<WeakPtr<TerrainPatch> > patches_;
+    /// Patches whose height data has changed since they were built.
+    PODVector<bool> dirtyPatches_;
+    /// Patch rebuilds in worker threads, in the order they were started.
+    Vector<SharedPtr<TerrainPatchBuild> > patchBuilds_;
+    /// Height data of heightmap tiles. Null when not loaded.
+    Vector<SharedArrayPtr<float> > tileHeightData_;
+    /// Heightmap tile indices being background loaded, by tile name.
+    HashMap<StringHash, unsigned> loadingTiles_;
+    /// Heightmap tile name format.
+    String heightMapTileFormat_;
+    /// Streaming focus node.
+    WeakPtr<Node> streamingFocus_;
     /// Draw ranges for different LODs and stitching combinations.
     PODVector<Pair<unsigned, unsigned> > drawRanges_;
     /// North neighbor terrain.
@@ -277,6 +367,10 @@ private:
     IntVector2 lastNumVertices_;
     /// Terrain size in patches.
     IntVector2 numPatches_;
+    /// Number of heightmap tiles.
+    IntVector2 numTiles_;
+    /// Heightmap tile size, quads per side.
+    int tileSize_;
     /// Patch size, quads per side.
     int patchSize_;
     /// Patch size at the time of last update.
@@ -313,6 +407,8 @@ private:
     float lodBias_;
     /// Maximum lights.
     unsigned maxLights_;
+    /// Heightmap tile streaming distance.
+    float streamingDistance_;
     /// Node ID of north neighbor.
     unsigned northID_;
     /// Node ID of south neighbor.
@@ -325,6 +421,8 @@ private:
     bool recreateTerrain_;
     /// Terrain neighbor attributes dirty flag.
     bool neighborsDirty_;
+    /// Patches need rebuild flag.
+    bool hasDirtyPatches_;
 };
 
 }
@@ -109,6 +109,26 @@ bool Texture2D::EndLoad()
     return success;
 }
 
+unsigned Texture2D::Demote()
+{
+    // Only static textures loaded from a file can be demoted, as they are reloaded with the mip levels skipped. Leave at
+    // least 4x4 pixels
+    if (!graphics_ || graphics_->IsDeviceLost() || usage_ != TEXTURE_STATIC || GetName().Empty() || levels_ < 2 ||
+        width_ < 8 || height_ < 8 || !GetSubsystem<ResourceCache>()->Exists(GetName()))
+        return GetMemoryUse();
+
+    // Skipping the top mip level leaves a quarter of the data
+    ++demotedMips_;
+    return GetMemoryUse() / 4;
+}
+
+unsigned Texture2D::GetRestoredMemoryUse() const
+{
+    // Each skipped mip level quadruples the data when restored
+    unsigned long long memoryUse = (unsigned long long)GetMemoryUse() << Min(2 * demotedMips_, 32U);
+    return (unsigned)Min(memoryUse, (unsigned long long)M_MAX_UNSIGNED);
+}
+
 bool Texture2D::SetSize(int width, int height, unsigned format, TextureUsage usage, int multiSample, bool autoResolve)
 {
     if (width <= 0 || height <= 0)
@@ -55,6 +55,14 @@ public:
     void OnDeviceReset() override;
     /// Release the texture.
     void Release() override;
+    /// Prepare to reduce memory use by skipping one more mip level on the next load. Return the expected memory use after reloading, or the current memory use if can not be demoted.
+    unsigned Demote() override;
+    /// Clear demotion so that the next load restores all mip levels.
+    void ClearDemotion() override { demotedMips_ = 0; }
+    /// Return whether mip levels have been skipped by demotion.
+    bool IsDemoted() const override { return demotedMips_ != 0; }
+    /// Return the expected memory use after restoring the skipped mip levels.
+    unsigned GetRestoredMemoryUse() const override;
 
     /// Set size, format, usage and multisampling parameters for rendertargets. Zero size will follow application window size. Return true if successful.
     /** Autoresolve true means the multisampled texture will be automatically resolved to 1-sample after being rendered to and before being sampled as a texture.
@@ -90,6 +98,8 @@ private:
     SharedPtr<Image> loadImage_;
     /// Parameter file acquired during BeginLoad.
     SharedPtr<XMLFile> loadParameters_;
+    /// Mip levels skipped in addition to the quality setting due to demotion.
+    unsigned demotedMips_{};
 };
 
 }
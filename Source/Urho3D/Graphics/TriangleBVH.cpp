@@ -0,0 +1,342 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/TriangleBVH.h"
+#include "../Math/Frustum.h"
+#include "../Math/Ray.h"
+
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Maximum triangles in a leaf node. Matches the SIMD width of the frustum test.
+static const unsigned MAX_LEAF_TRIANGLES = 4;
+/// Maximum tree depth for the traversal stacks.
+static const unsigned MAX_DEPTH = 64;
+/// Depth after which nodes are split by triangle count, which keeps the total depth within the limit.
+static const unsigned MAX_SPATIAL_SPLIT_DEPTH = 24;
+
+/// Test up to four consecutive triangles against the frustum planes and add those that are not completely outside.
+static void CullTriangles(const Frustum& frustum, const Vector3* vertices, unsigned first, unsigned count,
+    PODVector<unsigned>& triangles)
+{
+#ifdef URHO3D_SSE
+    // Transpose the triangles' vertices into SoA form. Unused lanes repeat the first triangle
+    const Vector3* t0 = &vertices[first * 3];
+    const Vector3* t1 = count > 1 ? t0 + 3 : t0;
+    const Vector3* t2 = count > 2 ? t0 + 6 : t0;
+    const Vector3* t3 = count > 3 ? t0 + 9 : t0;
+    __m128 x[3];
+    __m128 y[3];
+    __m128 z[3];
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        x[i] = _mm_set_ps(t3[i].x_, t2[i].x_, t1[i].x_, t0[i].x_);
+        y[i] = _mm_set_ps(t3[i].y_, t2[i].y_, t1[i].y_, t0[i].y_);
+        z[i] = _mm_set_ps(t3[i].z_, t2[i].z_, t1[i].z_, t0[i].z_);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    __m128 outside = zero;
+    for (const auto& plane : frustum.planes_)
+    {
+        __m128 nx = _mm_set1_ps(plane.normal_.x_);
+        __m128 ny = _mm_set1_ps(plane.normal_.y_);
+        __m128 nz = _mm_set1_ps(plane.normal_.z_);
+        __m128 d = _mm_set1_ps(plane.d_);
+        __m128 allBehind = _mm_cmpeq_ps(zero, zero);
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, x[i]), _mm_mul_ps(ny, y[i])), _mm_add_ps(_mm_mul_ps(nz, z[i]), d));
+            allBehind = _mm_and_ps(allBehind, _mm_cmplt_ps(distance, zero));
+        }
+        outside = _mm_or_ps(outside, allBehind);
+    }
+
+    unsigned outsideMask = (unsigned)_mm_movemask_ps(outside);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (!(outsideMask & (1u << i)))
+            triangles.Push(first + i);
+    }
+#else
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const Vector3* v = &vertices[(first + i) * 3];
+        bool outside = false;
+        for (const auto& plane : frustum.planes_)
+        {
+            if (plane.Distance(v[0]) < 0.0f && plane.Distance(v[1]) < 0.0f && plane.Distance(v[2]) < 0.0f)
+            {
+                outside = true;
+                break;
+            }
+        }
+        if (!outside)
+            triangles.Push(first + i);
+    }
+#endif
+}
+
+TriangleBVH::TriangleBVH() :
+    vertexData_(nullptr)
+{
+}
+
+bool TriangleBVH::Build(const unsigned char* vertexData, unsigned vertexStride, const unsigned char* indexData, unsigned indexSize,
+    unsigned start, unsigned count)
+{
+    nodes_.Clear();
+    vertices_.Clear();
+    indices_.Clear();
+    vertexData_ = vertexData;
+
+    if (!vertexData || !vertexStride)
+        return false;
+
+    // Gather the source vertex indices of all triangles
+    unsigned numTriangles = count / 3;
+    PODVector<unsigned> sourceIndices(numTriangles * 3);
+    for (unsigned i = 0; i < numTriangles * 3; ++i)
+    {
+        if (!indexData)
+            sourceIndices[i] = start + i;
+        else if (indexSize == sizeof(unsigned short))
+            sourceIndices[i] = ((const unsigned short*)indexData)[start + i];
+        else
+            sourceIndices[i] = ((const unsigned*)indexData)[start + i];
+    }
+    if (!numTriangles)
+        return false;
+
+    PODVector<Vector3> centers(numTriangles);
+    PODVector<unsigned> order(numTriangles);
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        const Vector3& v0 = *((const Vector3*)(&vertexData[sourceIndices[i * 3] * vertexStride]));
+        const Vector3& v1 = *((const Vector3*)(&vertexData[sourceIndices[i * 3 + 1] * vertexStride]));
+        const Vector3& v2 = *((const Vector3*)(&vertexData[sourceIndices[i * 3 + 2] * vertexStride]));
+        centers[i] = (v0 + v1 + v2) * (1.0f / 3.0f);
+        order[i] = i;
+    }
+
+    nodes_.Reserve(2 * ((numTriangles + MAX_LEAF_TRIANGLES - 1) / MAX_LEAF_TRIANGLES));
+    BuildNode(0, numTriangles, 0, order, centers);
+
+    // Store the triangles in tree order so that each subtree is contiguous
+    vertices_.Resize(numTriangles * 3);
+    indices_.Resize(numTriangles * 3);
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            unsigned index = sourceIndices[order[i] * 3 + j];
+            indices_[i * 3 + j] = index;
+            vertices_[i * 3 + j] = *((const Vector3*)(&vertexData[index * vertexStride]));
+        }
+    }
+
+    // Now calculate the bounding boxes bottom-up. Children always follow their parent
+    for (unsigned i = nodes_.Size() - 1; i < nodes_.Size(); --i)
+    {
+        TriangleBVHNode& node = nodes_[i];
+        node.box_.Clear();
+        if (node.IsLeaf())
+        {
+            for (unsigned j = node.first_ * 3; j < (node.first_ + node.count_) * 3; ++j)
+                node.box_.Merge(vertices_[j]);
+        }
+        else
+        {
+            node.box_.Merge(nodes_[i + 1].box_);
+            node.box_.Merge(nodes_[node.right_].box_);
+        }
+    }
+
+    return true;
+}
+
+unsigned TriangleBVH::BuildNode(unsigned first, unsigned count, unsigned depth, PODVector<unsigned>& order,
+    const PODVector<Vector3>& centers)
+{
+    unsigned index = nodes_.Size();
+    nodes_.Resize(index + 1);
+    nodes_[index].first_ = first;
+    nodes_[index].count_ = count;
+    nodes_[index].right_ = 0;
+
+    if (count <= MAX_LEAF_TRIANGLES)
+        return index;
+
+    if (depth >= MAX_SPATIAL_SPLIT_DEPTH)
+    {
+        unsigned leftCount = count / 2;
+        BuildNode(first, leftCount, depth + 1, order, centers);
+        unsigned right = BuildNode(first + leftCount, count - leftCount, depth + 1, order, centers);
+        nodes_[index].right_ = right;
+        return index;
+    }
+
+    // Split at the middle of the longest axis of the triangle centers
+    BoundingBox centerBox;
+    for (unsigned i = first; i < first + count; ++i)
+        centerBox.Merge(centers[order[i]]);
+    Vector3 size = centerBox.Size();
+    unsigned axis = size.x_ >= size.y_ ? (size.x_ >= size.z_ ? 0 : 2) : (size.y_ >= size.z_ ? 1 : 2);
+    float split = centerBox.Center().Data()[axis];
+
+    unsigned* begin = &order[first];
+    unsigned* end = begin + count;
+    unsigned* mid = begin;
+    for (unsigned* i = begin; i < end; ++i)
+    {
+        if (centers[*i].Data()[axis] < split)
+            Swap(*i, *mid++);
+    }
+
+    // If all centers fell on one side (coincident triangles), split by count instead
+    unsigned leftCount = (unsigned)(mid - begin);
+    if (leftCount == 0 || leftCount == count)
+        leftCount = count / 2;
+
+    BuildNode(first, leftCount, depth + 1, order, centers);
+    unsigned right = BuildNode(first + leftCount, count - leftCount, depth + 1, order, centers);
+    nodes_[index].right_ = right;
+    return index;
+}
+
+void TriangleBVH::GetTriangles(const Frustum& frustum, PODVector<unsigned>& triangles) const
+{
+    if (nodes_.Empty())
+        return;
+
+    unsigned stack[MAX_DEPTH];
+    unsigned stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize)
+    {
+        const TriangleBVHNode& node = nodes_[stack[--stackSize]];
+        Intersection result = frustum.IsInside(node.box_);
+        if (result == OUTSIDE)
+            continue;
+
+        if (result == INSIDE)
+        {
+            // The whole subtree is inside, no need to test the triangles
+            for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+                triangles.Push(i);
+        }
+        else if (node.IsLeaf())
+            CullTriangles(frustum, vertices_.Buffer(), node.first_, node.count_, triangles);
+        else
+        {
+            unsigned nodeIndex = (unsigned)(&node - nodes_.Buffer());
+            stack[stackSize++] = node.right_;
+            stack[stackSize++] = nodeIndex + 1;
+        }
+    }
+}
+
+float TriangleBVH::Raycast(const Ray& ray, Vector3* outNormal, unsigned* outTriangle, Vector3* outBary) const
+{
+    float nearest = M_INFINITY;
+    unsigned nearestTriangle = M_MAX_UNSIGNED;
+    if (nodes_.Empty())
+        return nearest;
+
+    unsigned stack[MAX_DEPTH];
+    unsigned stackSize = 0;
+    if (ray.HitDistance(nodes_[0].box_) < M_INFINITY)
+        stack[stackSize++] = 0;
+
+    while (stackSize)
+    {
+        unsigned nodeIndex = stack[--stackSize];
+        const TriangleBVHNode& node = nodes_[nodeIndex];
+
+        if (node.IsLeaf())
+        {
+            for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+            {
+                const Vector3* v = &vertices_[i * 3];
+                float distance = ray.HitDistance(v[0], v[1], v[2]);
+                if (distance < nearest)
+                {
+                    nearest = distance;
+                    nearestTriangle = i;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, and skip children that are farther than the nearest hit so far
+        unsigned left = nodeIndex + 1;
+        unsigned right = node.right_;
+        float leftDistance = ray.HitDistance(nodes_[left].box_);
+        float rightDistance = ray.HitDistance(nodes_[right].box_);
+        if (leftDistance > rightDistance)
+        {
+            Swap(left, right);
+            Swap(leftDistance, rightDistance);
+        }
+        if (rightDistance < nearest)
+            stack[stackSize++] = right;
+        if (leftDistance < nearest)
+            stack[stackSize++] = left;
+    }
+
+    if (nearestTriangle != M_MAX_UNSIGNED)
+    {
+        if (outNormal || outBary)
+        {
+            const Vector3* v = &vertices_[nearestTriangle * 3];
+            ray.HitDistance(v[0], v[1], v[2], outNormal, outBary);
+        }
+        if (outTriangle)
+            *outTriangle = nearestTriangle;
+    }
+
+    return nearest;
+}
+
+const BoundingBox& TriangleBVH::GetBoundingBox() const
+{
+    static const BoundingBox emptyBox;
+    return nodes_.Size() ? nodes_[0].box_ : emptyBox;
+}
+
+unsigned TriangleBVH::GetMemoryUse() const
+{
+    return sizeof(TriangleBVH) + nodes_.Capacity() * sizeof(TriangleBVHNode) + vertices_.Capacity() * sizeof(Vector3) +
+        indices_.Capacity() * sizeof(unsigned);
+}
+
+}
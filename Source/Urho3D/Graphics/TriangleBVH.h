@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/RefCounted.h"
+#include "../Container/Vector.h"
+#include "../Math/BoundingBox.h"
+
+namespace Urho3D
+{
+
+class Frustum;
+class Ray;
+
+/// Node of a triangle bounding volume hierarchy. The left child immediately follows its parent.
+struct TriangleBVHNode
+{
+    /// Return whether is a leaf node.
+    bool IsLeaf() const { return right_ == 0; }
+
+    /// Bounding box of the node's triangles.
+    BoundingBox box_;
+    /// First triangle of the subtree.
+    unsigned first_;
+    /// Number of triangles in the subtree.
+    unsigned count_;
+    /// Right child node index, zero for leaves.
+    unsigned right_;
+};
+
+/// Static bounding volume hierarchy of a geometry's triangles for CPU-side queries such as raycasts and decal projection. Stores a copy of the vertex positions, with the triangles of each subtree stored contiguously.
+class URHO3D_API TriangleBVH : public RefCounted
+{
+public:
+    /// Construct empty.
+    TriangleBVH();
+
+    /// Build from vertex position data and optional 16- or 32-bit index data. The start and count refer to indices if index data is given, otherwise to vertices. Return true if any triangles were found.
+    bool Build(const unsigned char* vertexData, unsigned vertexStride, const unsigned char* indexData, unsigned indexSize,
+        unsigned start, unsigned count);
+    /// Return the triangles that are not completely outside a frustum.
+    void GetTriangles(const Frustum& frustum, PODVector<unsigned>& triangles) const;
+    /// Return hit distance to the nearest triangle, or infinity if no hit. Optionally return the hit normal, triangle and barycentric coordinate.
+    float Raycast(const Ray& ray, Vector3* outNormal = nullptr, unsigned* outTriangle = nullptr, Vector3* outBary = nullptr) const;
+
+    /// Return number of triangles.
+    unsigned GetNumTriangles() const { return indices_.Size() / 3; }
+    /// Return the vertex positions of a triangle.
+    const Vector3* GetTriangleVertices(unsigned triangle) const { return &vertices_[triangle * 3]; }
+    /// Return the source vertex indices of a triangle.
+    const unsigned* GetTriangleIndices(unsigned triangle) const { return &indices_[triangle * 3]; }
+    /// Return the vertex data the hierarchy was built from. Used for checking that the hierarchy matches the data at hand.
+    const unsigned char* GetVertexData() const { return vertexData_; }
+    /// Return bounding box of all triangles.
+    const BoundingBox& GetBoundingBox() const;
+    /// Return approximate memory use in bytes.
+    unsigned GetMemoryUse() const;
+
+private:
+    /// Build a subtree from a range of triangles. Return the node index.
+    unsigned BuildNode(unsigned first, unsigned count, unsigned depth, PODVector<unsigned>& order, const PODVector<Vector3>& centers);
+
+    /// Nodes, root first.
+    Vector<TriangleBVHNode> nodes_;
+    /// Vertex positions, three per triangle in hierarchy order.
+    PODVector<Vector3> vertices_;
+    /// Source vertex indices, three per triangle in hierarchy order.
+    PODVector<unsigned> indices_;
+    /// Vertex data the hierarchy was built from.
+    const unsigned char* vertexData_;
+};
+
+}
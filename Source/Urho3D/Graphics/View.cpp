@@ -55,6 +55,9 @@
 namespace Urho3D
 {
 
+/// Minimum number of geometries in a base batch collection chunk when collecting batches in worker threads.
+static const unsigned GEOMETRIES_PER_BATCH_CHUNK = 64;
+
 /// %Frustum octree query for shadowcasters.
 class ShadowCasterOctreeQuery : public FrustumOctreeQuery
 {
@@ -160,6 +163,8 @@ public:
 void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
 {
     auto* view = reinterpret_cast<View*>(item->aux_);
+    URHO3D_PROFILE_OBJECT(CheckVisibilityWork, view);
+
     auto** start = reinterpret_cast<Drawable**>(item->start_);
     auto** end = reinterpret_cast<Drawable**>(item->end_);
     OcclusionBuffer* buffer = view->occlusionBuffer_;
@@ -229,6 +234,8 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
 void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
 {
     auto* view = reinterpret_cast<View*>(item->aux_);
+    URHO3D_PROFILE_OBJECT(ProcessLightWork, view);
+
     auto* query = reinterpret_cast<LightQueryResult*>(item->start_);
 
     view->ProcessLight(*query, threadIndex);
@@ -1011,6 +1018,7 @@ void View::GetLightBatches()
 
         lightQueues_.Resize(numLightQueues);
         maxLightsDrawables_.Clear();
+        unsigned numShadowBatchTasks = 0;
         auto maxSortedInstances = (unsigned)renderer_->GetMaxSortedInstances();
 
         for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
@@ -1087,28 +1095,18 @@ void View::GetLightBatches()
                             else if (type == UPDATE_WORKER_THREAD)
                                 threadedGeometries_.Push(drawable);
                         }
+                    }
 
-                        const Vector<SourceBatch>& batches = drawable->GetBatches();
-
-                        for (unsigned l = 0; l < batches.Size(); ++l)
-                        {
-                            const SourceBatch& srcBatch = batches[l];
-
-                            Technique* tech = GetTechnique(drawable, srcBatch.material_);
-                            if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
-                                continue;
-
-                            Pass* pass = tech->GetSupportedPass(Technique::shadowPassIndex);
-                            // Skip if material has no shadow pass
-                            if (!pass)
-                                continue;
-
-                            Batch destBatch(srcBatch);
-                            destBatch.pass_ = pass;
-                            destBatch.zone_ = nullptr;
-
-                            AddBatchToQueue(shadowQueue.shadowBatches_, destBatch, tech);
-                        }
+                    // The shadow batches themselves are collected for all splits at once in worker threads
+                    if (query.shadowCasterEnd_[j] > query.shadowCasterBegin_[j])
+                    {
+                        if (shadowBatchTasks_.Size() <= numShadowBatchTasks)
+                            shadowBatchTasks_.Resize(numShadowBatchTasks + 1);
+                        ShadowBatchTask& task = shadowBatchTasks_[numShadowBatchTasks++];
+                        task.query_ = &query;
+                        task.shadowQueue_ = &shadowQueue;
+                        task.splitIndex_ = j;
+                        task.deferredBatches_.Clear();
                     }
                 }
 
@@ -1156,6 +1154,25 @@ void View::GetLightBatches()
                 }
             }
         }
+
+        if (numShadowBatchTasks)
+        {
+            URHO3D_PROFILE(GetShadowBatches);
+
+            auto* queue = GetSubsystem<WorkQueue>();
+            queue->ParallelFor(numShadowBatchTasks, 1, [this](unsigned start, unsigned end, unsigned /*threadIndex*/)
+            {
+                for (unsigned i = start; i < end; ++i)
+                    GetShadowBatches(shadowBatchTasks_[i]);
+            });
+
+            for (unsigned i = 0; i < numShadowBatchTasks; ++i)
+            {
+                PODVector<DeferredBatch>& deferredBatches = shadowBatchTasks_[i].deferredBatches_;
+                for (PODVector<DeferredBatch>::Iterator j = deferredBatches.Begin(); j != deferredBatches.End(); ++j)
+                    AddBatchToQueue(*j->queue_, j->batch_, j->tech_, j->allowInstancing_);
+            }
+        }
     }
 
     // Process drawables with limited per-pixel light count
@@ -1185,14 +1202,83 @@ void View::GetBaseBatches()
 {
     URHO3D_PROFILE(GetBaseBatches);
 
-    for (PODVector<Drawable*>::ConstIterator i = geometries_.Begin(); i != geometries_.End(); ++i)
+    auto* queue = GetSubsystem<WorkQueue>();
+    unsigned numGeometries = geometries_.Size();
+    unsigned numThreads = queue->GetNumThreads() + 1;
+    if (numThreads == 1 || numGeometries < GEOMETRIES_PER_BATCH_CHUNK * 2)
     {
-        Drawable* drawable = *i;
+        GetBaseBatches(0, numGeometries, nullptr);
+        return;
+    }
+
+    // Split the geometries into contiguous chunks which collect batches into their own queues. The chunks are merged
+    // in order, so the result does not depend on which thread processed which chunk
+    unsigned chunkSize = Max(GEOMETRIES_PER_BATCH_CHUNK, (numGeometries + numThreads * 4 - 1) / (numThreads * 4));
+    unsigned numChunks = (numGeometries + chunkSize - 1) / chunkSize;
+    if (baseBatchChunks_.Size() < numChunks)
+        baseBatchChunks_.Resize(numChunks);
+
+    for (unsigned i = 0; i < numChunks; ++i)
+    {
+        BaseBatchChunk& chunk = baseBatchChunks_[i];
+        chunk.nonThreadedGeometries_.Clear();
+        chunk.threadedGeometries_.Clear();
+        chunk.auxViewMaterials_.Clear();
+        chunk.deferredBatches_.Clear();
+        chunk.batchQueues_.Resize(scenePasses_.Size());
+        for (unsigned j = 0; j < scenePasses_.Size(); ++j)
+        {
+            // Only the shader define hashes are needed, as shaders are never loaded through the chunk queues
+            const BatchQueue& mainQueue = *scenePasses_[j].batchQueue_;
+            BatchQueue& chunkQueue = chunk.batchQueues_[j];
+            chunkQueue.Clear(mainQueue.maxSortedInstances_);
+            chunkQueue.hasExtraDefines_ = mainQueue.hasExtraDefines_;
+            chunkQueue.vsExtraDefinesHash_ = mainQueue.vsExtraDefinesHash_;
+            chunkQueue.psExtraDefinesHash_ = mainQueue.psExtraDefinesHash_;
+        }
+    }
+
+    queue->ParallelFor(numChunks, 1, [this, chunkSize, numGeometries](unsigned start, unsigned end, unsigned /*threadIndex*/)
+    {
+        for (unsigned i = start; i < end; ++i)
+            GetBaseBatches(i * chunkSize, Min((i + 1) * chunkSize, numGeometries), &baseBatchChunks_[i]);
+    });
+
+    URHO3D_PROFILE(MergeBaseBatches);
+
+    for (unsigned i = 0; i < numChunks; ++i)
+    {
+        BaseBatchChunk& chunk = baseBatchChunks_[i];
+        nonThreadedGeometries_.Push(chunk.nonThreadedGeometries_);
+        threadedGeometries_.Push(chunk.threadedGeometries_);
+
+        for (PODVector<Material*>::ConstIterator j = chunk.auxViewMaterials_.Begin(); j != chunk.auxViewMaterials_.End(); ++j)
+        {
+            if ((*j)->GetAuxViewFrameNumber() != frame_.frameNumber_)
+                CheckMaterialForAuxView(*j);
+        }
+
+        for (unsigned j = 0; j < scenePasses_.Size(); ++j)
+            MergeBatchQueue(*scenePasses_[j].batchQueue_, chunk.batchQueues_[j]);
+
+        for (PODVector<DeferredBatch>::Iterator j = chunk.deferredBatches_.Begin(); j != chunk.deferredBatches_.End(); ++j)
+            AddBatchToQueue(*j->queue_, j->batch_, j->tech_, j->allowInstancing_);
+    }
+}
+
+void View::GetBaseBatches(unsigned start, unsigned end, BaseBatchChunk* chunk)
+{
+    PODVector<Drawable*>& nonThreadedGeometries = chunk ? chunk->nonThreadedGeometries_ : nonThreadedGeometries_;
+    PODVector<Drawable*>& threadedGeometries = chunk ? chunk->threadedGeometries_ : threadedGeometries_;
+
+    for (unsigned i = start; i < end; ++i)
+    {
+        Drawable* drawable = geometries_[i];
         UpdateGeometryType type = drawable->GetUpdateGeometryType();
         if (type == UPDATE_MAIN_THREAD)
-            nonThreadedGeometries_.Push(drawable);
+            nonThreadedGeometries.Push(drawable);
         else if (type == UPDATE_WORKER_THREAD)
-            threadedGeometries_.Push(drawable);
+            threadedGeometries.Push(drawable);
 
         const Vector<SourceBatch>& batches = drawable->GetBatches();
         bool vertexLightsProcessed = false;
@@ -1202,9 +1288,14 @@ void View::GetBaseBatches()
             const SourceBatch& srcBatch = batches[j];
 
             // Check here if the material refers to a rendertarget texture with camera(s) attached
-            // Only check this for backbuffer views (null rendertarget)
+            // Only check this for backbuffer views (null rendertarget). Worker threads leave the check to the main thread
             if (srcBatch.material_ && srcBatch.material_->GetAuxViewFrameNumber() != frame_.frameNumber_ && !renderTarget_)
-                CheckMaterialForAuxView(srcBatch.material_);
+            {
+                if (!chunk)
+                    CheckMaterialForAuxView(srcBatch.material_);
+                else if (chunk->auxViewMaterials_.Empty() || chunk->auxViewMaterials_.Back() != srcBatch.material_)
+                    chunk->auxViewMaterials_.Push(srcBatch.material_);
+            }
 
             Technique* tech = GetTechnique(drawable, srcBatch.material_);
             if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
@@ -1242,18 +1333,20 @@ void View::GetBaseBatches()
 
                     if (drawableVertexLights.Size())
                     {
-                        // Find a vertex light queue. If not found, create new
+                        // Find a vertex light queue. If not found, create new. The queues are shared between worker threads,
+                        // but stay in place once created
                         unsigned long long hash = GetVertexLightQueueHash(drawableVertexLights);
-                        HashMap<unsigned long long, LightBatchQueue>::Iterator i = vertexLightQueues_.Find(hash);
-                        if (i == vertexLightQueues_.End())
+                        MutexLock lock(vertexLightQueuesMutex_);
+                        HashMap<unsigned long long, LightBatchQueue>::Iterator lightQueue = vertexLightQueues_.Find(hash);
+                        if (lightQueue == vertexLightQueues_.End())
                         {
-                            i = vertexLightQueues_.Insert(MakePair(hash, LightBatchQueue()));
-                            i->second_.light_ = nullptr;
-                            i->second_.shadowMap_ = nullptr;
-                            i->second_.vertexLights_ = drawableVertexLights;
+                            lightQueue = vertexLightQueues_.Insert(MakePair(hash, LightBatchQueue()));
+                            lightQueue->second_.light_ = nullptr;
+                            lightQueue->second_.shadowMap_ = nullptr;
+                            lightQueue->second_.vertexLights_ = drawableVertexLights;
                         }
 
-                        destBatch.lightQueue_ = &(i->second_);
+                        destBatch.lightQueue_ = &(lightQueue->second_);
                     }
                 }
                 else
@@ -1263,12 +1356,49 @@ void View::GetBaseBatches()
                 if (allowInstancing && info.markToStencil_ && destBatch.lightMask_ != (destBatch.zone_->GetLightMask() & 0xffu))
                     allowInstancing = false;
 
-                AddBatchToQueue(*info.batchQueue_, destBatch, tech, allowInstancing);
+                if (chunk)
+                    AddBatchToQueueThreaded(chunk->batchQueues_[k], *info.batchQueue_, destBatch, tech, allowInstancing,
+                        chunk->deferredBatches_);
+                else
+                    AddBatchToQueue(*info.batchQueue_, destBatch, tech, allowInstancing);
             }
         }
     }
 }
 
+void View::GetShadowBatches(ShadowBatchTask& task)
+{
+    const LightQueryResult& query = *task.query_;
+    BatchQueue& shadowBatches = task.shadowQueue_->shadowBatches_;
+
+    for (PODVector<Drawable*>::ConstIterator i = query.shadowCasters_.Begin() + query.shadowCasterBegin_[task.splitIndex_];
+         i < query.shadowCasters_.Begin() + query.shadowCasterEnd_[task.splitIndex_]; ++i)
+    {
+        Drawable* drawable = *i;
+        const Vector<SourceBatch>& batches = drawable->GetBatches();
+
+        for (unsigned j = 0; j < batches.Size(); ++j)
+        {
+            const SourceBatch& srcBatch = batches[j];
+
+            Technique* tech = GetTechnique(drawable, srcBatch.material_);
+            if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
+                continue;
+
+            Pass* pass = tech->GetSupportedPass(Technique::shadowPassIndex);
+            // Skip if material has no shadow pass
+            if (!pass)
+                continue;
+
+            Batch destBatch(srcBatch);
+            destBatch.pass_ = pass;
+            destBatch.zone_ = nullptr;
+
+            AddBatchToQueueThreaded(shadowBatches, shadowBatches, destBatch, tech, true, task.deferredBatches_);
+        }
+    }
+}
+
 void View::UpdateGeometries()
 {
     // Update geometries in the source view if necessary (prepare order may differ from render order)
@@ -2836,6 +2966,19 @@ Technique* View::GetTechnique(Drawable* drawable, Material* material)
     }
 }
 
+Technique* View::GetPassTechnique(Material* material, Pass* pass)
+{
+    const Vector<TechniqueEntry>& techniques = material->GetTechniques();
+    for (unsigned i = 0; i < techniques.Size(); ++i)
+    {
+        Technique* tech = techniques[i].technique_;
+        if (tech && tech->GetPass(pass->GetIndex()) == pass)
+            return tech;
+    }
+
+    return renderer_->GetDefaultMaterial()->GetTechniques()[0].technique_;
+}
+
 void View::CheckMaterialForAuxView(Material* material)
 {
     const HashMap<TextureUnit, SharedPtr<Texture> >& textures = material->GetTextures();
@@ -2943,6 +3086,58 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
     }
 }
 
+void View::AddBatchToQueueThreaded(BatchQueue& queue, BatchQueue& mainQueue, Batch& batch, Technique* tech, bool allowInstancing,
+    PODVector<DeferredBatch>& deferredBatches)
+{
+    // Loading shaders is not thread-safe. This happens only on the first frames a pass is used, or after shaders are reloaded
+    if (!renderer_->HasPassShaders(batch.pass_, queue))
+    {
+        DeferredBatch deferred;
+        deferred.batch_ = batch;
+        deferred.tech_ = tech;
+        deferred.queue_ = &mainQueue;
+        deferred.allowInstancing_ = allowInstancing;
+        deferredBatches.Push(deferred);
+    }
+    else
+        AddBatchToQueue(queue, batch, tech, allowInstancing);
+}
+
+void View::MergeBatchQueue(BatchQueue& dest, const BatchQueue& src)
+{
+    dest.batches_.Push(src.batches_);
+
+    for (HashMap<BatchGroupKey, BatchGroup>::ConstIterator i = src.batchGroups_.Begin(); i != src.batchGroups_.End(); ++i)
+    {
+        HashMap<BatchGroupKey, BatchGroup>::Iterator j = dest.batchGroups_.Find(i->first_);
+        if (j == dest.batchGroups_.End())
+        {
+            dest.batchGroups_.Insert(i);
+            continue;
+        }
+
+        BatchGroup& group = j->second_;
+        group.instances_.Push(i->second_.instances_);
+
+        // The combined group may reach the instancing limit even if neither part did
+        if ((int)group.instances_.Size() >= minInstances_ && group.geometryType_ != GEOM_INSTANCED)
+        {
+            if (i->second_.geometryType_ == GEOM_INSTANCED)
+            {
+                group.geometryType_ = GEOM_INSTANCED;
+                group.vertexShader_ = i->second_.vertexShader_;
+                group.pixelShader_ = i->second_.pixelShader_;
+            }
+            else
+            {
+                group.geometryType_ = GEOM_INSTANCED;
+                renderer_->SetBatchShaders(group, GetPassTechnique(group.material_, group.pass_), true, dest);
+            }
+            group.CalculateSortKey();
+        }
+    }
+}
+
 void View::PrepareInstancingBuffer()
 {
     // Prepare instancing buffer from the source view
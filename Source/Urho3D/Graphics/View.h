@@ -24,6 +24,7 @@
 
 #include "../Container/HashSet.h"
 #include "../Container/List.h"
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/Light.h"
@@ -37,9 +38,11 @@ class Camera;
 class DebugRenderer;
 class Light;
 class Drawable;
+class Material;
 class Graphics;
 class OcclusionBuffer;
 class Octree;
+class Pass;
 class Renderer;
 class RenderPath;
 class RenderSurface;
@@ -104,6 +107,47 @@ struct PerThreadSceneResult
     float maxZ_;
 };
 
+/// Batch collected in a worker thread before its pass shaders were loaded. Added to its queue later in the main thread.
+struct DeferredBatch
+{
+    /// Batch.
+    Batch batch_;
+    /// Technique.
+    Technique* tech_;
+    /// Destination batch queue.
+    BatchQueue* queue_;
+    /// Allow instancing flag.
+    bool allowInstancing_;
+};
+
+/// Base batch collection results for a contiguous range of geometries, merged into the view's batch queues in the main thread.
+struct BaseBatchChunk
+{
+    /// Batch queues, one for each scene pass.
+    Vector<BatchQueue> batchQueues_;
+    /// Geometry objects that will be updated in the main thread.
+    PODVector<Drawable*> nonThreadedGeometries_;
+    /// Geometry objects that will be updated in worker threads.
+    PODVector<Drawable*> threadedGeometries_;
+    /// Materials to check for auxiliary views.
+    PODVector<Material*> auxViewMaterials_;
+    /// Batches deferred to the main thread.
+    PODVector<DeferredBatch> deferredBatches_;
+};
+
+/// Shadow batch collection task for one shadow split.
+struct ShadowBatchTask
+{
+    /// Light query result.
+    LightQueryResult* query_;
+    /// Shadow batch queue of the split.
+    ShadowBatchQueue* shadowQueue_;
+    /// Split index.
+    unsigned splitIndex_;
+    /// Batches deferred to the main thread.
+    PODVector<DeferredBatch> deferredBatches_;
+};
+
 static const unsigned MAX_VIEWPORT_TEXTURES = 2;
 
 /// Internal structure for 3D rendering work. Created for each backbuffer and texture viewport, but not for shadow cameras.
@@ -206,6 +250,10 @@ private:
     void GetLightBatches();
     /// Get unlit batches.
     void GetBaseBatches();
+    /// Get unlit batches for a range of geometries. If a chunk is given, collect into its queues instead of the view's queues; this is safe to call from worker threads.
+    void GetBaseBatches(unsigned start, unsigned end, BaseBatchChunk* chunk);
+    /// Get shadow batches for a shadow split. Safe to call from worker threads.
+    void GetShadowBatches(ShadowBatchTask& task);
     /// Update geometries and sort batches.
     void UpdateGeometries();
     /// Get pixel lit batches for a certain light and drawable.
@@ -257,12 +305,19 @@ private:
     void FindZone(Drawable* drawable);
     /// Return material technique, considering the drawable's LOD distance.
     Technique* GetTechnique(Drawable* drawable, Material* material);
+    /// Return the material technique which contains a pass.
+    Technique* GetPassTechnique(Material* material, Pass* pass);
     /// Check if material should render an auxiliary view (if it has a camera attached.)
     void CheckMaterialForAuxView(Material* material);
     /// Set shader defines for a batch queue if used.
     void SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& command);
     /// Choose shaders for a batch and add it to queue.
     void AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing = true, bool allowShadows = true);
+    /// Choose shaders for a batch and add it to queue from a worker thread. If the pass shaders are not loaded yet, defer the batch to be added to the main queue in the main thread.
+    void AddBatchToQueueThreaded(BatchQueue& queue, BatchQueue& mainQueue, Batch& batch, Technique* tech, bool allowInstancing,
+        PODVector<DeferredBatch>& deferredBatches);
+    /// Merge a batch queue collected in a worker thread into a main queue, combining the instancing groups.
+    void MergeBatchQueue(BatchQueue& dest, const BatchQueue& src);
     /// Prepare instancing buffer by filling it with all instance transforms.
     void PrepareInstancingBuffer();
     /// Set up a light volume rendering batch.
@@ -415,6 +470,12 @@ private:
     Vector<LightBatchQueue> lightQueues_;
     /// Per-vertex light queues.
     HashMap<unsigned long long, LightBatchQueue> vertexLightQueues_;
+    /// Mutex for per-vertex light queue creation during threaded batch collection.
+    Mutex vertexLightQueuesMutex_;
+    /// Base batch collection chunks.
+    Vector<BaseBatchChunk> baseBatchChunks_;
+    /// Shadow batch collection tasks.
+    Vector<ShadowBatchTask> shadowBatchTasks_;
     /// Batch queues by pass index.
     HashMap<unsigned, BatchQueue> batchQueues_;
     /// Index of the GBuffer pass.
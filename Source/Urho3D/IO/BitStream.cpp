@@ -0,0 +1,180 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../IO/BitStream.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Bits for the zigzag-encoded difference of a small change in a delta-coded value.
+static const unsigned SMALL_DELTA_BITS = 5;
+
+BitSerializer::BitSerializer(Serializer& dest) :
+    dest_(dest),
+    accumulator_(0),
+    numBits_(0)
+{
+}
+
+BitSerializer::~BitSerializer()
+{
+    Flush();
+}
+
+unsigned BitSerializer::Write(const void* data, unsigned size)
+{
+    // When byte-aligned, pass through directly
+    if (!numBits_)
+        return dest_.Write(data, size);
+
+    auto* bytes = (const unsigned char*)data;
+    for (unsigned i = 0; i < size; ++i)
+        WriteBits(bytes[i], 8);
+    return size;
+}
+
+void BitSerializer::WriteBits(unsigned value, unsigned numBits)
+{
+    if (!numBits)
+        return;
+    if (numBits < 32)
+        value &= (1u << numBits) - 1;
+
+    accumulator_ |= (unsigned long long)value << numBits_;
+    numBits_ += numBits;
+
+    while (numBits_ >= 8)
+    {
+        dest_.WriteUByte((unsigned char)(accumulator_ & 0xff));
+        accumulator_ >>= 8;
+        numBits_ -= 8;
+    }
+}
+
+void BitSerializer::WriteDeltaBits(unsigned value, unsigned baseline, unsigned numBits)
+{
+    if (value == baseline)
+    {
+        WriteBit(false);
+        return;
+    }
+
+    WriteBit(true);
+    if (numBits > SMALL_DELTA_BITS + 1)
+    {
+        int delta = (int)(value - baseline);
+        unsigned zigzag = ((unsigned)delta << 1u) ^ (unsigned)(delta >> 31);
+        if (zigzag <= (1u << SMALL_DELTA_BITS))
+        {
+            WriteBit(false);
+            WriteBits(zigzag - 1, SMALL_DELTA_BITS);
+            return;
+        }
+        WriteBit(true);
+    }
+    WriteBits(value, numBits);
+}
+
+void BitSerializer::Flush()
+{
+    if (numBits_)
+    {
+        dest_.WriteUByte((unsigned char)(accumulator_ & 0xff));
+        accumulator_ = 0;
+        numBits_ = 0;
+    }
+}
+
+BitDeserializer::BitDeserializer(Deserializer& source) :
+    Deserializer(source.GetSize() - source.GetPosition()),
+    source_(source),
+    accumulator_(0),
+    numBits_(0)
+{
+}
+
+unsigned BitDeserializer::Read(void* dest, unsigned size)
+{
+    // When byte-aligned, pass through directly
+    if (!numBits_)
+    {
+        unsigned read = source_.Read(dest, size);
+        position_ += read;
+        return read;
+    }
+
+    auto* bytes = (unsigned char*)dest;
+    unsigned read = 0;
+    while (read < size && !IsEof())
+        bytes[read++] = (unsigned char)ReadBits(8);
+    return read;
+}
+
+unsigned BitDeserializer::Seek(unsigned position)
+{
+    return position_;
+}
+
+unsigned BitDeserializer::ReadBits(unsigned numBits)
+{
+    if (!numBits)
+        return 0;
+
+    while (numBits_ < numBits)
+    {
+        // Past the end of the source stream, read zeros
+        unsigned char byte = 0;
+        if (!source_.IsEof())
+        {
+            byte = source_.ReadUByte();
+            ++position_;
+        }
+        accumulator_ |= (unsigned long long)byte << numBits_;
+        numBits_ += 8;
+    }
+
+    auto value = (unsigned)(accumulator_ & (numBits < 32 ? (1ull << numBits) - 1 : 0xffffffffull));
+    accumulator_ >>= numBits;
+    numBits_ -= numBits;
+    return value;
+}
+
+unsigned BitDeserializer::ReadDeltaBits(unsigned baseline, unsigned numBits)
+{
+    if (!ReadBit())
+        return baseline;
+
+    if (numBits > SMALL_DELTA_BITS + 1 && !ReadBit())
+    {
+        unsigned zigzag = ReadBits(SMALL_DELTA_BITS) + 1;
+        int delta = (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+        return baseline + (unsigned)delta;
+    }
+
+    return ReadBits(numBits);
+}
+
+}
@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../IO/Deserializer.h"
+#include "../IO/Serializer.h"
+
+namespace Urho3D
+{
+
+/// Bit-level stream for writing, which packs values of arbitrary bit width into another stream. Byte writes through the Serializer interface are unaligned.
+class URHO3D_API BitSerializer : public Serializer
+{
+public:
+    /// Construct with the destination stream.
+    explicit BitSerializer(Serializer& dest);
+    /// Destruct. Flush remaining bits.
+    ~BitSerializer() override;
+
+    /// Write bytes to the stream. Return number of bytes actually written.
+    unsigned Write(const void* data, unsigned size) override;
+
+    /// Write the lowest bits of a value, at most 32.
+    void WriteBits(unsigned value, unsigned numBits);
+    /// Write a single bit.
+    void WriteBit(bool value) { WriteBits(value ? 1 : 0, 1); }
+    /// Write a value of specified bit width relative to a baseline value known by the reader. Unchanged values take one bit and small changes seven.
+    void WriteDeltaBits(unsigned value, unsigned baseline, unsigned numBits);
+    /// Write remaining bits to the destination stream, padding the last byte with zeros.
+    void Flush();
+
+private:
+    /// Destination stream.
+    Serializer& dest_;
+    /// Bits not yet written to the destination stream.
+    unsigned long long accumulator_;
+    /// Number of bits in the accumulator.
+    unsigned numBits_;
+};
+
+/// Bit-level stream for reading values written by BitSerializer. Consumes whole bytes from the source stream, so that after reading the last value the source is positioned at the next byte-aligned data.
+class URHO3D_API BitDeserializer : public Deserializer
+{
+public:
+    /// Construct with the source stream.
+    explicit BitDeserializer(Deserializer& source);
+
+    /// Read bytes from the stream. Return number of bytes actually read.
+    unsigned Read(void* dest, unsigned size) override;
+    /// Set position from the beginning of the stream. Not supported, return the current position.
+    unsigned Seek(unsigned position) override;
+    /// Return whether the end of stream has been reached.
+    bool IsEof() const override { return !numBits_ && source_.IsEof(); }
+
+    /// Read a value of specified bit width, at most 32.
+    unsigned ReadBits(unsigned numBits);
+    /// Read a single bit.
+    bool ReadBit() { return ReadBits(1) != 0; }
+    /// Read a value written relative to a baseline value.
+    unsigned ReadDeltaBits(unsigned baseline, unsigned numBits);
+
+    /// Return number of bits left to read.
+    unsigned long long GetNumRemainingBits() const { return (unsigned long long)(size_ - position_) * 8 + numBits_; }
+
+private:
+    /// Source stream.
+    Deserializer& source_;
+    /// Bits read from the source stream but not yet consumed.
+    unsigned long long accumulator_;
+    /// Number of bits in the accumulator.
+    unsigned numBits_;
+};
+
+}
@@ -50,6 +50,8 @@ public:
     virtual unsigned GetChecksum();
     /// Return whether the end of stream has been reached.
     virtual bool IsEof() const { return position_ >= size_; }
+    /// Return pointer to the next bytes and advance past them if the stream is memory resident, so that they can be used without copying. Return null without advancing if not supported, size is zero or not enough data. The pointer stays valid until the stream is modified or closed.
+    virtual const unsigned char* ReadView(unsigned /*size*/) { return nullptr; }
 
     /// Set position relative to current position. Return actual new position.
     unsigned SeekRelative(int delta);
@@ -23,6 +23,10 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#ifndef MINI_URHO
+#include "../Core/WorkQueue.h"
+#endif
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -33,6 +37,7 @@
 #include <SDL/SDL_rwops.h>
 #endif
 
+#include <atomic>
 #include <cstdio>
 #include <LZ4/lz4.h>
 
@@ -64,14 +69,20 @@ const char* APK = "/apk/";
 static const unsigned READ_BUFFER_SIZE = 32768;
 #endif
 static const unsigned SKIP_BUFFER_SIZE = 1024;
+#ifndef MINI_URHO
+static const unsigned MIN_PARALLEL_BLOCKS = 4;
+#endif
 
 File::File(Context* context) :
     Object(context),
     mode_(FILE_READ),
     handle_(nullptr),
+    mappedData_(nullptr),
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    blockSize_(0),
+    readBufferBlock_(M_MAX_UNSIGNED),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -86,9 +97,12 @@ File::File(Context* context, const String& fileName, FileMode mode) :
     Object(context),
     mode_(FILE_READ),
     handle_(nullptr),
+    mappedData_(nullptr),
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    blockSize_(0),
+    readBufferBlock_(M_MAX_UNSIGNED),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -104,9 +118,12 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
     Object(context),
     mode_(FILE_READ),
     handle_(nullptr),
+    mappedData_(nullptr),
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    blockSize_(0),
+    readBufferBlock_(M_MAX_UNSIGNED),
     readBufferOffset_(0),
     readBufferSize_(0),
     offset_(0),
@@ -137,7 +154,22 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
-    bool success = OpenInternal(package->GetName(), FILE_READ, true);
+    // Read directly from the mapping if the package is memory mapped, otherwise open the package file
+    const unsigned char* mappedData = package->GetMappedData();
+    if (mappedData)
+    {
+        // The mapping is read without further checks, so the entry must lie within it. Compressed entries are shorter
+        // than their uncompressed size, their block data is validated when reading the block index
+        unsigned long long end = (unsigned long long)entry->offset_ + (package->IsCompressed() ? 0 : entry->size_);
+        if (end > package->GetTotalSize())
+        {
+            URHO3D_LOGERROR("Package file " + fileName + " extends past the end of package " + package->GetName());
+            return false;
+        }
+    }
+
+    bool success = mappedData ? OpenMapped(package, mappedData + entry->offset_) :
+        OpenInternal(package->GetName(), FILE_READ, true);
     if (!success)
     {
         URHO3D_LOGERROR("Could not open package file " + fileName);
@@ -149,9 +181,19 @@ bool File::Open(PackageFile* package, const String& fileName)
     checksum_ = entry->checksum_;
     size_ = entry->size_;
     compressed_ = package->IsCompressed();
+    blockSize_ = package->GetBlockSize();
 
     // Seek to beginning of package entry's file data
-    SeekInternal(offset_);
+    if (!mappedData_)
+        SeekInternal(offset_);
+
+    if (blockSize_ && !ReadBlockIndex(package->GetTotalSize() - offset_))
+    {
+        URHO3D_LOGERROR("Could not read block index of package file " + fileName);
+        Close();
+        return false;
+    }
+
     return true;
 }
 
@@ -174,6 +216,16 @@ unsigned File::Read(void* dest, unsigned size)
     if (!size)
         return 0;
 
+    if (mappedData_ && !compressed_)
+    {
+        memcpy(dest, mappedData_ + position_, size);
+        position_ += size;
+        return size;
+    }
+
+    if (blockSize_)
+        return ReadBlocks((unsigned char*)dest, size);
+
 #ifdef __ANDROID__
     if (assetHandle_ && !compressed_)
     {
@@ -282,6 +334,13 @@ unsigned File::Seek(unsigned position)
     if (mode_ == FILE_READ && position > size_)
         position = size_;
 
+    // Files read from a mapping or from block compressed packages can seek freely
+    if (mappedData_ || blockSize_)
+    {
+        position_ = position;
+        return position_;
+    }
+
     if (compressed_)
     {
         // Start over from the beginning
@@ -312,6 +371,16 @@ unsigned File::Seek(unsigned position)
     return position_;
 }
 
+const unsigned char* File::ReadView(unsigned size)
+{
+    if (!mappedData_ || compressed_ || !size || size > size_ - position_)
+        return nullptr;
+
+    const unsigned char* data = mappedData_ + position_;
+    position_ += size;
+    return data;
+}
+
 unsigned File::Write(const void* data, unsigned size)
 {
     if (!IsOpen())
@@ -393,6 +462,20 @@ void File::Close()
 
     readBuffer_.Reset();
     inputBuffer_.Reset();
+    blockOffsets_.Clear();
+    blockData_.Clear();
+    blockSize_ = 0;
+    readBufferBlock_ = M_MAX_UNSIGNED;
+
+    if (mappedData_)
+    {
+        mappedData_ = nullptr;
+        package_.Reset();
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
 
     if (handle_)
     {
@@ -419,9 +502,9 @@ void File::SetName(const String& name)
 bool File::IsOpen() const
 {
 #ifdef __ANDROID__
-    return handle_ != 0 || assetHandle_ != 0;
+    return handle_ != 0 || assetHandle_ != 0 || mappedData_ != 0;
 #else
-    return handle_ != nullptr;
+    return handle_ != nullptr || mappedData_ != nullptr;
 #endif
 }
 
@@ -523,6 +606,162 @@ bool File::OpenInternal(const String& fileName, FileMode mode, bool fromPackage)
     return true;
 }
 
+bool File::OpenMapped(PackageFile* package, const unsigned char* data)
+{
+    Close();
+
+    compressed_ = false;
+    readSyncNeeded_ = false;
+    writeSyncNeeded_ = false;
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    if (fileSystem && !fileSystem->CheckAccess(GetPath(package->GetName())))
+    {
+        URHO3D_LOGERRORF("Access denied to %s", package->GetName().CString());
+        return false;
+    }
+
+    mappedData_ = data;
+    package_ = package;
+    mode_ = FILE_READ;
+    position_ = 0;
+
+    return true;
+}
+
+bool File::ReadBlockIndex(unsigned maxPackedSize)
+{
+    // The index holds the end offset of each block. The first block starts right after the index
+    unsigned numBlocks = (unsigned)(((unsigned long long)size_ + blockSize_ - 1) / blockSize_);
+    if ((unsigned long long)numBlocks * sizeof(unsigned) > maxPackedSize)
+        return false;
+
+    blockOffsets_.Resize(numBlocks + 1);
+    blockOffsets_[0] = numBlocks * sizeof(unsigned);
+    if (numBlocks)
+    {
+        if (mappedData_)
+            memcpy(&blockOffsets_[1], mappedData_, numBlocks * sizeof(unsigned));
+        else if (!ReadInternal(&blockOffsets_[1], numBlocks * sizeof(unsigned)))
+            return false;
+    }
+
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        unsigned unpackedSize = Min(size_ - i * blockSize_, blockSize_);
+        unsigned packedSize = blockOffsets_[i + 1] - blockOffsets_[i];
+        if (blockOffsets_[i + 1] < blockOffsets_[i] || packedSize > unpackedSize)
+            return false;
+    }
+
+    // The blocks are read from the mapping without further checks, so they must end within the package
+    if (blockOffsets_[numBlocks] > maxPackedSize)
+        return false;
+
+    readBuffer_ = new unsigned char[blockSize_];
+    return true;
+}
+
+unsigned File::ReadBlocks(unsigned char* dest, unsigned size)
+{
+    unsigned sizeLeft = size;
+
+    while (sizeLeft)
+    {
+        unsigned block = position_ / blockSize_;
+        unsigned blockOffset = position_ - block * blockSize_;
+
+        // Decompress whole blocks directly to the destination
+        unsigned numWholeBlocks = blockOffset ? 0 : sizeLeft / blockSize_;
+        if (position_ + sizeLeft == size_ && !blockOffset)
+            numWholeBlocks = blockOffsets_.Size() - 1 - block;
+        if (numWholeBlocks)
+        {
+            if (!DecompressBlocks(block, numWholeBlocks, dest))
+                return size - sizeLeft;
+
+            unsigned copySize = Min(numWholeBlocks * blockSize_, sizeLeft);
+            dest += copySize;
+            sizeLeft -= copySize;
+            position_ += copySize;
+            continue;
+        }
+
+        // Otherwise decompress the block to the read buffer
+        if (readBufferBlock_ != block)
+        {
+            if (!DecompressBlocks(block, 1, readBuffer_.Get()))
+                return size - sizeLeft;
+            readBufferBlock_ = block;
+        }
+
+        unsigned copySize = Min(Min(size_ - block * blockSize_, blockSize_) - blockOffset, sizeLeft);
+        memcpy(dest, readBuffer_.Get() + blockOffset, copySize);
+        dest += copySize;
+        sizeLeft -= copySize;
+        position_ += copySize;
+    }
+
+    return size;
+}
+
+bool File::DecompressBlocks(unsigned first, unsigned count, unsigned char* dest)
+{
+    // Get the compressed data of the blocks from the mapping, or read it in one go
+    const unsigned char* src;
+    if (mappedData_)
+        src = mappedData_ + blockOffsets_[first];
+    else
+    {
+        blockData_.Resize(blockOffsets_[first + count] - blockOffsets_[first]);
+        SeekInternal(offset_ + blockOffsets_[first]);
+        if (!blockData_.Empty() && !ReadInternal(&blockData_[0], blockData_.Size()))
+        {
+            URHO3D_LOGERROR("Error while reading from file " + GetName());
+            return false;
+        }
+        src = blockData_.Begin().ptr_;
+    }
+
+    const unsigned* offsets = &blockOffsets_[first];
+    const unsigned blockSize = blockSize_;
+    const unsigned size = size_;
+    std::atomic<bool> failed{false};
+    auto decompress = [&](unsigned start, unsigned end, unsigned /*threadIndex*/)
+    {
+        for (unsigned i = start; i < end; ++i)
+        {
+            unsigned block = first + i;
+            unsigned unpackedSize = Min(size - block * blockSize, blockSize);
+            unsigned packedSize = offsets[i + 1] - offsets[i];
+            const unsigned char* blockSrc = src + offsets[i] - offsets[0];
+            unsigned char* blockDest = dest + i * blockSize;
+
+            // Incompressible blocks are stored as is
+            if (packedSize == unpackedSize)
+                memcpy(blockDest, blockSrc, unpackedSize);
+            else if (LZ4_decompress_safe((const char*)blockSrc, (char*)blockDest, packedSize, unpackedSize) != (int)unpackedSize)
+                failed = true;
+        }
+    };
+
+#ifndef MINI_URHO
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (count >= MIN_PARALLEL_BLOCKS && queue && queue->GetNumThreads() && Thread::IsMainThread())
+        queue->ParallelFor(count, 1, decompress);
+    else
+#endif
+        decompress(0, count, 0);
+
+    if (failed)
+    {
+        URHO3D_LOGERROR("Could not decompress data in file " + GetName());
+        return false;
+    }
+
+    return true;
+}
+
 bool File::ReadInternal(void* dest, unsigned size)
 {
 #ifdef __ANDROID__
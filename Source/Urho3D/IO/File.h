@@ -77,6 +77,8 @@ public:
     unsigned Seek(unsigned position) override;
     /// Write bytes to the file. Return number of bytes actually written.
     unsigned Write(const void* data, unsigned size) override;
+    /// Return pointer to the next bytes and advance past them if the file is read from a memory mapped package. Return null otherwise.
+    const unsigned char* ReadView(unsigned size) override;
 
     /// Return the file name.
     const String& GetName() const override { return fileName_; }
@@ -107,9 +109,20 @@ public:
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
 
+    /// Return whether the file is read from a memory mapped package.
+    bool IsMemoryMapped() const { return mappedData_ != nullptr; }
+
 private:
     /// Open file internally using either C standard IO functions or SDL RWops for Android asset files. Return true if successful.
     bool OpenInternal(const String& fileName, FileMode mode, bool fromPackage = false);
+    /// Open file from within a memory mapped package. Return true if successful.
+    bool OpenMapped(PackageFile* package, const unsigned char* data);
+    /// Read the block index of a file in a block compressed package. The index and block data must fit in the given number of bytes. Return true if successful.
+    bool ReadBlockIndex(unsigned maxPackedSize);
+    /// Read from a file in a block compressed package. Return number of bytes actually read.
+    unsigned ReadBlocks(unsigned char* dest, unsigned size);
+    /// Decompress consecutive blocks of a file in a block compressed package. Large ranges are decompressed in worker threads when called from the main thread. Return true if successful.
+    bool DecompressBlocks(unsigned first, unsigned count, unsigned char* dest);
     /// Perform the file read internally using either C standard IO functions or SDL RWops for Android asset files. Return true if successful. This does not handle compressed package file reading.
     bool ReadInternal(void* dest, unsigned size);
     /// Seek in file internally using either C standard IO functions or SDL RWops for Android asset files.
@@ -121,6 +134,10 @@ private:
     FileMode mode_;
     /// File handle.
     void* handle_;
+    /// Start of the file data within a memory mapped package, null if not mapped.
+    const unsigned char* mappedData_;
+    /// Memory mapped package, kept alive while the file is open.
+    SharedPtr<PackageFile> package_;
 #ifdef __ANDROID__
     /// SDL RWops context for Android asset loading.
     SDL_RWops* assetHandle_;
@@ -129,6 +146,14 @@ private:
     SharedArrayPtr<unsigned char> readBuffer_;
     /// Decompression input buffer for compressed file loading.
     SharedArrayPtr<unsigned char> inputBuffer_;
+    /// Block offsets from the start of the file data for a file in a block compressed package, with the end offset last.
+    PODVector<unsigned> blockOffsets_;
+    /// Compressed block data read for decompression when not memory mapped.
+    PODVector<unsigned char> blockData_;
+    /// Uncompressed block size of a block compressed package, 0 if not block compressed.
+    unsigned blockSize_;
+    /// Index of the block in the read buffer for a file in a block compressed package.
+    unsigned readBufferBlock_;
     /// Read buffer position.
     unsigned readBufferOffset_;
     /// Bytes in the current read buffer.
@@ -99,6 +99,16 @@ unsigned MemoryBuffer::Seek(unsigned position)
     return position_;
 }
 
+const unsigned char* MemoryBuffer::ReadView(unsigned size)
+{
+    if (!size || size > size_ - position_)
+        return nullptr;
+
+    const unsigned char* data = buffer_ + position_;
+    position_ += size;
+    return data;
+}
+
 unsigned MemoryBuffer::Write(const void* data, unsigned size)
 {
     if (size + position_ > size_)
@@ -23,17 +23,31 @@
 #include "../Precompiled.h"
 
 #include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace Urho3D
 {
 
+/// Largest accepted compression block size. Each open file allocates a read buffer of this size.
+static const unsigned MAX_COMPRESSED_BLOCK_SIZE = 16 * 1024 * 1024;
+
 PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
+    blockSize_(0),
+    mappedData_(nullptr),
     compressed_(false)
 {
 }
@@ -43,15 +57,22 @@ PackageFile::PackageFile(Context* context, const String& fileName, unsigned star
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
+    blockSize_(0),
+    mappedData_(nullptr),
     compressed_(false)
 {
     Open(fileName, startOffset);
 }
 
-PackageFile::~PackageFile() = default;
+PackageFile::~PackageFile()
+{
+    Unmap();
+}
 
 bool PackageFile::Open(const String& fileName, unsigned startOffset)
 {
+    Unmap();
+
     SharedPtr<File> file(new File(context_, fileName));
     if (!file->IsOpen())
         return false;
@@ -59,7 +80,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (id != "UPAK" && id != "ULZ4" && id != "ULZB")
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -76,7 +97,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
 
-        if (id != "UPAK" && id != "ULZ4")
+        if (id != "UPAK" && id != "ULZ4" && id != "ULZB")
         {
             URHO3D_LOGERROR(fileName + " is not a valid package file");
             return false;
@@ -86,10 +107,21 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     fileName_ = fileName;
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
-    compressed_ = id == "ULZ4";
+    compressed_ = id == "ULZ4" || id == "ULZB";
 
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
+    blockSize_ = id == "ULZB" ? file->ReadUInt() : 0;
+    if (id == "ULZB" && !blockSize_)
+    {
+        URHO3D_LOGERROR(fileName + " has zero compression block size");
+        return false;
+    }
+    if (blockSize_ > MAX_COMPRESSED_BLOCK_SIZE)
+    {
+        URHO3D_LOGERROR(fileName + " has too large compression block size " + String(blockSize_));
+        return false;
+    }
 
     for (unsigned i = 0; i < numFiles; ++i)
     {
@@ -107,6 +139,10 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             entries_[entryName] = newEntry;
     }
 
+    // Block compressed packages are mapped too, so that blocks can be decompressed straight from the mapping
+    if (!compressed_ || blockSize_)
+        Map();
+
     return true;
 }
 
@@ -153,4 +189,58 @@ const PackageEntry* PackageFile::GetEntry(const String& fileName) const
     return nullptr;
 }
 
+void PackageFile::Map()
+{
+#ifdef __EMSCRIPTEN__
+    return;
+#else
+#ifdef __ANDROID__
+    // Files inside the APK can not be mapped
+    if (URHO3D_IS_ASSET(fileName_))
+        return;
+#endif
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(GetWideNativePath(fileName_).CString(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+
+    // The view keeps the mapping alive after the handles are closed
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return;
+
+    mappedData_ = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+#else
+    int fd = open(GetNativePath(fileName_).CString(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    void* data = mmap(nullptr, totalSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data != MAP_FAILED)
+        mappedData_ = (unsigned char*)data;
+#endif
+
+    if (!mappedData_)
+        URHO3D_LOGWARNING("Could not memory map package file " + fileName_ + ", reading with file IO");
+#endif
+}
+
+void PackageFile::Unmap()
+{
+    if (!mappedData_)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mappedData_);
+#elif !defined(__EMSCRIPTEN__)
+    munmap(mappedData_, totalSize_);
+#endif
+    mappedData_ = nullptr;
+}
+
 }
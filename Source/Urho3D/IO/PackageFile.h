@@ -38,7 +38,7 @@ struct PackageEntry
     unsigned checksum_;
 };
 
-/// Stores files of a directory tree sequentially for convenient access.
+/// Stores files of a directory tree sequentially for convenient access. The files may be LZ4 compressed either as a stream of blocks (legacy ULZ4 format) or as independent blocks with a block index at the start of each file (ULZB format), which allows seeking and decompressing blocks in parallel.
 class URHO3D_API PackageFile : public Object
 {
     URHO3D_OBJECT(PackageFile, Object);
@@ -82,10 +82,21 @@ public:
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
 
+    /// Return uncompressed block size if the files are compressed in independent blocks with a block index, or 0 if not.
+    unsigned GetBlockSize() const { return blockSize_; }
+
     /// Return list of file names in the package.
     const Vector<String> GetEntryNames() const { return entries_.Keys(); }
 
+    /// Return the memory mapped package file contents, or null if not mapped. Uncompressed packages and packages compressed in independent blocks are mapped.
+    const unsigned char* GetMappedData() const { return mappedData_; }
+
 private:
+    /// Memory map an uncompressed or block compressed package file, so that its files can be read or decompressed without file IO.
+    void Map();
+    /// Release the memory mapping.
+    void Unmap();
+
     /// File entries.
     HashMap<String, PackageEntry> entries_;
     /// File name.
@@ -98,6 +109,10 @@ private:
     unsigned totalDataSize_;
     /// Package file checksum.
     unsigned checksum_;
+    /// Uncompressed block size of a block compressed package, 0 if not block compressed.
+    unsigned blockSize_;
+    /// Memory mapped package file contents.
+    unsigned char* mappedData_;
     /// Compressed flag.
     bool compressed_;
 };
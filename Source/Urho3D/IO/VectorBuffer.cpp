@@ -84,6 +84,16 @@ unsigned VectorBuffer::Seek(unsigned position)
     return position_;
 }
 
+const unsigned char* VectorBuffer::ReadView(unsigned size)
+{
+    if (!size || size > size_ - position_)
+        return nullptr;
+
+    const unsigned char* data = &buffer_[position_];
+    position_ += size;
+    return data;
+}
+
 unsigned VectorBuffer::Write(const void* data, unsigned size)
 {
     if (!size)
@@ -44,6 +44,8 @@ public:
     unsigned Read(void* dest, unsigned size) override;
     /// Set position from the beginning of the buffer. Return actual new position.
     unsigned Seek(unsigned position) override;
+    /// Return pointer to the next bytes and advance past them. Return null if not enough data.
+    const unsigned char* ReadView(unsigned size) override;
     /// Write bytes to the buffer. Return number of bytes actually written.
     unsigned Write(const void* data, unsigned size) override;
 
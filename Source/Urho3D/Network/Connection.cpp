@@ -22,7 +22,9 @@
 
 #include "../Precompiled.h"
 
+#include "../Container/Sort.h"
 #include "../Core/Profiler.h"
+#include "../Core/Timer.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -33,6 +35,7 @@
 #include "../Network/NetworkEvents.h"
 #include "../Network/NetworkPriority.h"
 #include "../Network/Protocol.h"
+#include "../Network/ReplicationGrid.h"
 #include "../Resource/ResourceCache.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
@@ -48,6 +51,7 @@
 #include "../DebugNew.h"
 
 #include <cstdio>
+#include <cstring>
 
 namespace Urho3D
 {
@@ -70,13 +74,20 @@ PackageUpload::PackageUpload() :
 Connection::Connection(Context* context, bool isClient, const SLNet::AddressOrGUID& address, SLNet::RakPeerInterface* peer) :
     Object(context),
     timeStamp_(0),
-    peer_(peer),
+    grid_(nullptr),
+    snapshotSequence_(0),
+    ackedSnapshot_(0),
+    snapshotTime_(0.0f),
+    interpolatedSnapshot_(0),
     sendMode_(OPSM_NONE),
     isClient_(isClient),
     connectPending_(false),
     sceneLoaded_(false),
     logStatistics_(false),
-    address_(nullptr)
+    bufferMessages_(false),
+    snapshotReplication_(false),
+    address_(nullptr),
+    peer_(peer)
 {
     sceneState_.connection_ = this;
     port_ = address.systemAddress.GetPort();
@@ -114,6 +125,19 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
         return;
     }
     
+    if (bufferMessages_)
+    {
+        BufferedMessage message;
+        message.offset_ = outgoingBuffer_.GetSize();
+        outgoingBuffer_.WriteUByte((unsigned char)msgID);
+        outgoingBuffer_.Write(data, numBytes);
+        message.size_ = outgoingBuffer_.GetSize() - message.offset_;
+        message.reliable_ = reliable;
+        message.inOrder_ = inOrder;
+        outgoingMessages_.Push(message);
+        return;
+    }
+
     VectorBuffer buffer;
     buffer.WriteUByte((unsigned char)msgID);
     buffer.Write(data, numBytes);
@@ -176,6 +200,9 @@ void Connection::SetScene(Scene* newScene)
     if (isClient_)
     {
         sceneState_.Clear();
+        distantNodes_.Clear();
+        snapshots_.Clear();
+        ackedSnapshot_ = 0;
 
         // When scene is assigned on the server, instruct the client to load it. This may require downloading packages
         const Vector<SharedPtr<PackageFile> >& packages = scene_->GetRequiredPackageFiles();
@@ -244,6 +271,22 @@ void Connection::SendServerUpdate()
     if (!scene_ || !sceneLoaded_)
         return;
 
+    snapshotReplication_ = GetSubsystem<Network>()->GetSnapshotReplication();
+
+    // If the scene has a replication grid, only nodes near the observer need to be considered for interest management
+    grid_ = scene_->GetComponent<ReplicationGrid>();
+    if (grid_)
+    {
+        interestCells_ = grid_->GetInterestCells(position_);
+        RestoreNearbyNodes();
+    }
+    else if (!distantNodes_.Empty())
+    {
+        // The replication grid has been removed, so consider all nodes again
+        sceneState_.dirtyNodes_.Insert(distantNodes_);
+        distantNodes_.Clear();
+    }
+
     // Always check the root node (scene) first so that the scene-wide components get sent first,
     // and all other replicated nodes get added to the dirty set for sending the initial state
     unsigned sceneID = scene_->GetID();
@@ -259,6 +302,11 @@ void Connection::SendServerUpdate()
         unsigned nodeID = nodesToProcess_.Front();
         ProcessNode(nodeID);
     }
+
+    if (snapshotReplication_)
+        SendSnapshot();
+
+    grid_ = nullptr;
 }
 
 void Connection::SendClientUpdate()
@@ -272,6 +320,7 @@ void Connection::SendClientUpdate()
     msg_.WriteFloat(controls_.pitch_);
     msg_.WriteVariantMap(controls_.extraData_);
     msg_.WriteUByte(timeStamp_);
+    msg_.WriteVLE(snapshots_.GetNewestSequence());
     if (sendMode_ >= OPSM_POSITION)
         msg_.WriteVector3(position_);
     if (sendMode_ >= OPSM_POSITION_ROTATION)
@@ -350,6 +399,27 @@ void Connection::SendPackages()
     }
 }
 
+void Connection::SetBufferMessages(bool enable)
+{
+    bufferMessages_ = enable;
+    if (enable || outgoingMessages_.Empty())
+        return;
+
+    if (peer_)
+    {
+        const auto* data = (const char*)outgoingBuffer_.GetData();
+        for (PODVector<BufferedMessage>::ConstIterator i = outgoingMessages_.Begin(); i != outgoingMessages_.End(); ++i)
+        {
+            PacketReliability reliability = i->reliable_ ? (i->inOrder_ ? RELIABLE_ORDERED : RELIABLE) :
+                (i->inOrder_ ? UNRELIABLE_SEQUENCED : UNRELIABLE);
+            peer_->Send(data + i->offset_, (int)i->size_, HIGH_PRIORITY, reliability, (char)0, *address_, false);
+        }
+    }
+
+    outgoingBuffer_.Clear();
+    outgoingMessages_.Clear();
+}
+
 void Connection::ProcessPendingLatestData()
 {
     if (!scene_ || !sceneLoaded_)
@@ -438,6 +508,10 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
         ProcessPackageInfo(msgID, msg);
         break;
 
+    case MSG_SNAPSHOT:
+        ProcessSnapshot(msgID, msg);
+        break;
+
     default:
         processed = false;
         break;
@@ -471,9 +545,11 @@ void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
     // Store the scene file name we need to eventually load
     sceneFileName_ = msg.ReadString();
 
-    // Clear previous pending latest data and package downloads if any
+    // Clear previous pending latest data, snapshots and package downloads if any
     nodeLatestData_.Clear();
     componentLatestData_.Clear();
+    snapshots_.Clear();
+    interpolatedSnapshot_ = 0;
     downloads_.Clear();
 
     // In case we have joined other scenes in this session, remove first all downloaded package files from the resource system
@@ -543,7 +619,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             }
 
             // Read initial attributes, then snap the motion smoothing immediately to the end
-            node->ReadDeltaUpdate(msg);
+            node->ReadDeltaUpdate(msg, true);
             auto* transform = node->GetComponent<SmoothedTransform>();
             if (transform)
                 transform->Update(1.0f, 0.0f);
@@ -583,7 +659,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
                 }
 
                 // Read initial attributes and apply
-                component->ReadDeltaUpdate(msg);
+                component->ReadDeltaUpdate(msg, true);
                 component->ApplyAttributes();
             }
         }
@@ -623,7 +699,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             }
             else
             {
-                // Latest data messages may be received out-of-order relative to node creation, so cache if necessary
+                // Latest data messages are sent in order with node creation, but cache in case the node is not available yet
                 PODVector<unsigned char>& data = nodeLatestData_[nodeID];
                 data.Resize(msg.GetSize());
                 memcpy(&data[0], msg.GetData(), msg.GetSize());
@@ -667,7 +743,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
                 }
 
                 // Read initial attributes and apply
-                component->ReadDeltaUpdate(msg);
+                component->ReadDeltaUpdate(msg, true);
                 component->ApplyAttributes();
             }
             else
@@ -700,7 +776,7 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             }
             else
             {
-                // Latest data messages may be received out-of-order relative to component creation, so cache if necessary
+                // Latest data messages are sent in order with component creation, but cache in case the component is not available yet
                 PODVector<unsigned char>& data = componentLatestData_[componentID];
                 data.Resize(msg.GetSize());
                 memcpy(&data[0], msg.GetData(), msg.GetSize());
@@ -902,6 +978,11 @@ void Connection::ProcessControls(int msgID, MemoryBuffer& msg)
     SetControls(newControls);
     timeStamp_ = msg.ReadUByte();
 
+    // Controls also acknowledge the newest received snapshot. As they are unreliable, only accept newer acknowledgements
+    unsigned ackedSnapshot = msg.ReadVLE();
+    if (ackedSnapshot > ackedSnapshot_ && ackedSnapshot <= snapshotSequence_)
+        ackedSnapshot_ = ackedSnapshot;
+
     // Client may or may not send observer position & rotation for interest management
     if (!msg.IsEof())
         position_ = msg.ReadVector3();
@@ -1145,6 +1226,7 @@ void Connection::ProcessNode(unsigned nodeID)
             // information at the time of receiving this message
             SendMessage(MSG_REMOVENODE, true, true, msg_);
             sceneState_.nodeStates_.Erase(nodeID);
+            distantNodes_.Erase(nodeID);
         }
         else
             ProcessExistingNode(node, i->second_);
@@ -1184,7 +1266,7 @@ void Connection::ProcessNewNode(Node* node)
     node->AddReplicationState(&nodeState);
 
     // Write node's attributes
-    node->WriteInitialDeltaUpdate(msg_, timeStamp_);
+    node->WriteInitialDeltaUpdate(msg_, nodeState.quantizedValues_, timeStamp_);
 
     // Write node's user variables
     const VariantMap& vars = node->GetVars();
@@ -1213,7 +1295,7 @@ void Connection::ProcessNewNode(Node* node)
 
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
-        component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+        component->WriteInitialDeltaUpdate(msg_, componentState.quantizedValues_, timeStamp_);
     }
 
     SendMessage(MSG_CREATENODE, true, true, msg_);
@@ -1234,13 +1316,36 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     }
 
     // Check from the interest management component, if exists, whether should update
-    /// \todo Searching for the component is a potential CPU hotspot. It should be cached
-    auto* priority = node->GetComponent<NetworkPriority>();
-    if (priority && (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this))
+    if (grid_)
     {
-        float distance = (node->GetWorldPosition() - position_).Length();
-        if (!priority->CheckUpdate(distance, nodeState.priorityAcc_))
-            return;
+        // Use the interest management data cached by the replication grid
+        const ReplicationGridEntry* entry = grid_->GetEntry(node->GetID());
+        if (entry && (!entry->priority_->GetAlwaysUpdateOwner() || node->GetOwner() != this))
+        {
+            // Outside the interest cells the priority is zero. Set the node aside and leave it marked dirty, so that
+            // its changes do not return it to the dirty set until its cell comes near or it stops being cullable
+            if (entry->cullable_ && interestCells_.IsInside(entry->cell_) == OUTSIDE)
+            {
+                distantNodes_.Insert(node->GetID());
+                sceneState_.dirtyNodes_.Erase(node->GetID());
+                return;
+            }
+
+            float distance = (entry->position_ - position_).Length();
+            if (!entry->priority_->CheckUpdate(distance, nodeState.priorityAcc_))
+                return;
+        }
+    }
+    else
+    {
+        /// \todo Searching for the component is a potential CPU hotspot. Use a ReplicationGrid in the scene to cache it
+        auto* priority = node->GetComponent<NetworkPriority>();
+        if (priority && (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this))
+        {
+            float distance = (node->GetWorldPosition() - position_).Length();
+            if (!priority->CheckUpdate(distance, nodeState.priorityAcc_))
+                return;
+        }
     }
 
     // Check if attributes have changed
@@ -1259,14 +1364,15 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             }
         }
 
-        // Send latestdata message if necessary
-        if (hasLatestData)
+        // Send latestdata message if necessary. With snapshot replication the node transform is sent in snapshots instead
+        if (hasLatestData && !snapshotReplication_)
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteLatestDataUpdate(msg_, timeStamp_);
+            node->WriteLatestDataUpdate(msg_, nodeState.quantizedValues_, timeStamp_);
 
-            SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
+            // Send in order, as quantized attributes are delta encoded against the previously sent values
+            SendMessage(MSG_NODELATESTDATA, true, true, msg_, node->GetID());
         }
 
         // Send deltaupdate if remaining dirty bits, or vars have changed
@@ -1274,7 +1380,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_, timeStamp_);
+            node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_, nodeState.quantizedValues_, timeStamp_);
 
             // Write changed variables
             msg_.WriteVLE(nodeState.dirtyVars_.Size());
@@ -1342,9 +1448,9 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteLatestDataUpdate(msg_, timeStamp_);
+                    component->WriteLatestDataUpdate(msg_, componentState.quantizedValues_, timeStamp_);
 
-                    SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
+                    SendMessage(MSG_COMPONENTLATESTDATA, true, true, msg_, component->GetID());
                 }
 
                 // Send deltaupdate if remaining dirty bits
@@ -1352,7 +1458,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_);
+                    component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, componentState.quantizedValues_, timeStamp_);
 
                     SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
 
@@ -1387,7 +1493,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 msg_.WriteNetID(node->GetID());
                 msg_.WriteStringHash(component->GetType());
                 msg_.WriteNetID(component->GetID());
-                component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+                component->WriteInitialDeltaUpdate(msg_, componentState.quantizedValues_, timeStamp_);
 
                 SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
             }
@@ -1398,6 +1504,53 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     sceneState_.dirtyNodes_.Erase(node->GetID());
 }
 
+void Connection::RestoreNearbyNodes()
+{
+    if (distantNodes_.Empty())
+        return;
+
+    // Nodes no longer culled by the grid need to be processed regardless of their cell. Removed nodes are returned to the
+    // dirty set by the scene
+    const PODVector<unsigned>& unculledNodes = grid_->GetUnculledNodes();
+    for (PODVector<unsigned>::ConstIterator i = unculledNodes.Begin(); i != unculledNodes.End(); ++i)
+    {
+        if (distantNodes_.Erase(*i))
+            sceneState_.dirtyNodes_.Insert(*i);
+    }
+
+    // Visit the interest cells, or the occupied cells when there are fewer of them
+    const PODVector<IntVector2>& occupiedCells = grid_->GetOccupiedCells();
+    if ((unsigned long long)interestCells_.Width() * interestCells_.Height() <= occupiedCells.Size())
+    {
+        for (int y = interestCells_.top_; y < interestCells_.bottom_; ++y)
+        {
+            for (int x = interestCells_.left_; x < interestCells_.right_; ++x)
+                RestoreCellNodes(IntVector2(x, y));
+        }
+    }
+    else
+    {
+        for (PODVector<IntVector2>::ConstIterator i = occupiedCells.Begin(); i != occupiedCells.End(); ++i)
+        {
+            if (interestCells_.IsInside(*i) != OUTSIDE)
+                RestoreCellNodes(*i);
+        }
+    }
+}
+
+void Connection::RestoreCellNodes(const IntVector2& cell)
+{
+    const PODVector<unsigned>* nodes = grid_->GetCellNodes(cell);
+    if (!nodes)
+        return;
+
+    for (PODVector<unsigned>::ConstIterator i = nodes->Begin(); i != nodes->End(); ++i)
+    {
+        if (distantNodes_.Erase(*i))
+            sceneState_.dirtyNodes_.Insert(*i);
+    }
+}
+
 bool Connection::RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg)
 {
     auto* cache = GetSubsystem<ResourceCache>();
@@ -1568,6 +1721,129 @@ void Connection::ProcessPackageInfo(int msgID, MemoryBuffer& msg)
     RequestNeededPackages(1, msg);
 }
 
+void Connection::ProcessSnapshot(int msgID, MemoryBuffer& msg)
+{
+    if (IsClient())
+    {
+        URHO3D_LOGWARNING("Received unexpected Snapshot message from client");
+        return;
+    }
+
+    if (!scene_ || !sceneLoaded_)
+        return;
+
+    if (!snapshotFormat_)
+        snapshotFormat_ = new SnapshotFormat(context_);
+
+    // Outdated snapshots and snapshots whose baseline is no longer buffered are dropped; the server will resend against
+    // an older acknowledged baseline or in full
+    snapshotFormat_->Read(msg, snapshots_);
+}
+
+void Connection::SendSnapshot()
+{
+    if (!snapshotFormat_)
+        snapshotFormat_ = new SnapshotFormat(context_);
+
+    Snapshot* snapshot = snapshots_.Add(++snapshotSequence_);
+    snapshot->time_ = GetSubsystem<Time>()->GetElapsedTime();
+    snapshot->nodes_.Clear();
+
+    // Include the nodes the client has received, except for the scene itself and the nodes set aside by interest management
+    for (HashMap<unsigned, NodeReplicationState>::ConstIterator i = sceneState_.nodeStates_.Begin();
+         i != sceneState_.nodeStates_.End(); ++i)
+    {
+        Node* node = i->second_.node_;
+        if (!node || node == scene_ || distantNodes_.Contains(i->first_))
+            continue;
+
+        SnapshotNode snapshotNode;
+        snapshotNode.nodeID_ = i->first_;
+        snapshotFormat_->Quantize(node->GetPosition(), node->GetRotation(), snapshotNode.values_);
+        snapshot->nodes_.Push(snapshotNode);
+    }
+
+    Sort(snapshot->nodes_.Begin(), snapshot->nodes_.End(), [](const SnapshotNode& lhs, const SnapshotNode& rhs)
+    {
+        return lhs.nodeID_ < rhs.nodeID_;
+    });
+
+    // Delta encode against the newest snapshot the client has acknowledged, if it is still buffered
+    const Snapshot* baseline = nullptr;
+    if (ackedSnapshot_ && snapshotSequence_ - ackedSnapshot_ < SNAPSHOT_BUFFER_SIZE)
+        baseline = snapshots_.Get(ackedSnapshot_);
+
+    msg_.Clear();
+    snapshotFormat_->Write(msg_, *snapshot, baseline);
+    SendMessage(MSG_SNAPSHOT, false, false, msg_);
+}
+
+void Connection::InterpolateSnapshots(float timeStep)
+{
+    const Snapshot* newest = snapshots_.GetNewest();
+    if (!scene_ || !sceneLoaded_ || !newest || !snapshotFormat_)
+        return;
+
+    // Play back behind the newest snapshot by the interpolation delay. Follow the server clock smoothly, but jump if
+    // too far off, e.g. after the first snapshot or a long stall
+    float targetTime = newest->time_ - GetSubsystem<Network>()->GetInterpolationDelay();
+    snapshotTime_ += timeStep;
+    float error = targetTime - snapshotTime_;
+    if (Abs(error) > 1.0f)
+        snapshotTime_ = targetTime;
+    else
+        snapshotTime_ += error * 0.1f;
+
+    const Snapshot* from;
+    const Snapshot* to;
+    snapshots_.GetInterpolationSnapshots(snapshotTime_, from, to);
+    if (!from)
+        return;
+
+    float t = 0.0f;
+    if (to && to->time_ > from->time_)
+        t = Clamp((snapshotTime_ - from->time_) / (to->time_ - from->time_), 0.0f, 1.0f);
+
+    bool newFrom = from->sequence_ != interpolatedSnapshot_;
+    interpolatedSnapshot_ = from->sequence_;
+
+    for (PODVector<SnapshotNode>::ConstIterator i = from->nodes_.Begin(); i != from->nodes_.End(); ++i)
+    {
+        const SnapshotNode* toNode = to ? to->FindNode(i->nodeID_) : nullptr;
+        bool moving = toNode && memcmp(i->values_, toNode->values_, sizeof i->values_) != 0;
+        // A stationary node only needs to be set once per snapshot
+        if (!moving && !newFrom)
+            continue;
+
+        Node* node = scene_->GetNode(i->nodeID_);
+        if (!node)
+            continue;
+
+        Vector3 position;
+        Quaternion rotation;
+        snapshotFormat_->Dequantize(i->values_, position, rotation);
+        if (moving)
+        {
+            Vector3 toPosition;
+            Quaternion toRotation;
+            snapshotFormat_->Dequantize(toNode->values_, toPosition, toRotation);
+            position = position.Lerp(toPosition, t);
+            rotation = rotation.Slerp(toRotation, t);
+        }
+
+        // The snapshots are already interpolated, so snap the motion smoothing to the interpolated transform
+        auto* transform = node->GetComponent<SmoothedTransform>();
+        if (transform)
+        {
+            transform->SetTargetPosition(position);
+            transform->SetTargetRotation(rotation);
+            transform->Update(1.0f, 0.0f);
+        }
+        else if (position != node->GetPosition() || rotation != node->GetRotation())
+            node->SetTransform(position, rotation);
+    }
+}
+
 String Connection::GetAddress() const {
     return String(address_->ToString(false /*write port*/)); 
 }
@@ -27,6 +27,7 @@
 #include "../Core/Timer.h"
 #include "../Input/Controls.h"
 #include "../IO/VectorBuffer.h"
+#include "../Network/Snapshot.h"
 #include "../Scene/ReplicationState.h"
 
 namespace SLNet
@@ -48,6 +49,7 @@ class Node;
 class Scene;
 class Serializable;
 class PackageFile;
+class ReplicationGrid;
 
 /// Queued remote event.
 struct RemoteEvent
@@ -96,6 +98,19 @@ struct PackageUpload
     unsigned totalFragments_;
 };
 
+/// Outgoing message buffered while building a server update in a worker thread.
+struct BufferedMessage
+{
+    /// Offset of the message in the buffer, starting with the message ID byte.
+    unsigned offset_;
+    /// Size of the message in bytes, including the message ID byte.
+    unsigned size_;
+    /// Reliable flag.
+    bool reliable_;
+    /// In order flag.
+    bool inOrder_;
+};
+
 /// Send modes for observer position/rotation. Activated by the client setting either position or rotation.
 enum ObserverPositionSendMode
 {
@@ -147,8 +162,12 @@ public:
     void SendRemoteEvents();
     /// Send package files to client. Called by network.
     void SendPackages();
+    /// Set whether to buffer outgoing messages instead of sending them immediately. When disabled, the buffered messages are sent. Used by Network to build server updates in worker threads.
+    void SetBufferMessages(bool enable);
     /// Process pending latest data for nodes and components.
     void ProcessPendingLatestData();
+    /// Advance the snapshot playback time and apply the interpolated node transforms from the received snapshots. Called by Network on the client.
+    void InterpolateSnapshots(float timeStep);
     /// Process a message from the server or client. Called by Network.
     bool ProcessMessage(int msgID, MemoryBuffer& msg);
     /// Ban this connections IP address.
@@ -255,12 +274,20 @@ private:
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
     /// Process a remote event message from the client or server. Called by Network.
     void ProcessRemoteEvent(int msgID, MemoryBuffer& msg);
+    /// Process a Snapshot message from the server. Called by Network.
+    void ProcessSnapshot(int msgID, MemoryBuffer& msg);
     /// Process a node for sending a network update. Recurses to process depended on node(s) first.
     void ProcessNode(unsigned nodeID);
     /// Process a node that the client has not yet received.
     void ProcessNewNode(Node* node);
     /// Process a node that the client has already received.
     void ProcessExistingNode(Node* node, NodeReplicationState& nodeState);
+    /// Return dirty nodes that were set aside by interest management to the dirty set, if they are within the observer's interest cells or no longer cullable.
+    void RestoreNearbyNodes();
+    /// Return the set aside nodes of a replication grid cell to the dirty set.
+    void RestoreCellNodes(const IntVector2& cell);
+    /// Send a snapshot of the transforms of the nodes the client has received, delta encoded against the last snapshot the client acknowledged.
+    void SendSnapshot();
     /// Process a SyncPackagesInfo message from server.
     void ProcessPackageInfo(int msgID, MemoryBuffer& msg);
     /// Check a package list received from server and initiate package downloads as necessary. Return true on success, or false if failed to initialze downloads (cache dir not set)
@@ -290,8 +317,30 @@ private:
     HashMap<unsigned, PODVector<unsigned char> > componentLatestData_;
     /// Node ID's to process during a replication update.
     HashSet<unsigned> nodesToProcess_;
+    /// Dirty node ID's set aside because they are too far from the observer to receive updates. They stay marked dirty, and are restored when their replication grid cell comes within the interest radius.
+    HashSet<unsigned> distantNodes_;
+    /// Replication grid of the scene during a replication update.
+    ReplicationGrid* grid_;
+    /// Replication grid cells within the interest radius of the observer during a replication update.
+    IntRect interestCells_;
+    /// Snapshot encoding. Created on first use.
+    UniquePtr<SnapshotFormat> snapshotFormat_;
+    /// Sent snapshots on the server, or received snapshots on the client.
+    SnapshotBuffer snapshots_;
+    /// Sequence number of the last sent snapshot.
+    unsigned snapshotSequence_;
+    /// Sequence number of the newest snapshot acknowledged by the client.
+    unsigned ackedSnapshot_;
+    /// Snapshot playback time on the client.
+    float snapshotTime_;
+    /// Sequence number of the snapshot interpolated from on the previous frame on the client.
+    unsigned interpolatedSnapshot_;
     /// Reusable message buffer.
     VectorBuffer msg_;
+    /// Buffered outgoing message data.
+    VectorBuffer outgoingBuffer_;
+    /// Buffered outgoing messages.
+    PODVector<BufferedMessage> outgoingMessages_;
     /// Queued remote events.
     Vector<RemoteEvent> remoteEvents_;
     /// Scene file to load once all packages (if any) have been downloaded.
@@ -314,6 +363,10 @@ private:
     bool sceneLoaded_;
     /// Show statistics flag.
     bool logStatistics_;
+    /// Buffer outgoing messages flag.
+    bool bufferMessages_;
+    /// Snapshot replication flag during a replication update.
+    bool snapshotReplication_;
     /// Address of this connection.
     SLNet::AddressOrGUID* address_;
     /// Raknet peer object.
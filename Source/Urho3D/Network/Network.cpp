@@ -25,6 +25,7 @@
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Engine/EngineEvents.h"
 #include "../IO/FileSystem.h"
 #include "../Input/InputEvents.h"
@@ -36,6 +37,7 @@
 #include "../Network/NetworkEvents.h"
 #include "../Network/NetworkPriority.h"
 #include "../Network/Protocol.h"
+#include "../Network/ReplicationGrid.h"
 #include "../Scene/Scene.h"
 
 #include <SLikeNet/MessageIdentifiers.h>
@@ -192,6 +194,7 @@ static const char* RAKNET_MESSAGEID_STRINGS[] = {
 
 static const int DEFAULT_UPDATE_FPS = 30;
 static const int SERVER_TIMEOUT_TIME = 10000;
+static const float DEFAULT_INTERPOLATION_DELAY = 0.1f;
 
 Network::Network(Context* context) :
     Object(context),
@@ -200,6 +203,8 @@ Network::Network(Context* context) :
     simulatedPacketLoss_(0.0f),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
     updateAcc_(0.0f),
+    interpolationDelay_(DEFAULT_INTERPOLATION_DELAY),
+    snapshotReplication_(false),
     isServer_(false),
     scene_(nullptr),
     natPunchServerAddress_(nullptr),
@@ -596,6 +601,16 @@ void Network::SetSimulatedPacketLoss(float probability)
     ConfigureNetworkSimulator();
 }
 
+void Network::SetSnapshotReplication(bool enable)
+{
+    snapshotReplication_ = enable;
+}
+
+void Network::SetInterpolationDelay(float delay)
+{
+    interpolationDelay_ = Max(delay, 0.0f);
+}
+
 void Network::RegisterRemoteEvent(StringHash eventType)
 {
     if (blacklistedRemoteEvents_.Find(eventType) != blacklistedRemoteEvents_.End())
@@ -927,6 +942,10 @@ void Network::PostUpdate(float timeStep)
 {
     URHO3D_PROFILE(PostUpdateNetwork);
 
+    // Interpolate the node transforms received in snapshots every frame
+    if (serverConnection_)
+        serverConnection_->InterpolateSnapshots(timeStep);
+
     // Check if periodic update should happen now
     updateAcc_ += timeStep;
     bool updateNow = updateAcc_ >= updateInterval_;
@@ -952,19 +971,48 @@ void Network::PostUpdate(float timeStep)
                 }
 
                 for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
+                {
                     (*i)->PrepareNetworkUpdate();
+                    auto* grid = (*i)->GetComponent<ReplicationGrid>();
+                    if (grid)
+                        grid->Update();
+                }
             }
 
             {
                 URHO3D_PROFILE(SendServerUpdate);
 
-                // Then send server updates for each client connection
+                // Then build server updates for each client connection in worker threads. The prepared network state of the
+                // scenes is only read, and each connection buffers its messages so that they can be sent from the main thread
+                updateConnections_.Clear();
                 for (HashMap<SLNet::AddressOrGUID, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
                      i != clientConnections_.End(); ++i)
                 {
-                    i->second_->SendServerUpdate();
-                    i->second_->SendRemoteEvents();
-                    i->second_->SendPackages();
+                    i->second_->SetBufferMessages(true);
+                    updateConnections_.Push(i->second_.Get());
+                }
+
+                for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
+                    (*i)->BeginThreadedUpdate();
+
+                Connection** connections = updateConnections_.Begin().ptr_;
+                GetSubsystem<WorkQueue>()->ParallelFor(updateConnections_.Size(), 1,
+                    [connections](unsigned start, unsigned end, unsigned /*threadIndex*/)
+                    {
+                        for (unsigned i = start; i < end; ++i)
+                        {
+                            connections[i]->SendServerUpdate();
+                            connections[i]->SendRemoteEvents();
+                        }
+                    });
+
+                for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
+                    (*i)->EndThreadedUpdate();
+
+                for (PODVector<Connection*>::ConstIterator i = updateConnections_.Begin(); i != updateConnections_.End(); ++i)
+                {
+                    (*i)->SetBufferMessages(false);
+                    (*i)->SendPackages();
                 }
             }
         }
@@ -1040,6 +1088,7 @@ void Network::ConfigureNetworkSimulator()
 void RegisterNetworkLibrary(Context* context)
 {
     NetworkPriority::RegisterObject(context);
+    ReplicationGrid::RegisterObject(context);
 }
 
 }
@@ -90,6 +90,10 @@ public:
     void SetSimulatedLatency(int ms);
     /// Set simulated packet loss probability between 0.0 - 1.0.
     void SetSimulatedPacketLoss(float probability);
+    /// Set whether to replicate node transforms as delta encoded snapshots instead of latest data messages. Server only.
+    void SetSnapshotReplication(bool enable);
+    /// Set how far behind the newest received snapshot the client plays back node transforms, in seconds. Client only.
+    void SetInterpolationDelay(float delay);
     /// Register a remote event as allowed to be received. There is also a fixed blacklist of events that can not be allowed in any case, such as ConsoleCommand.
     void RegisterRemoteEvent(StringHash eventType);
     /// Unregister a remote event as allowed to received.
@@ -113,6 +117,12 @@ public:
     /// Return simulated packet loss probability.
     float GetSimulatedPacketLoss() const { return simulatedPacketLoss_; }
 
+    /// Return whether node transforms are replicated as snapshots.
+    bool GetSnapshotReplication() const { return snapshotReplication_; }
+
+    /// Return snapshot interpolation delay in seconds.
+    float GetInterpolationDelay() const { return interpolationDelay_; }
+
     /// Return a client or server connection by kNet MessageConnection, or null if none exist.
     Connection* GetConnection(const SLNet::AddressOrGUID& connection) const;
     /// Return the connection to the server. Null if not connected.
@@ -160,6 +170,8 @@ private:
     HashSet<StringHash> blacklistedRemoteEvents_;
     /// Networked scenes.
     HashSet<Scene*> networkScenes_;
+    /// Client connections receiving a server update, collected for building the updates in worker threads.
+    PODVector<Connection*> updateConnections_;
     /// Update FPS.
     int updateFps_;
     /// Simulated latency (send delay) in milliseconds.
@@ -170,6 +182,10 @@ private:
     float updateInterval_;
     /// Update time accumulator.
     float updateAcc_;
+    /// Snapshot interpolation delay in seconds.
+    float interpolationDelay_;
+    /// Snapshot replication flag.
+    bool snapshotReplication_;
     /// Package cache directory.
     String packageCacheDir_;
     /// Whether we started as server or not.
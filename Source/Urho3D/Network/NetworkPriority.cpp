@@ -24,6 +24,8 @@
 
 #include "../Core/Context.h"
 #include "../Network/NetworkPriority.h"
+#include "../Network/ReplicationGrid.h"
+#include "../Scene/Scene.h"
 
 #include "../DebugNew.h"
 
@@ -39,6 +41,7 @@ static const float UPDATE_THRESHOLD = 100.0f;
 
 NetworkPriority::NetworkPriority(Context* context) :
     Component(context),
+    grid_(nullptr),
     basePriority_(DEFAULT_BASE_PRIORITY),
     distanceFactor_(DEFAULT_DISTANCE_FACTOR),
     minPriority_(DEFAULT_MIN_PRIORITY),
@@ -46,7 +49,11 @@ NetworkPriority::NetworkPriority(Context* context) :
 {
 }
 
-NetworkPriority::~NetworkPriority() = default;
+NetworkPriority::~NetworkPriority()
+{
+    if (grid_)
+        grid_->RemovePriority(this);
+}
 
 void NetworkPriority::RegisterObject(Context* context)
 {
@@ -95,4 +102,17 @@ bool NetworkPriority::CheckUpdate(float distance, float& accumulator)
         return false;
 }
 
+void NetworkPriority::OnSceneSet(Scene* scene)
+{
+    if (grid_)
+        grid_->RemovePriority(this);
+
+    if (scene)
+    {
+        auto* grid = scene->GetComponent<ReplicationGrid>();
+        if (grid)
+            grid->AddPriority(this);
+    }
+}
+
 }
@@ -27,6 +27,8 @@
 namespace Urho3D
 {
 
+class ReplicationGrid;
+
 /// %Network interest management settings component.
 class URHO3D_API NetworkPriority : public Component
 {
@@ -64,7 +66,19 @@ public:
     /// Increment and check priority accumulator. Return true if should update. Called by Connection.
     bool CheckUpdate(float distance, float& accumulator);
 
+    /// Set the replication grid the component is registered to. Called by ReplicationGrid.
+    void SetReplicationGrid(ReplicationGrid* grid) { grid_ = grid; }
+
+    /// Return the replication grid the component is registered to.
+    ReplicationGrid* GetReplicationGrid() const { return grid_; }
+
+protected:
+    /// Handle scene being assigned.
+    void OnSceneSet(Scene* scene) override;
+
 private:
+    /// Replication grid.
+    ReplicationGrid* grid_;
     /// Base priority.
     float basePriority_;
     /// Priority reduction distance factor.
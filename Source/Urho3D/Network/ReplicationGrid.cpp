@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Network/NetworkPriority.h"
+#include "../Network/ReplicationGrid.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* NETWORK_CATEGORY;
+
+static const float DEFAULT_CELL_SIZE = 50.0f;
+
+ReplicationGrid::ReplicationGrid(Context* context) :
+    Component(context),
+    cellSize_(DEFAULT_CELL_SIZE),
+    maxInterestRadius_(0.0f)
+{
+}
+
+ReplicationGrid::~ReplicationGrid()
+{
+    for (PODVector<NetworkPriority*>::ConstIterator i = priorities_.Begin(); i != priorities_.End(); ++i)
+        (*i)->SetReplicationGrid(nullptr);
+}
+
+void ReplicationGrid::RegisterObject(Context* context)
+{
+    context->RegisterFactory<ReplicationGrid>(NETWORK_CATEGORY);
+
+    URHO3D_ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
+}
+
+void ReplicationGrid::SetCellSize(float size)
+{
+    cellSize_ = Max(size, M_EPSILON);
+    MarkNetworkUpdate();
+}
+
+void ReplicationGrid::AddPriority(NetworkPriority* priority)
+{
+    if (!priority || priorities_.Contains(priority))
+        return;
+
+    priorities_.Push(priority);
+    priority->SetReplicationGrid(this);
+}
+
+void ReplicationGrid::RemovePriority(NetworkPriority* priority)
+{
+    if (priorities_.RemoveSwap(priority))
+        priority->SetReplicationGrid(nullptr);
+}
+
+void ReplicationGrid::Update()
+{
+    entries_.Clear();
+    for (HashMap<IntVector2, PODVector<unsigned> >::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+        i->second_.Clear();
+    occupiedCells_.Clear();
+    previousCullableNodes_.Swap(cullableNodes_);
+    cullableNodes_.Clear();
+    unculledNodes_.Clear();
+    maxInterestRadius_ = 0.0f;
+
+    for (PODVector<NetworkPriority*>::ConstIterator i = priorities_.Begin(); i != priorities_.End(); ++i)
+    {
+        NetworkPriority* priority = *i;
+        Node* node = priority->GetNode();
+        // Like Node::GetComponent(), use the first interest management component of the node
+        if (!node || !node->IsReplicated() || entries_.Contains(node->GetID()))
+            continue;
+
+        ReplicationGridEntry& entry = entries_[node->GetID()];
+        entry.priority_ = priority;
+        entry.position_ = node->GetWorldPosition();
+        entry.cell_ = GetCell(entry.position_);
+
+        // With zero minimum priority a node gets no updates at all beyond the distance where its priority reaches zero
+        entry.cullable_ = priority->GetMinPriority() <= 0.0f && priority->GetDistanceFactor() > 0.0f;
+        if (entry.cullable_)
+        {
+            maxInterestRadius_ = Max(maxInterestRadius_, priority->GetBasePriority() / priority->GetDistanceFactor());
+            cullableNodes_.Push(node->GetID());
+        }
+
+        PODVector<unsigned>& cellNodes = cells_[entry.cell_];
+        if (cellNodes.Empty())
+            occupiedCells_.Push(entry.cell_);
+        cellNodes.Push(node->GetID());
+    }
+
+    occupiedBounds_ = occupiedCells_.Size() ? IntRect(M_MAX_INT, M_MAX_INT, M_MIN_INT, M_MIN_INT) : IntRect::ZERO;
+    for (PODVector<IntVector2>::ConstIterator i = occupiedCells_.Begin(); i != occupiedCells_.End(); ++i)
+    {
+        occupiedBounds_.left_ = Min(occupiedBounds_.left_, i->x_);
+        occupiedBounds_.top_ = Min(occupiedBounds_.top_, i->y_);
+        occupiedBounds_.right_ = Max(occupiedBounds_.right_, i->x_ + 1);
+        occupiedBounds_.bottom_ = Max(occupiedBounds_.bottom_, i->y_ + 1);
+    }
+
+    // Connections only look at the cells near their observer for the nodes they have set aside, so report the nodes that
+    // now need updates regardless of their cell
+    for (PODVector<unsigned>::ConstIterator i = previousCullableNodes_.Begin(); i != previousCullableNodes_.End(); ++i)
+    {
+        const ReplicationGridEntry* entry = GetEntry(*i);
+        if (!entry || !entry->cullable_)
+            unculledNodes_.Push(*i);
+    }
+}
+
+const ReplicationGridEntry* ReplicationGrid::GetEntry(unsigned nodeID) const
+{
+    HashMap<unsigned, ReplicationGridEntry>::ConstIterator i = entries_.Find(nodeID);
+    return i != entries_.End() ? &i->second_ : nullptr;
+}
+
+IntVector2 ReplicationGrid::GetCell(const Vector3& position) const
+{
+    return IntVector2(FloorToInt(position.x_ / cellSize_), FloorToInt(position.z_ / cellSize_));
+}
+
+IntRect ReplicationGrid::GetInterestCells(const Vector3& position) const
+{
+    // Clamp in floating point before converting, so that a very large interest radius can not overflow the cell range
+    Vector2 min((position.x_ - maxInterestRadius_) / cellSize_, (position.z_ - maxInterestRadius_) / cellSize_);
+    Vector2 max((position.x_ + maxInterestRadius_) / cellSize_, (position.z_ + maxInterestRadius_) / cellSize_);
+    const IntRect& bounds = occupiedBounds_;
+    return IntRect(
+        FloorToInt(Clamp(min.x_, (float)bounds.left_, (float)bounds.right_)),
+        FloorToInt(Clamp(min.y_, (float)bounds.top_, (float)bounds.bottom_)),
+        FloorToInt(Clamp(max.x_, (float)bounds.left_ - 1.0f, (float)bounds.right_ - 1.0f)) + 1,
+        FloorToInt(Clamp(max.y_, (float)bounds.top_ - 1.0f, (float)bounds.bottom_ - 1.0f)) + 1);
+}
+
+const PODVector<unsigned>* ReplicationGrid::GetCellNodes(const IntVector2& cell) const
+{
+    HashMap<IntVector2, PODVector<unsigned> >::ConstIterator i = cells_.Find(cell);
+    return i != cells_.End() && i->second_.Size() ? &i->second_ : nullptr;
+}
+
+void ReplicationGrid::OnSceneSet(Scene* scene)
+{
+    if (scene)
+    {
+        // Register the interest management components that already exist in the scene
+        PODVector<NetworkPriority*> priorities;
+        scene->GetComponents<NetworkPriority>(priorities, true);
+        for (PODVector<NetworkPriority*>::ConstIterator i = priorities.Begin(); i != priorities.End(); ++i)
+        {
+            if (!(*i)->GetReplicationGrid())
+                AddPriority(*i);
+        }
+    }
+    else
+    {
+        for (PODVector<NetworkPriority*>::ConstIterator i = priorities_.Begin(); i != priorities_.End(); ++i)
+            (*i)->SetReplicationGrid(nullptr);
+        priorities_.Clear();
+        entries_.Clear();
+        cells_.Clear();
+        occupiedCells_.Clear();
+        occupiedBounds_ = IntRect::ZERO;
+        cullableNodes_.Clear();
+        previousCullableNodes_.Clear();
+        unculledNodes_.Clear();
+    }
+}
+
+}
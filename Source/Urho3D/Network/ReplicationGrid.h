@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Math/Rect.h"
+#include "../Math/Vector2.h"
+#include "../Math/Vector3.h"
+#include "../Scene/Component.h"
+
+namespace Urho3D
+{
+
+class Connection;
+class NetworkPriority;
+
+/// Cached interest management data of a replicated node.
+struct ReplicationGridEntry
+{
+    /// Interest management component of the node.
+    NetworkPriority* priority_;
+    /// World position of the node.
+    Vector3 position_;
+    /// Grid cell of the node.
+    IntVector2 cell_;
+    /// Whether the node receives no updates outside the grid's maximum interest radius.
+    bool cullable_;
+};
+
+/// %Scene component that indexes the NetworkPriority nodes into a grid of cells on the XZ plane, so that connections only need to consider nodes near their observer position for interest management.
+class URHO3D_API ReplicationGrid : public Component
+{
+    URHO3D_OBJECT(ReplicationGrid, Component);
+
+public:
+    /// Construct.
+    explicit ReplicationGrid(Context* context);
+    /// Destruct.
+    ~ReplicationGrid() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Set cell size in world units. Should be of the same magnitude as the interest radii (base priority divided by distance factor) of the nodes.
+    void SetCellSize(float size);
+    /// Add an interest management component. Called by NetworkPriority.
+    void AddPriority(NetworkPriority* priority);
+    /// Remove an interest management component. Called by NetworkPriority.
+    void RemovePriority(NetworkPriority* priority);
+    /// Update node positions and cells. Called by Network before sending server updates.
+    void Update();
+
+    /// Return cell size.
+    float GetCellSize() const { return cellSize_; }
+
+    /// Return the largest interest radius of the cullable nodes.
+    float GetMaxInterestRadius() const { return maxInterestRadius_; }
+
+    /// Return the cached interest management data of a node, or null if the node has no NetworkPriority component.
+    const ReplicationGridEntry* GetEntry(unsigned nodeID) const;
+    /// Return the cell containing a world position.
+    IntVector2 GetCell(const Vector3& position) const;
+    /// Return the range of cells (right and bottom exclusive) outside which cullable nodes receive no updates for an observer position. Clamped to the occupied cells.
+    IntRect GetInterestCells(const Vector3& position) const;
+    /// Return the IDs of nodes in a cell, or null if the cell is empty.
+    const PODVector<unsigned>* GetCellNodes(const IntVector2& cell) const;
+    /// Return the cells which contain nodes.
+    const PODVector<IntVector2>& GetOccupiedCells() const { return occupiedCells_; }
+    /// Return the IDs of nodes which were cullable on the previous update, but are no longer cullable or have left the grid.
+    const PODVector<unsigned>& GetUnculledNodes() const { return unculledNodes_; }
+
+protected:
+    /// Handle scene being assigned.
+    void OnSceneSet(Scene* scene) override;
+
+private:
+    /// Registered interest management components.
+    PODVector<NetworkPriority*> priorities_;
+    /// Cached data by node ID.
+    HashMap<unsigned, ReplicationGridEntry> entries_;
+    /// Node IDs by cell. Cells which become empty keep their vectors for reuse.
+    HashMap<IntVector2, PODVector<unsigned> > cells_;
+    /// Cells which contain nodes.
+    PODVector<IntVector2> occupiedCells_;
+    /// Range of the occupied cells, right and bottom exclusive.
+    IntRect occupiedBounds_;
+    /// IDs of the cullable nodes.
+    PODVector<unsigned> cullableNodes_;
+    /// IDs of the cullable nodes on the previous update.
+    PODVector<unsigned> previousCullableNodes_;
+    /// IDs of nodes which stopped being cullable on the last update.
+    PODVector<unsigned> unculledNodes_;
+    /// Cell size.
+    float cellSize_;
+    /// Largest interest radius of the cullable nodes.
+    float maxInterestRadius_;
+};
+
+}
@@ -0,0 +1,320 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../IO/BitStream.h"
+#include "../Network/Snapshot.h"
+#include "../Scene/Node.h"
+
+#include <cstring>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const AttributeInfo* FindNetworkAttribute(const Vector<AttributeInfo>* attributes, const char* name)
+{
+    if (!attributes)
+        return nullptr;
+
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        if (attributes->At(i).name_ == name)
+            return &attributes->At(i);
+    }
+
+    return nullptr;
+}
+
+const SnapshotNode* Snapshot::FindNode(unsigned nodeID) const
+{
+    unsigned first = 0;
+    unsigned last = nodes_.Size();
+    while (first < last)
+    {
+        unsigned middle = (first + last) >> 1u;
+        if (nodes_[middle].nodeID_ < nodeID)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first < nodes_.Size() && nodes_[first].nodeID_ == nodeID ? &nodes_[first] : nullptr;
+}
+
+SnapshotBuffer::SnapshotBuffer() :
+    snapshots_(SNAPSHOT_BUFFER_SIZE),
+    newestSequence_(0)
+{
+}
+
+Snapshot* SnapshotBuffer::Add(unsigned sequence)
+{
+    Snapshot& snapshot = snapshots_[sequence % SNAPSHOT_BUFFER_SIZE];
+    if (!sequence || snapshot.sequence_ >= sequence)
+        return nullptr;
+
+    snapshot.sequence_ = sequence;
+    newestSequence_ = Max(newestSequence_, sequence);
+    return &snapshot;
+}
+
+void SnapshotBuffer::Clear()
+{
+    for (unsigned i = 0; i < snapshots_.Size(); ++i)
+    {
+        snapshots_[i].sequence_ = 0;
+        snapshots_[i].nodes_.Clear();
+    }
+    newestSequence_ = 0;
+}
+
+const Snapshot* SnapshotBuffer::Get(unsigned sequence) const
+{
+    const Snapshot& snapshot = snapshots_[sequence % SNAPSHOT_BUFFER_SIZE];
+    return sequence && snapshot.sequence_ == sequence ? &snapshot : nullptr;
+}
+
+void SnapshotBuffer::GetInterpolationSnapshots(float time, const Snapshot*& from, const Snapshot*& to) const
+{
+    from = nullptr;
+    to = nullptr;
+
+    for (unsigned i = 0; i < snapshots_.Size(); ++i)
+    {
+        const Snapshot& snapshot = snapshots_[i];
+        if (!snapshot.sequence_)
+            continue;
+
+        if (snapshot.time_ <= time)
+        {
+            if (!from || snapshot.time_ > from->time_)
+                from = &snapshot;
+        }
+        else
+        {
+            if (!to || snapshot.time_ < to->time_)
+                to = &snapshot;
+        }
+    }
+}
+
+SnapshotFormat::SnapshotFormat(Context* context)
+{
+    const Vector<AttributeInfo>* attributes = context->GetNetworkAttributes(Node::GetTypeStatic());
+    position_ = FindNetworkAttribute(attributes, "Network Position");
+    rotation_ = FindNetworkAttribute(attributes, "Network Rotation");
+
+    // Values of attributes without quantization are sent as raw float bits
+    if (position_ && position_->type_ == VAR_VECTOR3 && GetNumQuantizedValues(*position_) == 3)
+    {
+        for (unsigned i = 0; i < 3; ++i)
+            bits_[i] = GetQuantizedBits(*position_, i);
+    }
+    else
+    {
+        position_ = nullptr;
+        for (unsigned i = 0; i < 3; ++i)
+            bits_[i] = 32;
+    }
+
+    if (rotation_ && rotation_->type_ == VAR_QUATERNION && GetNumQuantizedValues(*rotation_) == 4)
+    {
+        for (unsigned i = 0; i < 4; ++i)
+            bits_[3 + i] = GetQuantizedBits(*rotation_, i);
+    }
+    else
+    {
+        rotation_ = nullptr;
+        for (unsigned i = 0; i < 4; ++i)
+            bits_[3 + i] = 32;
+    }
+}
+
+void SnapshotFormat::Quantize(const Vector3& position, const Quaternion& rotation, unsigned* dest) const
+{
+    if (position_)
+        QuantizeAttributeValue(*position_, position, dest);
+    else
+        memcpy(dest, position.Data(), 3 * sizeof(float));
+
+    if (rotation_)
+        QuantizeAttributeValue(*rotation_, rotation, dest + 3);
+    else
+        memcpy(dest + 3, rotation.Data(), 4 * sizeof(float));
+}
+
+void SnapshotFormat::Dequantize(const unsigned* src, Vector3& position, Quaternion& rotation) const
+{
+    if (position_)
+        position = DequantizeAttributeValue(*position_, src).GetVector3();
+    else
+        memcpy(&position.x_, src, 3 * sizeof(float));
+
+    if (rotation_)
+        rotation = DequantizeAttributeValue(*rotation_, src + 3).GetQuaternion();
+    else
+        memcpy(&rotation.w_, src + 3, 4 * sizeof(float));
+}
+
+void SnapshotFormat::Write(Serializer& dest, const Snapshot& snapshot, const Snapshot* baseline) const
+{
+    static const SnapshotNode emptyNode{};
+
+    // Find the changed and removed nodes by walking both sorted node lists
+    PODVector<const SnapshotNode*> changedNodes;
+    PODVector<unsigned> removedNodes;
+    const PODVector<SnapshotNode>& nodes = snapshot.nodes_;
+    unsigned numBaselineNodes = baseline ? baseline->nodes_.Size() : 0;
+    unsigned i = 0;
+    unsigned j = 0;
+
+    while (i < nodes.Size() || j < numBaselineNodes)
+    {
+        if (j == numBaselineNodes || (i < nodes.Size() && nodes[i].nodeID_ < baseline->nodes_[j].nodeID_))
+            changedNodes.Push(&nodes[i++]);
+        else if (i == nodes.Size() || baseline->nodes_[j].nodeID_ < nodes[i].nodeID_)
+            removedNodes.Push(baseline->nodes_[j++].nodeID_);
+        else
+        {
+            if (memcmp(nodes[i].values_, baseline->nodes_[j].values_, sizeof nodes[i].values_))
+                changedNodes.Push(&nodes[i]);
+            ++i;
+            ++j;
+        }
+    }
+
+    dest.WriteUInt(snapshot.sequence_);
+    dest.WriteVLE(baseline ? snapshot.sequence_ - baseline->sequence_ : 0);
+    dest.WriteFloat(snapshot.time_);
+
+    // Node IDs are written as differences to the previous ID, and the values delta encoded against the baseline
+    BitSerializer bits(dest);
+    bits.WriteVLE(changedNodes.Size());
+    unsigned lastID = 0;
+    for (PODVector<const SnapshotNode*>::ConstIterator k = changedNodes.Begin(); k != changedNodes.End(); ++k)
+    {
+        const SnapshotNode& node = **k;
+        const SnapshotNode* baselineNode = baseline ? baseline->FindNode(node.nodeID_) : nullptr;
+        if (!baselineNode)
+            baselineNode = &emptyNode;
+
+        bits.WriteVLE(node.nodeID_ - lastID);
+        lastID = node.nodeID_;
+        for (unsigned l = 0; l < SNAPSHOT_NODE_VALUES; ++l)
+            bits.WriteDeltaBits(node.values_[l], baselineNode->values_[l], bits_[l]);
+    }
+
+    bits.WriteVLE(removedNodes.Size());
+    lastID = 0;
+    for (PODVector<unsigned>::ConstIterator k = removedNodes.Begin(); k != removedNodes.End(); ++k)
+    {
+        bits.WriteVLE(*k - lastID);
+        lastID = *k;
+    }
+}
+
+const Snapshot* SnapshotFormat::Read(Deserializer& source, SnapshotBuffer& buffer) const
+{
+    static const SnapshotNode emptyNode{};
+
+    unsigned sequence = source.ReadUInt();
+    unsigned baselineOffset = source.ReadVLE();
+    float time = source.ReadFloat();
+
+    const Snapshot* baseline = nullptr;
+    if (baselineOffset)
+    {
+        baseline = buffer.Get(sequence - baselineOffset);
+        if (!baseline || baselineOffset >= SNAPSHOT_BUFFER_SIZE)
+            return nullptr;
+    }
+
+    // Each changed node takes at least a byte for the ID and a bit per value, and each removed node a byte for the ID.
+    // Reject counts the message can not hold before allocating for them
+    BitDeserializer bits(source);
+    unsigned numChanged = bits.ReadVLE();
+    if (numChanged > bits.GetNumRemainingBits() / (8 + SNAPSHOT_NODE_VALUES))
+        return nullptr;
+    PODVector<SnapshotNode> changedNodes(numChanged);
+    unsigned lastID = 0;
+    for (unsigned i = 0; i < numChanged; ++i)
+    {
+        SnapshotNode& node = changedNodes[i];
+        lastID += bits.ReadVLE();
+        node.nodeID_ = lastID;
+
+        const SnapshotNode* baselineNode = baseline ? baseline->FindNode(node.nodeID_) : nullptr;
+        if (!baselineNode)
+            baselineNode = &emptyNode;
+        for (unsigned j = 0; j < SNAPSHOT_NODE_VALUES; ++j)
+            node.values_[j] = bits.ReadDeltaBits(baselineNode->values_[j], bits_[j]);
+    }
+
+    unsigned numRemoved = bits.ReadVLE();
+    if (numRemoved > bits.GetNumRemainingBits() / 8)
+        return nullptr;
+    PODVector<unsigned> removedNodes(numRemoved);
+    lastID = 0;
+    for (unsigned i = 0; i < numRemoved; ++i)
+    {
+        lastID += bits.ReadVLE();
+        removedNodes[i] = lastID;
+    }
+
+    Snapshot* snapshot = buffer.Add(sequence);
+    if (!snapshot)
+        return nullptr;
+    snapshot->time_ = time;
+    snapshot->nodes_.Clear();
+
+    // Merge the changes into the baseline nodes, keeping the order by ID
+    unsigned numBaselineNodes = baseline ? baseline->nodes_.Size() : 0;
+    unsigned i = 0;
+    unsigned j = 0;
+    unsigned k = 0;
+    while (i < changedNodes.Size() || j < numBaselineNodes)
+    {
+        if (j == numBaselineNodes || (i < changedNodes.Size() && changedNodes[i].nodeID_ <= baseline->nodes_[j].nodeID_))
+        {
+            // Changed node replaces the baseline node of the same ID
+            if (j < numBaselineNodes && changedNodes[i].nodeID_ == baseline->nodes_[j].nodeID_)
+                ++j;
+            snapshot->nodes_.Push(changedNodes[i++]);
+        }
+        else
+        {
+            const SnapshotNode& node = baseline->nodes_[j++];
+            while (k < removedNodes.Size() && removedNodes[k] < node.nodeID_)
+                ++k;
+            if (k == removedNodes.Size() || removedNodes[k] != node.nodeID_)
+                snapshot->nodes_.Push(node);
+        }
+    }
+
+    return snapshot;
+}
+
+}
@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/Quaternion.h"
+
+namespace Urho3D
+{
+
+class Context;
+class Deserializer;
+class Serializer;
+struct AttributeInfo;
+
+/// Number of quantized values of a node transform in a snapshot, three for the position and four for the rotation.
+static const unsigned SNAPSHOT_NODE_VALUES = 7;
+/// Number of snapshots kept for delta encoding and interpolation.
+static const unsigned SNAPSHOT_BUFFER_SIZE = 32;
+
+/// Quantized transform of a replicated node in a snapshot.
+struct SnapshotNode
+{
+    /// Node ID.
+    unsigned nodeID_;
+    /// Quantized position and rotation.
+    unsigned values_[SNAPSHOT_NODE_VALUES];
+};
+
+/// Transforms of the replicated nodes at a server network update.
+struct URHO3D_API Snapshot
+{
+    /// Return node by ID, or null if not included.
+    const SnapshotNode* FindNode(unsigned nodeID) const;
+
+    /// Sequence number. Zero if unused.
+    unsigned sequence_{};
+    /// Server time in seconds.
+    float time_{};
+    /// Nodes sorted by ID.
+    PODVector<SnapshotNode> nodes_;
+};
+
+/// Ring buffer of the most recent snapshots.
+class URHO3D_API SnapshotBuffer
+{
+public:
+    /// Construct.
+    SnapshotBuffer();
+
+    /// Return the slot for a new snapshot, replacing an older snapshot. Return null if the slot holds a newer snapshot.
+    Snapshot* Add(unsigned sequence);
+    /// Clear all snapshots.
+    void Clear();
+
+    /// Return snapshot by sequence number, or null if not buffered.
+    const Snapshot* Get(unsigned sequence) const;
+    /// Return the newest snapshot, or null if none.
+    const Snapshot* GetNewest() const { return Get(newestSequence_); }
+    /// Return the newest snapshot at or before a time and the oldest snapshot after it. Either may be null.
+    void GetInterpolationSnapshots(float time, const Snapshot*& from, const Snapshot*& to) const;
+    /// Return sequence number of the newest snapshot, or zero if none.
+    unsigned GetNewestSequence() const { return newestSequence_; }
+
+private:
+    /// Snapshot slots indexed by sequence number.
+    Vector<Snapshot> snapshots_;
+    /// Sequence number of the newest snapshot.
+    unsigned newestSequence_;
+};
+
+/// Snapshot encoding. Node transforms are quantized like the network position and rotation attributes of Node, and snapshots are delta encoded against a baseline snapshot that the receiver has acknowledged.
+class URHO3D_API SnapshotFormat
+{
+public:
+    /// Construct from the registered Node network attributes.
+    explicit SnapshotFormat(Context* context);
+
+    /// Quantize a node transform.
+    void Quantize(const Vector3& position, const Quaternion& rotation, unsigned* dest) const;
+    /// Reconstruct a node transform.
+    void Dequantize(const unsigned* src, Vector3& position, Quaternion& rotation) const;
+    /// Write a snapshot delta encoded against a baseline snapshot, or in full if baseline is null.
+    void Write(Serializer& dest, const Snapshot& snapshot, const Snapshot* baseline) const;
+    /// Read a snapshot into the buffer. Return the snapshot, or null if it is outdated, its baseline is no longer buffered or its node counts exceed the data.
+    const Snapshot* Read(Deserializer& source, SnapshotBuffer& buffer) const;
+
+private:
+    /// Network position attribute, or null if not registered.
+    const AttributeInfo* position_;
+    /// Network rotation attribute, or null if not registered.
+    const AttributeInfo* rotation_;
+    /// Bits of each quantized value.
+    unsigned bits_[SNAPSHOT_NODE_VALUES];
+};
+
+}
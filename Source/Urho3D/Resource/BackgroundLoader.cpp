@@ -36,77 +36,105 @@
 namespace Urho3D
 {
 
-BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
+BackgroundLoaderThread::BackgroundLoaderThread(BackgroundLoader* owner) :
     owner_(owner)
 {
 }
 
+void BackgroundLoaderThread::ThreadFunction()
+{
+    while (shouldRun_)
+    {
+        // Sleep when there are no resources to load
+        if (!owner_->LoadNextResource())
+            Time::Sleep(5);
+    }
+}
+
+BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
+    owner_(owner),
+    numThreads_(1)
+{
+}
+
 BackgroundLoader::~BackgroundLoader()
 {
+    StopThreads();
+
     MutexLock lock(backgroundLoadMutex_);
 
     backgroundLoadQueue_.Clear();
 }
 
-void BackgroundLoader::ThreadFunction()
+void BackgroundLoader::SetNumThreads(unsigned num)
 {
-    while (shouldRun_)
+    num = Max(num, 1U);
+    if (num == numThreads_)
+        return;
+
+    // Let the current threads finish the resources they are loading. The new threads start on the next background request
+    StopThreads();
+
+    MutexLock lock(backgroundLoadMutex_);
+    numThreads_ = num;
+    if (!backgroundLoadQueue_.Empty())
+        StartThreads();
+}
+
+bool BackgroundLoader::LoadNextResource()
+{
+    backgroundLoadMutex_.Acquire();
+
+    // Search for a queued resource that has not been loaded yet
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
+    while (i != backgroundLoadQueue_.End())
     {
-        backgroundLoadMutex_.Acquire();
+        if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+            break;
+        else
+            ++i;
+    }
 
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
-        {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
-        }
+    if (i == backgroundLoadQueue_.End())
+    {
+        // No resources to load found
+        backgroundLoadMutex_.Release();
+        return false;
+    }
 
-        if (i == backgroundLoadQueue_.End())
+    BackgroundLoadItem& item = i->second_;
+    Resource* resource = item.resource_;
+    // Claim the resource while holding the mutex so that other loader threads skip it. We can be sure that the item
+    // is not removed from the queue as long as it is in the "queued" or "loading" state
+    resource->SetAsyncLoadState(ASYNC_LOADING);
+    backgroundLoadMutex_.Release();
+
+    bool success = false;
+    SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+    if (file)
+        success = resource->BeginLoad(*file);
+
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    backgroundLoadMutex_.Acquire();
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
+             i != item.dependents_.End(); ++i)
         {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
         }
-        else
-        {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
-
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
 
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
-                     i != item.dependents_.End(); ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
+        item.dependents_.Clear();
+    }
 
-                item.dependents_.Clear();
-            }
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    backgroundLoadMutex_.Release();
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
-        }
-    }
+    return true;
 }
 
 bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
@@ -122,6 +150,7 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
 
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
+    item.reload_ = false;
 
     // Make sure the pointer is non-null and is a Resource subclass
     item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
@@ -163,9 +192,32 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
                        " requested for a background loaded resource but was not in the background load queue");
     }
 
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    // Start the background loader threads now
+    if (threads_.Empty())
+        StartThreads();
+
+    return true;
+}
+
+bool BackgroundLoader::QueueReload(Resource* resource)
+{
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+
+    MutexLock lock(backgroundLoadMutex_);
+
+    if (backgroundLoadQueue_.Find(key) != backgroundLoadQueue_.End())
+        return false;
+
+    URHO3D_LOGDEBUG("Background reloading resource " + resource->GetName());
+
+    BackgroundLoadItem& item = backgroundLoadQueue_[key];
+    item.sendEventOnFailure_ = true;
+    item.reload_ = true;
+    item.resource_ = resource;
+    resource->SetAsyncLoadState(ASYNC_QUEUED);
+
+    if (threads_.Empty())
+        StartThreads();
 
     return true;
 }
@@ -174,10 +226,11 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 {
     backgroundLoadMutex_.Acquire();
 
-    // Check if the resource in question is being background loaded
+    // Check if the resource in question is being background loaded. A resource being reloaded is usable meanwhile, so
+    // there is no need to wait for it
     Pair<StringHash, StringHash> key = MakePair(type, nameHash);
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
-    if (i != backgroundLoadQueue_.End())
+    if (i != backgroundLoadQueue_.End() && !i->second_.reload_)
     {
         backgroundLoadMutex_.Release();
 
@@ -217,12 +270,12 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    backgroundLoadMutex_.Acquire();
+
+    if (!threads_.Empty())
     {
         HiresTimer timer;
 
-        backgroundLoadMutex_.Acquire();
-
         for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
              i != backgroundLoadQueue_.End();)
         {
@@ -245,9 +298,9 @@ void BackgroundLoader::FinishResources(int maxMs)
             if (timer.GetUSec(false) >= maxMs * 1000LL)
                 break;
         }
-
-        backgroundLoadMutex_.Release();
     }
+
+    backgroundLoadMutex_.Release();
 }
 
 unsigned BackgroundLoader::GetNumQueuedResources() const
@@ -256,6 +309,29 @@ unsigned BackgroundLoader::GetNumQueuedResources() const
     return backgroundLoadQueue_.Size();
 }
 
+void BackgroundLoader::StartThreads()
+{
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        threads_.Push(SharedPtr<BackgroundLoaderThread>(new BackgroundLoaderThread(this)));
+        threads_.Back()->Run();
+    }
+}
+
+void BackgroundLoader::StopThreads()
+{
+    // Take the threads while holding the mutex, as they may be started concurrently from a resource requesting a background
+    // load in a loader thread. Stop them only after releasing it, as they need the mutex to finish their current resource
+    Vector<SharedPtr<BackgroundLoaderThread> > threads;
+    {
+        MutexLock lock(backgroundLoadMutex_);
+        threads.Swap(threads_);
+    }
+
+    for (unsigned i = 0; i < threads.Size(); ++i)
+        threads[i]->Stop();
+}
+
 void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
 {
     Resource* resource = item.resource_;
@@ -281,6 +357,20 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
     }
     resource->SetAsyncLoadState(ASYNC_DONE);
 
+    // A reloaded resource is already in the cache. Update its memory use unless it has been released meanwhile
+    if (item.reload_)
+    {
+        if (success)
+        {
+            resource->ResetUseTimer();
+            if (owner_->GetExistingResource(resource->GetType(), resource->GetName()) == resource)
+                owner_->AddManualResource(resource);
+        }
+
+        resource->SendEvent(success ? E_RELOADFINISHED : E_RELOADFAILED);
+        return;
+    }
+
     if (!success && item.sendEventOnFailure_)
     {
         using namespace LoadFailed;
@@ -47,23 +47,45 @@ struct BackgroundLoadItem
     HashSet<Pair<StringHash, StringHash> > dependents_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
+    /// Whether reloading a resource that is already in the cache.
+    bool reload_;
 };
 
-/// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+class BackgroundLoader;
+
+/// Background loader worker thread.
+class BackgroundLoaderThread : public RefCounted, public Thread
 {
 public:
     /// Construct.
-    explicit BackgroundLoader(ResourceCache* owner);
-
-    /// Destruct. Forcibly clear the load queue.
-    ~BackgroundLoader() override;
+    explicit BackgroundLoaderThread(BackgroundLoader* owner);
 
     /// Resource background loading loop.
     void ThreadFunction() override;
 
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+};
+
+/// Background loader of resources. Owned by the ResourceCache. Resources are loaded by a pool of worker threads, while finishing them happens in the main thread.
+class BackgroundLoader : public RefCounted
+{
+public:
+    /// Construct.
+    explicit BackgroundLoader(ResourceCache* owner);
+
+    /// Destruct. Stop the worker threads and forcibly clear the load queue.
+    ~BackgroundLoader() override;
+
+    /// Set number of worker threads. The threads are started on the first background request.
+    void SetNumThreads(unsigned num);
+    /// Load one queued resource whose loading has not begun yet. Return false if there was none. Called by the worker threads.
+    bool LoadNextResource();
     /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
     bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
+    /// Queue reloading of a resource that is already in the cache. The resource remains usable with its old data until finished. Return true if queued.
+    bool QueueReload(Resource* resource);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
@@ -71,13 +93,23 @@ public:
 
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
+    /// Return number of worker threads.
+    unsigned GetNumThreads() const { return numThreads_; }
 
 private:
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
+    /// Start the worker threads. Called with the mutex held.
+    void StartThreads();
+    /// Stop and destroy the worker threads.
+    void StopThreads();
 
     /// Resource cache.
     ResourceCache* owner_;
+    /// Worker threads. Empty until the first background request.
+    Vector<SharedPtr<BackgroundLoaderThread> > threads_;
+    /// Number of worker threads to start.
+    unsigned numThreads_;
     /// Mutex for thread-safe access to the background load queue.
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
@@ -70,6 +70,10 @@ public:
     bool LoadFile(const String& fileName);
     /// Save resource to file.
     virtual bool SaveFile(const String& fileName) const;
+    /// Prepare to reduce memory use on the next load while remaining usable, for example by dropping detail levels. Called by the ResourceCache when over the total memory budget, if demotion is enabled; the cache then reloads the resource in the background. Return the expected memory use after reloading, or the current memory use if can not be demoted.
+    virtual unsigned Demote() { return GetMemoryUse(); }
+    /// Clear demotion so that the next load restores full detail. Called by the ResourceCache before reloading a demoted resource on its next use.
+    virtual void ClearDemotion() { }
 
     /// Set name.
     void SetName(const String& name);
@@ -95,6 +99,11 @@ public:
     /// Return the asynchronous loading state.
     AsyncLoadState GetAsyncLoadState() const { return asyncLoadState_; }
 
+    /// Return whether has been demoted to reduce memory use.
+    virtual bool IsDemoted() const { return false; }
+    /// Return the expected memory use after restoring full detail.
+    virtual unsigned GetRestoredMemoryUse() const { return GetMemoryUse(); }
+
 private:
     /// Name.
     String name_;
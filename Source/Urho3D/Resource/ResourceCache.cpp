@@ -22,8 +22,10 @@
 
 #include "../Precompiled.h"
 
+#include "../Container/Sort.h"
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
 #include "../Core/WorkQueue.h"
 #include "../IO/FileSystem.h"
@@ -67,20 +69,51 @@ static const char* checkDirs[] =
 
 static const SharedPtr<Resource> noResource;
 
+/// Interval in milliseconds for checking the total memory budget again after it could not be met, unless memory use changes.
+static const unsigned TOTAL_MEMORY_BUDGET_RECHECK_MS = 1000;
+/// Time before a restored resource can be demoted again.
+static const unsigned DEMOTE_AFTER_RESTORE_MS = 5000;
+
+/// Candidate for demotion or release when over the total memory budget. Unused resources are ordered by time since last use, longest first, followed by resources in use, largest first.
+struct BudgetCandidate
+{
+    /// Test for less than with another entry.
+    bool operator <(const BudgetCandidate& rhs) const
+    {
+        return useTimer_ != rhs.useTimer_ ? useTimer_ > rhs.useTimer_ : memoryUse_ > rhs.memoryUse_;
+    }
+
+    /// Time since last use in milliseconds. Zero if in use.
+    unsigned useTimer_;
+    /// Memory use.
+    unsigned memoryUse_;
+    /// Resource.
+    SharedPtr<Resource> resource_;
+};
+
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
     autoReloadResources_(false),
     returnFailedResources_(false),
     searchPackagesFirst_(true),
     isRouting_(false),
-    finishBackgroundResourcesMs_(5)
+    finishBackgroundResourcesMs_(5),
+    totalMemoryBudget_(0),
+    demoteResources_(false),
+    updatingTotalMemoryBudget_(false),
+    numEvictedResources_(0),
+    numDemotedResources_(0),
+    numRestoredResources_(0),
+    failedTotalMemoryUse_(0)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
 
 #ifdef URHO3D_THREADING
-    // Create resource background loader. Its thread will start on the first background request
+    // Create resource background loader. Its threads will start on the first background request. Loading is partly bound
+    // by file access, so do not use more than a few threads by default
     backgroundLoader_ = new BackgroundLoader(this);
+    backgroundLoader_->SetNumThreads((unsigned)Clamp((int)GetNumPhysicalCPUs() - 1, 1, 4));
 #endif
 
     // Subscribe BeginFrame for handling directory watchers and background loaded resource finalization
@@ -438,6 +471,13 @@ void ResourceCache::SetMemoryBudget(StringHash type, unsigned long long budget)
     resourceGroups_[type].memoryBudget_ = budget;
 }
 
+void ResourceCache::SetTotalMemoryBudget(unsigned long long budget)
+{
+    totalMemoryBudget_ = budget;
+    failedTotalMemoryUse_ = 0;
+    UpdateTotalMemoryBudget();
+}
+
 void ResourceCache::SetAutoReloadResources(bool enable)
 {
     if (enable != autoReloadResources_)
@@ -582,7 +622,11 @@ Resource* ResourceCache::GetResource(StringHash type, const String& name, bool s
 
     const SharedPtr<Resource>& existing = FindResource(type, nameHash);
     if (existing)
+    {
+        if (existing->IsDemoted())
+            RestoreDemotedResource(existing);
         return existing;
+    }
 
     SharedPtr<Resource> resource;
     // Make sure the pointer is non-null and is a Resource subclass
@@ -645,8 +689,13 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& name,
 
     // First check if already exists as a loaded resource
     StringHash nameHash(sanitatedName);
-    if (FindResource(type, nameHash) != noResource)
+    const SharedPtr<Resource>& existing = FindResource(type, nameHash);
+    if (existing)
+    {
+        if (existing->IsDemoted() && Thread::IsMainThread())
+            RestoreDemotedResource(existing);
         return false;
+    }
 
     return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller);
 #else
@@ -708,6 +757,22 @@ SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String
     return resource;
 }
 
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned num)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetNumThreads(num);
+#endif
+}
+
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetNumThreads();
+#else
+    return 0;
+#endif
+}
+
 unsigned ResourceCache::GetNumBackgroundLoadResources() const
 {
 #ifdef URHO3D_THREADING
@@ -964,11 +1029,19 @@ String ResourceCache::PrintMemoryUsage() const
     const String memMaxString = GetFileSizeString(totalLargest);
     const String memTotalString = GetFileSizeString(totalUse);
 
+    const String memBudgetString = totalMemoryBudget_ ? GetFileSizeString(totalMemoryBudget_) : String("-");
+
     memset(outputLine, ' ', 256);
     outputLine[255] = 0;
-    sprintf(outputLine, "%-28s %4s %9s %9s %9s %9s\n", "All", countString.CString(), memUseString.CString(), memMaxString.CString(), "-", memTotalString.CString());
+    sprintf(outputLine, "%-28s %4s %9s %9s %9s %9s\n", "All", countString.CString(), memUseString.CString(), memMaxString.CString(), memBudgetString.CString(), memTotalString.CString());
     output += ((const char*)outputLine);
 
+    if (numEvictedResources_ || numDemotedResources_)
+    {
+        sprintf(outputLine, "\nEvicted %u Demoted %u Restored %u\n", numEvictedResources_, numDemotedResources_, numRestoredResources_);
+        output += ((const char*)outputLine);
+    }
+
     return output;
 }
 
@@ -1064,10 +1137,189 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
             URHO3D_LOGDEBUG("Resource group " + oldestResource->second_->GetTypeName() + " over memory budget, releasing resource " +
                      oldestResource->second_->GetName());
             i->second_.resources_.Erase(oldestResource);
+            ++numEvictedResources_;
         }
         else
             break;
     }
+
+    UpdateTotalMemoryBudget();
+}
+
+void ResourceCache::UpdateTotalMemoryBudget()
+{
+    if (!totalMemoryBudget_ || updatingTotalMemoryBudget_)
+        return;
+
+    // Wait for demoted resources to finish reloading, as their memory use drops only then
+    for (Vector<WeakPtr<Resource> >::Iterator i = demotingResources_.Begin(); i != demotingResources_.End();)
+    {
+        if (i->Expired() || (*i)->GetAsyncLoadState() == ASYNC_DONE)
+            i = demotingResources_.Erase(i);
+        else
+            ++i;
+    }
+    if (!demotingResources_.Empty())
+        return;
+
+    unsigned long long totalUse = GetTotalMemoryUse();
+    if (totalUse <= totalMemoryBudget_)
+    {
+        failedTotalMemoryUse_ = 0;
+        return;
+    }
+
+    // If the budget could not be met last time, do not scan all resources again each frame, but only after memory use
+    // has changed or some time has passed, as resources may have become unused meanwhile
+    if (failedTotalMemoryUse_ == totalUse && totalMemoryBudgetTimer_.GetMSec(false) < TOTAL_MEMORY_BUDGET_RECHECK_MS)
+        return;
+
+    URHO3D_PROFILE(UpdateTotalMemoryBudget);
+
+    // Demoting or releasing resources may release or load others, which must not recurse here
+    updatingTotalMemoryBudget_ = true;
+    bool demote = demoteResources_;
+
+    while (totalUse > totalMemoryBudget_)
+    {
+        // Collect the loaded resources. Resources in use elsewhere always return a zero timer and can only be demoted
+        Vector<BudgetCandidate> candidates;
+        for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+        {
+            for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+                 j != i->second_.resources_.End(); ++j)
+            {
+                unsigned useTimer = j->second_->GetUseTimer();
+                if ((useTimer || demote) && j->second_->GetAsyncLoadState() == ASYNC_DONE)
+                {
+                    candidates.Resize(candidates.Size() + 1);
+                    candidates.Back().useTimer_ = useTimer;
+                    candidates.Back().memoryUse_ = j->second_->GetMemoryUse();
+                    candidates.Back().resource_ = j->second_;
+                }
+            }
+        }
+        if (candidates.Empty())
+            break;
+
+        Sort(candidates.Begin(), candidates.End());
+
+        // Demote first if enabled, so that the resources stay available at reduced detail. The demoted resources are
+        // reloaded in the background, and releasing waits until they have finished
+        if (demote)
+        {
+            for (HashMap<Pair<StringHash, StringHash>, Timer>::Iterator i = restoredResources_.Begin();
+                 i != restoredResources_.End();)
+            {
+                if (i->second_.GetMSec(false) >= DEMOTE_AFTER_RESTORE_MS)
+                    i = restoredResources_.Erase(i);
+                else
+                    ++i;
+            }
+
+            for (unsigned i = 0; i < candidates.Size() && totalUse > totalMemoryBudget_; ++i)
+            {
+                Resource* resource = candidates[i].resource_;
+                // Do not demote recently restored resources, so that a resource in use does not cycle between the two
+                if (restoredResources_.Contains(MakePair(resource->GetType(), resource->GetNameHash())))
+                    continue;
+
+                unsigned memoryUse = candidates[i].memoryUse_;
+                unsigned demotedMemoryUse = resource->Demote();
+                if (demotedMemoryUse >= memoryUse)
+                    continue;
+
+                URHO3D_LOGDEBUG("Over total memory budget, demoting resource " + resource->GetName());
+#ifdef URHO3D_THREADING
+                if (!backgroundLoader_->QueueReload(resource))
+                {
+                    // Already being reloaded, so the demotion would not take effect
+                    resource->ClearDemotion();
+                    continue;
+                }
+                resource->SendEvent(E_RELOADSTARTED);
+                demotingResources_.Push(WeakPtr<Resource>(resource));
+#else
+                if (!ReloadResource(resource))
+                {
+                    resource->ClearDemotion();
+                    continue;
+                }
+#endif
+
+                totalUse -= memoryUse - demotedMemoryUse;
+                ++numDemotedResources_;
+            }
+
+            demote = false;
+            if (!demotingResources_.Empty())
+                break;
+            totalUse = GetTotalMemoryUse();
+            continue;
+        }
+
+        bool progress = false;
+        for (unsigned i = 0; i < candidates.Size() && totalUse > totalMemoryBudget_; ++i)
+        {
+            Resource* resource = candidates[i].resource_;
+            HashMap<StringHash, ResourceGroup>::Iterator j = resourceGroups_.Find(resource->GetType());
+            if (j != resourceGroups_.End() && j->second_.resources_.Erase(resource->GetNameHash()))
+            {
+                URHO3D_LOGDEBUG("Over total memory budget, releasing resource " + resource->GetName());
+                totalUse -= candidates[i].memoryUse_;
+                ++numEvictedResources_;
+                progress = true;
+            }
+        }
+
+        // Releasing resources may have left others unused, for example textures of released materials, so collect again
+        if (!progress)
+            break;
+    }
+
+    // Recalculate the memory use of each group
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        unsigned long long memoryUse = 0;
+        for (HashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = i->second_.resources_.Begin();
+             j != i->second_.resources_.End(); ++j)
+            memoryUse += j->second_->GetMemoryUse();
+        i->second_.memoryUse_ = memoryUse;
+    }
+
+    // Remember if the budget could not be met, unless waiting for demoted resources
+    totalUse = GetTotalMemoryUse();
+    if (totalUse > totalMemoryBudget_ && demotingResources_.Empty())
+    {
+        failedTotalMemoryUse_ = totalUse;
+        totalMemoryBudgetTimer_.Reset();
+    }
+    else
+        failedTotalMemoryUse_ = 0;
+
+    updatingTotalMemoryBudget_ = false;
+}
+
+void ResourceCache::RestoreDemotedResource(Resource* resource)
+{
+    // Stay demoted while full detail would not fit in the budget, as restoring would only cause demoting again
+    if (totalMemoryBudget_ && GetTotalMemoryUse() + resource->GetRestoredMemoryUse() > totalMemoryBudget_ + resource->GetMemoryUse())
+        return;
+
+    // Clearing the demotion also applies to a reload already in progress, as the detail levels are chosen when it finishes
+    resource->ClearDemotion();
+
+#ifdef URHO3D_THREADING
+    if (!backgroundLoader_->QueueReload(resource))
+        return;
+    resource->SendEvent(E_RELOADSTARTED);
+#else
+    ReloadResource(resource);
+#endif
+
+    URHO3D_LOGDEBUG("Restoring demoted resource " + resource->GetName());
+    restoredResources_[MakePair(resource->GetType(), resource->GetNameHash())].Reset();
+    ++numRestoredResources_;
 }
 
 void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
@@ -1096,6 +1348,9 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
         backgroundLoader_->FinishResources(finishBackgroundResourcesMs_);
     }
 #endif
+
+    // Resources may have become unused since the last check
+    UpdateTotalMemoryBudget();
 }
 
 File* ResourceCache::SearchResourceDirs(const String& name)
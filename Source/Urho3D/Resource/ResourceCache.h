@@ -118,6 +118,10 @@ public:
     void ReloadResourceWithDependencies(const String& fileName);
     /// Set memory budget for a specific resource type, default 0 is unlimited.
     void SetMemoryBudget(StringHash type, unsigned long long budget);
+    /// Set memory budget for all resource types combined, default 0 is unlimited. When exceeded, the least recently used resources of any type are released, or demoted first if enabled.
+    void SetTotalMemoryBudget(unsigned long long budget);
+    /// Enable or disable demoting resources, for example textures to lower mip levels, before releasing them when over the total memory budget. Also resources in use are demoted, largest first after the unused ones. Demotion and restoring a demoted resource on its next use reload it in the background. A demoted resource is restored only if its full detail fits in the budget, and a restored resource is not demoted again for a few seconds. Default false.
+    void SetDemoteResources(bool enable) { demoteResources_ = enable; }
     /// Enable or disable automatic reloading of resources as files are modified. Default false.
     void SetAutoReloadResources(bool enable);
     /// Enable or disable returning resources that failed to load. Default false. This may be useful in editing to not lose resource ref attributes.
@@ -128,6 +132,8 @@ public:
 
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of threads for background loading resources. Default is one less than the number of physical CPU cores, at most four.
+    void SetNumBackgroundLoadThreads(unsigned num);
 
     /// Add a resource router object. By default there is none, so the routing process is skipped.
     void AddResourceRouter(ResourceRouter* router, bool addAsFirst = false);
@@ -178,6 +184,20 @@ public:
     unsigned long long GetMemoryUse(StringHash type) const;
     /// Return total memory use for all resources.
     unsigned long long GetTotalMemoryUse() const;
+    /// Return memory budget for all resource types combined.
+    unsigned long long GetTotalMemoryBudget() const { return totalMemoryBudget_; }
+
+    /// Return whether resources are demoted before releasing them when over the total memory budget.
+    bool GetDemoteResources() const { return demoteResources_; }
+
+    /// Return number of resources released due to memory budgets.
+    unsigned GetNumEvictedResources() const { return numEvictedResources_; }
+
+    /// Return number of resource demotions due to the total memory budget.
+    unsigned GetNumDemotedResources() const { return numDemotedResources_; }
+
+    /// Return number of demoted resources reloaded on their next use.
+    unsigned GetNumRestoredResources() const { return numRestoredResources_; }
     /// Return full absolute file name of resource if possible, or empty if not found.
     String GetResourceFileName(const String& name) const;
 
@@ -192,6 +212,8 @@ public:
 
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
+    /// Return number of threads for background loading resources.
+    unsigned GetNumBackgroundLoadThreads() const;
 
     /// Return a resource router by index.
     ResourceRouter* GetResourceRouter(unsigned index) const;
@@ -219,6 +241,10 @@ private:
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
     void UpdateResourceGroup(StringHash type);
+    /// Demote or release the least recently used resources of all types if over the total memory budget.
+    void UpdateTotalMemoryBudget();
+    /// Reload a demoted resource to full detail, in the background if possible.
+    void RestoreDemotedResource(Resource* resource);
     /// Handle begin frame event. Automatic resource reloads and the finalization of background loaded resources are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Search FileSystem for file.
@@ -252,6 +278,26 @@ private:
     mutable bool isRouting_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// Memory budget for all resource types combined.
+    unsigned long long totalMemoryBudget_;
+    /// Demote resources before releasing flag.
+    bool demoteResources_;
+    /// Total memory budget update in progress flag to prevent recursion when demoting or releasing resources.
+    bool updatingTotalMemoryBudget_;
+    /// Number of resources released due to memory budgets.
+    unsigned numEvictedResources_;
+    /// Number of resource demotions.
+    unsigned numDemotedResources_;
+    /// Number of demoted resources reloaded.
+    unsigned numRestoredResources_;
+    /// Demoted resources being reloaded in the background.
+    Vector<WeakPtr<Resource> > demotingResources_;
+    /// Time since restoring demoted resources by type and name hash, to not demote them again right away.
+    HashMap<Pair<StringHash, StringHash>, Timer> restoredResources_;
+    /// Total memory use when the total memory budget could last not be met, or zero if it was met.
+    unsigned long long failedTotalMemoryUse_;
+    /// Time since the total memory budget could last not be met.
+    Timer totalMemoryBudgetTimer_;
 };
 
 template <class T> T* ResourceCache::GetExistingResource(const String& name)
@@ -0,0 +1,908 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/HashSet.h"
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../Scene/ChunkedScene.h"
+#include "../Scene/Component.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Number of selected nodes converted at a time.
+static const unsigned CONVERT_WINDOW_SIZE = 256;
+/// Minimum number of nodes converted per worker thread batch.
+static const unsigned MIN_CONVERT_BATCH = 16;
+
+/// Attribute modes that refer to node or component IDs.
+static const AttributeModeFlags ID_ATTRIBUTE_MODES = AM_NODEID | AM_COMPONENTID | AM_NODEIDVECTOR;
+
+/// State of a chunked scene save operation.
+struct ChunkedSceneSaveState
+{
+    /// Attribute schemas.
+    Vector<ChunkedAttributeSchema> schemas_;
+    /// Schema indices of objects saved with an attribute layout.
+    HashMap<StringHash, unsigned> layoutSchemas_;
+    /// Schema indices of objects saved verbatim.
+    HashMap<StringHash, unsigned> verbatimSchemas_;
+    /// Referenced resources.
+    Vector<ResourceRef> resources_;
+    /// Referenced resource keys for removing duplicates.
+    HashSet<String> resourceKeys_;
+    /// Node table.
+    PODVector<ChunkedNodeEntry> nodes_;
+    /// Component table.
+    PODVector<ChunkedComponentEntry> components_;
+    /// Attribute block data.
+    VectorBuffer data_;
+};
+
+/// Return whether an attribute is written when saving.
+static bool IsSavedAttribute(const AttributeInfo& attr)
+{
+    return (attr.mode_ & AM_FILE) && (attr.mode_ & AM_FILEREADONLY) != AM_FILEREADONLY;
+}
+
+/// Return a value of the attribute's type to use when the attribute is missing from the file.
+static Variant GetMissingAttributeValue(const AttributeInfo& attr)
+{
+    if (attr.defaultValue_.GetType() == attr.type_)
+        return attr.defaultValue_;
+
+    switch (attr.type_)
+    {
+    case VAR_VARIANTVECTOR:
+        return Variant::emptyVariantVector;
+
+    case VAR_STRINGVECTOR:
+        return Variant::emptyStringVector;
+
+    case VAR_VARIANTMAP:
+        return Variant::emptyVariantMap;
+
+    default:
+        return Variant(attr.type_, String::EMPTY);
+    }
+}
+
+/// Add a referenced resource to the save state if not added yet.
+static void AddResource(ChunkedSceneSaveState& state, StringHash type, const String& name)
+{
+    if (name.Empty())
+        return;
+
+    String key = type.ToString() + name;
+    if (!state.resourceKeys_.Contains(key))
+    {
+        state.resourceKeys_.Insert(key);
+        state.resources_.Push(ResourceRef(type, name));
+    }
+}
+
+/// Add the resources referenced by an attribute value to the save state.
+static void AddResources(ChunkedSceneSaveState& state, const Variant& value)
+{
+    if (value.GetType() == VAR_RESOURCEREF)
+    {
+        const ResourceRef& ref = value.GetResourceRef();
+        AddResource(state, ref.type_, ref.name_);
+    }
+    else if (value.GetType() == VAR_RESOURCEREFLIST)
+    {
+        const ResourceRefList& refList = value.GetResourceRefList();
+        for (unsigned i = 0; i < refList.names_.Size(); ++i)
+            AddResource(state, refList.type_, refList.names_[i]);
+    }
+}
+
+/// Return the schema index for an object, creating the schema if necessary.
+static unsigned GetSchema(ChunkedSceneSaveState& state, const Serializable* object, bool verbatim)
+{
+    StringHash type = object->GetType();
+    HashMap<StringHash, unsigned>& schemaIndices = verbatim ? state.verbatimSchemas_ : state.layoutSchemas_;
+    HashMap<StringHash, unsigned>::ConstIterator i = schemaIndices.Find(type);
+    if (i != schemaIndices.End())
+        return i->second_;
+
+    ChunkedAttributeSchema schema;
+    schema.type_ = type;
+    schema.typeName_ = object->GetTypeName();
+    schema.verbatim_ = verbatim;
+
+    const Vector<AttributeInfo>* attributes = object->GetAttributes();
+    if (attributes && !verbatim)
+    {
+        for (unsigned j = 0; j < attributes->Size(); ++j)
+        {
+            const AttributeInfo& attr = attributes->At(j);
+            if (!IsSavedAttribute(attr))
+                continue;
+
+            schema.names_.Push(attr.name_);
+            schema.types_.Push(attr.type_);
+        }
+    }
+
+    unsigned index = state.schemas_.Size();
+    state.schemas_.Push(schema);
+    schemaIndices[type] = index;
+    return index;
+}
+
+/// Write the attributes of an object in its schema layout and collect the referenced resources.
+static bool WriteAttributes(ChunkedSceneSaveState& state, const Serializable* object, bool verbatim)
+{
+    const Vector<AttributeInfo>* attributes = object->GetAttributes();
+    if (!attributes)
+        return true;
+
+    Variant value;
+
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (!IsSavedAttribute(attr))
+            continue;
+
+        object->OnGetAttribute(attr, value);
+        AddResources(state, value);
+
+        if (!verbatim && !state.data_.WriteVariantData(value))
+            return false;
+    }
+
+    return true;
+}
+
+/// Write a node, its components and child nodes in depth-first order. If a child node list is given, write only those child nodes and no components.
+static bool WriteNode(ChunkedSceneSaveState& state, const Node* node, unsigned parent, const PODVector<Node*>* childList = nullptr)
+{
+    unsigned index = state.nodes_.Size();
+
+    ChunkedNodeEntry entry;
+    entry.id_ = node->GetID();
+    entry.parent_ = parent;
+    entry.schema_ = GetSchema(state, node, false);
+    entry.firstComponent_ = state.components_.Size();
+    entry.numComponents_ = 0;
+    entry.subtreeEnd_ = index + 1;
+    entry.position_ = node->GetWorldPosition();
+    entry.offset_ = state.data_.GetPosition();
+    if (!WriteAttributes(state, node, false))
+        return false;
+    entry.size_ = state.data_.GetPosition() - entry.offset_;
+
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (unsigned i = 0; i < components.Size() && !childList; ++i)
+    {
+        Component* component = components[i];
+        if (component->IsTemporary())
+            continue;
+
+        // Objects with per-instance attributes can not share a layout, so they are stored as written by their own Save()
+        Context* context = component->GetContext();
+        bool verbatim = component->GetAttributes() != context->GetAttributes(component->GetType());
+
+        ChunkedComponentEntry componentEntry;
+        componentEntry.schema_ = GetSchema(state, component, verbatim);
+        componentEntry.id_ = component->GetID();
+        componentEntry.offset_ = state.data_.GetPosition();
+        if (verbatim && !component->Save(state.data_))
+            return false;
+        if (!WriteAttributes(state, component, verbatim))
+            return false;
+        componentEntry.size_ = state.data_.GetPosition() - componentEntry.offset_;
+
+        state.components_.Push(componentEntry);
+        ++entry.numComponents_;
+    }
+
+    state.nodes_.Push(entry);
+
+    if (childList)
+    {
+        for (unsigned i = 0; i < childList->Size(); ++i)
+        {
+            if (!WriteNode(state, childList->At(i), index))
+                return false;
+        }
+    }
+    else
+    {
+        const Vector<SharedPtr<Node> >& children = node->GetChildren();
+        for (unsigned i = 0; i < children.Size(); ++i)
+        {
+            Node* child = children[i];
+            if (child->IsTemporary())
+                continue;
+
+            if (!WriteNode(state, child, index))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/// Write the tables and data of a finished save operation.
+static bool WriteChunkedScene(ChunkedSceneSaveState& state, Serializer& dest)
+{
+    bool success = true;
+
+    success &= dest.WriteFileID("USCC");
+
+    success &= dest.WriteUInt(state.schemas_.Size());
+    for (unsigned i = 0; i < state.schemas_.Size(); ++i)
+    {
+        const ChunkedAttributeSchema& schema = state.schemas_[i];
+        success &= dest.WriteStringHash(schema.type_);
+        success &= dest.WriteString(schema.typeName_);
+        success &= dest.WriteBool(schema.verbatim_);
+        success &= dest.WriteVLE(schema.names_.Size());
+        for (unsigned j = 0; j < schema.names_.Size(); ++j)
+        {
+            success &= dest.WriteString(schema.names_[j]);
+            success &= dest.WriteUByte((unsigned char)schema.types_[j]);
+        }
+    }
+
+    success &= dest.WriteUInt(state.resources_.Size());
+    for (unsigned i = 0; i < state.resources_.Size(); ++i)
+        success &= dest.WriteResourceRef(state.resources_[i]);
+
+    success &= dest.WriteUInt(state.nodes_.Size());
+    for (unsigned i = 0; i < state.nodes_.Size(); ++i)
+    {
+        const ChunkedNodeEntry& entry = state.nodes_[i];
+        success &= dest.WriteUInt(entry.id_);
+        success &= dest.WriteUInt(entry.parent_);
+        success &= dest.WriteUInt(entry.schema_);
+        success &= dest.WriteUInt(entry.numComponents_);
+        success &= dest.WriteVector3(entry.position_);
+        success &= dest.WriteUInt(entry.offset_);
+        success &= dest.WriteUInt(entry.size_);
+    }
+
+    success &= dest.WriteUInt(state.components_.Size());
+    for (unsigned i = 0; i < state.components_.Size(); ++i)
+    {
+        const ChunkedComponentEntry& entry = state.components_[i];
+        success &= dest.WriteUInt(entry.schema_);
+        success &= dest.WriteUInt(entry.id_);
+        success &= dest.WriteUInt(entry.offset_);
+        success &= dest.WriteUInt(entry.size_);
+    }
+
+    success &= dest.WriteUInt(state.data_.GetSize());
+    success &= dest.Write(state.data_.GetData(), state.data_.GetSize()) == state.data_.GetSize();
+
+    if (!success)
+        URHO3D_LOGERROR("Could not save chunked scene, writing to stream failed");
+
+    return success;
+}
+
+ChunkedScene::ChunkedScene(Context* context) :
+    Resource(context),
+    windowBegin_(0),
+    windowEnd_(0),
+    nextNode_(0),
+    mode_(REPLICATED),
+    loadRoot_(false),
+    rewriteIDs_(false),
+    useResolver_(false),
+    useRegion_(false)
+{
+}
+
+ChunkedScene::~ChunkedScene() = default;
+
+void ChunkedScene::RegisterObject(Context* context)
+{
+    context->RegisterFactory<ChunkedScene>();
+}
+
+bool ChunkedScene::SaveNode(Serializer& dest, const Node* node)
+{
+    if (!node)
+    {
+        URHO3D_LOGERROR("Null node for saving chunked scene");
+        return false;
+    }
+
+    ChunkedSceneSaveState state;
+    if (!WriteNode(state, node, M_MAX_UNSIGNED))
+    {
+        URHO3D_LOGERROR("Could not save chunked scene, writing to buffer failed");
+        return false;
+    }
+
+    return WriteChunkedScene(state, dest);
+}
+
+bool ChunkedScene::SaveNode(Serializer& dest, const Node* node, const PODVector<Node*>& children)
+{
+    if (!node)
+    {
+        URHO3D_LOGERROR("Null node for saving chunked scene");
+        return false;
+    }
+
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        if (!children[i] || children[i]->GetParent() != node)
+        {
+            URHO3D_LOGERROR("Could not save chunked scene, child node list contains other than child nodes");
+            return false;
+        }
+    }
+
+    ChunkedSceneSaveState state;
+    if (!WriteNode(state, node, M_MAX_UNSIGNED, &children))
+    {
+        URHO3D_LOGERROR("Could not save chunked scene, writing to buffer failed");
+        return false;
+    }
+
+    return WriteChunkedScene(state, dest);
+}
+
+bool ChunkedScene::BeginLoad(Deserializer& source)
+{
+    // Read into separate tables, as an instantiation may be in progress in the main thread. They replace the current
+    // tables in EndLoad()
+    loadSchemas_.Clear();
+    loadResources_.Clear();
+    loadNodes_.Clear();
+    loadComponents_.Clear();
+    loadData_.Clear();
+
+    if (source.ReadFileID() != "USCC")
+    {
+        URHO3D_LOGERROR(source.GetName() + " is not a valid chunked scene file");
+        return false;
+    }
+
+    unsigned numSchemas = source.ReadUInt();
+    loadSchemas_.Resize(numSchemas);
+    for (unsigned i = 0; i < numSchemas && !source.IsEof(); ++i)
+    {
+        ChunkedAttributeSchema& schema = loadSchemas_[i];
+        schema.type_ = source.ReadStringHash();
+        schema.typeName_ = source.ReadString();
+        schema.verbatim_ = source.ReadBool();
+        unsigned numAttributes = source.ReadVLE();
+        schema.names_.Resize(numAttributes);
+        schema.types_.Resize(numAttributes);
+        schema.runtimeIndices_.Resize(numAttributes);
+        for (unsigned j = 0; j < numAttributes; ++j)
+        {
+            schema.names_[j] = source.ReadString();
+            schema.types_[j] = (VariantType)source.ReadUByte();
+            schema.runtimeIndices_[j] = M_MAX_UNSIGNED;
+        }
+
+        // Match the file layout to the registered attributes by name and type. Unknown types are loaded as is, to be
+        // stored by UnknownComponent
+        const Vector<AttributeInfo>* attributes = context_->GetAttributes(schema.type_);
+        if (schema.verbatim_ || !attributes)
+        {
+            schema.identical_ = true;
+            continue;
+        }
+
+        unsigned fileIndex = 0;
+        schema.identical_ = true;
+        for (unsigned j = 0; j < attributes->Size(); ++j)
+        {
+            const AttributeInfo& attr = attributes->At(j);
+            if (!(attr.mode_ & AM_FILE))
+                continue;
+
+            if (attr.mode_ & ID_ATTRIBUTE_MODES)
+                schema.hasIDAttributes_ = true;
+
+            if (fileIndex >= numAttributes || schema.names_[fileIndex] != attr.name_ || schema.types_[fileIndex] != attr.type_)
+                schema.identical_ = false;
+            ++fileIndex;
+
+            for (unsigned k = 0; k < numAttributes; ++k)
+            {
+                if (schema.runtimeIndices_[k] == M_MAX_UNSIGNED && schema.names_[k] == attr.name_ &&
+                    schema.types_[k] == attr.type_)
+                {
+                    schema.runtimeIndices_[k] = j;
+                    break;
+                }
+            }
+        }
+
+        if (fileIndex != numAttributes)
+            schema.identical_ = false;
+    }
+
+    unsigned numResources = source.ReadUInt();
+    loadResources_.Resize(numResources);
+    for (unsigned i = 0; i < numResources && !source.IsEof(); ++i)
+        loadResources_[i] = source.ReadResourceRef();
+
+    unsigned numNodes = source.ReadUInt();
+    loadNodes_.Resize(numNodes);
+    unsigned firstComponent = 0;
+    for (unsigned i = 0; i < numNodes && !source.IsEof(); ++i)
+    {
+        ChunkedNodeEntry& entry = loadNodes_[i];
+        entry.id_ = source.ReadUInt();
+        entry.parent_ = source.ReadUInt();
+        entry.schema_ = source.ReadUInt();
+        entry.firstComponent_ = firstComponent;
+        entry.numComponents_ = source.ReadUInt();
+        entry.subtreeEnd_ = i + 1;
+        entry.position_ = source.ReadVector3();
+        entry.offset_ = source.ReadUInt();
+        entry.size_ = source.ReadUInt();
+        firstComponent += entry.numComponents_;
+    }
+
+    unsigned numComponents = source.ReadUInt();
+    loadComponents_.Resize(numComponents);
+    for (unsigned i = 0; i < numComponents && !source.IsEof(); ++i)
+    {
+        ChunkedComponentEntry& entry = loadComponents_[i];
+        entry.schema_ = source.ReadUInt();
+        entry.id_ = source.ReadUInt();
+        entry.offset_ = source.ReadUInt();
+        entry.size_ = source.ReadUInt();
+    }
+
+    unsigned dataSize = source.ReadUInt();
+    loadData_.Resize(dataSize);
+    if (dataSize && source.Read(&loadData_[0], dataSize) != dataSize)
+    {
+        URHO3D_LOGERROR("Could not load chunked scene " + source.GetName() + ", unexpected end of data");
+        loadNodes_.Clear();
+        return false;
+    }
+
+    // Validate the tables so that instantiation can trust them
+    bool valid = numNodes && loadNodes_[0].parent_ == M_MAX_UNSIGNED && firstComponent == numComponents;
+    for (unsigned i = 0; i < numNodes && valid; ++i)
+    {
+        const ChunkedNodeEntry& entry = loadNodes_[i];
+        if ((i && entry.parent_ >= i) || entry.schema_ >= numSchemas || loadSchemas_[entry.schema_].verbatim_ ||
+            entry.offset_ > dataSize || entry.size_ > dataSize - entry.offset_)
+            valid = false;
+    }
+    for (unsigned i = 0; i < numComponents && valid; ++i)
+    {
+        const ChunkedComponentEntry& entry = loadComponents_[i];
+        if (entry.schema_ >= numSchemas || entry.offset_ > dataSize || entry.size_ > dataSize - entry.offset_)
+            valid = false;
+    }
+    if (!valid)
+    {
+        URHO3D_LOGERROR("Could not load chunked scene " + source.GetName() + ", invalid node or component table");
+        loadNodes_.Clear();
+        loadComponents_.Clear();
+        return false;
+    }
+
+    // Extend each parent's subtree to cover its descendants. Children always follow their parents in the table
+    for (unsigned i = numNodes - 1; i > 0; --i)
+    {
+        ChunkedNodeEntry& parent = loadNodes_[loadNodes_[i].parent_];
+        parent.subtreeEnd_ = Max(parent.subtreeEnd_, loadNodes_[i].subtreeEnd_);
+    }
+
+    return true;
+}
+
+bool ChunkedScene::EndLoad()
+{
+    // Can not replace the tables while instantiating, as the created node table refers to the old data
+    if (target_)
+        FinishInstantiate();
+
+    schemas_.Swap(loadSchemas_);
+    resources_.Swap(loadResources_);
+    nodes_.Swap(loadNodes_);
+    components_.Swap(loadComponents_);
+    data_.Swap(loadData_);
+    loadSchemas_.Clear();
+    loadResources_.Clear();
+    loadNodes_.Clear();
+    loadComponents_.Clear();
+    loadData_.Clear();
+
+    SetMemoryUse(sizeof(ChunkedScene) + data_.Size() + nodes_.Size() * sizeof(ChunkedNodeEntry) +
+        components_.Size() * sizeof(ChunkedComponentEntry));
+    return true;
+}
+
+void ChunkedScene::SetRegion(const BoundingBox& region)
+{
+    region_ = region;
+    useRegion_ = true;
+}
+
+void ChunkedScene::ClearRegion()
+{
+    useRegion_ = false;
+}
+
+bool ChunkedScene::BeginInstantiate(Node* target, bool loadRoot, bool rewriteIDs, CreateMode mode)
+{
+    if (target_)
+        FinishInstantiate();
+
+    if (!target)
+    {
+        URHO3D_LOGERROR("Null target node for instantiating chunked scene");
+        return false;
+    }
+    if (nodes_.Empty())
+    {
+        URHO3D_LOGERROR("No chunked scene loaded for instantiation");
+        return false;
+    }
+
+    Scene* scene = target->GetScene();
+    if (!scene)
+    {
+        URHO3D_LOGERROR("Target node for instantiating chunked scene is not in a scene");
+        return false;
+    }
+
+    const ChunkedAttributeSchema& rootSchema = schemas_[nodes_[0].schema_];
+    if (loadRoot && rootSchema.type_ != target->GetType())
+    {
+        URHO3D_LOGERROR("Can not load chunked scene root of type " + rootSchema.typeName_ + " into " + target->GetTypeName());
+        return false;
+    }
+
+    // Select the root-level subtrees to instantiate
+    selectedNodes_.Clear();
+    if (loadRoot)
+        selectedNodes_.Push(0);
+    for (unsigned i = 1; i < nodes_.Size(); i = nodes_[i].subtreeEnd_)
+    {
+        if (useRegion_ && region_.IsInside(nodes_[i].position_) == OUTSIDE)
+            continue;
+
+        for (unsigned j = i; j < nodes_[i].subtreeEnd_; ++j)
+            selectedNodes_.Push(j);
+    }
+
+    createdNodes_.Clear();
+    createdNodes_.Resize(nodes_.Size());
+    createdNodes_[0] = target;
+
+    // Allocate the new IDs up front, so that ID attributes can be remapped while converting the attribute blocks
+    nodeIDs_.Clear();
+    componentIDs_.Clear();
+    if (rewriteIDs)
+    {
+        nodeIDs_[nodes_[0].id_] = target->GetID();
+        for (unsigned i = 0; i < selectedNodes_.Size(); ++i)
+        {
+            unsigned index = selectedNodes_[i];
+            const ChunkedNodeEntry& entry = nodes_[index];
+            CreateMode nodeMode = index ? ((mode == REPLICATED && Scene::IsReplicatedID(entry.id_)) ? REPLICATED : LOCAL) :
+                (target->IsReplicated() ? REPLICATED : LOCAL);
+            if (index)
+                nodeIDs_[entry.id_] = scene->GetFreeNodeID(nodeMode);
+
+            for (unsigned j = entry.firstComponent_; j < entry.firstComponent_ + entry.numComponents_; ++j)
+            {
+                unsigned componentID = components_[j].id_;
+                CreateMode componentMode = (nodeMode == REPLICATED && mode == REPLICATED && Scene::IsReplicatedID(componentID)) ?
+                    REPLICATED : LOCAL;
+                componentIDs_[componentID] = scene->GetFreeComponentID(componentMode);
+            }
+        }
+    }
+
+    // Verbatim components can not be remapped while converting, so their ID attributes are resolved at the end
+    useResolver_ = false;
+    if (rewriteIDs)
+    {
+        for (unsigned i = 0; i < schemas_.Size(); ++i)
+        {
+            if (schemas_[i].verbatim_)
+            {
+                useResolver_ = true;
+                break;
+            }
+        }
+    }
+    resolver_.Reset();
+    if (useResolver_)
+        resolver_.AddNode(nodes_[0].id_, target);
+
+    target_ = target;
+    mode_ = mode;
+    loadRoot_ = loadRoot;
+    rewriteIDs_ = rewriteIDs;
+    windowBegin_ = 0;
+    windowEnd_ = 0;
+    nextNode_ = 0;
+
+    return true;
+}
+
+bool ChunkedScene::InstantiateNext()
+{
+    if (!target_)
+        return false;
+
+    // Skip the subtrees of nodes removed since they were created
+    while (nextNode_ < selectedNodes_.Size())
+    {
+        const ChunkedNodeEntry& entry = nodes_[selectedNodes_[nextNode_]];
+        if (!selectedNodes_[nextNode_] || createdNodes_[entry.parent_])
+            break;
+        while (nextNode_ < selectedNodes_.Size() && selectedNodes_[nextNode_] < entry.subtreeEnd_)
+            ++nextNode_;
+    }
+    if (nextNode_ >= selectedNodes_.Size())
+        return false;
+
+    if (nextNode_ >= windowEnd_)
+        ConvertWindow();
+
+    unsigned index = selectedNodes_[nextNode_];
+    unsigned block = windowStarts_[nextNode_ - windowBegin_];
+    const ChunkedNodeEntry& entry = nodes_[index];
+
+    Node* node;
+    CreateMode nodeMode;
+    if (index)
+    {
+        Node* parent = createdNodes_[entry.parent_];
+        nodeMode = (mode_ == REPLICATED && Scene::IsReplicatedID(entry.id_)) ? REPLICATED : LOCAL;
+        node = parent->CreateChild(rewriteIDs_ ? nodeIDs_[entry.id_] : entry.id_, nodeMode);
+        createdNodes_[index] = node;
+        if (useResolver_)
+            resolver_.AddNode(entry.id_, node);
+    }
+    else
+    {
+        node = target_;
+        nodeMode = node->IsReplicated() ? REPLICATED : LOCAL;
+    }
+
+    const ChunkedAttributeSchema& nodeSchema = schemas_[entry.schema_];
+    if (NeedsConversion(nodeSchema))
+    {
+        MemoryBuffer buffer(windowBlocks_[block].GetData(), windowBlocks_[block].GetSize());
+        node->Serializable::Load(buffer);
+    }
+    else
+    {
+        MemoryBuffer buffer(data_.Buffer() + entry.offset_, entry.size_);
+        node->Serializable::Load(buffer);
+    }
+
+    for (unsigned i = 0; i < entry.numComponents_; ++i)
+    {
+        const ChunkedComponentEntry& componentEntry = components_[entry.firstComponent_ + i];
+        const ChunkedAttributeSchema& schema = schemas_[componentEntry.schema_];
+
+        CreateMode componentMode = (nodeMode == REPLICATED && mode_ == REPLICATED && Scene::IsReplicatedID(componentEntry.id_)) ?
+            REPLICATED : LOCAL;
+        Component* component = node->SafeCreateComponent(schema.typeName_, schema.type_, componentMode,
+            rewriteIDs_ ? componentIDs_[componentEntry.id_] : componentEntry.id_);
+        if (!component)
+            continue;
+
+        // Do not abort if a component fails to load, as its block is separate from the others
+        if (NeedsConversion(schema))
+        {
+            const VectorBuffer& converted = windowBlocks_[block + 1 + i];
+            MemoryBuffer buffer(converted.GetData(), converted.GetSize());
+            component->Load(buffer);
+        }
+        else
+        {
+            MemoryBuffer buffer(data_.Buffer() + componentEntry.offset_, componentEntry.size_);
+            if (schema.verbatim_)
+            {
+                // Skip the type and ID written by the component's own Save()
+                buffer.ReadStringHash();
+                buffer.ReadUInt();
+                if (useResolver_)
+                    resolver_.AddComponent(componentEntry.id_, component);
+            }
+            component->Load(buffer);
+        }
+    }
+
+    ++nextNode_;
+    return true;
+}
+
+void ChunkedScene::InstantiateAll()
+{
+    while (InstantiateNext())
+    {
+    }
+
+    FinishInstantiate();
+}
+
+void ChunkedScene::FinishInstantiate()
+{
+    // If the target has been destroyed meanwhile, only clear the instantiation state
+    if (target_)
+    {
+        if (useResolver_)
+            resolver_.Resolve();
+        else
+            resolver_.Reset();
+
+        if (loadRoot_)
+            target_->ApplyAttributes();
+        else
+        {
+            // Apply the instantiated root-level subtrees only, as the target may have other content
+            for (unsigned i = 0; i < nextNode_; ++i)
+            {
+                unsigned index = selectedNodes_[i];
+                if (nodes_[index].parent_ == 0 && createdNodes_[index])
+                    createdNodes_[index]->ApplyAttributes();
+            }
+        }
+    }
+    else
+        resolver_.Reset();
+
+    target_.Reset();
+    selectedNodes_.Clear();
+    createdNodes_.Clear();
+    nodeIDs_.Clear();
+    componentIDs_.Clear();
+    windowBlocks_.Clear();
+    windowStarts_.Clear();
+    windowBegin_ = 0;
+    windowEnd_ = 0;
+}
+
+void ChunkedScene::ConvertWindow()
+{
+    windowBegin_ = nextNode_;
+    windowEnd_ = Min(nextNode_ + CONVERT_WINDOW_SIZE, selectedNodes_.Size());
+
+    unsigned numWindowNodes = windowEnd_ - windowBegin_;
+    unsigned numBlocks = 0;
+    bool needsConversion = false;
+    windowStarts_.Resize(numWindowNodes);
+    for (unsigned i = 0; i < numWindowNodes; ++i)
+    {
+        const ChunkedNodeEntry& entry = nodes_[selectedNodes_[windowBegin_ + i]];
+        windowStarts_[i] = numBlocks;
+        numBlocks += 1 + entry.numComponents_;
+
+        needsConversion |= NeedsConversion(schemas_[entry.schema_]);
+        for (unsigned j = entry.firstComponent_; j < entry.firstComponent_ + entry.numComponents_ && !needsConversion; ++j)
+            needsConversion |= NeedsConversion(schemas_[components_[j].schema_]);
+    }
+
+    windowBlocks_.Resize(numBlocks);
+    if (!needsConversion)
+        return;
+
+    URHO3D_PROFILE(ConvertChunkedSceneBlocks);
+
+    auto convertNodes = [&](unsigned begin, unsigned end, unsigned /*threadIndex*/)
+    {
+        for (unsigned i = begin; i < end; ++i)
+        {
+            const ChunkedNodeEntry& entry = nodes_[selectedNodes_[windowBegin_ + i]];
+            unsigned block = windowStarts_[i];
+
+            const ChunkedAttributeSchema& nodeSchema = schemas_[entry.schema_];
+            if (NeedsConversion(nodeSchema))
+                ConvertBlock(nodeSchema, entry.offset_, entry.size_, windowBlocks_[block]);
+
+            for (unsigned j = 0; j < entry.numComponents_; ++j)
+            {
+                const ChunkedComponentEntry& componentEntry = components_[entry.firstComponent_ + j];
+                const ChunkedAttributeSchema& schema = schemas_[componentEntry.schema_];
+                if (NeedsConversion(schema))
+                    ConvertBlock(schema, componentEntry.offset_, componentEntry.size_, windowBlocks_[block + 1 + j]);
+            }
+        }
+    };
+
+    // Blocks of different nodes are independent, so convert them in worker threads when possible
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (queue && queue->GetNumThreads() && Thread::IsMainThread() && numWindowNodes > MIN_CONVERT_BATCH)
+        queue->ParallelFor(numWindowNodes, MIN_CONVERT_BATCH, convertNodes);
+    else
+        convertNodes(0, numWindowNodes, 0);
+}
+
+void ChunkedScene::ConvertBlock(const ChunkedAttributeSchema& schema, unsigned offset, unsigned size, VectorBuffer& dest) const
+{
+    const Vector<AttributeInfo>* attributes = context_->GetAttributes(schema.type_);
+    dest.Clear();
+    if (!attributes)
+        return;
+
+    Vector<Variant> values(attributes->Size());
+    MemoryBuffer source(data_.Buffer() + offset, size);
+    for (unsigned i = 0; i < schema.types_.Size(); ++i)
+    {
+        Variant value = source.ReadVariant(schema.types_[i]);
+        unsigned runtimeIndex = schema.runtimeIndices_[i];
+        if (runtimeIndex != M_MAX_UNSIGNED)
+            values[runtimeIndex] = value;
+    }
+
+    for (unsigned i = 0; i < attributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (!(attr.mode_ & AM_FILE))
+            continue;
+
+        Variant& value = values[i];
+        if (value.GetType() != attr.type_)
+            value = GetMissingAttributeValue(attr);
+        else if (rewriteIDs_ && (attr.mode_ & ID_ATTRIBUTE_MODES))
+        {
+            // Like SceneResolver, unresolved IDs are left as they are, except in ID vectors where they are zeroed
+            if (attr.mode_ & AM_NODEIDVECTOR)
+            {
+                VariantVector ids = value.GetVariantVector();
+                // The first element stores the number of IDs
+                for (unsigned j = 1; j < ids.Size(); ++j)
+                {
+                    HashMap<unsigned, unsigned>::ConstIterator k = nodeIDs_.Find(ids[j].GetUInt());
+                    ids[j] = k != nodeIDs_.End() ? k->second_ : 0;
+                }
+                value = ids;
+            }
+            else
+            {
+                const HashMap<unsigned, unsigned>& ids = (attr.mode_ & AM_NODEID) ? nodeIDs_ : componentIDs_;
+                HashMap<unsigned, unsigned>::ConstIterator j = ids.Find(value.GetUInt());
+                if (j != ids.End())
+                    value = j->second_;
+            }
+        }
+
+        dest.WriteVariantData(value);
+    }
+}
+
+}
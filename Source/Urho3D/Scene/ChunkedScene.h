@@ -0,0 +1,212 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Core/Attribute.h"
+#include "../IO/VectorBuffer.h"
+#include "../Math/BoundingBox.h"
+#include "../Resource/Resource.h"
+#include "../Scene/Node.h"
+#include "../Scene/SceneResolver.h"
+
+namespace Urho3D
+{
+
+class Deserializer;
+class Serializer;
+
+/// Attribute layout of one object type in a chunked scene file.
+struct ChunkedAttributeSchema
+{
+    /// Object type.
+    StringHash type_;
+    /// Object type name.
+    String typeName_;
+    /// Attribute names in file order.
+    Vector<String> names_;
+    /// Attribute types in file order.
+    PODVector<VariantType> types_;
+    /// Verbatim flag. Verbatim objects have per-instance attributes and are stored as written by their own Save().
+    bool verbatim_{};
+    /// Runtime attribute index for each file attribute, or M_MAX_UNSIGNED if not present. Filled when loading.
+    PODVector<unsigned> runtimeIndices_;
+    /// Whether the file layout is identical to the runtime layout, so that blocks can be loaded as is. Filled when loading.
+    bool identical_{};
+    /// Whether the runtime layout has node or component ID attributes. Filled when loading.
+    bool hasIDAttributes_{};
+};
+
+/// Node entry in a chunked scene file.
+struct ChunkedNodeEntry
+{
+    /// Node ID.
+    unsigned id_;
+    /// Parent node index, or M_MAX_UNSIGNED for the root.
+    unsigned parent_;
+    /// Attribute schema index.
+    unsigned schema_;
+    /// Index of the first component in the component table.
+    unsigned firstComponent_;
+    /// Number of components.
+    unsigned numComponents_;
+    /// Index one past the last node of the subtree starting from this node.
+    unsigned subtreeEnd_;
+    /// World position at the time of saving.
+    Vector3 position_;
+    /// Attribute block offset in the data chunk.
+    unsigned offset_;
+    /// Attribute block size.
+    unsigned size_;
+};
+
+/// Component entry in a chunked scene file.
+struct ChunkedComponentEntry
+{
+    /// Attribute schema index.
+    unsigned schema_;
+    /// Component ID.
+    unsigned id_;
+    /// Attribute block offset in the data chunk.
+    unsigned offset_;
+    /// Attribute block size.
+    unsigned size_;
+};
+
+/// %Scene or object prefab in the chunked binary format. The node table, attribute layouts and resource list are read up front, so that nodes can be instantiated one at a time, selectively by region, and with their attribute blocks converted and ID-remapped in worker threads.
+class URHO3D_API ChunkedScene : public Resource
+{
+    URHO3D_OBJECT(ChunkedScene, Resource);
+
+public:
+    /// Construct.
+    explicit ChunkedScene(Context* context);
+    /// Destruct.
+    ~ChunkedScene() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Save a node and its child nodes in the chunked binary format. Return true if successful.
+    static bool SaveNode(Serializer& dest, const Node* node);
+    /// Save a node's attributes and the given child nodes in the chunked binary format, for example to split content into several files. The node's components are not saved. Return true if successful.
+    static bool SaveNode(Serializer& dest, const Node* node, const PODVector<Node*>& children);
+
+    /// Load resource from stream. May be called from a worker thread. Reads the tables and data of a chunked scene file. Return true if successful.
+    bool BeginLoad(Deserializer& source) override;
+    /// Finish resource loading. Always called from the main thread. Finishes an instantiation in progress and replaces the tables with the loaded ones. Return true if successful.
+    bool EndLoad() override;
+    /// Set region for instantiation. Only root-level child nodes whose saved world position is inside the region are instantiated.
+    void SetRegion(const BoundingBox& region);
+    /// Clear the region to instantiate all nodes.
+    void ClearRegion();
+    /// Begin instantiating into a target node. If loadRoot is true, the saved root node's attributes and components are loaded into the target, otherwise only its child nodes are created. A resource instantiates into one target at a time: an instantiation already in progress is finished first, leaving its remaining nodes uncreated. Return true if successful.
+    bool BeginInstantiate(Node* target, bool loadRoot, bool rewriteIDs, CreateMode mode = REPLICATED);
+    /// Instantiate the next node with its components. Subtrees whose parent node has been removed meanwhile are skipped. Return false if there were no nodes left.
+    bool InstantiateNext();
+    /// Instantiate all remaining nodes and finish.
+    void InstantiateAll();
+    /// Finish instantiation. Resolves remaining ID references and applies attributes of the instantiated nodes that still exist.
+    void FinishInstantiate();
+
+    /// Return node table in depth-first order. The first node is the saved root.
+    const PODVector<ChunkedNodeEntry>& GetNodes() const { return nodes_; }
+    /// Return component table.
+    const PODVector<ChunkedComponentEntry>& GetComponents() const { return components_; }
+    /// Return attribute schemas.
+    const Vector<ChunkedAttributeSchema>& GetSchemas() const { return schemas_; }
+    /// Return resources referenced by the saved objects.
+    const Vector<ResourceRef>& GetResources() const { return resources_; }
+    /// Return whether instantiation is in progress.
+    bool IsInstantiating() const { return target_ != nullptr; }
+    /// Return number of selected nodes instantiated or skipped since beginning.
+    unsigned GetNumInstantiated() const { return nextNode_; }
+    /// Return number of nodes selected for instantiation.
+    unsigned GetNumSelected() const { return selectedNodes_.Size(); }
+
+private:
+    /// Convert the attribute blocks of the next window of selected nodes, in worker threads if available.
+    void ConvertWindow();
+    /// Convert an attribute block to the runtime layout, remapping IDs if necessary.
+    void ConvertBlock(const ChunkedAttributeSchema& schema, unsigned offset, unsigned size, VectorBuffer& dest) const;
+    /// Return whether an attribute block needs to be converted before loading.
+    bool NeedsConversion(const ChunkedAttributeSchema& schema) const
+    {
+        return !schema.verbatim_ && (!schema.identical_ || (rewriteIDs_ && schema.hasIDAttributes_));
+    }
+
+    /// Attribute schemas.
+    Vector<ChunkedAttributeSchema> schemas_;
+    /// Referenced resources.
+    Vector<ResourceRef> resources_;
+    /// Node table.
+    PODVector<ChunkedNodeEntry> nodes_;
+    /// Component table.
+    PODVector<ChunkedComponentEntry> components_;
+    /// Attribute block data.
+    PODVector<unsigned char> data_;
+    /// Attribute schemas being loaded.
+    Vector<ChunkedAttributeSchema> loadSchemas_;
+    /// Referenced resources being loaded.
+    Vector<ResourceRef> loadResources_;
+    /// Node table being loaded.
+    PODVector<ChunkedNodeEntry> loadNodes_;
+    /// Component table being loaded.
+    PODVector<ChunkedComponentEntry> loadComponents_;
+    /// Attribute block data being loaded.
+    PODVector<unsigned char> loadData_;
+    /// Instantiation region.
+    BoundingBox region_;
+    /// Target node of the instantiation.
+    WeakPtr<Node> target_;
+    /// Node indices selected for instantiation, in depth-first order.
+    PODVector<unsigned> selectedNodes_;
+    /// Instantiated nodes by node index.
+    Vector<WeakPtr<Node> > createdNodes_;
+    /// Node ID mapping when rewriting IDs.
+    HashMap<unsigned, unsigned> nodeIDs_;
+    /// Component ID mapping when rewriting IDs.
+    HashMap<unsigned, unsigned> componentIDs_;
+    /// Resolver for the ID attributes of verbatim components when rewriting IDs.
+    SceneResolver resolver_;
+    /// Converted attribute blocks of the current window, node block first followed by its component blocks.
+    Vector<VectorBuffer> windowBlocks_;
+    /// Start of each window node's blocks.
+    PODVector<unsigned> windowStarts_;
+    /// First selected node index of the current window.
+    unsigned windowBegin_;
+    /// Selected node index one past the current window.
+    unsigned windowEnd_;
+    /// Next selected node index to instantiate.
+    unsigned nextNode_;
+    /// Instantiation create mode.
+    CreateMode mode_;
+    /// Load root node attributes and components flag.
+    bool loadRoot_;
+    /// Rewrite IDs flag.
+    bool rewriteIDs_;
+    /// Whether verbatim components have been registered to the resolver.
+    bool useResolver_;
+    /// Region defined flag.
+    bool useRegion_;
+};
+
+}
@@ -159,6 +159,17 @@ Scene* Component::GetScene() const
 
 void Component::AddReplicationState(ComponentReplicationState* state)
 {
+    // Connections build their server updates in worker threads during a threaded update
+    Scene* scene = GetScene();
+    if (scene && scene->IsThreadedUpdate())
+    {
+        MutexLock lock(scene->GetSceneMutex());
+        if (!networkState_)
+            AllocateNetworkState();
+        networkState_->replicationStates_.Push(state);
+        return;
+    }
+
     if (!networkState_)
         AllocateNetworkState();
 
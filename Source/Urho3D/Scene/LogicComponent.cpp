@@ -28,7 +28,6 @@
 #endif
 #include "../Scene/LogicComponent.h"
 #include "../Scene/Scene.h"
-#include "../Scene/SceneEvents.h"
 
 namespace Urho3D
 {
@@ -37,11 +36,20 @@ LogicComponent::LogicComponent(Context* context) :
     Component(context),
     updateEventMask_(USE_UPDATE | USE_POSTUPDATE | USE_FIXEDUPDATE | USE_FIXEDPOSTUPDATE),
     currentEventMask_(0),
-    delayedStartCalled_(false)
+    delayedStartCalled_(false),
+    updateScene_(nullptr)
 {
+    for (unsigned i = 0; i < MAX_SCENE_UPDATE_PHASES; ++i)
+    {
+        updateListIndex_[i] = M_MAX_UNSIGNED;
+        updateListPosition_[i] = M_MAX_UNSIGNED;
+    }
 }
 
-LogicComponent::~LogicComponent() = default;
+LogicComponent::~LogicComponent()
+{
+    RemoveFromUpdateLists();
+}
 
 void LogicComponent::OnSetEnabled()
 {
@@ -90,11 +98,13 @@ void LogicComponent::OnNodeSet(Node* node)
 void LogicComponent::OnSceneSet(Scene* scene)
 {
     if (scene)
+    {
+        updateScene_ = scene;
         UpdateEventSubscription();
+    }
     else
     {
-        UnsubscribeFromEvent(E_SCENEUPDATE);
-        UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+        RemoveFromUpdateLists();
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
         UnsubscribeFromEvent(E_PHYSICSPRESTEP);
         UnsubscribeFromEvent(E_PHYSICSPOSTSTEP);
@@ -114,24 +124,24 @@ void LogicComponent::UpdateEventSubscription()
     bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
     if (needUpdate && !(currentEventMask_ & USE_UPDATE))
     {
-        SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(LogicComponent, HandleSceneUpdate));
+        scene->AddUpdateComponent(this, SUP_UPDATE);
         currentEventMask_ |= USE_UPDATE;
     }
     else if (!needUpdate && (currentEventMask_ & USE_UPDATE))
     {
-        UnsubscribeFromEvent(scene, E_SCENEUPDATE);
+        scene->RemoveUpdateComponent(this, SUP_UPDATE);
         currentEventMask_ &= ~USE_UPDATE;
     }
 
     bool needPostUpdate = enabled && (updateEventMask_ & USE_POSTUPDATE);
     if (needPostUpdate && !(currentEventMask_ & USE_POSTUPDATE))
     {
-        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(LogicComponent, HandleScenePostUpdate));
+        scene->AddUpdateComponent(this, SUP_POSTUPDATE);
         currentEventMask_ |= USE_POSTUPDATE;
     }
     else if (!needPostUpdate && (currentEventMask_ & USE_POSTUPDATE))
     {
-        UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
+        scene->RemoveUpdateComponent(this, SUP_POSTUPDATE);
         currentEventMask_ &= ~USE_POSTUPDATE;
     }
 
@@ -166,35 +176,50 @@ void LogicComponent::UpdateEventSubscription()
 #endif
 }
 
-void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+void LogicComponent::RemoveFromUpdateLists()
 {
-    using namespace SceneUpdate;
+    if (updateScene_)
+    {
+        updateScene_->RemoveUpdateComponent(this, SUP_UPDATE);
+        updateScene_->RemoveUpdateComponent(this, SUP_POSTUPDATE);
+        updateScene_ = nullptr;
+    }
+
+    currentEventMask_ &= ~(USE_UPDATE | USE_POSTUPDATE);
+}
+
+void LogicComponent::CallDelayedStart()
+{
+    DelayedStart();
+    delayedStartCalled_ = true;
+
+    // If did not need actual updates, stop them now
+    if (!(updateEventMask_ & USE_UPDATE) && (currentEventMask_ & USE_UPDATE) && updateScene_)
+    {
+        updateScene_->RemoveUpdateComponent(this, SUP_UPDATE);
+        currentEventMask_ &= ~USE_UPDATE;
+    }
+}
+
+void LogicComponent::CallUpdate(SceneUpdatePhase phase, float timeStep)
+{
+    if (phase == SUP_POSTUPDATE)
+    {
+        // Execute user-defined post-update function
+        PostUpdate(timeStep);
+        return;
+    }
 
     // Execute user-defined delayed start function before first update
     if (!delayedStartCalled_)
     {
-        DelayedStart();
-        delayedStartCalled_ = true;
-
-        // If did not need actual update events, unsubscribe now
+        CallDelayedStart();
         if (!(updateEventMask_ & USE_UPDATE))
-        {
-            UnsubscribeFromEvent(GetScene(), E_SCENEUPDATE);
-            currentEventMask_ &= ~USE_UPDATE;
             return;
-        }
     }
 
     // Then execute user-defined update function
-    Update(eventData[P_TIMESTEP].GetFloat());
-}
-
-void LogicComponent::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
-{
-    using namespace ScenePostUpdate;
-
-    // Execute user-defined post-update function
-    PostUpdate(eventData[P_TIMESTEP].GetFloat());
+    Update(timeStep);
 }
 
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
@@ -205,10 +230,7 @@ void LogicComponent::HandlePhysicsPreStep(StringHash eventType, VariantMap& even
 
     // Execute user-defined delayed start function before first fixed update if not called yet
     if (!delayedStartCalled_)
-    {
-        DelayedStart();
-        delayedStartCalled_ = true;
-    }
+        CallDelayedStart();
 
     // Execute user-defined fixed update function
     FixedUpdate(eventData[P_TIMESTEP].GetFloat());
@@ -24,6 +24,7 @@
 
 #include "../Container/FlagSet.h"
 #include "../Scene/Component.h"
+#include "../Scene/Scene.h"
 
 namespace Urho3D
 {
@@ -43,11 +44,13 @@ enum UpdateEvent : unsigned
 };
 URHO3D_FLAGSET(UpdateEvent, UpdateEventFlags);
 
-/// Helper base class for user-defined game logic components that hooks up to update events and forwards them to virtual functions similar to ScriptInstance class.
+/// Helper base class for user-defined game logic components that hooks up to update events and forwards them to virtual functions similar to ScriptInstance class. The variable timestep updates are called directly by the scene from per-type update lists instead of through events.
 class URHO3D_API LogicComponent : public Component
 {
     URHO3D_OBJECT(LogicComponent, Component);
 
+    friend class Scene;
+
     /// Construct.
     explicit LogicComponent(Context* context);
     /// Destruct.
@@ -82,6 +85,8 @@ class URHO3D_API LogicComponent : public Component
 
     /// Return whether the DelayedStart() function has been called.
     bool IsDelayedStartCalled() const { return delayedStartCalled_; }
+    /// Return whether Update() and PostUpdate() of this component type may be called in worker threads, in parallel with other components of the same type. Override to return true only if they modify nothing but the component's own state and its node's transform.
+    virtual bool IsThreadSafeUpdate() const { return false; }
 
 protected:
     /// Handle scene node being assigned at creation.
@@ -92,10 +97,12 @@ protected:
 private:
     /// Subscribe/unsubscribe to update events based on current enabled state and update event mask.
     void UpdateEventSubscription();
-    /// Handle scene update event.
-    void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
-    /// Handle scene post-update event.
-    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    /// Remove from the scene's update lists.
+    void RemoveFromUpdateLists();
+    /// Call the delayed start function and stop variable timestep updates if not wanted. Called by the scene or before the first fixed update.
+    void CallDelayedStart();
+    /// Call the update or post-update function, with delayed start before the first update. Called by the scene.
+    void CallUpdate(SceneUpdatePhase phase, float timeStep);
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
     /// Handle physics pre-step event.
     void HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData);
@@ -108,6 +115,12 @@ private:
     UpdateEventFlags currentEventMask_;
     /// Flag for delayed start.
     bool delayedStartCalled_;
+    /// Scene whose update lists the component is in.
+    Scene* updateScene_;
+    /// Index of the scene update list per update phase, or M_MAX_UNSIGNED if not listed.
+    unsigned updateListIndex_[MAX_SCENE_UPDATE_PHASES];
+    /// Position within the scene update list per update phase, or M_MAX_UNSIGNED if not listed.
+    unsigned updateListPosition_[MAX_SCENE_UPDATE_PHASES];
 };
 
 }
@@ -74,7 +74,9 @@ class URHO3D_API Node : public Animatable
 {
     URHO3D_OBJECT(Node, Animatable);
 
+    friend class ChunkedScene;
     friend class Connection;
+    friend class Scene;
 
 public:
     /// Construct.
@@ -111,6 +113,8 @@ public:
     bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
     /// Save to a JSON file. Return true if successful.
     bool SaveJSON(Serializer& dest, const String& indentation = "\t") const;
+    /// Save to the chunked binary format, which can be instantiated one node at a time. Return true if successful.
+    bool SaveChunked(Serializer& dest) const;
     /// Set name of the scene node. Names are not required to be unique.
     void SetName(const String& name);
 
@@ -581,13 +585,13 @@ public:
     /// Set network position attribute.
     void SetNetPositionAttr(const Vector3& value);
     /// Set network rotation attribute.
-    void SetNetRotationAttr(const PODVector<unsigned char>& value);
+    void SetNetRotationAttr(const Quaternion& value);
     /// Set network parent attribute.
     void SetNetParentAttr(const PODVector<unsigned char>& value);
     /// Return network position attribute.
     const Vector3& GetNetPositionAttr() const;
     /// Return network rotation attribute.
-    const PODVector<unsigned char>& GetNetRotationAttr() const;
+    const Quaternion& GetNetRotationAttr() const;
     /// Return network parent attribute.
     const PODVector<unsigned char>& GetNetParentAttr() const;
     /// Load components and optionally load child nodes.
@@ -644,6 +648,8 @@ private:
     Component* SafeCreateComponent(const String& typeName, StringHash type, CreateMode mode, unsigned id);
     /// Recalculate the world transform.
     void UpdateWorldTransform() const;
+    /// Notify listener components that the transform has changed.
+    void NotifyListeners();
     /// Remove child node by iterator.
     void RemoveChild(Vector<SharedPtr<Node> >::Iterator i);
     /// Return child nodes recursively.
@@ -669,6 +675,8 @@ private:
     bool enabled_;
     /// Last SetEnabled flag before any SetDeepEnabled.
     bool enabledPrev_;
+    /// Queued for the scene's batched transform update flag.
+    bool transformQueued_;
 
 protected:
     /// Network update queued flag.
@@ -132,6 +132,8 @@ struct URHO3D_API NetworkState
     VariantMap previousVars_;
     /// Bitmask for intercepting network messages. Used on the client only.
     unsigned long long interceptMask_{};
+    /// Last received quantized attribute values, the baseline for delta decoding. Used on the client only.
+    PODVector<unsigned> quantizedValues_;
 };
 
 /// Base class for per-user network replication states.
@@ -150,6 +152,8 @@ struct URHO3D_API ComponentReplicationState : public ReplicationState
     WeakPtr<Component> component_;
     /// Dirty attribute bits.
     DirtyBits dirtyAttributes_;
+    /// Last sent quantized attribute values, the baseline for delta encoding.
+    PODVector<unsigned> quantizedValues_;
 };
 
 /// Per-user node network replication state.
@@ -163,6 +167,8 @@ struct URHO3D_API NodeReplicationState : public ReplicationState
     DirtyBits dirtyAttributes_;
     /// Dirty user vars.
     HashSet<StringHash> dirtyVars_;
+    /// Last sent quantized attribute values, the baseline for delta encoding.
+    PODVector<unsigned> quantizedValues_;
     /// Components by ID.
     HashMap<unsigned, ComponentReplicationState> componentStates_;
     /// Interest management priority accumulator.
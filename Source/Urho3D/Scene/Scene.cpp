@@ -33,7 +33,9 @@
 #include "../Resource/ResourceEvents.h"
 #include "../Resource/XMLFile.h"
 #include "../Resource/JSONFile.h"
+#include "../Scene/ChunkedScene.h"
 #include "../Scene/Component.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/Scene.h"
@@ -42,6 +44,7 @@
 #include "../Scene/SplinePath.h"
 #include "../Scene/UnknownComponent.h"
 #include "../Scene/ValueAnimation.h"
+#include "../Scene/WorldStreamer.h"
 
 #include "../DebugNew.h"
 
@@ -54,9 +57,12 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+static const unsigned MIN_PARALLEL_TRANSFORMS = 256;
+static const unsigned TRANSFORMS_PER_BATCH = 64;
 
 Scene::Scene(Context* context) :
     Node(context),
+    numRemovedSmoothedTransforms_(0),
     replicatedNodeID_(FIRST_REPLICATED_ID),
     replicatedComponentID_(FIRST_REPLICATED_ID),
     localNodeID_(FIRST_LOCAL_ID),
@@ -69,7 +75,9 @@ Scene::Scene(Context* context) :
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
     updateEnabled_(true),
     asyncLoading_(false),
-    threadedUpdate_(false)
+    threadedUpdate_(false),
+    batchedTransforms_(false),
+    batchingTransforms_(false)
 {
     // Assign an ID to self so that nodes can refer to this node as a parent
     SetID(GetFreeNodeID(REPLICATED));
@@ -91,6 +99,25 @@ Scene::~Scene()
         i->second_->ResetScene();
     for (HashMap<unsigned, Node*>::Iterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
         i->second_->ResetScene();
+
+    // Components of nodes that still exist must not refer to the update lists anymore
+    for (unsigned phase = 0; phase < MAX_SCENE_UPDATE_PHASES; ++phase)
+    {
+        for (unsigned i = 0; i < updateLists_[phase].Size(); ++i)
+        {
+            PODVector<LogicComponent*>& components = updateLists_[phase][i].components_;
+            for (PODVector<LogicComponent*>::Iterator j = components.Begin(); j != components.End(); ++j)
+            {
+                if (*j)
+                    (*j)->RemoveFromUpdateLists();
+            }
+        }
+    }
+    for (PODVector<SmoothedTransform*>::Iterator i = smoothedTransforms_.Begin(); i != smoothedTransforms_.End(); ++i)
+    {
+        if (*i)
+            (*i)->StopSmoothing();
+    }
 }
 
 void Scene::RegisterObject(Context* context)
@@ -118,7 +145,32 @@ bool Scene::Load(Deserializer& source)
     StopAsyncLoading();
 
     // Check ID
-    if (source.ReadFileID() != "USCN")
+    unsigned position = source.GetPosition();
+    String fileID = source.ReadFileID();
+    if (fileID == "USCC")
+    {
+        // Chunked binary scene, rewind so that the file ID is checked again when reading the tables
+        source.Seek(position);
+        SharedPtr<ChunkedScene> chunkedScene(new ChunkedScene(context_));
+        if (!chunkedScene->Load(source))
+            return false;
+        if (chunkedScene->GetSchemas()[chunkedScene->GetNodes()[0].schema_].type_ != GetTypeStatic())
+        {
+            URHO3D_LOGERROR(source.GetName() + " is not a valid scene file");
+            return false;
+        }
+
+        URHO3D_LOGINFO("Loading scene from " + source.GetName());
+
+        Clear();
+
+        if (!chunkedScene->BeginInstantiate(this, true, false))
+            return false;
+        chunkedScene->InstantiateAll();
+        FinishLoading(&source);
+        return true;
+    }
+    else if (fileID != "USCN")
     {
         URHO3D_LOGERROR(source.GetName() + " is not a valid scene file");
         return false;
@@ -282,6 +334,23 @@ bool Scene::SaveXML(Serializer& dest, const String& indentation) const
         return false;
 }
 
+bool Scene::SaveChunked(Serializer& dest) const
+{
+    URHO3D_PROFILE(SaveSceneChunked);
+
+    auto* ptr = dynamic_cast<Deserializer*>(&dest);
+    if (ptr)
+        URHO3D_LOGINFO("Saving scene to " + ptr->GetName());
+
+    if (Node::SaveChunked(dest))
+    {
+        FinishSaving(&dest);
+        return true;
+    }
+    else
+        return false;
+}
+
 bool Scene::SaveJSON(Serializer& dest, const String& indentation) const
 {
     URHO3D_PROFILE(SaveSceneJSON);
@@ -317,7 +386,14 @@ bool Scene::LoadAsync(File* file, LoadMode mode)
     StopAsyncLoading();
 
     // Check ID
-    bool isSceneFile = file->ReadFileID() == "USCN";
+    String fileID = file->ReadFileID();
+    if (fileID == "USCC")
+    {
+        file->Seek(0);
+        return LoadAsyncChunked(file, mode);
+    }
+
+    bool isSceneFile = fileID == "USCN";
     if (!isSceneFile)
     {
         // In resource load mode can load also object prefabs, which have no identifier
@@ -379,6 +455,56 @@ bool Scene::LoadAsync(File* file, LoadMode mode)
     return true;
 }
 
+bool Scene::LoadAsyncChunked(File* file, LoadMode mode)
+{
+    SharedPtr<ChunkedScene> chunkedScene(new ChunkedScene(context_));
+    if (!chunkedScene->Load(*file))
+        return false;
+
+    // In resource load mode can load also object prefabs
+    bool isSceneFile = chunkedScene->GetSchemas()[chunkedScene->GetNodes()[0].schema_].type_ == GetTypeStatic();
+    if (mode > LOAD_RESOURCES_ONLY)
+    {
+        if (!isSceneFile)
+        {
+            URHO3D_LOGERROR(file->GetName() + " is not a valid scene file");
+            return false;
+        }
+
+        URHO3D_LOGINFO("Loading scene from " + file->GetName());
+        Clear();
+    }
+
+    asyncLoading_ = true;
+    asyncProgress_.file_ = file;
+    asyncProgress_.chunkedScene_ = chunkedScene;
+    asyncProgress_.mode_ = mode;
+    asyncProgress_.loadedNodes_ = asyncProgress_.totalNodes_ = asyncProgress_.loadedResources_ = asyncProgress_.totalResources_ = 0;
+    asyncProgress_.resources_.Clear();
+
+    if (mode > LOAD_RESOURCES_ONLY)
+    {
+        // The resources are listed in their own table, so no need to read through the scene content
+        if (mode != LOAD_SCENE)
+            PreloadResourcesChunked(chunkedScene);
+
+        // Prepare to load all nodes one at a time in the async updates, starting from the scene itself
+        if (!chunkedScene->BeginInstantiate(this, true, false))
+        {
+            StopAsyncLoading();
+            return false;
+        }
+        asyncProgress_.totalNodes_ = chunkedScene->GetNumSelected();
+    }
+    else
+    {
+        URHO3D_LOGINFO("Preloading resources from " + file->GetName());
+        PreloadResourcesChunked(chunkedScene);
+    }
+
+    return true;
+}
+
 bool Scene::LoadAsyncXML(File* file, LoadMode mode)
 {
     if (!file)
@@ -519,6 +645,7 @@ void Scene::StopAsyncLoading()
     asyncProgress_.file_.Reset();
     asyncProgress_.xmlFile_.Reset();
     asyncProgress_.jsonFile_.Reset();
+    asyncProgress_.chunkedScene_.Reset();
     asyncProgress_.xmlElement_ = XMLElement::EMPTY;
     asyncProgress_.jsonIndex_ = 0;
     asyncProgress_.resources_.Clear();
@@ -612,6 +739,42 @@ Node* Scene::InstantiateJSON(Deserializer& source, const Vector3& position, cons
     return InstantiateJSON(json->GetRoot(), position, rotation, mode);
 }
 
+Node* Scene::InstantiateChunked(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode)
+{
+    SharedPtr<ChunkedScene> chunkedScene(new ChunkedScene(context_));
+    if (!chunkedScene->Load(source))
+        return nullptr;
+
+    return InstantiateChunked(chunkedScene, position, rotation, mode);
+}
+
+Node* Scene::InstantiateChunked(ChunkedScene* chunkedScene, const Vector3& position, const Quaternion& rotation, CreateMode mode)
+{
+    URHO3D_PROFILE(InstantiateChunked);
+
+    if (!chunkedScene)
+    {
+        URHO3D_LOGERROR("Null chunked scene for instantiation");
+        return nullptr;
+    }
+
+    // Rewrite IDs when instantiating
+    Node* node = CreateChild(0, mode);
+    if (!chunkedScene->BeginInstantiate(node, true, true, mode))
+    {
+        node->Remove();
+        return nullptr;
+    }
+
+    while (chunkedScene->InstantiateNext())
+    {
+    }
+
+    node->SetTransform(position, rotation);
+    chunkedScene->FinishInstantiate();
+    return node;
+}
+
 void Scene::Clear(bool clearReplicated, bool clearLocal)
 {
     StopAsyncLoading();
@@ -669,6 +832,13 @@ void Scene::SetAsyncLoadingMs(int ms)
     asyncLoadingMs_ = Max(ms, 1);
 }
 
+void Scene::SetBatchedTransforms(bool enable)
+{
+    batchedTransforms_ = enable;
+    if (!enable)
+        EndTransformBatch();
+}
+
 void Scene::SetElapsedTime(float time)
 {
     elapsedTime_ = time;
@@ -777,11 +947,14 @@ void Scene::Update(float timeStep)
     eventData[P_SCENE] = this;
     eventData[P_TIMESTEP] = timeStep;
 
-    // Update variable timestep logic
+    // Update variable timestep logic. Logic components are updated directly, then the event is sent for other listeners
+    BeginTransformBatch();
+    UpdateLogicComponents(SUP_UPDATE, timeStep);
     SendEvent(E_SCENEUPDATE, eventData);
 
     // Update scene attribute animation.
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
+    EndTransformBatch();
 
     // Update scene subsystems. If a physics world is present, it will be updated, triggering fixed timestep logic updates
     SendEvent(E_SCENESUBSYSTEMUPDATE, eventData);
@@ -795,13 +968,20 @@ void Scene::Update(float timeStep)
 
         using namespace UpdateSmoothing;
 
+        BeginTransformBatch();
+        UpdateSmoothedTransforms(constant, squaredSnapThreshold);
+
         smoothingData_[P_CONSTANT] = constant;
         smoothingData_[P_SQUAREDSNAPTHRESHOLD] = squaredSnapThreshold;
         SendEvent(E_UPDATESMOOTHING, smoothingData_);
+        EndTransformBatch();
     }
 
     // Post-update variable timestep logic
+    BeginTransformBatch();
+    UpdateLogicComponents(SUP_POSTUPDATE, timeStep);
     SendEvent(E_SCENEPOSTUPDATE, eventData);
+    EndTransformBatch();
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -839,6 +1019,195 @@ void Scene::DelayedMarkedDirty(Component* component)
     delayedDirtyComponents_.Push(component);
 }
 
+void Scene::QueueTransformUpdate(Node* node)
+{
+    if (!node)
+        return;
+
+    if (!threadedUpdate_)
+    {
+        if (!node->transformQueued_)
+        {
+            node->transformQueued_ = true;
+            transformUpdateNodes_.Push(WeakPtr<Node>(node));
+        }
+    }
+    else
+    {
+        MutexLock lock(sceneMutex_);
+        if (!node->transformQueued_)
+        {
+            node->transformQueued_ = true;
+            transformUpdateNodes_.Push(WeakPtr<Node>(node));
+        }
+    }
+}
+
+void Scene::UpdateTransforms()
+{
+    if (transformUpdateNodes_.Empty())
+        return;
+
+    URHO3D_PROFILE(UpdateTransforms);
+
+    // Listeners may move nodes while being notified; handle those immediately instead of queuing again
+    bool wasBatching = batchingTransforms_;
+    batchingTransforms_ = false;
+
+    // Sort the queued nodes by hierarchy depth with a counting sort, so that parents are always processed before their children.
+    // Nodes that have expired or left the scene get depth zero and are skipped
+    unsigned numNodes = transformUpdateNodes_.Size();
+    transformNodeDepths_.Resize(numNodes);
+    transformDepthOffsets_.Clear();
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        Node* node = transformUpdateNodes_[i];
+        unsigned depth = 0;
+        if (node)
+        {
+            node->transformQueued_ = false;
+            if (node->scene_ == this)
+            {
+                depth = 1;
+                for (Node* parent = node->parent_; parent; parent = parent->parent_)
+                    ++depth;
+            }
+        }
+
+        transformNodeDepths_[i] = depth;
+        while (transformDepthOffsets_.Size() <= depth + 1)
+            transformDepthOffsets_.Push(0);
+        ++transformDepthOffsets_[depth + 1];
+    }
+
+    unsigned numDepths = transformDepthOffsets_.Size() - 1;
+    for (unsigned i = 1; i <= numDepths; ++i)
+        transformDepthOffsets_[i] += transformDepthOffsets_[i - 1];
+
+    sortedTransformNodes_.Resize(numNodes);
+    for (unsigned i = 0; i < numNodes; ++i)
+        sortedTransformNodes_[transformDepthOffsets_[transformNodeDepths_[i]]++] = transformUpdateNodes_[i];
+    // The offsets now point to the end of each depth; shift them back to the start
+    for (unsigned i = numDepths; i > 0; --i)
+        transformDepthOffsets_[i] = transformDepthOffsets_[i - 1];
+    transformDepthOffsets_[0] = 0;
+
+    transformUpdateNodes_.Clear();
+
+    // Recalculate world transforms one depth at a time. Nodes of the same depth only read their already updated parents and can
+    // be processed in parallel
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    Node** nodes = sortedTransformNodes_.Begin().ptr_;
+    unsigned firstNode = transformDepthOffsets_[1];
+    for (unsigned depth = 1; depth < numDepths; ++depth)
+    {
+        unsigned start = transformDepthOffsets_[depth];
+        unsigned end = transformDepthOffsets_[depth + 1];
+
+        // A parent may have been dirtied outside the batch and not be queued; update it first so that it is not written
+        // concurrently by its children
+        for (unsigned i = start; i < end; ++i)
+        {
+            Node* parent = nodes[i]->parent_;
+            if (parent && parent->dirty_)
+                parent->UpdateWorldTransform();
+        }
+
+        if (queue && queue->GetNumThreads() && end - start >= MIN_PARALLEL_TRANSFORMS)
+        {
+            queue->ParallelFor(end - start, TRANSFORMS_PER_BATCH, [=](unsigned begin, unsigned batchEnd, unsigned /*threadIndex*/)
+            {
+                for (unsigned i = start + begin; i < start + batchEnd; ++i)
+                {
+                    if (nodes[i]->dirty_)
+                        nodes[i]->UpdateWorldTransform();
+                }
+            });
+        }
+        else
+        {
+            for (unsigned i = start; i < end; ++i)
+            {
+                if (nodes[i]->dirty_)
+                    nodes[i]->UpdateWorldTransform();
+            }
+        }
+    }
+
+    // Notify the listener components in one pass, in hierarchy order
+    for (unsigned i = firstNode; i < numNodes; ++i)
+        nodes[i]->NotifyListeners();
+
+    batchingTransforms_ = wasBatching;
+}
+
+void Scene::BeginTransformBatch()
+{
+    batchingTransforms_ = batchedTransforms_;
+}
+
+void Scene::EndTransformBatch()
+{
+    batchingTransforms_ = false;
+    UpdateTransforms();
+}
+
+void Scene::AddUpdateComponent(LogicComponent* component, SceneUpdatePhase phase)
+{
+    if (!component || component->updateListIndex_[phase] != M_MAX_UNSIGNED)
+        return;
+
+    Vector<LogicComponentUpdateList>& lists = updateLists_[phase];
+    StringHash type = component->GetType();
+    unsigned listIndex = 0;
+    while (listIndex < lists.Size() && lists[listIndex].type_ != type)
+        ++listIndex;
+
+    if (listIndex == lists.Size())
+    {
+        lists.Resize(listIndex + 1);
+        lists[listIndex].type_ = type;
+        lists[listIndex].threadSafe_ = component->IsThreadSafeUpdate();
+    }
+
+    component->updateListIndex_[phase] = listIndex;
+    component->updateListPosition_[phase] = lists[listIndex].components_.Size();
+    lists[listIndex].components_.Push(component);
+}
+
+void Scene::RemoveUpdateComponent(LogicComponent* component, SceneUpdatePhase phase)
+{
+    if (!component || component->updateListIndex_[phase] == M_MAX_UNSIGNED)
+        return;
+
+    // Leave a hole to not disturb an update in progress; the list is compacted before its next update
+    LogicComponentUpdateList& list = updateLists_[phase][component->updateListIndex_[phase]];
+    list.components_[component->updateListPosition_[phase]] = nullptr;
+    ++list.numRemoved_;
+
+    component->updateListIndex_[phase] = M_MAX_UNSIGNED;
+    component->updateListPosition_[phase] = M_MAX_UNSIGNED;
+}
+
+void Scene::AddSmoothedTransform(SmoothedTransform* transform)
+{
+    if (!transform || transform->smoothingListPosition_ != M_MAX_UNSIGNED)
+        return;
+
+    transform->smoothingListPosition_ = smoothedTransforms_.Size();
+    smoothedTransforms_.Push(transform);
+}
+
+void Scene::RemoveSmoothedTransform(SmoothedTransform* transform)
+{
+    if (!transform || transform->smoothingListPosition_ == M_MAX_UNSIGNED)
+        return;
+
+    smoothedTransforms_[transform->smoothingListPosition_] = nullptr;
+    ++numRemovedSmoothedTransforms_;
+    transform->smoothingListPosition_ = M_MAX_UNSIGNED;
+}
+
 unsigned Scene::GetFreeNodeID(CreateMode mode)
 {
     if (mode == REPLICATED)
@@ -1204,9 +1573,12 @@ void Scene::UpdateAsyncLoading()
         }
 
 
-        // Read one child node with its full sub-hierarchy either from binary, JSON, or XML
-        /// \todo Works poorly in scenes where one root-level child node contains all content
-        if (asyncProgress_.xmlFile_)
+        // Read one node with its components from chunked binary, or one child node with its full sub-hierarchy either
+        // from binary, JSON, or XML
+        /// \todo Works poorly in scenes where one root-level child node contains all content, unless using chunked binary
+        if (asyncProgress_.chunkedScene_)
+            asyncProgress_.chunkedScene_->InstantiateNext();
+        else if (asyncProgress_.xmlFile_)
         {
             unsigned nodeID = asyncProgress_.xmlElement_.GetUInt("id");
             Node* newNode = CreateChild(nodeID, IsReplicatedID(nodeID) ? REPLICATED : LOCAL);
@@ -1251,12 +1623,121 @@ void Scene::UpdateAsyncLoading()
     SendEvent(E_ASYNCLOADPROGRESS, eventData);
 }
 
+void Scene::UpdateLogicComponents(SceneUpdatePhase phase, float timeStep)
+{
+    if (updateLists_[phase].Empty())
+        return;
+
+    URHO3D_PROFILE(UpdateLogicComponents);
+
+    auto* queue = GetSubsystem<WorkQueue>();
+
+    // Access the lists by index, as components may add new types or components while updating
+    for (unsigned i = 0; i < updateLists_[phase].Size(); ++i)
+    {
+        // Compact out removed components
+        {
+            LogicComponentUpdateList& list = updateLists_[phase][i];
+            if (list.numRemoved_)
+            {
+                unsigned dest = 0;
+                for (unsigned j = 0; j < list.components_.Size(); ++j)
+                {
+                    LogicComponent* component = list.components_[j];
+                    if (component)
+                    {
+                        component->updateListPosition_[phase] = dest;
+                        list.components_[dest++] = component;
+                    }
+                }
+                list.components_.Resize(dest);
+                list.numRemoved_ = 0;
+            }
+        }
+
+        // Components added during the update are updated from the next frame on
+        unsigned numComponents = updateLists_[phase][i].components_.Size();
+        if (!numComponents)
+            continue;
+
+        if (updateLists_[phase][i].threadSafe_ && queue->GetNumThreads() && numComponents > 1)
+        {
+            PODVector<LogicComponent*>& components = updateLists_[phase][i].components_;
+
+            // Delayed starts may do anything, so call them in the main thread first
+            if (phase == SUP_UPDATE)
+            {
+                for (unsigned j = 0; j < numComponents; ++j)
+                {
+                    LogicComponent* component = components[j];
+                    if (component && !component->IsDelayedStartCalled())
+                        component->CallDelayedStart();
+                }
+            }
+
+            BeginThreadedUpdate();
+            queue->ParallelFor(numComponents, 16, [&](unsigned begin, unsigned end, unsigned /*threadIndex*/)
+            {
+                for (unsigned j = begin; j < end; ++j)
+                {
+                    LogicComponent* component = components[j];
+                    if (component)
+                        component->CallUpdate(phase, timeStep);
+                }
+            });
+            EndThreadedUpdate();
+        }
+        else
+        {
+            for (unsigned j = 0; j < numComponents; ++j)
+            {
+                LogicComponent* component = updateLists_[phase][i].components_[j];
+                if (component)
+                    component->CallUpdate(phase, timeStep);
+            }
+        }
+    }
+}
+
+void Scene::UpdateSmoothedTransforms(float constant, float squaredSnapThreshold)
+{
+    if (numRemovedSmoothedTransforms_)
+    {
+        unsigned dest = 0;
+        for (unsigned i = 0; i < smoothedTransforms_.Size(); ++i)
+        {
+            SmoothedTransform* transform = smoothedTransforms_[i];
+            if (transform)
+            {
+                transform->smoothingListPosition_ = dest;
+                smoothedTransforms_[dest++] = transform;
+            }
+        }
+        smoothedTransforms_.Resize(dest);
+        numRemovedSmoothedTransforms_ = 0;
+    }
+
+    // Finished transforms remove themselves, leaving holes
+    unsigned numTransforms = smoothedTransforms_.Size();
+    for (unsigned i = 0; i < numTransforms; ++i)
+    {
+        SmoothedTransform* transform = smoothedTransforms_[i];
+        if (transform)
+            transform->Update(constant, squaredSnapThreshold);
+    }
+}
+
 void Scene::FinishAsyncLoading()
 {
     if (asyncProgress_.mode_ > LOAD_RESOURCES_ONLY)
     {
-        resolver_.Resolve();
-        ApplyAttributes();
+        if (asyncProgress_.chunkedScene_)
+            asyncProgress_.chunkedScene_->FinishInstantiate();
+        else
+        {
+            resolver_.Resolve();
+            ApplyAttributes();
+        }
         FinishLoading(asyncProgress_.file_);
     }
 
@@ -1364,6 +1845,27 @@ void Scene::PreloadResources(File* file, bool isSceneFile)
 #endif
 }
 
+void Scene::PreloadResourcesChunked(ChunkedScene* chunkedScene)
+{
+    // If not threaded, can not background load resources, so rather load synchronously later when needed
+#ifdef URHO3D_THREADING
+    auto* cache = GetSubsystem<ResourceCache>();
+
+    const Vector<ResourceRef>& resources = chunkedScene->GetResources();
+    for (unsigned i = 0; i < resources.Size(); ++i)
+    {
+        // Sanitate resource name beforehand so that when we get the background load event, the name matches exactly
+        String name = cache->SanitateResourceName(resources[i].name_);
+        bool success = cache->BackgroundLoadResource(resources[i].type_, name);
+        if (success)
+        {
+            ++asyncProgress_.totalResources_;
+            asyncProgress_.resources_.Insert(StringHash(name));
+        }
+    }
+#endif
+}
+
 void Scene::PreloadResourcesXML(const XMLElement& element)
 {
     // If not threaded, can not background load resources, so rather load synchronously later when needed
@@ -1536,6 +2038,8 @@ void RegisterSceneLibrary(Context* context)
     SmoothedTransform::RegisterObject(context);
     UnknownComponent::RegisterObject(context);
     SplinePath::RegisterObject(context);
+    ChunkedScene::RegisterObject(context);
+    WorldStreamer::RegisterObject(context);
 }
 
 }
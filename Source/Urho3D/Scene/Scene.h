@@ -32,8 +32,11 @@
 namespace Urho3D
 {
 
+class ChunkedScene;
 class File;
+class LogicComponent;
 class PackageFile;
+class SmoothedTransform;
 
 static const unsigned FIRST_REPLICATED_ID = 0x1;
 static const unsigned LAST_REPLICATED_ID = 0xffffff;
@@ -51,6 +54,29 @@ enum LoadMode
     LOAD_SCENE_AND_RESOURCES
 };
 
+/// Scene update phases in which logic components are updated directly by the scene.
+enum SceneUpdatePhase
+{
+    /// Variable timestep update, before the scene update event.
+    SUP_UPDATE = 0,
+    /// Variable timestep post-update, before the scene post-update event.
+    SUP_POSTUPDATE,
+    MAX_SCENE_UPDATE_PHASES
+};
+
+/// Logic components of one type, stored contiguously and updated directly by the scene.
+struct LogicComponentUpdateList
+{
+    /// Component type.
+    StringHash type_;
+    /// Whether the type allows updating in worker threads.
+    bool threadSafe_{};
+    /// Components. Removed components leave null entries until the list is compacted before the next update.
+    PODVector<LogicComponent*> components_;
+    /// Number of null entries.
+    unsigned numRemoved_{};
+};
+
 /// Asynchronous loading progress of a scene.
 struct AsyncProgress
 {
@@ -60,6 +86,8 @@ struct AsyncProgress
     SharedPtr<XMLFile> xmlFile_;
     /// JSON file for JSON mode
     SharedPtr<JSONFile> jsonFile_;
+    /// Chunked scene for chunked binary mode.
+    SharedPtr<ChunkedScene> chunkedScene_;
 
     /// Current XML element for XML mode.
     XMLElement xmlElement_;
@@ -77,7 +105,7 @@ struct AsyncProgress
     unsigned totalResources_;
     /// Loaded root-level nodes.
     unsigned loadedNodes_;
-    /// Total root-level nodes.
+    /// Total root-level nodes, or total nodes in chunked binary mode.
     unsigned totalNodes_;
 };
 
@@ -119,6 +147,8 @@ public:
     bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
     /// Save to a JSON file. Return true if successful.
     bool SaveJSON(Serializer& dest, const String& indentation = "\t") const;
+    /// Save to the chunked binary format. The chunked format is detected automatically by Load() and LoadAsync(), and loads asynchronously one node at a time. Return true if successful.
+    bool SaveChunked(Serializer& dest) const;
     /// Load from a binary file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
     bool LoadAsync(File* file, LoadMode mode = LOAD_SCENE_AND_RESOURCES);
     /// Load from an XML file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
@@ -139,6 +169,10 @@ public:
         (const JSONValue& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
     /// Instantiate scene content from JSON data. Return root node if successful.
     Node* InstantiateJSON(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+    /// Instantiate scene content from chunked binary data. Return root node if successful.
+    Node* InstantiateChunked(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+    /// Instantiate scene content from an already loaded chunked scene, which can be reused for multiple instances. Return root node if successful.
+    Node* InstantiateChunked(ChunkedScene* chunkedScene, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
 
     /// Clear scene completely of either replicated, local or all nodes and components.
     void Clear(bool clearReplicated = true, bool clearLocal = true);
@@ -154,6 +188,8 @@ public:
     void SetSnapThreshold(float threshold);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
+    /// Set whether to batch node transform updates during the scene update phases. When enabled, moved nodes are only marked dirty; their world transforms are recalculated in hierarchy depth order and their listener components notified at the end of each phase.
+    void SetBatchedTransforms(bool enable);
     /// Add a required package file for networking. To be called on the server.
     void AddRequiredPackageFile(PackageFile* package);
     /// Clear required package files.
@@ -205,6 +241,9 @@ public:
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
 
+    /// Return whether node transform updates are batched during the scene update phases.
+    bool GetBatchedTransforms() const { return batchedTransforms_; }
+
     /// Return required package files.
     const Vector<SharedPtr<PackageFile> >& GetRequiredPackageFiles() const { return requiredPackageFiles_; }
 
@@ -219,9 +258,26 @@ public:
     void EndThreadedUpdate();
     /// Add a component to the delayed dirty notify queue. Is thread-safe.
     void DelayedMarkedDirty(Component* component);
+    /// Add a logic component to the direct update list of its type for an update phase. Called by LogicComponent.
+    void AddUpdateComponent(LogicComponent* component, SceneUpdatePhase phase);
+    /// Remove a logic component from the direct update list of an update phase. Called by LogicComponent.
+    void RemoveUpdateComponent(LogicComponent* component, SceneUpdatePhase phase);
+    /// Add a smoothed transform to be updated directly while smoothing is in progress. Called by SmoothedTransform.
+    void AddSmoothedTransform(SmoothedTransform* transform);
+    /// Remove a smoothed transform from smoothing updates. Called by SmoothedTransform.
+    void RemoveSmoothedTransform(SmoothedTransform* transform);
+
+    /// Queue a dirty node for the batched transform update. Is thread-safe. Called by Node.
+    void QueueTransformUpdate(Node* node);
+    /// Recalculate the world transforms of the nodes queued for the batched transform update and notify their listener components.
+    void UpdateTransforms();
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
+    /// Return the mutex that guards shared scene data during a threaded update.
+    Mutex& GetSceneMutex() { return sceneMutex_; }
+    /// Return whether a batched transform update is in progress.
+    bool IsBatchingTransforms() const { return batchingTransforms_; }
 
     /// Get free node ID, either non-local or local.
     unsigned GetFreeNodeID(CreateMode mode);
@@ -277,6 +333,18 @@ private:
     void PreloadResourcesXML(const XMLElement& element);
     /// Preload resources from a JSON scene or object prefab file.
     void PreloadResourcesJSON(const JSONValue& value);
+    /// Preload resources listed in a chunked binary scene or object prefab file.
+    void PreloadResourcesChunked(ChunkedScene* chunkedScene);
+    /// Load from a chunked binary file asynchronously. Called by LoadAsync() after detecting the format.
+    bool LoadAsyncChunked(File* file, LoadMode mode);
+    /// Update the logic components listed for an update phase, type by type. Thread-safe types are updated in worker threads.
+    void UpdateLogicComponents(SceneUpdatePhase phase, float timeStep);
+    /// Update transform smoothing of the listed smoothed transforms.
+    void UpdateSmoothedTransforms(float constant, float squaredSnapThreshold);
+    /// Begin a batched transform update if enabled.
+    void BeginTransformBatch();
+    /// End the batched transform update and process the queued nodes.
+    void EndTransformBatch();
 
     /// Replicated scene nodes by ID.
     HashMap<unsigned, Node*> replicatedNodes_;
@@ -308,6 +376,20 @@ private:
     Mutex sceneMutex_;
     /// Preallocated event data map for smoothing update events.
     VariantMap smoothingData_;
+    /// Direct update lists of logic components per update phase, one list per component type.
+    Vector<LogicComponentUpdateList> updateLists_[MAX_SCENE_UPDATE_PHASES];
+    /// Smoothed transforms with smoothing in progress. Removed components leave null entries until compacted.
+    PODVector<SmoothedTransform*> smoothedTransforms_;
+    /// Number of null entries in the smoothed transforms.
+    unsigned numRemovedSmoothedTransforms_;
+    /// Nodes queued for the batched transform update.
+    Vector<WeakPtr<Node> > transformUpdateNodes_;
+    /// Queued nodes sorted by hierarchy depth.
+    PODVector<Node*> sortedTransformNodes_;
+    /// Hierarchy depths of the queued nodes, zero if the node should be skipped.
+    PODVector<unsigned> transformNodeDepths_;
+    /// Start offsets of each hierarchy depth in the sorted nodes.
+    PODVector<unsigned> transformDepthOffsets_;
     /// Next free non-local node ID.
     unsigned replicatedNodeID_;
     /// Next free non-local component ID.
@@ -334,6 +416,10 @@ private:
     bool asyncLoading_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Batched transform updates enabled flag.
+    bool batchedTransforms_;
+    /// Batched transform update in progress flag.
+    bool batchingTransforms_;
 };
 
 /// Register Scene library objects.
@@ -110,6 +110,22 @@ URHO3D_EVENT(E_ASYNCLOADFINISHED, AsyncLoadFinished)
     URHO3D_PARAM(P_SCENE, Scene);                  // Scene pointer
 };
 
+/// A world streaming cell has been loaded and its content instantiated.
+URHO3D_EVENT(E_STREAMINGCELLLOADED, StreamingCellLoaded)
+{
+    URHO3D_PARAM(P_STREAMER, Streamer);            // WorldStreamer pointer
+    URHO3D_PARAM(P_CELL, Cell);                    // IntVector2
+    URHO3D_PARAM(P_NODE, Node);                    // Node pointer
+};
+
+/// A world streaming cell is about to be unloaded.
+URHO3D_EVENT(E_STREAMINGCELLUNLOADED, StreamingCellUnloaded)
+{
+    URHO3D_PARAM(P_STREAMER, Streamer);            // WorldStreamer pointer
+    URHO3D_PARAM(P_CELL, Cell);                    // IntVector2
+    URHO3D_PARAM(P_NODE, Node);                    // Node pointer
+};
+
 /// A child node has been added to a parent node.
 URHO3D_EVENT(E_NODEADDED, NodeAdded)
 {
@@ -23,6 +23,7 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../IO/BitStream.h"
 #include "../IO/Deserializer.h"
 #include "../IO/Log.h"
 #include "../IO/Serializer.h"
@@ -53,6 +54,244 @@ static unsigned RemapAttributeIndex(const Vector<AttributeInfo>* attributes, con
     return netAttrIndex; // Could not remap
 }
 
+/// Bits used for the index of the largest component of a quaternion in smallest three encoding.
+static const unsigned ROTATION_INDEX_BITS = 2;
+/// Range of the smallest three components of a unit quaternion.
+static const float SMALLEST_THREE_RANGE = 0.70710678f;
+
+unsigned GetNumQuantizedValues(const AttributeInfo& attr)
+{
+    if (!attr.quantization_.IsEnabled())
+        return 0;
+
+    switch (attr.type_)
+    {
+    case VAR_INT:
+    case VAR_FLOAT:
+        return 1;
+
+    case VAR_VECTOR2:
+        return 2;
+
+    case VAR_VECTOR3:
+        return 3;
+
+    case VAR_VECTOR4:
+    case VAR_QUATERNION:
+    case VAR_COLOR:
+        return 4;
+
+    default:
+        return 0;
+    }
+}
+
+unsigned GetQuantizedBits(const AttributeInfo& attr, unsigned index)
+{
+    if (attr.type_ == VAR_QUATERNION && attr.quantization_.rotationEncoding_ == RE_SMALLESTTHREE && index == 0)
+        return ROTATION_INDEX_BITS;
+    else
+        return attr.quantization_.bits_;
+}
+
+static unsigned QuantizeFloat(float value, float min, float max, unsigned bits)
+{
+    double maxValue = bits < 32 ? (double)((1u << bits) - 1) : 4294967295.0;
+    double t = max > min ? ((double)value - min) / ((double)max - min) : 0.0;
+    return (unsigned)(Clamp(t, 0.0, 1.0) * maxValue + 0.5);
+}
+
+static float DequantizeFloat(unsigned value, float min, float max, unsigned bits)
+{
+    double maxValue = bits < 32 ? (double)((1u << bits) - 1) : 4294967295.0;
+    return (float)(min + ((double)max - min) * (value / maxValue));
+}
+
+void QuantizeAttributeValue(const AttributeInfo& attr, const Variant& value, unsigned* dest)
+{
+    const AttributeQuantization& quantization = attr.quantization_;
+    unsigned bits = quantization.bits_;
+
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        {
+            auto min = (int)quantization.min_;
+            dest[0] = (unsigned)(Clamp(value.GetInt(), min, (int)quantization.max_) - min);
+            // Never exceed the bits, even if the range was set without validation
+            if (bits < 32)
+                dest[0] = Min(dest[0], (1u << bits) - 1);
+        }
+        break;
+
+    case VAR_FLOAT:
+        dest[0] = QuantizeFloat(value.GetFloat(), quantization.min_, quantization.max_, bits);
+        break;
+
+    case VAR_VECTOR2:
+    case VAR_VECTOR3:
+    case VAR_VECTOR4:
+    case VAR_COLOR:
+        {
+            const float* data = attr.type_ == VAR_VECTOR2 ? value.GetVector2().Data() : attr.type_ == VAR_VECTOR3 ?
+                value.GetVector3().Data() : attr.type_ == VAR_VECTOR4 ? value.GetVector4().Data() : value.GetColor().Data();
+            unsigned numValues = GetNumQuantizedValues(attr);
+            for (unsigned i = 0; i < numValues; ++i)
+                dest[i] = QuantizeFloat(data[i], quantization.min_, quantization.max_, bits);
+        }
+        break;
+
+    case VAR_QUATERNION:
+        {
+            const float* data = value.GetQuaternion().Data();
+            if (quantization.rotationEncoding_ == RE_SMALLESTTHREE)
+            {
+                // Send the index of the largest component and make it positive, as q and -q are the same rotation
+                unsigned largest = 0;
+                for (unsigned i = 1; i < 4; ++i)
+                {
+                    if (Abs(data[i]) > Abs(data[largest]))
+                        largest = i;
+                }
+                float sign = data[largest] < 0.0f ? -1.0f : 1.0f;
+
+                dest[0] = largest;
+                unsigned index = 1;
+                for (unsigned i = 0; i < 4; ++i)
+                {
+                    if (i != largest)
+                        dest[index++] = QuantizeFloat(sign * data[i], -SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE, bits);
+                }
+            }
+            else
+            {
+                for (unsigned i = 0; i < 4; ++i)
+                    dest[i] = QuantizeFloat(data[i], -1.0f, 1.0f, bits);
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+Variant DequantizeAttributeValue(const AttributeInfo& attr, const unsigned* src)
+{
+    const AttributeQuantization& quantization = attr.quantization_;
+    unsigned bits = quantization.bits_;
+    float data[4] = {};
+
+    switch (attr.type_)
+    {
+    case VAR_INT:
+        return (int)(src[0] + (unsigned)(int)quantization.min_);
+
+    case VAR_FLOAT:
+        return DequantizeFloat(src[0], quantization.min_, quantization.max_, bits);
+
+    case VAR_VECTOR2:
+    case VAR_VECTOR3:
+    case VAR_VECTOR4:
+    case VAR_COLOR:
+        for (unsigned i = 0; i < GetNumQuantizedValues(attr); ++i)
+            data[i] = DequantizeFloat(src[i], quantization.min_, quantization.max_, bits);
+        if (attr.type_ == VAR_VECTOR2)
+            return Vector2(data);
+        else if (attr.type_ == VAR_VECTOR3)
+            return Vector3(data);
+        else if (attr.type_ == VAR_VECTOR4)
+            return Vector4(data);
+        else
+            return Color(data[0], data[1], data[2], data[3]);
+
+    case VAR_QUATERNION:
+        if (quantization.rotationEncoding_ == RE_SMALLESTTHREE)
+        {
+            unsigned largest = src[0];
+            unsigned index = 1;
+            float sumSquares = 0.0f;
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                if (i != largest)
+                {
+                    data[i] = DequantizeFloat(src[index++], -SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE, bits);
+                    sumSquares += data[i] * data[i];
+                }
+            }
+            data[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+        }
+        else
+        {
+            for (unsigned i = 0; i < 4; ++i)
+                data[i] = DequantizeFloat(src[i], -1.0f, 1.0f, bits);
+        }
+        return Quaternion(data).Normalized();
+
+    default:
+        return Variant::EMPTY;
+    }
+}
+
+/// Reset the delta encoding baseline to the quantized default values of the attributes.
+static void ResetQuantizedBaseline(const Vector<AttributeInfo>& attributes, PODVector<unsigned>& baseline)
+{
+    baseline.Clear();
+
+    unsigned values[4];
+    for (unsigned i = 0; i < attributes.Size(); ++i)
+    {
+        const AttributeInfo& attr = attributes[i];
+        unsigned numValues = GetNumQuantizedValues(attr);
+        if (numValues)
+        {
+            QuantizeAttributeValue(attr, attr.defaultValue_, values);
+            for (unsigned j = 0; j < numValues; ++j)
+                baseline.Push(values[j]);
+        }
+    }
+}
+
+/// Return number of quantized values of all attributes.
+static unsigned GetNumQuantizedValues(const Vector<AttributeInfo>& attributes)
+{
+    unsigned numValues = 0;
+    for (unsigned i = 0; i < attributes.Size(); ++i)
+        numValues += GetNumQuantizedValues(attributes[i]);
+    return numValues;
+}
+
+/// Write an attribute value, quantized and delta encoded against the baseline if the attribute has quantization. Update the baseline.
+static void WriteNetworkValue(BitSerializer& dest, const AttributeInfo& attr, const Variant& value, unsigned* baseline)
+{
+    unsigned numValues = GetNumQuantizedValues(attr);
+    if (!numValues)
+    {
+        dest.WriteVariantData(value);
+        return;
+    }
+
+    unsigned values[4];
+    QuantizeAttributeValue(attr, value, values);
+    for (unsigned i = 0; i < numValues; ++i)
+    {
+        dest.WriteDeltaBits(values[i], baseline[i], GetQuantizedBits(attr, i));
+        baseline[i] = values[i];
+    }
+}
+
+/// Read an attribute value written by WriteNetworkValue. Update the baseline.
+static Variant ReadNetworkValue(BitDeserializer& source, const AttributeInfo& attr, unsigned* baseline)
+{
+    unsigned numValues = GetNumQuantizedValues(attr);
+    if (!numValues)
+        return source.ReadVariant(attr.type_);
+
+    for (unsigned i = 0; i < numValues; ++i)
+        baseline[i] = source.ReadDeltaBits(baseline[i], GetQuantizedBits(attr, i));
+    return DequantizeAttributeValue(attr, baseline);
+}
+
 Serializable::Serializable(Context* context) :
     Object(context),
     setInstanceDefault_(false),
@@ -734,7 +973,7 @@ void Serializable::AllocateNetworkState()
     }
 }
 
-void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp)
+void Serializable::WriteInitialDeltaUpdate(Serializer& dest, PODVector<unsigned>& baseline, unsigned char timeStamp)
 {
     if (!networkState_)
     {
@@ -757,18 +996,13 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
             attributeBits.Set(i);
     }
 
-    // First write the change bitfield, then attribute data for non-default attributes
-    dest.WriteUByte(timeStamp);
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3u);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    // Quantized attributes are delta encoded starting from the defaults
+    ResetQuantizedBaseline(*attributes, baseline);
+    WriteNetworkValues(dest, attributeBits, baseline, timeStamp);
 }
 
-void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp)
+void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, PODVector<unsigned>& baseline,
+    unsigned char timeStamp)
 {
     if (!networkState_)
     {
@@ -780,21 +1014,13 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
     if (!attributes)
         return;
 
-    unsigned numAttributes = attributes->Size();
-
-    // First write the change bitfield, then attribute data for changed attributes
     // Note: the attribute bits should not contain LATESTDATA attributes
-    dest.WriteUByte(timeStamp);
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3u);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    if (baseline.Size() != GetNumQuantizedValues(*attributes))
+        ResetQuantizedBaseline(*attributes, baseline);
+    WriteNetworkValues(dest, attributeBits, baseline, timeStamp);
 }
 
-void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp)
+void Serializable::WriteLatestDataUpdate(Serializer& dest, PODVector<unsigned>& baseline, unsigned char timeStamp)
 {
     if (!networkState_)
     {
@@ -807,17 +1033,45 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
         return;
 
     unsigned numAttributes = attributes->Size();
+    if (baseline.Size() != GetNumQuantizedValues(*attributes))
+        ResetQuantizedBaseline(*attributes, baseline);
+
+    BitSerializer bits(dest);
+    bits.WriteUByte(timeStamp);
+
+    unsigned offset = 0;
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if (attr.mode_ & AM_LATESTDATA)
+            WriteNetworkValue(bits, attr, networkState_->currentValues_[i], baseline.Buffer() + offset);
+        offset += GetNumQuantizedValues(attr);
+    }
+}
+
+void Serializable::WriteNetworkValues(Serializer& dest, const DirtyBits& attributeBits, PODVector<unsigned>& baseline,
+    unsigned char timeStamp)
+{
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    unsigned numAttributes = attributes->Size();
 
-    dest.WriteUByte(timeStamp);
+    // First write the change bitfield, then attribute data for changed attributes
+    BitSerializer bits(dest);
+    bits.WriteUByte(timeStamp);
+    for (unsigned i = 0; i < numAttributes; ++i)
+        bits.WriteBit(attributeBits.IsSet(i));
 
+    unsigned offset = 0;
     for (unsigned i = 0; i < numAttributes; ++i)
     {
-        if (attributes->At(i).mode_ & AM_LATESTDATA)
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        const AttributeInfo& attr = attributes->At(i);
+        if (attributeBits.IsSet(i))
+            WriteNetworkValue(bits, attr, networkState_->currentValues_[i], baseline.Buffer() + offset);
+        offset += GetNumQuantizedValues(attr);
     }
 }
 
-bool Serializable::ReadDeltaUpdate(Deserializer& source)
+bool Serializable::ReadDeltaUpdate(Deserializer& source, bool initial)
 {
     const Vector<AttributeInfo>* attributes = GetNetworkAttributes();
     if (!attributes)
@@ -827,33 +1081,25 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
     DirtyBits attributeBits;
     bool changed = false;
 
-    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
-    unsigned char timeStamp = source.ReadUByte();
-    source.Read(attributeBits.data_, (numAttributes + 7) >> 3u);
+    PODVector<unsigned>& baseline = GetReceivedBaseline(*attributes, initial);
+    BitDeserializer bits(source);
+    unsigned char timeStamp = bits.ReadUByte();
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (bits.ReadBit())
+            attributeBits.Set(i);
+    }
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    unsigned offset = 0;
+    for (unsigned i = 0; i < numAttributes && !bits.IsEof(); ++i)
     {
+        const AttributeInfo& attr = attributes->At(i);
         if (attributeBits.IsSet(i))
         {
-            const AttributeInfo& attr = attributes->At(i);
-            if (!(interceptMask & (1ULL << i)))
-            {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+            if (ApplyNetworkValue(attr, i, ReadNetworkValue(bits, attr, baseline.Buffer() + offset), timeStamp))
                 changed = true;
-            }
-            else
-            {
-                using namespace InterceptNetworkUpdate;
-
-                VariantMap& eventData = GetEventDataMap();
-                eventData[P_SERIALIZABLE] = this;
-                eventData[P_TIMESTAMP] = (unsigned)timeStamp;
-                eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
-                eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
-                SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
-            }
         }
+        offset += GetNumQuantizedValues(attr);
     }
 
     return changed;
@@ -868,32 +1114,20 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
     unsigned numAttributes = attributes->Size();
     bool changed = false;
 
-    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
-    unsigned char timeStamp = source.ReadUByte();
+    PODVector<unsigned>& baseline = GetReceivedBaseline(*attributes, false);
+    BitDeserializer bits(source);
+    unsigned char timeStamp = bits.ReadUByte();
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    unsigned offset = 0;
+    for (unsigned i = 0; i < numAttributes && !bits.IsEof(); ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
         if (attr.mode_ & AM_LATESTDATA)
         {
-            if (!(interceptMask & (1ULL << i)))
-            {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+            if (ApplyNetworkValue(attr, i, ReadNetworkValue(bits, attr, baseline.Buffer() + offset), timeStamp))
                 changed = true;
-            }
-            else
-            {
-                using namespace InterceptNetworkUpdate;
-
-                VariantMap& eventData = GetEventDataMap();
-                eventData[P_SERIALIZABLE] = this;
-                eventData[P_TIMESTAMP] = (unsigned)timeStamp;
-                eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
-                eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
-                SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
-            }
         }
+        offset += GetNumQuantizedValues(attr);
     }
 
     return changed;
@@ -1036,4 +1270,41 @@ Variant Serializable::GetInstanceDefault(const String& name) const
     return Variant::EMPTY;
 }
 
+PODVector<unsigned>& Serializable::GetReceivedBaseline(const Vector<AttributeInfo>& attributes, bool reset)
+{
+    static PODVector<unsigned> emptyBaseline;
+
+    // Only objects with quantized attributes need the network state on the receiving side
+    unsigned numValues = GetNumQuantizedValues(attributes);
+    if (!numValues)
+        return emptyBaseline;
+
+    AllocateNetworkState();
+    PODVector<unsigned>& baseline = networkState_->quantizedValues_;
+    if (reset || baseline.Size() != numValues)
+        ResetQuantizedBaseline(attributes, baseline);
+    return baseline;
+}
+
+bool Serializable::ApplyNetworkValue(const AttributeInfo& attr, unsigned index, const Variant& value, unsigned char timeStamp)
+{
+    unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
+    if (!(interceptMask & (1ULL << index)))
+    {
+        OnSetAttribute(attr, value);
+        return true;
+    }
+
+    using namespace InterceptNetworkUpdate;
+
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_SERIALIZABLE] = this;
+    eventData[P_TIMESTAMP] = (unsigned)timeStamp;
+    eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, index);
+    eventData[P_NAME] = attr.name_;
+    eventData[P_VALUE] = value;
+    SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
+    return false;
+}
+
 }
@@ -97,14 +97,14 @@ public:
     void SetInterceptNetworkUpdate(const String& attributeName, bool enable);
     /// Allocate network attribute state.
     void AllocateNetworkState();
-    /// Write initial delta network update.
-    void WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp);
-    /// Write a delta network update according to dirty attribute bits.
-    void WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp);
-    /// Write a latest data network update.
-    void WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp);
-    /// Read and apply a network delta update. Return true if attributes were changed.
-    bool ReadDeltaUpdate(Deserializer& source);
+    /// Write initial delta network update. Reset the connection's baseline of quantized attribute values to the defaults.
+    void WriteInitialDeltaUpdate(Serializer& dest, PODVector<unsigned>& baseline, unsigned char timeStamp);
+    /// Write a delta network update according to dirty attribute bits. Quantized attributes are delta encoded against the connection's baseline, which is updated.
+    void WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, PODVector<unsigned>& baseline, unsigned char timeStamp);
+    /// Write a latest data network update. Quantized attributes are delta encoded against the connection's baseline, which is updated.
+    void WriteLatestDataUpdate(Serializer& dest, PODVector<unsigned>& baseline, unsigned char timeStamp);
+    /// Read and apply a network delta update. Reset the baseline of quantized attribute values first if it is the initial update. Return true if attributes were changed.
+    bool ReadDeltaUpdate(Deserializer& source, bool initial = false);
     /// Read and apply a network latest data update. Return true if attributes were changed.
     bool ReadLatestDataUpdate(Deserializer& source);
 
@@ -139,6 +139,12 @@ private:
     void SetInstanceDefault(const String& name, const Variant& defaultValue);
     /// Get instance-level default value.
     Variant GetInstanceDefault(const String& name) const;
+    /// Write the dirty attribute bits and the changed attribute values of a delta update.
+    void WriteNetworkValues(Serializer& dest, const DirtyBits& attributeBits, PODVector<unsigned>& baseline, unsigned char timeStamp);
+    /// Return the baseline of received quantized attribute values, resetting it to the defaults if necessary.
+    PODVector<unsigned>& GetReceivedBaseline(const Vector<AttributeInfo>& attributes, bool reset);
+    /// Apply a received network attribute value, or send it as an event if intercepted. Return true if applied.
+    bool ApplyNetworkValue(const AttributeInfo& attr, unsigned index, const Variant& value, unsigned char timeStamp);
 
     /// Attribute default value at each instance level.
     UniquePtr<VariantMap> instanceDefaultValues_;
@@ -148,6 +154,15 @@ private:
     bool temporary_;
 };
 
+/// Return number of values an attribute is quantized to in network replication, or zero if it is sent unquantized.
+URHO3D_API unsigned GetNumQuantizedValues(const AttributeInfo& attr);
+/// Return number of bits of a quantized value of an attribute.
+URHO3D_API unsigned GetQuantizedBits(const AttributeInfo& attr, unsigned index);
+/// Quantize an attribute value for network replication.
+URHO3D_API void QuantizeAttributeValue(const AttributeInfo& attr, const Variant& value, unsigned* dest);
+/// Reconstruct an attribute value from quantized values.
+URHO3D_API Variant DequantizeAttributeValue(const AttributeInfo& attr, const unsigned* src);
+
 /// Template implementation of the variant attribute accessor.
 template <class TClassType, class TGetFunction, class TSetFunction>
 class VariantAttributeAccessorImpl : public AttributeAccessor
@@ -37,11 +37,15 @@ SmoothedTransform::SmoothedTransform(Context* context) :
     targetPosition_(Vector3::ZERO),
     targetRotation_(Quaternion::IDENTITY),
     smoothingMask_(SMOOTH_NONE),
-    subscribed_(false)
+    smoothingScene_(nullptr),
+    smoothingListPosition_(M_MAX_UNSIGNED)
 {
 }
 
-SmoothedTransform::~SmoothedTransform() = default;
+SmoothedTransform::~SmoothedTransform()
+{
+    StopSmoothing();
+}
 
 void SmoothedTransform::RegisterObject(Context* context)
 {
@@ -88,12 +92,9 @@ void SmoothedTransform::Update(float constant, float squaredSnapThreshold)
         }
     }
 
-    // If smoothing has completed, unsubscribe from the update event
+    // If smoothing has completed, stop updates from the scene
     if (!smoothingMask_)
-    {
-        UnsubscribeFromEvent(GetScene(), E_UPDATESMOOTHING);
-        subscribed_ = false;
-    }
+        StopSmoothing();
 }
 
 void SmoothedTransform::SetTargetPosition(const Vector3& position)
@@ -101,12 +102,8 @@ void SmoothedTransform::SetTargetPosition(const Vector3& position)
     targetPosition_ = position;
     smoothingMask_ |= SMOOTH_POSITION;
 
-    // Subscribe to smoothing update if not yet subscribed
-    if (!subscribed_)
-    {
-        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, URHO3D_HANDLER(SmoothedTransform, HandleUpdateSmoothing));
-        subscribed_ = true;
-    }
+    // Start smoothing updates if not yet started
+    StartSmoothing();
 
     SendEvent(E_TARGETPOSITION);
 }
@@ -116,11 +113,7 @@ void SmoothedTransform::SetTargetRotation(const Quaternion& rotation)
     targetRotation_ = rotation;
     smoothingMask_ |= SMOOTH_ROTATION;
 
-    if (!subscribed_)
-    {
-        SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, URHO3D_HANDLER(SmoothedTransform, HandleUpdateSmoothing));
-        subscribed_ = true;
-    }
+    StartSmoothing();
 
     SendEvent(E_TARGETROTATION);
 }
@@ -167,13 +160,35 @@ void SmoothedTransform::OnNodeSet(Node* node)
     }
 }
 
-void SmoothedTransform::HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData)
+void SmoothedTransform::OnSceneSet(Scene* scene)
 {
-    using namespace UpdateSmoothing;
+    if (scene)
+    {
+        // Resume smoothing that was set up before the node was added to the scene
+        if (smoothingMask_)
+            StartSmoothing();
+    }
+    else
+        StopSmoothing();
+}
 
-    float constant = eventData[P_CONSTANT].GetFloat();
-    float squaredSnapThreshold = eventData[P_SQUAREDSNAPTHRESHOLD].GetFloat();
-    Update(constant, squaredSnapThreshold);
+void SmoothedTransform::StartSmoothing()
+{
+    if (smoothingScene_)
+        return;
+
+    smoothingScene_ = GetScene();
+    if (smoothingScene_)
+        smoothingScene_->AddSmoothedTransform(this);
+}
+
+void SmoothedTransform::StopSmoothing()
+{
+    if (smoothingScene_)
+    {
+        smoothingScene_->RemoveSmoothedTransform(this);
+        smoothingScene_ = nullptr;
+    }
 }
 
 }
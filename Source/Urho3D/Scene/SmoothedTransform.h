@@ -43,6 +43,8 @@ class URHO3D_API SmoothedTransform : public Component
 {
     URHO3D_OBJECT(SmoothedTransform, Component);
 
+    friend class Scene;
+
 public:
     /// Construct.
     explicit SmoothedTransform(Context* context);
@@ -79,10 +81,14 @@ public:
 protected:
     /// Handle scene node being assigned at creation.
     void OnNodeSet(Node* node) override;
+    /// Handle scene being assigned.
+    void OnSceneSet(Scene* scene) override;
 
 private:
-    /// Handle smoothing update event.
-    void HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData);
+    /// Start smoothing updates from the scene if not started yet.
+    void StartSmoothing();
+    /// Stop smoothing updates from the scene.
+    void StopSmoothing();
 
     /// Target position.
     Vector3 targetPosition_;
@@ -90,8 +96,10 @@ private:
     Quaternion targetRotation_;
     /// Active smoothing operations bitmask.
     SmoothingTypeFlags smoothingMask_;
-    /// Subscribed to smoothing update event flag.
-    bool subscribed_;
+    /// Scene that updates the smoothing.
+    Scene* smoothingScene_;
+    /// Position in the scene's smoothing update list, or M_MAX_UNSIGNED if not listed.
+    unsigned smoothingListPosition_;
 };
 
 }
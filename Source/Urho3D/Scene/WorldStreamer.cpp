@@ -0,0 +1,601 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/Timer.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
+#include "../Resource/ResourceEvents.h"
+#include "../Scene/ChunkedScene.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+#include "../Scene/WorldStreamer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* SUBSYSTEM_CATEGORY;
+
+static const float DEFAULT_CELL_SIZE = 64.0f;
+static const float DEFAULT_LOAD_DISTANCE = 128.0f;
+static const float DEFAULT_UNLOAD_DISTANCE = 192.0f;
+static const float DEFAULT_TIME_BUDGET = 2.0f;
+static const unsigned DEFAULT_MAX_CONCURRENT_LOADS = 4;
+static const char* DEFAULT_CELL_NAME_FORMAT = "Cells/{x}_{z}.uscc";
+
+/// Cell waiting to be requested, sorted by distance to the nearest focus.
+struct CellCandidate
+{
+    /// Construct.
+    CellCandidate(const IntVector2& coords, float distance) :
+        coords_(coords),
+        distance_(distance)
+    {
+    }
+
+    /// Test for less than with another candidate.
+    bool operator <(const CellCandidate& rhs) const { return distance_ < rhs.distance_; }
+
+    /// Cell coordinates.
+    IntVector2 coords_;
+    /// Distance to the nearest focus.
+    float distance_;
+};
+
+/// Release a resource no longer referenced by a cell. Resources of types with a memory budget stay cached while the budget is not exceeded, so that nearby cells can be reloaded quickly.
+static void ReleaseStreamedResource(ResourceCache* cache, StringHash type, const String& name)
+{
+    unsigned long long budget = cache->GetMemoryBudget(type);
+    if (budget && cache->GetMemoryUse(type) <= budget)
+        return;
+
+    cache->ReleaseResource(type, name);
+}
+
+WorldStreamer::WorldStreamer(Context* context) :
+    Component(context),
+    cellNameFormat_(DEFAULT_CELL_NAME_FORMAT),
+    cellSize_(DEFAULT_CELL_SIZE),
+    loadDistance_(DEFAULT_LOAD_DISTANCE),
+    unloadDistance_(DEFAULT_UNLOAD_DISTANCE),
+    timeBudget_(DEFAULT_TIME_BUDGET),
+    maxConcurrentLoads_(DEFAULT_MAX_CONCURRENT_LOADS)
+{
+}
+
+WorldStreamer::~WorldStreamer() = default;
+
+void WorldStreamer::RegisterObject(Context* context)
+{
+    context->RegisterFactory<WorldStreamer>(SUBSYSTEM_CATEGORY);
+
+    URHO3D_ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Load Distance", GetLoadDistance, SetLoadDistance, float, DEFAULT_LOAD_DISTANCE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Unload Distance", GetUnloadDistance, SetUnloadDistance, float, DEFAULT_UNLOAD_DISTANCE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Cell Name Format", GetCellNameFormat, SetCellNameFormat, String, String(DEFAULT_CELL_NAME_FORMAT),
+        AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Time Budget", GetTimeBudget, SetTimeBudget, float, DEFAULT_TIME_BUDGET, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Max Concurrent Loads", GetMaxConcurrentLoads, SetMaxConcurrentLoads, unsigned,
+        DEFAULT_MAX_CONCURRENT_LOADS, AM_DEFAULT);
+}
+
+void WorldStreamer::OnSetEnabled()
+{
+    UpdateEventSubscription();
+}
+
+void WorldStreamer::SetCellSize(float size)
+{
+    size = Max(size, M_EPSILON);
+    if (size == cellSize_)
+        return;
+
+    // Existing cells do not match the new grid
+    UnloadAllCells();
+    cellSize_ = size;
+    MarkNetworkUpdate();
+}
+
+void WorldStreamer::SetLoadDistance(float distance)
+{
+    loadDistance_ = Max(distance, 0.0f);
+    unloadDistance_ = Max(unloadDistance_, loadDistance_);
+    MarkNetworkUpdate();
+}
+
+void WorldStreamer::SetUnloadDistance(float distance)
+{
+    unloadDistance_ = Max(distance, loadDistance_);
+    MarkNetworkUpdate();
+}
+
+void WorldStreamer::SetCellNameFormat(const String& format)
+{
+    if (format == cellNameFormat_)
+        return;
+
+    UnloadAllCells();
+    cellNameFormat_ = format;
+    MarkNetworkUpdate();
+}
+
+void WorldStreamer::SetTimeBudget(float milliseconds)
+{
+    timeBudget_ = Max(milliseconds, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void WorldStreamer::SetMaxConcurrentLoads(unsigned count)
+{
+    maxConcurrentLoads_ = Max(count, 1U);
+    MarkNetworkUpdate();
+}
+
+void WorldStreamer::AddFocus(Node* node)
+{
+    if (!node)
+        return;
+
+    WeakPtr<Node> focus(node);
+    if (!foci_.Contains(focus))
+        foci_.Push(focus);
+}
+
+void WorldStreamer::RemoveFocus(Node* node)
+{
+    foci_.Remove(WeakPtr<Node>(node));
+}
+
+void WorldStreamer::RemoveAllFoci()
+{
+    foci_.Clear();
+}
+
+void WorldStreamer::Update()
+{
+    Scene* scene = GetScene();
+    if (!scene)
+        return;
+
+    URHO3D_PROFILE(UpdateWorldStreamer);
+
+    for (unsigned i = foci_.Size() - 1; i < foci_.Size(); --i)
+    {
+        if (foci_[i].Expired())
+            foci_.Erase(i);
+    }
+
+    // Unload cells that are out of range of all foci
+    PODVector<IntVector2> outOfRange;
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        if (GetCellDistance(i->first_) > unloadDistance_)
+            outOfRange.Push(i->first_);
+    }
+    for (unsigned i = 0; i < outOfRange.Size(); ++i)
+    {
+        HashMap<IntVector2, StreamingCell>::Iterator j = cells_.Find(outOfRange[i]);
+        if (j != cells_.End())
+        {
+            UnloadCell(j->second_);
+            cells_.Erase(j);
+        }
+    }
+
+    // Begin instantiating cells whose resources have finished loading. If the content is still being instantiated elsewhere,
+    // for example by another cell using the same file, wait for it to finish
+    unsigned numLoading = 0;
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        StreamingCell& cell = i->second_;
+        if (cell.state_ == CELL_LOADING_RESOURCES && cell.pendingResources_.Empty() && !cell.content_->IsInstantiating())
+            BeginInstantiate(cell);
+        if (cell.state_ == CELL_LOADING_FILE || cell.state_ == CELL_LOADING_RESOURCES)
+            ++numLoading;
+    }
+
+    // Request the nearest missing cells in range
+    if (numLoading < maxConcurrentLoads_)
+    {
+        PODVector<CellCandidate> candidates;
+        for (unsigned i = 0; i < foci_.Size(); ++i)
+        {
+            Vector3 position = foci_[i]->GetWorldPosition();
+            IntVector2 minCoords = GetCellCoords(position - Vector3(loadDistance_, 0.0f, loadDistance_));
+            IntVector2 maxCoords = GetCellCoords(position + Vector3(loadDistance_, 0.0f, loadDistance_));
+            for (int z = minCoords.y_; z <= maxCoords.y_; ++z)
+            {
+                for (int x = minCoords.x_; x <= maxCoords.x_; ++x)
+                {
+                    IntVector2 coords(x, z);
+                    if (cells_.Contains(coords))
+                        continue;
+                    float distance = GetCellDistance(coords);
+                    if (distance > loadDistance_)
+                        continue;
+
+                    bool duplicate = false;
+                    for (unsigned j = 0; j < candidates.Size(); ++j)
+                    {
+                        if (candidates[j].coords_ == coords)
+                        {
+                            duplicate = true;
+                            break;
+                        }
+                    }
+                    if (!duplicate)
+                        candidates.Push(CellCandidate(coords, distance));
+                }
+            }
+        }
+
+        Sort(candidates.Begin(), candidates.End());
+        for (unsigned i = 0; i < candidates.Size() && numLoading < maxConcurrentLoads_; ++i)
+        {
+            RequestCell(candidates[i].coords_);
+            StreamingCellState state = cells_[candidates[i].coords_].state_;
+            if (state == CELL_LOADING_FILE || state == CELL_LOADING_RESOURCES)
+                ++numLoading;
+        }
+    }
+
+    // Instantiate cell content within the time budget. Always create at least one node per frame to guarantee progress
+    HiresTimer timer;
+    auto budget = (long long)(timeBudget_ * 1000.0f);
+    PODVector<IntVector2> finished;
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        StreamingCell& cell = i->second_;
+        if (cell.state_ != CELL_INSTANTIATING)
+            continue;
+
+        bool done;
+        do
+            done = !cell.content_->InstantiateNext();
+        while (!done && timer.GetUSec(false) < budget);
+
+        if (done)
+        {
+            cell.content_->FinishInstantiate();
+            cell.state_ = CELL_LOADED;
+            finished.Push(i->first_);
+        }
+        if (!done || timer.GetUSec(false) >= budget)
+            break;
+    }
+
+    for (unsigned i = 0; i < finished.Size(); ++i)
+    {
+        HashMap<IntVector2, StreamingCell>::Iterator j = cells_.Find(finished[i]);
+        if (j != cells_.End() && j->second_.state_ == CELL_LOADED)
+            SendCellEvent(E_STREAMINGCELLLOADED, j->second_);
+    }
+}
+
+void WorldStreamer::UnloadAllCells()
+{
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+        UnloadCell(i->second_);
+    cells_.Clear();
+}
+
+bool WorldStreamer::SaveCells(Node* source, const String& directory) const
+{
+    if (!source)
+    {
+        URHO3D_LOGERROR("Null source node for saving world streaming cells");
+        return false;
+    }
+    // The children are saved relative to the source, but cell content is instantiated at the scene origin
+    if (!source->GetWorldTransform().Equals(Matrix3x4::IDENTITY))
+    {
+        URHO3D_LOGERROR("Source node " + source->GetName() + " for saving world streaming cells must have identity world transform");
+        return false;
+    }
+
+    HashMap<IntVector2, PODVector<Node*> > cellNodes;
+    const Vector<SharedPtr<Node> >& children = source->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        Node* child = children[i];
+        if (!child->IsTemporary())
+            cellNodes[GetCellCoords(child->GetWorldPosition())].Push(child);
+    }
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    String path = AddTrailingSlash(directory);
+
+    for (HashMap<IntVector2, PODVector<Node*> >::ConstIterator i = cellNodes.Begin(); i != cellNodes.End(); ++i)
+    {
+        String fileName = path + GetCellName(i->first_);
+        if (!fileSystem->CreateDir(GetPath(fileName)))
+            return false;
+
+        File file(context_, fileName, FILE_WRITE);
+        if (!file.IsOpen() || !ChunkedScene::SaveNode(file, source, i->second_))
+            return false;
+    }
+
+    return true;
+}
+
+IntVector2 WorldStreamer::GetCellCoords(const Vector3& position) const
+{
+    return IntVector2(FloorToInt(position.x_ / cellSize_), FloorToInt(position.z_ / cellSize_));
+}
+
+String WorldStreamer::GetCellName(const IntVector2& coords) const
+{
+    String name = cellNameFormat_;
+    name.Replace("{x}", String(coords.x_));
+    name.Replace("{z}", String(coords.y_));
+    return name;
+}
+
+unsigned WorldStreamer::GetNumLoadedCells() const
+{
+    unsigned count = 0;
+    for (HashMap<IntVector2, StreamingCell>::ConstIterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        if (i->second_.state_ == CELL_LOADED || i->second_.state_ == CELL_EMPTY)
+            ++count;
+    }
+    return count;
+}
+
+bool WorldStreamer::IsCellLoaded(const IntVector2& coords) const
+{
+    HashMap<IntVector2, StreamingCell>::ConstIterator i = cells_.Find(coords);
+    return i != cells_.End() && (i->second_.state_ == CELL_LOADED || i->second_.state_ == CELL_EMPTY);
+}
+
+Node* WorldStreamer::GetCellNode(const IntVector2& coords) const
+{
+    HashMap<IntVector2, StreamingCell>::ConstIterator i = cells_.Find(coords);
+    return i != cells_.End() && i->second_.state_ == CELL_LOADED ? i->second_.node_.Get() : nullptr;
+}
+
+void WorldStreamer::OnSceneSet(Scene* scene)
+{
+    if (scene)
+    {
+        SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, URHO3D_HANDLER(WorldStreamer, HandleResourceBackgroundLoaded));
+        UpdateEventSubscription();
+    }
+    else
+    {
+        UnloadAllCells();
+        UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+        UnsubscribeFromEvent(E_RESOURCEBACKGROUNDLOADED);
+        requestedResources_.Clear();
+    }
+}
+
+void WorldStreamer::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
+{
+    Update();
+}
+
+void WorldStreamer::HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ResourceBackgroundLoaded;
+
+    const String& name = eventData[P_RESOURCENAME].GetString();
+    StringHash nameHash(name);
+    if (!requestedResources_.Erase(nameHash))
+        return;
+
+    bool success = eventData[P_SUCCESS].GetBool();
+    auto* resource = static_cast<Resource*>(eventData[P_RESOURCE].GetPtr());
+    bool used = false;
+
+    for (HashMap<IntVector2, StreamingCell>::Iterator i = cells_.Begin(); i != cells_.End(); ++i)
+    {
+        StreamingCell& cell = i->second_;
+        if (cell.state_ == CELL_LOADING_FILE && cell.name_ == name)
+        {
+            used = true;
+            if (success && resource && resource->GetType() == ChunkedScene::GetTypeStatic())
+            {
+                cell.content_ = static_cast<ChunkedScene*>(resource);
+                RequestResources(cell);
+            }
+            else
+                cell.state_ = CELL_EMPTY;
+        }
+        else if (cell.state_ == CELL_LOADING_RESOURCES && cell.pendingResources_.Erase(nameHash))
+            used = true;
+    }
+
+    // The requesting cells may have been unloaded in the meanwhile
+    if (!used && success && resource)
+        ReleaseStreamedResource(GetSubsystem<ResourceCache>(), resource->GetType(), name);
+}
+
+void WorldStreamer::UpdateEventSubscription()
+{
+    Scene* scene = GetScene();
+    if (scene && IsEnabledEffective())
+        SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(WorldStreamer, HandleScenePostUpdate));
+    else
+        UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+}
+
+float WorldStreamer::GetCellDistance(const IntVector2& coords) const
+{
+    float minX = coords.x_ * cellSize_;
+    float minZ = coords.y_ * cellSize_;
+    float minDistance = M_INFINITY;
+
+    for (unsigned i = 0; i < foci_.Size(); ++i)
+    {
+        if (!foci_[i])
+            continue;
+
+        Vector3 position = foci_[i]->GetWorldPosition();
+        float dx = Max(Max(minX - position.x_, position.x_ - minX - cellSize_), 0.0f);
+        float dz = Max(Max(minZ - position.z_, position.z_ - minZ - cellSize_), 0.0f);
+        minDistance = Min(minDistance, sqrtf(dx * dx + dz * dz));
+    }
+
+    return minDistance;
+}
+
+void WorldStreamer::RequestCell(const IntVector2& coords)
+{
+    auto* cache = GetSubsystem<ResourceCache>();
+
+    StreamingCell& cell = cells_[coords];
+    cell.coords_ = coords;
+    cell.name_ = cache->SanitateResourceName(GetCellName(coords));
+
+    // Cells without a file have no content, which is not an error
+    if (!cache->Exists(cell.name_))
+    {
+        cell.state_ = CELL_EMPTY;
+        return;
+    }
+
+    StringHash nameHash(cell.name_);
+    auto* content = cache->GetExistingResource<ChunkedScene>(cell.name_);
+    if (!content && !requestedResources_.Contains(nameHash))
+    {
+        if (!cache->BackgroundLoadResource<ChunkedScene>(cell.name_))
+        {
+            cell.state_ = CELL_EMPTY;
+            return;
+        }
+
+        // Without threading support the resource has been loaded synchronously
+        content = cache->GetExistingResource<ChunkedScene>(cell.name_);
+        if (!content)
+            requestedResources_.Insert(nameHash);
+    }
+
+    cell.state_ = CELL_LOADING_FILE;
+    if (content)
+    {
+        cell.content_ = content;
+        RequestResources(cell);
+    }
+}
+
+void WorldStreamer::RequestResources(StreamingCell& cell)
+{
+    auto* cache = GetSubsystem<ResourceCache>();
+
+    cell.state_ = CELL_LOADING_RESOURCES;
+    cell.pendingResources_.Clear();
+
+    const Vector<ResourceRef>& resources = cell.content_->GetResources();
+    for (unsigned i = 0; i < resources.Size(); ++i)
+    {
+        const ResourceRef& ref = resources[i];
+        // Skip types that are not registered, for example from disabled subsystems
+        if (context_->GetTypeName(ref.type_).Empty())
+            continue;
+
+        String name = cache->SanitateResourceName(ref.name_);
+        StringHash nameHash(name);
+        if (requestedResources_.Contains(nameHash))
+        {
+            cell.pendingResources_.Insert(nameHash);
+            continue;
+        }
+        if (cache->GetExistingResource(ref.type_, name))
+            continue;
+
+        if (cache->BackgroundLoadResource(ref.type_, name) && !cache->GetExistingResource(ref.type_, name))
+        {
+            requestedResources_.Insert(nameHash);
+            cell.pendingResources_.Insert(nameHash);
+        }
+    }
+}
+
+void WorldStreamer::BeginInstantiate(StreamingCell& cell)
+{
+    Scene* scene = GetScene();
+
+    // Cell content is created locally and is not saved with the scene
+    Node* node = scene->CreateChild(GetFileName(cell.name_), LOCAL);
+    node->SetTemporary(true);
+    cell.node_ = node;
+
+    cell.content_->ClearRegion();
+    if (cell.content_->BeginInstantiate(node, false, true, LOCAL))
+        cell.state_ = CELL_INSTANTIATING;
+    else
+    {
+        node->Remove();
+        cell.node_.Reset();
+        cell.state_ = CELL_EMPTY;
+    }
+}
+
+void WorldStreamer::UnloadCell(StreamingCell& cell)
+{
+    if (cell.state_ == CELL_INSTANTIATING)
+        cell.content_->FinishInstantiate();
+    else if (cell.state_ == CELL_LOADED)
+        SendCellEvent(E_STREAMINGCELLUNLOADED, cell);
+
+    if (cell.node_)
+        cell.node_->Remove();
+    cell.node_.Reset();
+
+    if (cell.content_)
+    {
+        auto* cache = GetSubsystem<ResourceCache>();
+        Vector<ResourceRef> resources = cell.content_->GetResources();
+        cell.content_.Reset();
+
+        ReleaseStreamedResource(cache, ChunkedScene::GetTypeStatic(), cell.name_);
+        for (unsigned i = 0; i < resources.Size(); ++i)
+            ReleaseStreamedResource(cache, resources[i].type_, cache->SanitateResourceName(resources[i].name_));
+    }
+
+    cell.pendingResources_.Clear();
+    cell.state_ = CELL_EMPTY;
+}
+
+void WorldStreamer::SendCellEvent(StringHash eventType, StreamingCell& cell)
+{
+    using namespace StreamingCellLoaded;
+
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_STREAMER] = this;
+    eventData[P_CELL] = cell.coords_;
+    eventData[P_NODE] = cell.node_.Get();
+    SendEvent(eventType, eventData);
+}
+
+}
@@ -0,0 +1,173 @@
+//
+// Copyright (c) 2008-2018 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashSet.h"
+#include "../Math/Vector2.h"
+#include "../Scene/Component.h"
+
+namespace Urho3D
+{
+
+class ChunkedScene;
+
+/// World streaming cell state.
+enum StreamingCellState
+{
+    CELL_LOADING_FILE = 0,
+    CELL_LOADING_RESOURCES,
+    CELL_INSTANTIATING,
+    CELL_LOADED,
+    CELL_EMPTY
+};
+
+/// World streaming cell.
+struct StreamingCell
+{
+    /// Cell coordinates.
+    IntVector2 coords_;
+    /// Cell file resource name.
+    String name_;
+    /// Loading state.
+    StreamingCellState state_{CELL_LOADING_FILE};
+    /// Cell content.
+    SharedPtr<ChunkedScene> content_;
+    /// Name hashes of resources still being background loaded.
+    HashSet<StringHash> pendingResources_;
+    /// Node holding the instantiated content.
+    WeakPtr<Node> node_;
+};
+
+/// %Scene component that partitions the world into cells on the XZ plane and streams cell content around focus nodes. Cells are chunked scene files, which are background loaded together with their resources, instantiated within a per-frame time budget, and removed along with their resource references when they fall out of range.
+class URHO3D_API WorldStreamer : public Component
+{
+    URHO3D_OBJECT(WorldStreamer, Component);
+
+public:
+    /// Construct.
+    explicit WorldStreamer(Context* context);
+    /// Destruct.
+    ~WorldStreamer() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Handle enabled/disabled state change.
+    void OnSetEnabled() override;
+
+    /// Set cell size in world units.
+    void SetCellSize(float size);
+    /// Set distance from a focus within which cells are loaded.
+    void SetLoadDistance(float distance);
+    /// Set distance from all foci beyond which cells are unloaded. Clamped to at least the load distance.
+    void SetUnloadDistance(float distance);
+    /// Set cell file name format. {x} and {z} are replaced with the cell coordinates.
+    void SetCellNameFormat(const String& format);
+    /// Set time budget in milliseconds for instantiating cell content per frame.
+    void SetTimeBudget(float milliseconds);
+    /// Set maximum number of cell files loading at the same time.
+    void SetMaxConcurrentLoads(unsigned count);
+    /// Add a focus node.
+    void AddFocus(Node* node);
+    /// Remove a focus node.
+    void RemoveFocus(Node* node);
+    /// Remove all focus nodes.
+    void RemoveAllFoci();
+    /// Update cell loading and unloading. Called automatically after each scene update when enabled.
+    void Update();
+    /// Unload all cells.
+    void UnloadAllCells();
+    /// Save the child nodes of a source node into cell files in a directory, grouped by their world position. The source must have identity world transform, as cell content is instantiated at the scene origin. Return true if successful.
+    bool SaveCells(Node* source, const String& directory) const;
+
+    /// Return cell size.
+    float GetCellSize() const { return cellSize_; }
+    /// Return load distance.
+    float GetLoadDistance() const { return loadDistance_; }
+    /// Return unload distance.
+    float GetUnloadDistance() const { return unloadDistance_; }
+    /// Return cell file name format.
+    const String& GetCellNameFormat() const { return cellNameFormat_; }
+    /// Return time budget in milliseconds.
+    float GetTimeBudget() const { return timeBudget_; }
+    /// Return maximum number of concurrently loading cell files.
+    unsigned GetMaxConcurrentLoads() const { return maxConcurrentLoads_; }
+    /// Return number of focus nodes.
+    unsigned GetNumFoci() const { return foci_.Size(); }
+    /// Return cell coordinates of a world position.
+    IntVector2 GetCellCoords(const Vector3& position) const;
+    /// Return cell file name.
+    String GetCellName(const IntVector2& coords) const;
+    /// Return number of fully loaded cells, including empty ones.
+    unsigned GetNumLoadedCells() const;
+    /// Return whether a cell is fully loaded.
+    bool IsCellLoaded(const IntVector2& coords) const;
+    /// Return the node holding a cell's content, or null if not loaded.
+    Node* GetCellNode(const IntVector2& coords) const;
+    /// Return all tracked cells.
+    const HashMap<IntVector2, StreamingCell>& GetCells() const { return cells_; }
+
+protected:
+    /// Handle scene being assigned.
+    void OnSceneSet(Scene* scene) override;
+
+private:
+    /// Handle scene post-update event.
+    void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle resource background loaded event.
+    void HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData);
+    /// Update the scene post-update event subscription.
+    void UpdateEventSubscription();
+    /// Return XZ distance from the nearest focus to a cell's rectangle.
+    float GetCellDistance(const IntVector2& coords) const;
+    /// Start loading a cell.
+    void RequestCell(const IntVector2& coords);
+    /// Begin loading the resources of a cell whose file has been loaded.
+    void RequestResources(StreamingCell& cell);
+    /// Create the cell node and begin instantiating the cell's content.
+    void BeginInstantiate(StreamingCell& cell);
+    /// Remove a cell's content and release its resources.
+    void UnloadCell(StreamingCell& cell);
+    /// Send a cell loaded or unloaded event.
+    void SendCellEvent(StringHash eventType, StreamingCell& cell);
+
+    /// Cells by coordinates.
+    HashMap<IntVector2, StreamingCell> cells_;
+    /// Focus nodes.
+    Vector<WeakPtr<Node> > foci_;
+    /// Name hashes of resources requested for background loading and not yet finished.
+    HashSet<StringHash> requestedResources_;
+    /// Cell file name format.
+    String cellNameFormat_;
+    /// Cell size.
+    float cellSize_;
+    /// Load distance.
+    float loadDistance_;
+    /// Unload distance.
+    float unloadDistance_;
+    /// Instantiation time budget in milliseconds.
+    float timeBudget_;
+    /// Maximum number of concurrently loading cell files.
+    unsigned maxConcurrentLoads_;
+};
+
+}
@@ -306,6 +306,8 @@ SharedPtr<Material> Renderer2D::CreateMaterial(Texture2D* texture, BlendMode ble
 void CheckDrawableVisibilityWork(const WorkItem* item, unsigned threadIndex)
 {
     auto* renderer = reinterpret_cast<Renderer2D*>(item->aux_);
+    URHO3D_PROFILE_OBJECT(CheckDrawableVisibilityWork, renderer);
+
     auto** start = reinterpret_cast<Drawable2D**>(item->start_);
     auto** end = reinterpret_cast<Drawable2D**>(item->end_);
 